@@ -0,0 +1,74 @@
+#include <juce_core/juce_core.h>
+
+#include <iostream>
+
+#include "benchmark.h"
+
+namespace {
+// The engine logs state changes (recording start, commit); at benchmark
+// rates that would measure the console instead of the engine.
+class SilentLogger : public juce::Logger {
+  void logMessage(const juce::String &) override {}
+};
+
+void printUsage() {
+  std::cout
+      << "Usage: CelestrianBench [options]\n"
+         "  --filter <text>       Only run cases whose key contains <text>\n"
+         "  --out <file>          Write results as JSON\n"
+         "  --baseline <file>     Compare against a previous --out file\n"
+         "  --threshold <pct>     Regression threshold (default 10)\n"
+         "  --quick               Fewer, shorter samples (smoke runs)\n";
+}
+}  // namespace
+
+/**
+ * Runs every registered benchmark, optionally saving the results and
+ * failing (exit code 1) on regressions against a baseline.
+ */
+int main(int argc, char *argv[]) {
+  juce::ArgumentList args(argc, argv);
+  if (args.containsOption("--help|-h")) {
+    printUsage();
+    return 0;
+  }
+
+  celestrian::bench::Runner::Options options;
+  options.filter = args.getValueForOption("--filter");
+  if (args.containsOption("--quick")) {
+    options.num_samples = 5;
+    options.min_sample_ms = 2.0;
+  }
+
+  SilentLogger silent_logger;
+  juce::Logger::setCurrentLogger(&silent_logger);
+
+  celestrian::bench::Runner runner(options);
+  runner.runAll();
+  juce::Logger::setCurrentLogger(nullptr);
+
+  auto out = args.getValueForOption("--out");
+  if (out.isNotEmpty()) {
+    auto file = juce::File::getCurrentWorkingDirectory().getChildFile(out);
+    if (!celestrian::bench::writeResults(runner.getResults(), file)) {
+      std::cout << "Cannot write " << file.getFullPathName() << std::endl;
+      return 1;
+    }
+    std::cout << "\nResults written to " << file.getFullPathName()
+              << std::endl;
+  }
+
+  auto baseline = args.getValueForOption("--baseline");
+  if (baseline.isNotEmpty()) {
+    auto threshold = args.getValueForOption("--threshold");
+    int regressions = celestrian::bench::compareWithBaseline(
+        runner.getResults(),
+        juce::File::getCurrentWorkingDirectory().getChildFile(baseline),
+        threshold.isNotEmpty() ? threshold.getDoubleValue() : 10.0);
+    if (regressions > 0) {
+      std::cout << "\n" << regressions << " regression(s)" << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
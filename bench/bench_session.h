@@ -0,0 +1,81 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "../src/audio_engine.h"
+#include "../src/clip_node.h"
+#include "../src/offline_device_backend.h"
+
+namespace celestrian::bench {
+
+constexpr double kSampleRate = 44100.0;
+constexpr int kRecordBlockSize = 512;
+
+/**
+ * Records `length` samples of a 220 Hz sine into `clip` and commits it. A
+ * clip without a parent has no quantum, so the commit is immediate.
+ */
+inline void recordInto(ClipNode &clip, int64_t length) {
+  std::vector<float> input(kRecordBlockSize);
+  const float *inputs[] = {input.data()};
+
+  clip.startRecording();
+  ProcessContext context;
+  context.is_recording = true;
+  for (int64_t done = 0; done < length;) {
+    int n = (int)std::min<int64_t>(kRecordBlockSize, length - done);
+    for (int i = 0; i < n; ++i)
+      input[i] = 0.5f * (float)std::sin(0.0313 * (double)(done + i));
+    context.num_samples = n;
+    context.master_pos = done;
+    clip.process(inputs, nullptr, 1, 0, context);
+    done += n;
+  }
+  clip.stopRecording();
+}
+
+/**
+ * Returns a committed clip of `length` samples whose buffer is sized to the
+ * clip rather than the default 60 s, so large sessions fit in memory.
+ */
+inline std::unique_ptr<ClipNode> makeClip(int64_t length) {
+  // ClipNode allocates source_sample_rate * 60 samples
+  auto clip = std::make_unique<ClipNode>(
+      "Bench Clip", std::ceil((double)length / 60.0) + 1.0);
+  recordInto(*clip, length);
+  return clip;
+}
+
+/**
+ * Records a clip in the engine's focused box through its offline backend
+ * and renders until the clip has committed (it may wait for a quantum
+ * boundary).
+ */
+inline void recordInEngine(AudioEngine &engine, int64_t length) {
+  auto &backend =
+      static_cast<OfflineDeviceBackend &>(engine.getDeviceBackend());
+  backend.setInputSignal(OfflineDeviceBackend::sine(220.0, 0.5f, kSampleRate));
+
+  engine.createNode("clip");
+  auto state = engine.getGraphState();
+  auto uuid = state["nodes"].getArray()->getLast()["id"].toString();
+
+  engine.startRecordingInNode(uuid);
+  backend.renderSamples(length);
+  engine.stopRecordingInNode(uuid);
+
+  auto isRecording = [&] {
+    auto current = engine.getGraphState();
+    for (const auto &node : *current["nodes"].getArray())
+      if (node["id"].toString() == uuid) return (bool)node["isRecording"];
+    return false;
+  };
+  for (int guard = 0; isRecording() && guard < 10000; ++guard)
+    backend.renderBlocks(1);
+}
+
+}  // namespace celestrian::bench
@@ -0,0 +1,199 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <vector>
+
+namespace celestrian::bench {
+
+namespace {
+constexpr int kWarmupIterations = 3;
+
+double nowNs() {
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+double timeBatch(const std::function<void()> &body, int64_t iterations) {
+  const double start = nowNs();
+  for (int64_t i = 0; i < iterations; ++i) body();
+  return nowNs() - start;
+}
+
+juce::String formatNs(double ns) {
+  if (ns >= 1.0e6) return juce::String(ns / 1.0e6, 2) + " ms";
+  if (ns >= 1.0e3) return juce::String(ns / 1.0e3, 2) + " us";
+  return juce::String(ns, 1) + " ns";
+}
+}  // namespace
+
+// --- Result ---
+
+juce::String Result::getKey() const {
+  juce::String key = name;
+  for (int i = 0; i < params.size(); ++i)
+    key << "/" << params.getAllKeys()[i] << "=" << params.getAllValues()[i];
+  return key;
+}
+
+double Result::getRealtimeFactor() const {
+  if (frames_per_iteration <= 0 || median_ns <= 0.0) return 0.0;
+  const double audio_ns = (double)frames_per_iteration / sample_rate * 1.0e9;
+  return audio_ns / median_ns;
+}
+
+juce::var Result::toVar() const {
+  auto *param_obj = new juce::DynamicObject();
+  for (int i = 0; i < params.size(); ++i)
+    param_obj->setProperty(params.getAllKeys()[i], params.getAllValues()[i]);
+
+  auto *obj = new juce::DynamicObject();
+  obj->setProperty("key", getKey());
+  obj->setProperty("name", name);
+  obj->setProperty("params", juce::var(param_obj));
+  obj->setProperty("medianNs", median_ns);
+  obj->setProperty("minNs", min_ns);
+  obj->setProperty("meanNs", mean_ns);
+  obj->setProperty("iterationsPerSample", (double)iterations_per_sample);
+  obj->setProperty("samples", num_samples);
+  if (frames_per_iteration > 0)
+    obj->setProperty("realtimeFactor", getRealtimeFactor());
+  return juce::var(obj);
+}
+
+// --- Benchmark ---
+
+Benchmark::Benchmark(const juce::String &name) : name(name) {
+  getAllBenchmarks().add(this);
+}
+
+Benchmark::~Benchmark() { getAllBenchmarks().removeFirstMatchingValue(this); }
+
+juce::Array<Benchmark *> &Benchmark::getAllBenchmarks() {
+  static juce::Array<Benchmark *> benchmarks;
+  return benchmarks;
+}
+
+// --- Runner ---
+
+bool Runner::isSelected(const juce::String &name,
+                        const juce::StringPairArray &params) const {
+  if (options.filter.isEmpty()) return true;
+  Result probe;
+  probe.name = name;
+  probe.params = params;
+  return probe.getKey().contains(options.filter);
+}
+
+void Runner::measure(const juce::String &name,
+                     const juce::StringPairArray &params,
+                     const std::function<void()> &body,
+                     int64_t frames_per_iteration) {
+  if (!isSelected(name, params)) return;
+
+  Result result;
+  result.name = name;
+  result.params = params;
+  result.frames_per_iteration = frames_per_iteration;
+
+  timeBatch(body, kWarmupIterations);
+
+  // Grow the batch until one takes min_sample_ms
+  const double min_sample_ns = options.min_sample_ms * 1.0e6;
+  int64_t iterations = 1;
+  double elapsed = timeBatch(body, iterations);
+  while (elapsed < min_sample_ns && iterations < (int64_t)1 << 30) {
+    iterations = elapsed > 0.0
+                     ? std::max(iterations * 2,
+                                (int64_t)(iterations * min_sample_ns /
+                                          elapsed * 1.2))
+                     : iterations * 10;
+    elapsed = timeBatch(body, iterations);
+  }
+
+  std::vector<double> per_iteration;
+  for (int s = 0; s < options.num_samples; ++s)
+    per_iteration.push_back(timeBatch(body, iterations) / (double)iterations);
+  std::sort(per_iteration.begin(), per_iteration.end());
+
+  result.iterations_per_sample = iterations;
+  result.num_samples = (int)per_iteration.size();
+  result.median_ns = per_iteration[per_iteration.size() / 2];
+  result.min_ns = per_iteration.front();
+  double total = 0.0;
+  for (auto ns : per_iteration) total += ns;
+  result.mean_ns = total / (double)per_iteration.size();
+
+  juce::String line = result.getKey().paddedRight(' ', 60) +
+                      formatNs(result.median_ns).paddedLeft(' ', 12);
+  if (frames_per_iteration > 0)
+    line << "  " << juce::String(result.getRealtimeFactor(), 1) << "x realtime";
+  std::cout << line << std::endl;
+
+  results.add(result);
+}
+
+void Runner::runAll() {
+  for (auto *benchmark : Benchmark::getAllBenchmarks()) benchmark->run(*this);
+}
+
+// --- Output ---
+
+bool writeResults(const juce::Array<Result> &results, const juce::File &file) {
+  juce::Array<juce::var> list;
+  for (const auto &result : results) list.add(result.toVar());
+
+  auto *root = new juce::DynamicObject();
+  root->setProperty("version", 1);
+  root->setProperty("benchmarks", list);
+  return file.replaceWithText(juce::JSON::toString(juce::var(root)));
+}
+
+int compareWithBaseline(const juce::Array<Result> &results,
+                        const juce::File &baseline, double threshold_percent) {
+  auto parsed = juce::JSON::parse(baseline.loadFileAsString());
+  auto *list = parsed["benchmarks"].getArray();
+  if (list == nullptr) {
+    std::cout << "Cannot read baseline " << baseline.getFullPathName()
+              << std::endl;
+    return 0;
+  }
+
+  std::map<juce::String, double> baseline_ns;
+  for (const auto &entry : *list)
+    baseline_ns[entry["key"].toString()] = (double)entry["medianNs"];
+
+  int regressions = 0;
+  std::cout << "\nComparison with " << baseline.getFileName()
+            << " (threshold " << threshold_percent << "%)" << std::endl;
+  for (const auto &result : results) {
+    auto it = baseline_ns.find(result.getKey());
+    if (it == baseline_ns.end() || it->second <= 0.0) {
+      std::cout << result.getKey().paddedRight(' ', 60) << "  (new)"
+                << std::endl;
+      continue;
+    }
+
+    const double change = (result.median_ns / it->second - 1.0) * 100.0;
+    const bool regressed = change > threshold_percent;
+    if (regressed) ++regressions;
+    std::cout << result.getKey().paddedRight(' ', 60)
+              << formatNs(it->second).paddedLeft(' ', 12) << " -> "
+              << formatNs(result.median_ns).paddedLeft(' ', 12) << "  "
+              << (change >= 0.0 ? "+" : "") << juce::String(change, 1) << "%"
+              << (regressed ? "  REGRESSION" : "") << std::endl;
+  }
+  return regressions;
+}
+
+juce::StringPairArray params(
+    std::initializer_list<std::pair<const char *, juce::var>> values) {
+  juce::StringPairArray result;
+  for (const auto &[key, value] : values) result.set(key, value.toString());
+  return result;
+}
+
+}  // namespace celestrian::bench
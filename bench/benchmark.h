@@ -0,0 +1,117 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <functional>
+
+namespace celestrian::bench {
+
+/**
+ * Timing of one benchmark case (a benchmark with one set of parameters).
+ */
+struct Result {
+  juce::String name;
+  juce::StringPairArray params;
+  int64_t iterations_per_sample = 0;
+  int num_samples = 0;
+  double median_ns = 0.0;  // Per iteration; the figure baselines compare
+  double min_ns = 0.0;
+  double mean_ns = 0.0;
+  // Audio frames processed per iteration, for a realtime factor (0 = n/a)
+  int64_t frames_per_iteration = 0;
+  double sample_rate = 44100.0;
+
+  /** "name/key=value/..." identifies the case across runs. */
+  juce::String getKey() const;
+
+  /** How many times faster than realtime the case ran (0 if n/a). */
+  double getRealtimeFactor() const;
+
+  juce::var toVar() const;
+};
+
+class Runner;
+
+/**
+ * Base class for benchmarks. Like juce::UnitTest, declare a static instance
+ * of each subclass and the runner finds it.
+ */
+class Benchmark {
+ public:
+  explicit Benchmark(const juce::String &name);
+  virtual ~Benchmark();
+
+  const juce::String &getName() const { return name; }
+
+  /** Calls runner.measure() once per parameter combination. */
+  virtual void run(Runner &runner) = 0;
+
+  static juce::Array<Benchmark *> &getAllBenchmarks();
+
+ private:
+  const juce::String name;
+
+  JUCE_DECLARE_NON_COPYABLE(Benchmark)
+};
+
+/**
+ * Times benchmark bodies and collects results.
+ *
+ * Each case is warmed up, then run in batches sized to take at least
+ * `min_sample_ms`; the median batch is reported per iteration, which keeps
+ * one descheduled batch from skewing the figure.
+ */
+class Runner {
+ public:
+  struct Options {
+    juce::String filter;  // Only run cases whose key contains this
+    int num_samples = 15;
+    double min_sample_ms = 10.0;
+  };
+
+  explicit Runner(Options options) : options(std::move(options)) {}
+
+  /**
+   * Times `body`. Anything the body needs must be set up beforehand: only
+   * the calls to `body` are timed.
+   * @param frames_per_iteration Audio frames one call renders, if any.
+   */
+  void measure(const juce::String &name, const juce::StringPairArray &params,
+               const std::function<void()> &body,
+               int64_t frames_per_iteration = 0);
+
+  /** Returns true if the case would run under the current filter. */
+  bool isSelected(const juce::String &name,
+                  const juce::StringPairArray &params) const;
+
+  const juce::Array<Result> &getResults() const { return results; }
+
+  /** Runs every registered benchmark. */
+  void runAll();
+
+ private:
+  Options options;
+  juce::Array<Result> results;
+};
+
+/**
+ * Writes results as `{ "version": 1, "benchmarks": [...] }`.
+ */
+bool writeResults(const juce::Array<Result> &results, const juce::File &file);
+
+/**
+ * Compares results against a baseline written by writeResults() and prints
+ * a table. A case regresses when its median is more than `threshold_percent`
+ * slower than the baseline's.
+ * @return The number of regressions.
+ */
+int compareWithBaseline(const juce::Array<Result> &results,
+                        const juce::File &baseline, double threshold_percent);
+
+/**
+ * Shorthand for building parameter lists: params({{"block", 256}}).
+ */
+juce::StringPairArray params(
+    std::initializer_list<std::pair<const char *, juce::var>> values);
+
+}  // namespace celestrian::bench
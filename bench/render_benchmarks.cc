@@ -0,0 +1,124 @@
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include "../src/box_node.h"
+#include "bench_session.h"
+#include "benchmark.h"
+
+namespace celestrian::bench {
+
+namespace {
+// Renders one block of `node` into a stereo scratch buffer, advancing the
+// transport like the engine does.
+struct BlockRenderer {
+  explicit BlockRenderer(int block_size) : output(2, block_size) {
+    context.num_samples = block_size;
+    context.is_playing = true;
+    context.is_recording = true;
+  }
+
+  void render(AudioNode &node) {
+    output.clear();
+    node.process(nullptr, output.getArrayOfWritePointers(), 0, 2, context);
+    context.master_pos += context.num_samples;
+  }
+
+  juce::AudioBuffer<float> output;
+  ProcessContext context;
+};
+}  // namespace
+
+/**
+ * ClipNode playback across block sizes and clip lengths.
+ */
+class ClipPlaybackBenchmark : public Benchmark {
+ public:
+  ClipPlaybackBenchmark() : Benchmark("ClipNode::process") {}
+
+  void run(Runner &runner) override {
+    for (int length_s : {1, 10, 60}) {
+      for (int block : {64, 256, 1024}) {
+        auto case_params = params({{"length_s", length_s}, {"block", block}});
+        if (!runner.isSelected(getName(), case_params)) continue;
+
+        auto clip = makeClip((int64_t)(length_s * kSampleRate));
+        BlockRenderer renderer(block);
+        runner.measure(
+            getName(), case_params, [&] { renderer.render(*clip); }, block);
+      }
+    }
+  }
+};
+
+/**
+ * BoxNode mixing across fan-out (clips in one box) and nesting depth (a
+ * chain of boxes above four clips).
+ */
+class BoxMixBenchmark : public Benchmark {
+ public:
+  BoxMixBenchmark() : Benchmark("BoxNode::process") {}
+
+  void run(Runner &runner) override {
+    const int block = 256;
+
+    for (int fan_out : {1, 8, 32, 128}) {
+      auto case_params =
+          params({{"fan_out", fan_out}, {"depth", 1}, {"block", block}});
+      if (!runner.isSelected(getName(), case_params)) continue;
+
+      BoxNode box("Bench Box");
+      for (int i = 0; i < fan_out; ++i)
+        box.addChild(makeClip((int64_t)kSampleRate));
+      BlockRenderer renderer(block);
+      runner.measure(
+          getName(), case_params, [&] { renderer.render(box); }, block);
+    }
+
+    for (int depth : {4, 16}) {
+      auto case_params =
+          params({{"fan_out", 4}, {"depth", depth}, {"block", block}});
+      if (!runner.isSelected(getName(), case_params)) continue;
+
+      auto root = std::make_unique<BoxNode>("Bench Root");
+      BoxNode *innermost = root.get();
+      for (int level = 1; level < depth; ++level) {
+        auto child = std::make_unique<BoxNode>("Bench Box");
+        auto *next = child.get();
+        innermost->addChild(std::move(child));
+        innermost = next;
+      }
+      for (int i = 0; i < 4; ++i)
+        innermost->addChild(makeClip((int64_t)kSampleRate));
+
+      BlockRenderer renderer(block);
+      runner.measure(
+          getName(), case_params, [&] { renderer.render(*root); }, block);
+    }
+  }
+};
+
+/**
+ * A full take: start, capture block by block, stop and commit.
+ */
+class RecordCommitBenchmark : public Benchmark {
+ public:
+  RecordCommitBenchmark() : Benchmark("ClipNode::record+commit") {}
+
+  void run(Runner &runner) override {
+    for (int length_s : {1, 10}) {
+      auto case_params =
+          params({{"length_s", length_s}, {"block", kRecordBlockSize}});
+      if (!runner.isSelected(getName(), case_params)) continue;
+
+      const auto length = (int64_t)(length_s * kSampleRate);
+      ClipNode clip("Bench Clip", kSampleRate);
+      runner.measure(
+          getName(), case_params, [&] { recordInto(clip, length); }, length);
+    }
+  }
+};
+
+static ClipPlaybackBenchmark clipPlaybackBenchmark;
+static BoxMixBenchmark boxMixBenchmark;
+static RecordCommitBenchmark recordCommitBenchmark;
+
+}  // namespace celestrian::bench
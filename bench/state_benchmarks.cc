@@ -0,0 +1,95 @@
+#include "../src/box_node.h"
+#include "bench_session.h"
+#include "benchmark.h"
+
+namespace celestrian::bench {
+
+/**
+ * Full graph-state serialization across session sizes: four clips plus a
+ * growing number of boxes in the focused box.
+ */
+class GraphStateBenchmark : public Benchmark {
+ public:
+  GraphStateBenchmark() : Benchmark("AudioEngine::getGraphState") {}
+
+  void run(Runner &runner) override {
+    for (int boxes : {0, 60, 250, 1000}) {
+      auto case_params = params({{"nodes", 4 + boxes}});
+      if (!runner.isSelected(getName(), case_params)) continue;
+
+      AudioEngine engine;
+      for (int i = 0; i < 4; ++i) engine.createNode("clip");
+      for (int i = 0; i < boxes; ++i) engine.createNode("box");
+
+      runner.measure(getName(), case_params,
+                     [&] { juce::ignoreUnused(engine.getGraphState()); });
+    }
+  }
+};
+
+/**
+ * Waveform peaks for one clip across lengths, and for a box aggregating
+ * many clips.
+ */
+class WaveformBenchmark : public Benchmark {
+ public:
+  WaveformBenchmark() : Benchmark("getWaveform") {}
+
+  void run(Runner &runner) override {
+    const int num_peaks = 512;
+
+    for (int length_s : {1, 10, 60}) {
+      auto case_params =
+          params({{"clips", 1}, {"length_s", length_s}, {"peaks", num_peaks}});
+      if (!runner.isSelected(getName(), case_params)) continue;
+
+      auto clip = makeClip((int64_t)(length_s * kSampleRate));
+      runner.measure(getName(), case_params, [&] {
+        juce::ignoreUnused(clip->getWaveform(num_peaks));
+      });
+    }
+
+    for (int clips : {8, 32}) {
+      auto case_params =
+          params({{"clips", clips}, {"length_s", 10}, {"peaks", num_peaks}});
+      if (!runner.isSelected(getName(), case_params)) continue;
+
+      BoxNode box("Bench Box");
+      for (int i = 0; i < clips; ++i)
+        box.addChild(makeClip((int64_t)(10 * kSampleRate)));
+      runner.measure(getName(), case_params, [&] {
+        juce::ignoreUnused(box.getWaveform(num_peaks));
+      });
+    }
+  }
+};
+
+/**
+ * The per-block LCM timeline computation, across recorded clip counts.
+ */
+class TimelineLengthBenchmark : public Benchmark {
+ public:
+  TimelineLengthBenchmark()
+      : Benchmark("AudioEngine::calculateTimelineLength") {}
+
+  void run(Runner &runner) override {
+    for (int clips : {1, 4, 16}) {
+      auto case_params = params({{"clips", clips}});
+      if (!runner.isSelected(getName(), case_params)) continue;
+
+      AudioEngine engine;
+      for (int i = 0; i < clips; ++i)
+        recordInEngine(engine, (int64_t)(kSampleRate * (1 + i % 3)));
+
+      runner.measure(getName(), case_params, [&] {
+        juce::ignoreUnused(engine.calculateTimelineLength());
+      });
+    }
+  }
+};
+
+static GraphStateBenchmark graphStateBenchmark;
+static WaveformBenchmark waveformBenchmark;
+static TimelineLengthBenchmark timelineLengthBenchmark;
+
+}  // namespace celestrian::bench
@@ -2,33 +2,102 @@
 
 #include <juce_audio_basics/juce_audio_basics.h>
 
+#include <algorithm>
+
 #include "box_node.h"
 #include "clip_node.h"
+#include "offline_device_backend.h"
+#include "realtime_checks.h"
 
-AudioEngine::AudioEngine() {
-  init(1, 2);
+AudioEngine::AudioEngine()
+    : AudioEngine(std::make_unique<celestrian::OfflineDeviceBackend>()) {}
 
+AudioEngine::AudioEngine(std::unique_ptr<celestrian::DeviceBackend> backend)
+    : device_backend(std::move(backend)) {
   // Start with an empty root box
   root_node = std::make_unique<celestrian::BoxNode>("SessionRoot");
-  focused_node = root_node.get();
+  root_node->setReclaimer(&node_reclaimer);
+  render_ahead_pool.setReclaimer(&node_reclaimer);
+  focused_node.store(root_node.get());
+
+  // Only once the graph exists: the callback may start straight away
+  device_backend->open(*this);
 }
 
-AudioEngine::~AudioEngine() { device_manager.removeAudioCallback(this); }
+AudioEngine::~AudioEngine() {
+  device_backend->close();
+  stopCapture();
+  // The pool outlives the reclaimer
+  render_ahead_pool.setReclaimer(nullptr);
+}
 
-void AudioEngine::init(int inputs, int outputs) {
-  // Try for 8 inputs, but default to whatever the hardware provides
-  device_manager.initialiseWithDefaultDevices(8, outputs);
-  auto *device = device_manager.getCurrentAudioDevice();
-  if (device) {
-    juce::Logger::writeToLog(
-        "AudioEngine: Initialized with " +
-        juce::String(device->getActiveInputChannels().countNumberOfSetBits()) +
-        " input channels.");
-  } else {
-    juce::Logger::writeToLog(
-        "AudioEngine: FAILED to get current audio device.");
+class AudioEngine::CommandFence {
+ public:
+  CommandFence(AudioEngine &engine, celestrian::CaptureCommandType type,
+               const juce::String &uuid = {})
+      : engine(engine) {
+    if (engine.active_capture.load() == nullptr) return;
+    lock = std::unique_lock<std::mutex>(engine.capture_fence);
+    auto *capture = engine.active_capture.load();
+    if (capture == nullptr) {
+      lock.unlock();
+      return;
+    }
+    command.type = type;
+    command.uuid = uuid;
+    command.block = capture->getNextBlock();
+    command.master_pos = engine.global_transport_pos.load();
+  }
+
+  ~CommandFence() { release(); }
+
+  // Logs the command and lets blocks run again
+  void release() {
+    if (!lock.owns_lock()) return;
+    engine.active_capture.load()->addCommand(command);
+    lock.unlock();
+  }
+
+  // Filled in by commands whose arguments the constructor doesn't take
+  celestrian::CapturedCommand command;
+
+ private:
+  AudioEngine &engine;
+  std::unique_lock<std::mutex> lock;
+};
+
+void AudioEngine::setRootNode(
+    std::unique_ptr<celestrian::AudioNode> new_root) {
+  // A capture replays from the session it started on
+  if (isCapturing()) {
+    juce::Logger::writeToLog("AudioEngine: Root replaced, stopping capture.");
+    stopCapture();
   }
-  device_manager.addAudioCallback(this);
+
+  // Queries walking the old graph finish before it goes
+  cancelGraphQueryJobs();
+
+  std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
+  device_backend->close();
+
+  // Commands and events for the old graph's nodes
+  {
+    std::lock_guard<std::mutex> drain_lock(command_drain_mutex);
+    applyPendingCommands();
+  }
+  transport_scheduler.clear();
+  soloed_node.store(nullptr);
+  render_generation.fetch_add(1);
+  cancelPeakJobs();
+  node_reclaimer.retire(std::move(root_node));
+  root_node = std::move(new_root);
+  root_node->setParent(nullptr);
+  root_node->setReclaimer(&node_reclaimer);
+  focused_node.store(root_node.get());
+  navigation_stack.clear();
+
+  device_backend->open(*this);
+  checkMemoryBudget();
 }
 
 celestrian::AudioNode *AudioEngine::findNodeByUuid(celestrian::AudioNode *node,
@@ -40,108 +109,603 @@ celestrian::AudioNode *AudioEngine::findNodeByUuid(celestrian::AudioNode *node,
   return nullptr;
 }
 
-void AudioEngine::startRecordingInNode(const juce::String &uuid) {
-  juce::Logger::writeToLog("AudioEngine: start_recording requested for " +
-                           uuid);
+celestrian::ClipNode *AudioEngine::findClipByUuid(const juce::String &uuid) {
+  return dynamic_cast<celestrian::ClipNode *>(
+      findNodeByUuid(root_node.get(), uuid));
+}
 
-  // If the whole song is stopped when clicking record, automatically play
-  if (!is_playing_global.load()) {
-    is_playing_global.store(true);
-    juce::Logger::writeToLog(
-        "AudioEngine: Auto-starting transport for recording.");
+uint64_t AudioEngine::sendCommand(CommandFence &fence,
+                                  const celestrian::EngineCommand &command,
+                                  std::function<void()> after_applied) {
+  uint64_t id = 0;
+  {
+    std::lock_guard<std::mutex> send_lock(command_send_mutex);
+    id = command_queue.push(command);
+  }
+  // The callback takes the fence too
+  fence.release();
+  if (id == 0) {
+    juce::Logger::writeToLog("AudioEngine: Command queue full, dropped.");
+    return 0;
   }
 
-  if (auto *clip = dynamic_cast<celestrian::ClipNode *>(
-          findNodeByUuid(root_node.get(), uuid))) {
-    juce::Logger::writeToLog("AudioEngine: Found clip, starting recording.");
+  bool applied = false;
+  {
+    std::lock_guard<std::mutex> drain_lock(command_drain_mutex);
+    if (!device_backend->isRealtime() || !device_running.load()) {
+      // Nothing is rendering, so nothing else is applying
+      applyPendingCommands();
+      applied = true;
+    }
+  }
+  if (after_applied == nullptr) return id;
+  if (applied) {
+    after_applied();
+    return id;
+  }
+
+  // The drain job waits for the acknowledgement; the follow-up runs on the
+  // message thread
+  {
+    std::lock_guard<std::mutex> lock(ack_mutex);
+    pending_acks.push_back({id, std::move(after_applied)});
+    if (ack_drain_scheduled) return id;
+    ack_drain_scheduled = true;
+  }
+  scheduleAckDrain();
+  return id;
+}
+
+void AudioEngine::scheduleAckDrain() {
+  auto anyApplied = [this] {
+    std::lock_guard<std::mutex> lock(ack_mutex);
+    return std::any_of(pending_acks.begin(), pending_acks.end(),
+                       [this](const PendingAck &ack) {
+                         return command_queue.isApplied(ack.id);
+                       });
+  };
+
+  job_system.schedule(
+      [this, anyApplied](JobSystem::JobContext &context) -> juce::var {
+        while (!anyApplied()) {
+          if (context.isCancelled()) return {};
+          {
+            // The device may have stopped since the commands were sent
+            std::lock_guard<std::mutex> drain_lock(command_drain_mutex);
+            if (!device_running.load()) applyPendingCommands();
+          }
+          juce::Thread::sleep(1);
+        }
+        return true;
+      },
+      [this](const juce::var &result) {
+        if (!(bool)result) return;
+        std::vector<std::function<void()>> ready;
+        bool more = false;
+        {
+          std::lock_guard<std::mutex> lock(ack_mutex);
+          auto still_pending = std::stable_partition(
+              pending_acks.begin(), pending_acks.end(),
+              [this](const PendingAck &ack) {
+                return !command_queue.isApplied(ack.id);
+              });
+          for (auto it = still_pending; it != pending_acks.end(); ++it)
+            ready.push_back(std::move(it->follow_up));
+          pending_acks.erase(still_pending, pending_acks.end());
+          more = !pending_acks.empty();
+          ack_drain_scheduled = more;
+        }
+        for (auto &follow_up : ready) follow_up();
+        if (more) scheduleAckDrain();
+      });
+}
+
+void AudioEngine::applyPendingCommands() {
+  command_queue.drain([this](const celestrian::EngineCommand &command) {
+    applyCommand(command);
+  });
+}
+
+void AudioEngine::applyCommand(const celestrian::EngineCommand &command) {
+  using Type = celestrian::EngineCommandType;
+  // Senders only target clips with the clip commands
+  auto *clip = static_cast<celestrian::ClipNode *>(command.target);
+
+  switch (command.type) {
+    case Type::TogglePlayback:
+      is_playing_global.store(!is_playing_global.load());
+      if (!is_playing_global.load()) global_transport_pos.store(0);
+      break;
+
+    case Type::StartRecording:
+      // If the whole song is stopped when clicking record, automatically play
+      is_playing_global.store(true);
+
+      // INITIAL RECORDING RESET:
+      // If we are starting a recording and there is NO existing quantum
+      // (i.e., this is the First Clip), we reset the global transport to 0.
+      // This ensures the first clip defines "Time Zero" and has no offset.
+      // The sender looked the quantum up (first != 0: no quantum).
+      if (command.first != 0) global_transport_pos.store(0);
+      // second: the clip's quantum, also looked up by the sender
+      clip->startRecording(command.second);
+      break;
 
-    // INITIAL RECORDING RESET:
-    // If we are starting a recording and there is NO existing quantum
-    // (i.e., this is the First Clip), we reset the global transport to 0.
-    // This ensures the first clip defines "Time Zero" and has no offset.
-    if (root_node->getEffectiveQuantum() == 0) {
-      global_transport_pos.store(0);
+    case Type::StopRecording:
+      // first: the clip's quantum, looked up by the sender. With none the
+      // sender commits the take once this is acknowledged.
+      clip->stopRecording(command.first);
+      break;
+
+    case Type::ToggleSolo:
+      soloed_node.store(soloed_node.load() == command.target ? nullptr
+                                                             : command.target);
+      break;
+
+    case Type::TogglePlay:
+      if (clip->isPlaying())
+        clip->stopPlayback();
+      else
+        clip->startPlayback();
+      break;
+
+    case Type::ToggleMute:
+      command.target->setMuted(!command.target->isMuted());
+      break;
+
+    case Type::SetNodeInput:
+      clip->setInputChannel((int)command.first);
+      break;
+
+    case Type::SetLoopPoints:
+      // Both ends change between the same two blocks
+      command.target->setLoopPoints(command.first, command.second);
+      break;
+
+    case Type::RemoveNode: {
+      // Unlinked by the sender; nothing may point into it once it's retired
+      const auto *removed = command.target;
+      transport_scheduler.removeIf(
+          [removed](const celestrian::TransportEvent &event) {
+            return event.target != nullptr && event.target->isInside(removed);
+          });
+      const auto *soloed = soloed_node.load();
+      if (soloed != nullptr && soloed->isInside(removed))
+        soloed_node.store(nullptr);
+      break;
+    }
+  }
+  // Whatever was rendered ahead assumed the old state
+  render_generation.fetch_add(1);
+}
+
+bool AudioEngine::startCapture(const juce::File &file) {
+  if (isCapturing()) return false;
+  {
+    std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
+    auto *root = dynamic_cast<celestrian::BoxNode *>(root_node.get());
+    if (root == nullptr || root->getNumChildren() > 0 ||
+        is_playing_global.load()) {
       juce::Logger::writeToLog(
-          "AudioEngine: First Clip detected -> Reset Global Transport to 0.");
+          "AudioEngine: Capture needs an empty session with the transport "
+          "stopped.");
+      return false;
     }
+  }
 
-    clip->startRecording();
-  } else {
-    juce::Logger::writeToLog("AudioEngine: CLIP NOT FOUND for " + uuid);
+  celestrian::CaptureHeader header;
+  header.config = device_backend->getConfig();
+  header.root_uuid = root_node->getUuid();
+  header.internal_block_size = internal_block_size.load();
+  auto new_capture = celestrian::SessionCapture::create(file, header);
+  if (new_capture == nullptr) return false;
+
+  {
+    std::lock_guard<std::mutex> lock(capture_fence);
+    capture = std::move(new_capture);
+    active_capture.store(capture.get());
   }
+
+  // A block that started before the capture runs without the fence: let it
+  // finish, so no command can land inside it
+  for (int i = 0; i < 1000 && callback_running.load(); ++i)
+    juce::Thread::sleep(1);
+  return true;
 }
 
-void AudioEngine::stopRecordingInNode(const juce::String &uuid) {
-  juce::Logger::writeToLog("AudioEngine: stop_recording requested for " + uuid);
-  if (auto *clip = dynamic_cast<celestrian::ClipNode *>(
-          findNodeByUuid(root_node.get(), uuid))) {
-    clip->stopRecording();
+juce::var AudioEngine::stopCapture() {
+  std::unique_ptr<celestrian::SessionCapture> finished;
+  {
+    // A block holding the fence finishes first; later blocks see nullptr
+    std::lock_guard<std::mutex> lock(capture_fence);
+    active_capture.store(nullptr);
+    finished = std::move(capture);
   }
+  if (finished == nullptr) return {};
+  return finished->finish();
 }
 
-void AudioEngine::togglePlayback() {
-  is_playing_global = !is_playing_global.load();
-  if (!is_playing_global.load()) {
-    global_transport_pos = 0;
+uint64_t AudioEngine::startRecordingInNode(const juce::String &uuid) {
+  CommandFence fence(*this, celestrian::CaptureCommandType::StartRecording,
+                     uuid);
+  juce::Logger::writeToLog("AudioEngine: start_recording requested for " +
+                           uuid);
+
+  auto *clip = findClipByUuid(uuid);
+  if (clip == nullptr) {
+    juce::Logger::writeToLog("AudioEngine: CLIP NOT FOUND for " + uuid);
+    return 0;
   }
+  if (!is_playing_global.load())
+    juce::Logger::writeToLog(
+        "AudioEngine: Auto-starting transport for recording.");
+
+  // Both are too slow for the audio thread: the quantum locks every box on
+  // the way, and the take buffer is a minute of audio
+  const bool first_clip = root_node->getEffectiveQuantum() == 0;
+  const int64_t quantum = clip->getEffectiveQuantum();
+  if (first_clip)
+    juce::Logger::writeToLog(
+        "AudioEngine: First Clip detected -> Reset Global Transport to 0.");
+  clip->prepareRecording();
+  return sendCommand(fence, {celestrian::EngineCommandType::StartRecording,
+                             clip, first_clip ? 1 : 0, quantum});
 }
 
-juce::var AudioEngine::getGraphState() const {
-  if (focused_node) {
-    auto metadata = focused_node->getMetadata();
+uint64_t AudioEngine::stopRecordingInNode(const juce::String &uuid) {
+  CommandFence fence(*this, celestrian::CaptureCommandType::StopRecording,
+                     uuid);
+  juce::Logger::writeToLog("AudioEngine: stop_recording requested for " + uuid);
+  auto *clip = findClipByUuid(uuid);
+  if (clip == nullptr) return 0;
+
+  const int64_t quantum = clip->getEffectiveQuantum();
+  return sendCommand(
+      fence, {celestrian::EngineCommandType::StopRecording, clip, quantum},
+      [this, uuid, quantum] {
+        // The graph may have changed since: find the clip again
+        auto *stopped = findClipByUuid(uuid);
+        if (stopped == nullptr) return;
+        if (quantum == 0) {
+          // Snapping, rotating and logging stay off the audio thread
+          stopped->commitRecording();
+        } else if (stopped->isAwaitingStop()) {
+          juce::Logger::writeToLog(
+              "ClipNode: Waiting for next Q boundary B=" +
+              juce::String(stopped->getAwaitingStopAt()) + " (current L=" +
+              juce::String(stopped->getWritePosition()) + ")");
+        }
+      });
+}
+
+uint64_t AudioEngine::togglePlayback() {
+  CommandFence fence(*this, celestrian::CaptureCommandType::TogglePlayback);
+  return sendCommand(fence, {celestrian::EngineCommandType::TogglePlayback});
+}
+
+juce::var AudioEngine::getGraphState(
+    const celestrian::MetadataQuery &query) const {
+  std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
+  const auto *soloed = soloed_node.load();
+  const auto soloed_id = soloed != nullptr ? soloed->getUuid() : juce::String();
+  if (const auto *focused = focused_node.load()) {
+    auto metadata = focused->getMetadata(query);
     auto *obj = metadata.getDynamicObject();
     obj->setProperty("isPlaying", (bool)is_playing_global.load());
     obj->setProperty("masterPos", (double)global_transport_pos.load());
-    obj->setProperty("soloedId", soloed_node_uuid);
-    obj->setProperty("focusedId", focused_node->getUuid());
+    obj->setProperty("soloedId", soloed_id);
+    obj->setProperty("focusedId", focused->getUuid());
+    obj->setProperty("transport", getTransportClock());
+    obj->setProperty("memory", getMemoryStatus());
     return metadata;
   }
 
   juce::DynamicObject::Ptr state = new juce::DynamicObject();
   state->setProperty("isPlaying", (bool)is_playing_global.load());
   state->setProperty("masterPos", (double)global_transport_pos.load());
-  state->setProperty("soloedId", soloed_node_uuid);
+  state->setProperty("soloedId", soloed_id);
   state->setProperty("nodes", juce::Array<juce::var>());
+  state->setProperty("transport", getTransportClock());
+  state->setProperty("memory", getMemoryStatus());
   return juce::var(state.get());
 }
 
+juce::var AudioEngine::getTransportClock() const {
+  auto anchor = transport_clock.read();
+  juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+  obj->setProperty("masterPos", (double)anchor.master_position);
+  obj->setProperty("timelineLength", (double)anchor.timeline_length);
+  obj->setProperty("sampleRate", anchor.sample_rate);
+  obj->setProperty("hostTimeNs", (double)anchor.host_time_ns);
+  obj->setProperty("anchorTimeNs", (double)anchor.anchor_time_ns);
+  obj->setProperty("outputLatency", anchor.output_latency);
+  obj->setProperty("isPlaying", anchor.is_playing);
+  obj->setProperty("scheduledEvents", transport_scheduler.getNumPending());
+  obj->setProperty("nowNs", (double)celestrian::TransportClock::nowNs());
+  return juce::var(obj.get());
+}
+
+void AudioEngine::setDspProfilingEnabled(bool should_enable) {
+  celestrian::DspProfile::setEnabled(should_enable);
+  juce::Logger::writeToLog(
+      "AudioEngine: DSP profiling " +
+      juce::String(should_enable ? "enabled" : "disabled"));
+}
+
+namespace {
+void collectDspProfiles(const celestrian::AudioNode &node, int depth,
+                        juce::Array<juce::var> &out) {
+  auto entry = node.getDspProfile().toVar();
+  auto *obj = entry.getDynamicObject();
+  obj->setProperty("id", node.getUuid());
+  obj->setProperty("name", node.getName());
+  obj->setProperty("type", node.getNodeTypeString());
+  obj->setProperty("depth", depth);
+  if (auto *parent = node.getParent())
+    obj->setProperty("parentId", parent->getUuid());
+  out.add(entry);
+
+  if (auto *box = dynamic_cast<const celestrian::BoxNode *>(&node)) {
+    box->forEachChild([&](const celestrian::AudioNode &child) {
+      collectDspProfiles(child, depth + 1, out);
+    });
+  }
+}
+}  // namespace
+
+juce::var AudioEngine::getDspProfile() const {
+  std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
+  juce::Array<juce::var> nodes;
+  if (root_node) collectDspProfiles(*root_node, 0, nodes);
+
+  juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+  obj->setProperty("enabled", celestrian::DspProfile::isEnabled());
+  obj->setProperty("nodes", nodes);
+  return juce::var(obj.get());
+}
+
+namespace {
+void updateTraceLabels(const celestrian::AudioNode &node) {
+  node.updateTraceLabel();
+  if (auto *box = dynamic_cast<const celestrian::BoxNode *>(&node))
+    box->forEachChild(updateTraceLabels);
+}
+}  // namespace
+
+bool AudioEngine::startTrace(const juce::File &file) {
+  if (!celestrian::TraceRecorder::getInstance().start(file)) return false;
+  // Nodes created from here on label themselves
+  std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
+  if (root_node) updateTraceLabels(*root_node);
+  return true;
+}
+
+namespace {
+const char *toString(AudioEngine::MemoryStatus status) {
+  switch (status) {
+    case AudioEngine::MemoryStatus::Warning:
+      return "warning";
+    case AudioEngine::MemoryStatus::OverBudget:
+      return "overBudget";
+    default:
+      return "ok";
+  }
+}
+
+juce::String toMegabytes(int64_t bytes) {
+  return juce::String((double)bytes / (1024.0 * 1024.0), 1) + " MB";
+}
+
+void collectMemoryUsage(const celestrian::AudioNode &node, int depth,
+                        juce::Array<juce::var> &out) {
+  auto entry = node.getMemoryUsage().toVar();
+  auto *obj = entry.getDynamicObject();
+  obj->setProperty("id", node.getUuid());
+  obj->setProperty("name", node.getName());
+  obj->setProperty("type", node.getNodeTypeString());
+  obj->setProperty("depth", depth);
+  if (auto *parent = node.getParent())
+    obj->setProperty("parentId", parent->getUuid());
+  out.add(entry);
+
+  if (auto *box = dynamic_cast<const celestrian::BoxNode *>(&node)) {
+    box->forEachChild([&](const celestrian::AudioNode &child) {
+      collectMemoryUsage(child, depth + 1, out);
+    });
+  }
+}
+}  // namespace
+
+void AudioEngine::setMemoryBudget(int64_t bytes) {
+  memory_budget_bytes.store(std::max<int64_t>(0, bytes));
+  juce::Logger::writeToLog("AudioEngine: Memory budget set to " +
+                           toMegabytes(memory_budget_bytes.load()));
+  checkMemoryBudget();
+}
+
+bool AudioEngine::reserveLockedAudioMemory(int64_t capacity_bytes) {
+  if (!audio_arena.reserve(capacity_bytes)) return false;
+  const auto stats = audio_arena.getStats();
+  juce::Logger::writeToLog(
+      "AudioEngine: Reserved " + toMegabytes(stats.capacity_bytes) +
+      " of clip memory (" + (stats.locked ? "locked" : "not locked") +
+      (stats.huge_pages ? ", huge pages" : "") + ")");
+  return true;
+}
+
+celestrian::MemoryUsage AudioEngine::checkMemoryBudget() const {
+  std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
+  // Before the walk: a change during it marks the total stale again
+  memory_total_stale.store(false);
+  auto usage = root_node ? root_node->getMemoryUsage()
+                         : celestrian::MemoryUsage{};
+  int64_t budget = memory_budget_bytes.load();
+  int64_t total = usage.total();
+  memory_total_bytes.store(total);
+
+  auto status = MemoryStatus::Ok;
+  if (budget > 0 && total > budget)
+    status = MemoryStatus::OverBudget;
+  else if (budget > 0 && (double)total >= kMemoryWarningFraction * budget)
+    status = MemoryStatus::Warning;
+
+  if (memory_status.exchange(status) != status && status != MemoryStatus::Ok) {
+    juce::Logger::writeToLog(
+        "AudioEngine: WARNING session memory " + toMegabytes(total) +
+        (status == MemoryStatus::OverBudget ? " exceeds" : " is nearing") +
+        " the budget of " + toMegabytes(budget) + " (audio " +
+        toMegabytes(usage.audio_bytes) + ", " +
+        toMegabytes(usage.audio_used_bytes) + " recorded)");
+  }
+  return usage;
+}
+
+juce::var AudioEngine::getMemoryStatus() const {
+  // Polled with every graph state: only re-walk the session after a change
+  if (memory_total_stale.load()) checkMemoryBudget();
+  juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+  obj->setProperty("totalBytes", (double)memory_total_bytes.load());
+  obj->setProperty("budgetBytes", (double)memory_budget_bytes.load());
+  obj->setProperty("status", toString(memory_status.load()));
+  return juce::var(obj.get());
+}
+
+juce::var AudioEngine::getMemoryUsage() const {
+  std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
+  auto usage = checkMemoryBudget();
+  juce::Array<juce::var> nodes;
+  if (root_node) collectMemoryUsage(*root_node, 0, nodes);
+
+  juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+  obj->setProperty("totalBytes", (double)usage.total());
+  obj->setProperty("budgetBytes", (double)memory_budget_bytes.load());
+  obj->setProperty("status", toString(memory_status.load()));
+  obj->setProperty("session", usage.toVar());
+  obj->setProperty("pendingFreeNodes", node_reclaimer.getNumPending());
+  obj->setProperty("audioArena", audio_arena.toVar());
+  auto &node_states = celestrian::NodeStateTable::getInstance();
+  obj->setProperty("nodeStateBytes", (double)node_states.getBytes());
+  obj->setProperty("nodeStates", node_states.getNumLive());
+  obj->setProperty("nodes", nodes);
+  return juce::var(obj.get());
+}
+
 juce::var AudioEngine::getWaveform(const juce::String &uuid,
                                    int num_peaks) const {
+  std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
   auto *self = const_cast<AudioEngine *>(this);
   if (auto *node = self->findNodeByUuid(root_node.get(), uuid)) {
+    if (auto *clip = dynamic_cast<celestrian::ClipNode *>(node))
+      self->schedulePeakCache(*clip);
     return node->getWaveform(num_peaks);
   }
   return juce::Array<juce::var>();
 }
 
-// --- Navigation ---
+void AudioEngine::schedulePeakCache(celestrian::ClipNode &clip) {
+  // Waveform work waits while the engine is shedding load
+  if (!clip.needsPeakCache() ||
+      overload_governor.getLevel() != celestrian::ShedLevel::None)
+    return;
 
-void AudioEngine::enterBox(const juce::String &uuid) {
-  if (auto *box = dynamic_cast<celestrian::BoxNode *>(focused_node)) {
-    for (int i = 0; i < box->getNumChildren(); ++i) {
-      auto *child = box->getChild(i);
-      if (child->getUuid() == uuid &&
-          dynamic_cast<celestrian::BoxNode *>(child)) {
-        navigation_stack.push_back(focused_node);
-        focused_node = child;
-        return;
+  std::lock_guard<std::mutex> lock(peak_jobs_mutex);
+  auto &job = peak_jobs[clip.getUuid()];
+  if (job != nullptr && !job->isDone()) return;
+
+  JobSystem::JobOptions options;
+  options.priority = JobSystem::Priority::Background;
+  job = job_system.schedule(
+      [this, &clip](JobSystem::JobContext &context) {
+        const bool built = clip.buildPeakCache(context);
+        if (built) memory_total_stale.store(true);
+        return juce::var(built);
+      },
+      {}, options);
+}
+
+void AudioEngine::cancelPeakJobs() {
+  std::lock_guard<std::mutex> lock(peak_jobs_mutex);
+  for (auto &[uuid, job] : peak_jobs) job->cancel();
+  for (auto &[uuid, job] : peak_jobs) job->wait();
+  peak_jobs.clear();
+}
+
+void AudioEngine::cancelPeakJobs(celestrian::AudioNode &subtree) {
+  std::vector<JobSystem::JobHandle> jobs;
+  {
+    std::lock_guard<std::mutex> lock(peak_jobs_mutex);
+    for (auto it = peak_jobs.begin(); it != peak_jobs.end();) {
+      if (findNodeByUuid(&subtree, it->first) != nullptr) {
+        jobs.push_back(std::move(it->second));
+        it = peak_jobs.erase(it);
+      } else {
+        ++it;
       }
     }
   }
+  for (auto &job : jobs) job->cancel();
+  for (auto &job : jobs) job->wait();
+}
+
+void AudioEngine::addGraphQueryJob(JobSystem::JobHandle job) {
+  std::lock_guard<std::mutex> lock(graph_query_jobs_mutex);
+  graph_query_jobs.erase(
+      std::remove_if(graph_query_jobs.begin(), graph_query_jobs.end(),
+                     [](const auto &pending) { return pending->isDone(); }),
+      graph_query_jobs.end());
+  graph_query_jobs.push_back(std::move(job));
+}
+
+void AudioEngine::cancelGraphQueryJobs() {
+  std::vector<JobSystem::JobHandle> jobs;
+  {
+    std::lock_guard<std::mutex> lock(graph_query_jobs_mutex);
+    jobs.swap(graph_query_jobs);
+  }
+  for (auto &job : jobs) job->cancel();
+  for (auto &job : jobs) job->wait();
+}
+
+// --- Navigation ---
+
+void AudioEngine::enterBox(const juce::String &uuid) {
+  CommandFence fence(*this, celestrian::CaptureCommandType::EnterBox, uuid);
+  std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
+  auto *box = dynamic_cast<celestrian::BoxNode *>(focused_node.load());
+  if (box == nullptr) return;
+  // Only a direct child of the focused box
+  auto *child =
+      dynamic_cast<celestrian::BoxNode *>(box->findNodeByUuid(uuid));
+  if (child == nullptr || child->getParent() != box) return;
+  navigation_stack.push_back(box);
+  focused_node.store(child);
 }
 
 void AudioEngine::exitBox() {
+  CommandFence fence(*this, celestrian::CaptureCommandType::ExitBox);
+  std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
   if (!navigation_stack.empty()) {
-    focused_node = navigation_stack.back();
+    focused_node.store(navigation_stack.back());
     navigation_stack.pop_back();
   }
 }
 
-void AudioEngine::createNode(const juce::String &type, double x, double y) {
-  if (auto *box = dynamic_cast<celestrian::BoxNode *>(focused_node)) {
+juce::String AudioEngine::createNode(const juce::String &type, double x,
+                                     double y) {
+  CommandFence fence(*this, celestrian::CaptureCommandType::CreateNode);
+  fence.command.text = type;
+  fence.command.x = x;
+  fence.command.y = y;
+
+  std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
+  juce::String uuid;
+  auto *box = dynamic_cast<celestrian::BoxNode *>(focused_node.load());
+  if (box != nullptr) {
     std::unique_ptr<celestrian::AudioNode> new_node;
     if (type == "clip") {
-      new_node = std::make_unique<celestrian::ClipNode>("New Clip", 44100.0);
+      new_node = std::make_unique<celestrian::ClipNode>(
+          "New Clip", prepared_sample_rate.load(),
+          audio_arena.isReserved() ? &audio_arena : nullptr);
     } else {
       new_node = std::make_unique<celestrian::BoxNode>("New Box");
     }
@@ -154,169 +718,456 @@ void AudioEngine::createNode(const juce::String &type, double x, double y) {
       new_node->x_pos = 0.0;  // Default to Time 0 (was 120.0)
       new_node->y_pos = box->getNumChildren() * 120.0;  // 120px per clip row
     }
+    uuid = new_node->getUuid();
     box->addChild(std::move(new_node));
+    render_generation.fetch_add(1);
   }
+  fence.command.uuid = uuid;
+  checkMemoryBudget();
+  return uuid;
 }
 
 void AudioEngine::renameNode(const juce::String &uuid,
                              const juce::String &new_name) {
+  // Graph queries read names on worker threads
+  std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
   if (auto *node = findNodeByUuid(root_node.get(), uuid)) {
     node->setName(new_name);
   }
 }
 
+uint64_t AudioEngine::removeNode(const juce::String &uuid) {
+  CommandFence fence(*this, celestrian::CaptureCommandType::RemoveNode, uuid);
+  std::unique_ptr<celestrian::AudioNode> removed;
+  {
+    std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
+    auto *node = findNodeByUuid(root_node.get(), uuid);
+    auto *box = node != nullptr
+                    ? dynamic_cast<celestrian::BoxNode *>(node->getParent())
+                    : nullptr;
+    if (box == nullptr) return 0;  // Not found, or the root
+
+    // Back out of the subtree if the focus is inside it
+    while (focused_node.load()->isInside(node) &&
+           !navigation_stack.empty()) {
+      focused_node.store(navigation_stack.back());
+      navigation_stack.pop_back();
+    }
+    removed = box->detachChild(uuid);
+    render_generation.fetch_add(1);
+  }
+  memory_total_stale.store(true);
+
+  // Commands queued before this one still run on the unlinked subtree; this
+  // one drops the events and solo pointing into it. Only then can it go.
+  auto subtree = std::make_shared<std::unique_ptr<celestrian::AudioNode>>(
+      std::move(removed));
+  auto *target = subtree->get();
+  return sendCommand(fence, {celestrian::EngineCommandType::RemoveNode, target},
+                     [this, subtree] {
+                       cancelPeakJobs(**subtree);
+                       node_reclaimer.retire(std::move(*subtree));
+                     });
+}
+
 juce::var AudioEngine::getInputList() const {
   juce::Array<juce::var> names;
-  if (auto *device = device_manager.getCurrentAudioDevice()) {
-    auto inputNames = device->getInputChannelNames();
-    juce::Logger::writeToLog("AudioEngine: Found " +
-                             juce::String(inputNames.size()) +
-                             " input channel names.");
-    for (const auto &name : inputNames) {
-      names.add(name);
-    }
+  auto input_names = device_backend->getInputChannelNames();
+  juce::Logger::writeToLog("AudioEngine: Found " +
+                           juce::String(input_names.size()) +
+                           " input channel names.");
+  for (const auto &name : input_names) {
+    names.add(name);
   }
   juce::DynamicObject::Ptr obj = new juce::DynamicObject();
   obj->setProperty("inputs", names);
   return juce::var(obj.get());
 }
 
-void AudioEngine::setNodeInput(const juce::String &uuid, int channel_index) {
-  if (auto *clip = dynamic_cast<celestrian::ClipNode *>(
-          findNodeByUuid(root_node.get(), uuid))) {
-    clip->setInputChannel(channel_index);
+uint64_t AudioEngine::setNodeInput(const juce::String &uuid,
+                                   int channel_index) {
+  CommandFence fence(*this, celestrian::CaptureCommandType::SetNodeInput,
+                     uuid);
+  fence.command.first = channel_index;
+  auto *clip = findClipByUuid(uuid);
+  if (clip == nullptr) return 0;
+  return sendCommand(fence, {celestrian::EngineCommandType::SetNodeInput,
+                             clip, channel_index});
+}
+
+uint64_t AudioEngine::setLoopPoints(const juce::String &uuid, int64_t start,
+                                    int64_t end) {
+  CommandFence fence(*this, celestrian::CaptureCommandType::SetLoopPoints,
+                     uuid);
+  fence.command.first = start;
+  fence.command.second = end;
+  auto *node = findNodeByUuid(root_node.get(), uuid);
+  if (node == nullptr) return 0;
+  return sendCommand(fence, {celestrian::EngineCommandType::SetLoopPoints,
+                             node, start, end});
+}
+
+bool AudioEngine::setNodePriority(const juce::String &uuid,
+                                  celestrian::NodePriority priority) {
+  std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
+  auto *node = findNodeByUuid(root_node.get(), uuid);
+  if (node == nullptr) return false;
+  node->setPriority(priority);
+  return true;
+}
+
+bool AudioEngine::setRenderAhead(const juce::String &uuid,
+                                 bool should_render_ahead) {
+  std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
+  auto *box = dynamic_cast<celestrian::BoxNode *>(
+      findNodeByUuid(root_node.get(), uuid));
+  if (box == nullptr) return false;
+  if (should_render_ahead) {
+    box->enableRenderAhead(render_ahead_pool);
+    memory_total_stale.store(true);  // The ring
+  } else {
+    box->disableRenderAhead();
   }
+  return true;
 }
 
-void AudioEngine::setLoopPoints(const juce::String &uuid, int64_t start,
-                                int64_t end) {
-  if (auto *node = findNodeByUuid(root_node.get(), uuid)) {
-    node->setLoopPoints(start, end);
+juce::StringArray AudioEngine::takeOverloadLog() {
+  juce::StringArray lines;
+  for (const auto &action :
+       overload_governor.getActionsSince(next_overload_action)) {
+    lines.add(celestrian::OverloadGovernor::describe(action));
+    next_overload_action = action.index + 1;
   }
+  return lines;
 }
+
+juce::StringArray AudioEngine::takeRecordingLog() {
+  juce::StringArray lines;
+  for (const auto &entry :
+       recording_log.getEntriesSince(next_recording_entry)) {
+    lines.add(celestrian::RecordingLog::describe(entry));
+    next_recording_entry = entry.index + 1;
+  }
+  return lines;
+}
+
 void AudioEngine::audioDeviceIOCallbackWithContext(
     const float *const *input_channel_data, int num_input_channels,
     float *const *output_channel_data, int num_output_channels, int num_samples,
     const juce::AudioIODeviceCallbackContext &context) {
+  celestrian::realtime::ScopedRealtimeThread realtime_thread;
+  // Flush-to-zero and denormals-are-zero: decaying tails stay cheap
+  juce::ScopedNoDenormals no_denormals;
+  const auto block_start_ticks = celestrian::CallbackMonitor::beginBlock();
+  callback_running.store(true);
+  node_reclaimer.beginBlock();
+
+  // Capture mode: blocks and commands take turns on the fence, so each
+  // command lands between two blocks. Capture is a debugging switch.
+  std::unique_lock<std::mutex> capture_lock;
+  celestrian::SessionCapture *block_capture = nullptr;
+  if (active_capture.load() != nullptr) {
+    celestrian::realtime::ScopedAllowViolations allow_capture_fence;
+    capture_lock = std::unique_lock<std::mutex>(capture_fence);
+    block_capture = active_capture.load();
+  }
+
+  // Commands sent since the last block; under the capture fence, so a
+  // captured command lands before the block it was logged against. The
+  // queue has one consumer: if a sender is draining it, its commands land
+  // before the next block instead.
+  {
+    std::unique_lock<std::mutex> drain_lock(command_drain_mutex,
+                                            std::try_to_lock);
+    if (drain_lock.owns_lock()) applyPendingCommands();
+  }
+  celestrian::TraceRecorder::nameCurrentThread("Audio Device");
+  CELESTRIAN_TRACE_SCOPE("audio", "AudioEngine::callback");
+  const auto block_start_ns = celestrian::TransportClock::nowNs();
+
   for (int i = 0; i < num_output_channels; ++i) {
     if (output_channel_data[i] != nullptr)
       juce::FloatVectorOperations::clear(output_channel_data[i], num_samples);
   }
 
   if (root_node) {
-    celestrian::ProcessContext pc;
-    pc.sample_rate = 44100.0;
-    pc.num_samples = num_samples;
-    pc.is_playing = is_playing_global;
-    pc.is_recording = true;  // Enable recording capture from inputs
-    pc.master_pos = global_transport_pos;
-    if (auto *device = device_manager.getCurrentAudioDevice()) {
-      pc.input_latency = device->getInputLatencyInSamples();
-      pc.output_latency = device->getOutputLatencyInSamples();
+    const int64_t block_master_pos = global_transport_pos.load();
+    const bool block_is_playing = is_playing_global.load();
+    const int pending_samples = block_adapter.getPendingInput();
+
+    int64_t timeline_length = 0;
+    if (block_adapter.isActive()) {
+      // A device block with too little input for an internal block renders
+      // nothing, so the timeline may not have been worked out yet
+      timeline_length = calculateTimelineLength();
+      block_adapter.process(
+          input_channel_data, num_input_channels, output_channel_data,
+          num_output_channels, num_samples,
+          [this, &timeline_length](const float *const *inputs, int num_inputs,
+                                   float *const *outputs, int num_outputs,
+                                   int block_samples) {
+            timeline_length = renderGraph(inputs, num_inputs, outputs,
+                                          num_outputs, block_samples);
+          });
+    } else {
+      timeline_length =
+          renderGraph(input_channel_data, num_input_channels,
+                      output_channel_data, num_output_channels, num_samples);
     }
-    pc.solo_node_uuid = soloed_node_uuid;
 
-    static int log_count = 0;
-    if (++log_count % 100 == 0) {
-      juce::Logger::writeToLog(
-          "AudioEngine: Processing " + juce::String(num_samples) +
-          " samples, Inputs: " + juce::String(num_input_channels));
+    // Anchor the block we just rendered so the UI can extrapolate from it.
+    // Input still waiting in the block adapter is ahead of the transport.
+    celestrian::TransportAnchor anchor;
+    anchor.master_position = block_master_pos;
+    if (block_is_playing) {
+      anchor.master_position += pending_samples;
+      if (timeline_length > 0) anchor.master_position %= timeline_length;
     }
+    anchor.timeline_length = timeline_length;
+    anchor.sample_rate = prepared_config.sample_rate;
+    anchor.host_time_ns =
+        context.hostTimeNs != nullptr ? *context.hostTimeNs : 0;
+    anchor.anchor_time_ns = block_start_ns;
+    anchor.output_latency = getOutputLatency();
+    anchor.is_playing = block_is_playing;
+    transport_clock.publish(anchor);
 
-    // Update Global Quantum Propagation:
-    // If focused box has no quantum, check if its children have a finished
-    // recording.
-    root_node->process(input_channel_data, output_channel_data,
-                       num_input_channels, num_output_channels, pc);
+    if (block_capture != nullptr)
+      block_capture->captureBlock(input_channel_data, num_input_channels,
+                                  output_channel_data, num_output_channels,
+                                  num_samples, block_master_pos);
 
-    if (is_playing_global.load()) {
-      // LCM Timeline: Wrap transport at the LCM of all clip durations
-      // This ensures all clips reach 0% simultaneously when timeline completes
-      int64_t timeline_length = calculateTimelineLength();
-      int64_t new_pos = global_transport_pos.load() + num_samples;
-      if (timeline_length > 0) {
-        new_pos = new_pos % timeline_length;
-      }
-      global_transport_pos.store(new_pos);
-    }
+    const double load = callback_monitor.endBlock(
+        block_start_ticks, num_samples, prepared_config.sample_rate,
+        block_master_pos, root_node->getActiveNodeCount());
+    // Shedding depends on timing: keep offline renders and captures exact
+    overload_governor.update(load, block_master_pos,
+                             device_backend->isRealtime() &&
+                                 block_capture == nullptr);
   }
+  node_reclaimer.endBlock();
+  callback_running.store(false);
 }
 
-void AudioEngine::audioDeviceAboutToStart(juce::AudioIODevice *device) {}
-void AudioEngine::audioDeviceStopped() {}
+celestrian::ProcessContext AudioEngine::makeProcessContext(int num_samples) {
+  celestrian::ProcessContext pc;
+  pc.sample_rate = prepared_config.sample_rate;
+  pc.num_samples = num_samples;
+  pc.fixed_block_size =
+      num_samples == block_adapter.getBlockSize() ? num_samples : 0;
+  pc.is_playing = is_playing_global;
+  pc.is_recording = true;  // Enable recording capture from inputs
+  pc.master_pos = global_transport_pos;
+  pc.sample_time = graph_sample_time;
+  pc.scheduler = &transport_scheduler;
+  pc.recording_log = &recording_log;
+  pc.input_latency = prepared_config.input_latency;
+  pc.output_latency = getOutputLatency();
+  pc.solo_node = soloed_node.load();
+  pc.shed_level = overload_governor.getLevel();
+  pc.timeline_length = last_timeline_length;
+  pc.graph_generation = render_generation.load(std::memory_order_acquire);
+  return pc;
+}
 
-void AudioEngine::toggleSolo(const juce::String &uuid) {
-  if (soloed_node_uuid == uuid) {
-    soloed_node_uuid = "";  // Unsolo
-  } else {
-    soloed_node_uuid = uuid;  // New solo
+int64_t AudioEngine::renderGraph(const float *const *input_channel_data,
+                                 int num_input_channels,
+                                 float *const *output_channel_data,
+                                 int num_output_channels, int num_samples) {
+  // Split the block at each scheduled event, so it lands on its sample
+  int64_t timeline_length = 0;
+  int offset = 0;
+  while (offset < num_samples) {
+    transport_scheduler.dispatchDue(
+        graph_sample_time, [this](const celestrian::TransportEvent &event) {
+          if (event.target != nullptr) {
+            event.target->handleTransportEvent(event, makeProcessContext(0));
+            render_generation.fetch_add(1);
+          }
+        });
+
+    int slice_samples = num_samples - offset;
+    const int64_t to_next_event =
+        transport_scheduler.getNextEventTime() - graph_sample_time;
+    if (to_next_event < slice_samples) slice_samples = (int)to_next_event;
+
+    if (slice_samples == num_samples) {
+      timeline_length =
+          renderSlice(input_channel_data, num_input_channels,
+                      output_channel_data, num_output_channels, num_samples);
+    } else {
+      const int slice_inputs_count =
+          std::min(num_input_channels, (int)slice_inputs.size());
+      const int slice_outputs_count =
+          std::min(num_output_channels, (int)slice_outputs.size());
+      for (int ch = 0; ch < slice_inputs_count; ++ch)
+        slice_inputs[(size_t)ch] = input_channel_data[ch] != nullptr
+                                       ? input_channel_data[ch] + offset
+                                       : nullptr;
+      for (int ch = 0; ch < slice_outputs_count; ++ch)
+        slice_outputs[(size_t)ch] = output_channel_data[ch] != nullptr
+                                        ? output_channel_data[ch] + offset
+                                        : nullptr;
+      timeline_length = renderSlice(slice_inputs.data(), slice_inputs_count,
+                                    slice_outputs.data(), slice_outputs_count,
+                                    slice_samples);
+    }
+    offset += slice_samples;
   }
-  juce::Logger::writeToLog("AudioEngine: Solo toggled for " + uuid +
-                           " (Active Solo: " + soloed_node_uuid + ")");
+  return timeline_length;
 }
 
-void AudioEngine::togglePlay(const juce::String &uuid) {
-  if (auto *node = findNodeByUuid(root_node.get(), uuid)) {
-    if (auto *clip = dynamic_cast<celestrian::ClipNode *>(node)) {
-      if (clip->isPlaying()) {
-        clip->stopPlayback();
-      } else {
-        clip->startPlayback();
-      }
-      juce::Logger::writeToLog(
-          "AudioEngine: Play toggled for " + uuid + " (New State: " +
-          juce::String(clip->isPlaying() ? "true" : "false") + ")");
+int64_t AudioEngine::renderSlice(const float *const *input_channel_data,
+                                 int num_input_channels,
+                                 float *const *output_channel_data,
+                                 int num_output_channels, int num_samples) {
+  const auto pc = makeProcessContext(num_samples);
+
+  // Update Global Quantum Propagation:
+  // If focused box has no quantum, check if its children have a finished
+  // recording.
+  {
+    CELESTRIAN_TRACE_SCOPE("audio", root_node->getTraceLabel());
+    celestrian::ScopedDspTimer timer(root_node->getDspProfile(), num_samples,
+                                     pc.sample_rate);
+    root_node->process(input_channel_data, output_channel_data,
+                       num_input_channels, num_output_channels, pc);
+  }
+
+  // LCM Timeline: Wrap transport at the LCM of all clip durations
+  // This ensures all clips reach 0% simultaneously when timeline completes
+  int64_t timeline_length = calculateTimelineLength();
+  last_timeline_length = timeline_length;
+  if (is_playing_global.load()) {
+    int64_t new_pos = global_transport_pos.load() + num_samples;
+    if (timeline_length > 0) {
+      new_pos = new_pos % timeline_length;
     }
+    global_transport_pos.store(new_pos);
   }
+  graph_sample_time += num_samples;
+  return timeline_length;
 }
-void AudioEngine::toggleMute(const juce::String &uuid) {
-  if (auto *node = findNodeByUuid(root_node.get(), uuid)) {
-    bool newState = !node->is_muted.load();
-    node->is_muted.store(newState);
+
+void AudioEngine::setInternalBlockSize(int block_size) {
+  block_size = std::max(0, block_size);
+  if (block_size == internal_block_size.load()) return;
+
+  // A capture replays with the block size it started with
+  if (isCapturing()) {
     juce::Logger::writeToLog(
-        "AudioEngine: Mute toggled for " + uuid +
-        " (New State: " + juce::String(newState ? "true" : "false") + ")");
+        "AudioEngine: Internal block size changed, stopping capture.");
+    stopCapture();
   }
+
+  std::lock_guard<std::recursive_mutex> lock(navigation_mutex);
+  device_backend->close();
+  internal_block_size.store(block_size);
+  device_backend->open(*this);
 }
 
-// --- LCM Timeline Helpers ---
+void AudioEngine::audioDeviceAboutToStart(juce::AudioIODevice *device) {
+  // No block is running, so this is where the graph allocates for the
+  // device; process() then only touches what was sized here.
+  prepared_config = device_backend->getConfig();
+  if (device != nullptr) {
+    prepared_config.sample_rate = device->getCurrentSampleRate();
+    prepared_config.block_size = device->getCurrentBufferSizeSamples();
+  }
+  prepared_sample_rate.store(prepared_config.sample_rate);
+  prepared_output_latency.store(prepared_config.output_latency);
 
-namespace {
-int64_t gcd(int64_t a, int64_t b) {
-  while (b != 0) {
-    int64_t t = b;
-    b = a % b;
-    a = t;
+  block_adapter.prepare(internal_block_size.load(), prepared_config.block_size,
+                        prepared_config.num_inputs,
+                        prepared_config.num_outputs);
+  const int graph_block_size = block_adapter.isActive()
+                                   ? block_adapter.getBlockSize()
+                                   : prepared_config.block_size;
+  slice_inputs.assign((size_t)std::max(1, prepared_config.num_inputs),
+                      nullptr);
+  slice_outputs.assign((size_t)std::max(1, prepared_config.num_outputs),
+                       nullptr);
+
+  if (root_node)
+    root_node->prepare(prepared_config.sample_rate, graph_block_size,
+                       prepared_config.num_outputs);
+  memory_total_stale.store(true);  // Mix buffers were resized
+
+  {
+    // Commands sent while the device was stopped, then blocks apply them
+    std::lock_guard<std::mutex> drain_lock(command_drain_mutex);
+    applyPendingCommands();
+    device_running.store(true);
   }
-  return a;
+  juce::Logger::writeToLog(
+      "AudioEngine: Prepared for " + juce::String(prepared_config.sample_rate) +
+      " Hz, " + juce::String(graph_block_size) + "-sample blocks" +
+      (block_adapter.isActive()
+           ? " (" + juce::String(block_adapter.getLatency()) +
+                 " samples of block adapter latency)."
+           : juce::String(".")));
 }
 
-int64_t lcm(int64_t a, int64_t b) {
-  if (a == 0 || b == 0) return std::max(a, b);
-  return (a / gcd(a, b)) * b;
+void AudioEngine::audioDeviceStopped() {
+  std::lock_guard<std::mutex> drain_lock(command_drain_mutex);
+  device_running.store(false);
 }
-}  // namespace
 
-int64_t AudioEngine::calculateTimelineLength() const {
-  if (!focused_node) {
-    return 44100;  // Default 1 second at 44.1kHz
-  }
+uint64_t AudioEngine::toggleSolo(const juce::String &uuid) {
+  CommandFence fence(*this, celestrian::CaptureCommandType::ToggleSolo, uuid);
+  auto *node = findNodeByUuid(root_node.get(), uuid);
+  if (node == nullptr) return 0;
+  return sendCommand(
+      fence, {celestrian::EngineCommandType::ToggleSolo, node}, [this, uuid] {
+        const auto *soloed = soloed_node.load();
+        juce::Logger::writeToLog(
+            "AudioEngine: Solo toggled for " + uuid + " (Active Solo: " +
+            juce::String(soloed != nullptr &&
+                                 soloed == findNodeByUuid(root_node.get(), uuid)
+                             ? uuid
+                             : "none") +
+            ")");
+      });
+}
 
-  int64_t quantum = focused_node->getEffectiveQuantum();
-  if (quantum <= 0) quantum = 44100;
+uint64_t AudioEngine::togglePlay(const juce::String &uuid) {
+  CommandFence fence(*this, celestrian::CaptureCommandType::TogglePlay, uuid);
+  auto *clip = findClipByUuid(uuid);
+  if (clip == nullptr) return 0;
+  return sendCommand(
+      fence, {celestrian::EngineCommandType::TogglePlay, clip}, [this, uuid] {
+        auto *toggled = findClipByUuid(uuid);
+        if (toggled == nullptr) return;
+        juce::Logger::writeToLog(
+            "AudioEngine: Play toggled for " + uuid + " (New State: " +
+            juce::String(toggled->isPlaying() ? "true" : "false") + ")");
+      });
+}
 
-  int64_t result = quantum;  // Start with quantum as base
+uint64_t AudioEngine::toggleMute(const juce::String &uuid) {
+  CommandFence fence(*this, celestrian::CaptureCommandType::ToggleMute, uuid);
+  auto *node = findNodeByUuid(root_node.get(), uuid);
+  if (node == nullptr) return 0;
+  return sendCommand(
+      fence, {celestrian::EngineCommandType::ToggleMute, node}, [this, uuid] {
+        auto *toggled = findNodeByUuid(root_node.get(), uuid);
+        if (toggled == nullptr) return;
+        juce::Logger::writeToLog(
+            "AudioEngine: Mute toggled for " + uuid + " (New State: " +
+            juce::String(toggled->isMuted() ? "true" : "false") + ")");
+      });
+}
 
-  // Calculate LCM of all children's durations
-  if (auto *box = dynamic_cast<celestrian::BoxNode *>(focused_node)) {
-    for (int i = 0; i < box->getNumChildren(); ++i) {
-      auto *child = box->getChild(i);
-      int64_t dur = child->getIntrinsicDuration();
-      if (dur > 0) {
-        result = lcm(result, dur);
-      }
-    }
-  }
+// --- LCM Timeline ---
+
+int64_t AudioEngine::calculateTimelineLength() const {
+  // Default 1 second at the device rate
+  const auto one_second = (int64_t)prepared_sample_rate.load();
 
-  return result;
+  // Runs on the audio thread: only what the focused box cached while it
+  // processed, never a walk of its children
+  const auto *box =
+      dynamic_cast<const celestrian::BoxNode *>(focused_node.load());
+  if (box == nullptr) return one_second;
+  return box->getCachedTimelineLength(one_second);
 }
@@ -2,47 +2,246 @@
 
 #include <juce_audio_devices/juce_audio_devices.h>
 
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <vector>
 
+#include "audio_memory_arena.h"
 #include "audio_node.h"
+#include "block_size_adapter.h"
+#include "callback_monitor.h"
 #include "clip_node.h"
+#include "command_queue.h"
+#include "device_backend.h"
+#include "job_system.h"
+#include "node_reclaimer.h"
+#include "overload_governor.h"
+#include "recording_log.h"
+#include "render_ahead.h"
+#include "session_capture.h"
+#include "transport_clock.h"
+#include "transport_scheduler.h"
 
 class AudioEngine : public juce::AudioIODeviceCallback {
  public:
+  /**
+   * Creates an engine on a headless OfflineDeviceBackend: nothing runs until
+   * the backend is asked to render. The app passes a HardwareDeviceBackend.
+   */
   AudioEngine();
+  explicit AudioEngine(std::unique_ptr<celestrian::DeviceBackend> backend);
   ~AudioEngine() override;
 
+  /**
+   * Returns the backend driving the audio callback, e.g. to render blocks
+   * from an OfflineDeviceBackend.
+   */
+  celestrian::DeviceBackend &getDeviceBackend() { return *device_backend; }
+
+  /**
+   * The shared pool for non-realtime work (bridge queries, peak caches,
+   * analysis, file I/O). Completions run on the message thread unless a job
+   * asks otherwise.
+   */
+  JobSystem &getJobSystem() { return job_system; }
+
+  /**
+   * Registers a job that reads the graph from a worker thread (e.g. an
+   * async bridge query), so setRootNode() can cancel it and wait for it
+   * before the graph it reads is retired.
+   */
+  void addGraphQueryJob(JobSystem::JobHandle job);
+
+  /**
+   * Replaces the whole session graph (e.g. a loaded or generated session)
+   * and returns the focus to the new root. The backend is closed around the
+   * swap, so the callback never sees a half-replaced graph; don't call this
+   * while another thread is rendering an offline backend. The old graph is
+   * freed in the background.
+   */
+  void setRootNode(std::unique_ptr<celestrian::AudioNode> new_root);
+
+  // Mutations
+  //
+  // Everything below that changes engine or node state is sent to the audio
+  // thread as a command and applied between two blocks, so a block never
+  // sees half a change. Each returns its command's id without waiting for
+  // the audio thread (0 if the target wasn't found or the queue was full);
+  // isCommandApplied() tells when it took effect. While the device isn't
+  // running the sender applies it straight away.
+
+  /**
+   * True once the command with `id` (from a mutation below) has been
+   * applied. Safe from any thread.
+   */
+  bool isCommandApplied(uint64_t id) const {
+    return command_queue.isApplied(id);
+  }
+
   // Global Transport
   /**
    * Toggles global audio playback.
    */
-  void togglePlayback();
+  uint64_t togglePlayback();
 
   /**
    * Returns true if the transport is currently running.
    */
   bool isPlaying() const { return is_playing_global; }
 
+  /**
+   * LCM Timeline: returns the length at which the transport wraps, the LCM
+   * of the quantum and every clip duration in the focused box. Runs every
+   * block on the audio thread, from what the box cached while it processed.
+   */
+  int64_t calculateTimelineLength() const;
+
   // Node Recording
   /**
    * Enables recording mode for a specific clip node.
    */
-  void startRecordingInNode(const juce::String &uuid);
+  uint64_t startRecordingInNode(const juce::String &uuid);
 
   /**
    * Disables recording mode for a specific clip node.
    */
-  void stopRecordingInNode(const juce::String &uuid);
+  uint64_t stopRecordingInNode(const juce::String &uuid);
 
   // State API
   /**
-   * Returns a JSON-compatible representation of the entire audio graph.
+   * Returns a JSON-compatible representation of the focused audio graph.
+   * @param query Depth limit and optional visible area. The default expands
+   *              the full subtree.
+   */
+  juce::var getGraphState(const celestrian::MetadataQuery &query = {}) const;
+
+  /**
+   * Returns the latest transport anchor published by the audio thread, plus
+   * the current time on the same clock (`nowNs`), so the caller can
+   * extrapolate the playhead between polls.
+   */
+  juce::var getTransportClock() const;
+
+  // Profiling API
+  /**
+   * Turns per-node DSP timing on or off. Off by default; when on, graph
+   * state nodes carry a `dsp` object.
+   */
+  void setDspProfilingEnabled(bool should_enable);
+
+  /**
+   * Returns `{ enabled, nodes: [...] }` with the last one-second DSP figures
+   * (`meanUs`, `p99Us`, `maxUs`) of every node in the session, depth-first
+   * from the root. Figures include the node's subtree.
+   */
+  juce::var getDspProfile() const;
+
+  /**
+   * Starts a TraceRecorder trace into `file` and labels every node for it:
+   * nodes only intern their names while tracing is on. Returns false if a
+   * trace is already running or the file can't be opened.
+   */
+  bool startTrace(const juce::File &file);
+
+  /**
+   * Returns audio callback timing: load histogram, near misses, overruns and
+   * the most recent overruns with their transport position.
+   */
+  juce::var getCallbackStats() const { return callback_monitor.toVar(); }
+
+  /**
+   * One-line callback timing summary for periodic logging.
+   */
+  juce::String getCallbackSummary() const {
+    return callback_monitor.getSummaryLine();
+  }
+
+  /**
+   * Returns the overload governor's shed level, smoothed load, threshold and
+   * recent actions.
+   */
+  juce::var getOverloadState() const { return overload_governor.toVar(); }
+
+  /**
+   * Sets the callback load (elapsed / deadline) past which the graph starts
+   * shedding work. Only realtime backends shed, and never while capturing.
+   */
+  void setOverloadThreshold(double load) {
+    overload_governor.setShedLoad(load);
+  }
+
+  /**
+   * Returns a log line for each shed level change since the last call.
+   * Message thread only.
+   */
+  juce::StringArray takeOverloadLog();
+
+  /**
+   * Returns a log line for each recording start and commit the audio thread
+   * made since the last call. Message thread only.
+   */
+  juce::StringArray takeRecordingLog();
+
+  // Memory API
+  static constexpr int64_t kDefaultMemoryBudgetBytes = 4LL << 30;  // 4 GB
+  // Fraction of the budget at which the session starts warning
+  static constexpr double kMemoryWarningFraction = 0.8;
+
+  enum class MemoryStatus { Ok, Warning, OverBudget };
+
+  /**
+   * Sets the session memory budget. Crossing 80% of it, or the budget itself,
+   * logs a warning and shows in the `memory` status of graph state.
+   */
+  void setMemoryBudget(int64_t bytes);
+  int64_t getMemoryBudget() const { return memory_budget_bytes.load(); }
+
+  /**
+   * Reserves `capacity_bytes` of locked, prefaulted memory (huge pages where
+   * available) that clips created from now on record into, so their audio
+   * never pages out or faults on the device thread. Clips that don't fit,
+   * and those created before, use the heap. Once per engine.
+   * @return False if already reserved or the memory can't be mapped.
+   */
+  bool reserveLockedAudioMemory(int64_t capacity_bytes);
+
+  /**
+   * Returns `{ totalBytes, budgetBytes, status, session, pendingFreeNodes,
+   * nodeStateBytes, nodeStates, audioArena, nodes: [...] }`: the session
+   * total against the budget, removed nodes not yet freed, the hot node
+   * state table, the locked clip arena's capacity and use, plus per-node
+   * figures (audio storage, peak caches, scratch buffers) depth-first from
+   * the root. Box figures include their subtree.
    */
-  juce::var getGraphState() const;
+  juce::var getMemoryUsage() const;
+
+  // Capture API
+  /**
+   * Starts recording the raw input and every command that changes the
+   * render (see `CaptureCommandType`) to `file`, for bit-identical offline
+   * replay with `replayCapture`. Captures replay from an empty session, so
+   * this fails unless the session is empty and the transport stopped.
+   *
+   * While capturing, commands and audio blocks take turns on a fence so
+   * each command lands exactly between two blocks: commands may wait up to
+   * one block, and the audio thread may wait for a command.
+   */
+  bool startCapture(const juce::File &file);
+
+  /**
+   * Stops capturing and closes the file.
+   * @return `{ file, blocks, commands, droppedBlocks, bytes }`, or void if
+   *         nothing was being captured.
+   */
+  juce::var stopCapture();
+
+  bool isCapturing() const { return active_capture.load() != nullptr; }
 
   /**
-   * Returns peak data for the specified node.
+   * Returns peak data for the specified node. A clip without an up-to-date
+   * peak cache gets one built in the background, for the next call.
    */
   juce::var getWaveform(const juce::String &uuid, int num_peaks) const;
 
@@ -59,17 +258,27 @@ class AudioEngine : public juce::AudioIODeviceCallback {
 
   /**
    * Creates a new node of the specified type in the current box.
+   * @return The new node's uuid, or an empty string if nothing was created.
    */
-  void createNode(const juce::String &type, double x = -1.0, double y = -1.0);
+  juce::String createNode(const juce::String &type, double x = -1.0,
+                          double y = -1.0);
 
   /**
    * Renames a specific node.
    */
   void renameNode(const juce::String &uuid, const juce::String &new_name);
 
-  void toggleSolo(const juce::String &uuid);
-  void togglePlay(const juce::String &uuid);
-  void toggleMute(const juce::String &uuid);
+  /**
+   * Removes a node and its subtree from the session (never the root). The
+   * focus moves out of it straight away; once the audio thread has applied
+   * the commands queued before it and dropped the scheduled events and solo
+   * pointing into it, its peak jobs are cancelled and it is retired.
+   */
+  uint64_t removeNode(const juce::String &uuid);
+
+  uint64_t toggleSolo(const juce::String &uuid);
+  uint64_t togglePlay(const juce::String &uuid);
+  uint64_t toggleMute(const juce::String &uuid);
 
   /**
    * Returns a list of available hardware audio inputs.
@@ -79,12 +288,42 @@ class AudioEngine : public juce::AudioIODeviceCallback {
   /**
    * Sets the input channel index for a specific node.
    */
-  void setNodeInput(const juce::String &uuid, int channel_index);
+  uint64_t setNodeInput(const juce::String &uuid, int channel_index);
 
   /**
    * Sets the non-destructive loop points for a specific node.
    */
-  void setLoopPoints(const juce::String &uuid, int64_t start, int64_t end);
+  uint64_t setLoopPoints(const juce::String &uuid, int64_t start, int64_t end);
+
+  /**
+   * Sets which clips an overloaded engine drops first.
+   */
+  bool setNodePriority(const juce::String &uuid,
+                       celestrian::NodePriority priority);
+
+  /**
+   * Has a worker thread render the box `uuid` a few blocks ahead while its
+   * subtree is predictable (looping playback only), so the callback only
+   * copies it. Returns false if `uuid` isn't a box.
+   */
+  bool setRenderAhead(const juce::String &uuid, bool should_render_ahead);
+
+  /**
+   * Runs the graph at a fixed block size (e.g. 32 or 64) whatever the device
+   * delivers, through a FIFO at the device boundary; 0 (the default) follows
+   * the device. The FIFO's latency is added to the output latency nodes
+   * compensate for. Restarts the backend and stops any capture; don't call
+   * while another thread is rendering an offline backend.
+   */
+  void setInternalBlockSize(int block_size);
+  int getInternalBlockSize() const { return internal_block_size.load(); }
+
+  /**
+   * Device output latency plus the block adapter's, in samples.
+   */
+  int getOutputLatency() const {
+    return prepared_output_latency.load() + block_adapter.getLatency();
+  }
 
   // AudioIODeviceCallback methods
   void audioDeviceIOCallbackWithContext(
@@ -97,28 +336,173 @@ class AudioEngine : public juce::AudioIODeviceCallback {
   void audioDeviceStopped() override;
 
  private:
-  void init(int inputs, int outputs);
   celestrian::AudioNode *findNodeByUuid(celestrian::AudioNode *node,
                                         const juce::String &uuid);
+  celestrian::ClipNode *findClipByUuid(const juce::String &uuid);
 
-  // LCM Timeline: Calculate the length at which the timeline wraps
-  // Returns LCM of all clip durations in focused_node
-  int64_t calculateTimelineLength() const;
+  /**
+   * Re-totals the session against the budget, caches the total for
+   * getGraphState() and logs when the status changes. Walks the whole
+   * session. Returns the session total.
+   */
+  celestrian::MemoryUsage checkMemoryBudget() const;
+
+  /**
+   * Processes one graph block, split at scheduled transport events, and
+   * advances the transport. Returns the timeline length it wrapped at.
+   */
+  int64_t renderGraph(const float *const *input_channel_data,
+                      int num_input_channels,
+                      float *const *output_channel_data,
+                      int num_output_channels, int num_samples);
+
+  // One slice of renderGraph() with no event inside it
+  int64_t renderSlice(const float *const *input_channel_data,
+                      int num_input_channels,
+                      float *const *output_channel_data,
+                      int num_output_channels, int num_samples);
+  celestrian::ProcessContext makeProcessContext(int num_samples);
+  juce::var getMemoryStatus() const;
+
+  // Queues a background peak-cache build for `clip` unless one is pending
+  void schedulePeakCache(celestrian::ClipNode &clip);
+  // Cancels every peak job and waits for the running ones
+  void cancelPeakJobs();
+  // The same for the clips in `subtree`
+  void cancelPeakJobs(celestrian::AudioNode &subtree);
+  // The same for the jobs passed to addGraphQueryJob(). Without
+  // navigation_mutex held: the jobs take it.
+  void cancelGraphQueryJobs();
+
+  // Holds the capture fence for one command and logs it; see startCapture()
+  class CommandFence;
+
+  /**
+   * Queues `command` under `fence` and releases the fence. Returns the
+   * command's id, or 0 if the queue was full; see the Mutations section
+   * above. `after_applied` runs once the command has been applied: here if
+   * the sender applied it, otherwise on the message thread.
+   */
+  uint64_t sendCommand(CommandFence &fence,
+                       const celestrian::EngineCommand &command,
+                       std::function<void()> after_applied = {});
+
+  // Polls the pending acknowledgements on a worker until at least one came
+  // in, then runs their follow-ups on the message thread and, if any are
+  // left, schedules itself again. One at a time: see ack_drain_scheduled.
+  void scheduleAckDrain();
 
-  juce::AudioDeviceManager device_manager;
+  // Applies queued commands. With command_drain_mutex held, the queue's
+  // only consumer.
+  void applyPendingCommands();
+  void applyCommand(const celestrian::EngineCommand &command);
 
-  // The root of the hierarchical audio graph
+  std::unique_ptr<celestrian::DeviceBackend> device_backend;
+
+  // Locked clip storage, if reserved. Declared before everything that can
+  // hold a clip.
+  celestrian::AudioMemoryArena audio_arena;
+
+  // Renders opted-in boxes ahead of the callback. Declared before the
+  // reclaimer and root_node: it outlives every box it renders.
+  // render_generation counts the graph and state changes that invalidate
+  // what it rendered.
+  celestrian::RenderAheadPool render_ahead_pool;
+  std::atomic<uint64_t> render_generation{0};
+  int64_t last_timeline_length = 0;  // Audio thread only
+
+  // Frees removed nodes (and replaced roots) off the audio and message
+  // threads. Declared before root_node, so it outlives the graph.
+  celestrian::NodeReclaimer node_reclaimer;
+
+  // The root of the hierarchical audio graph. Replaced only under
+  // navigation_mutex, which queries hold while they walk the graph.
   std::unique_ptr<celestrian::AudioNode> root_node;
 
-  // Navigation focus items
-  celestrian::AudioNode *focused_node = nullptr;
+  // Navigation focus items. Guarded by navigation_mutex: the message thread
+  // navigates while bridge jobs query the graph from worker threads.
+  // focused_node is only written under it, but is atomic: the audio thread
+  // reads it for the timeline length. A removed focus is moved off before
+  // its subtree is unlinked, and freed through node_reclaimer.
+  mutable std::recursive_mutex navigation_mutex;
+  std::atomic<celestrian::AudioNode *> focused_node{nullptr};
   std::vector<celestrian::AudioNode *> navigation_stack;
 
   // Global Transport
   std::atomic<bool> is_playing_global{false};
   std::atomic<int64_t> global_transport_pos{0};
+  celestrian::TransportClock transport_clock;
+  celestrian::CallbackMonitor callback_monitor;
+  celestrian::OverloadGovernor overload_governor;
+  int64_t next_overload_action = 0;  // Message thread only
+  celestrian::RecordingLog recording_log;
+  int64_t next_recording_entry = 0;  // Message thread only
+
+  // The device shape the graph was last prepared for. prepared_config is
+  // only written in audioDeviceAboutToStart(), while no block is running.
+  celestrian::DeviceConfig prepared_config;
+  std::atomic<double> prepared_sample_rate{44100.0};
+  std::atomic<int> prepared_output_latency{0};
+
+  // Fixed internal block size; the adapter is only touched by the callback
+  // and by audioDeviceAboutToStart()
+  std::atomic<int> internal_block_size{0};
+  celestrian::BlockSizeAdapter block_adapter;
+
+  // Sample-accurate transport events, and the clock they're timed on
+  // (samples the graph has rendered). Audio thread only, except while the
+  // backend is closed.
+  celestrian::TransportScheduler transport_scheduler;
+  int64_t graph_sample_time = 0;
+  std::vector<const float *> slice_inputs;
+  std::vector<float *> slice_outputs;
+
+  // Commands from the message thread. Senders take command_send_mutex to
+  // push; the callback drains at the start of each block, or, while it
+  // isn't running (see device_running), the sender does. Either drains
+  // under command_drain_mutex; the callback only tries it.
+  celestrian::CommandQueue command_queue;
+  std::mutex command_send_mutex;
+  std::mutex command_drain_mutex;
+  std::atomic<bool> device_running{false};
+
+  // sendCommand() follow-ups waiting for their command to be applied, all
+  // polled by a single drain job, so a burst of commands takes one worker
+  // and not one each
+  struct PendingAck {
+    uint64_t id = 0;
+    std::function<void()> follow_up;
+  };
+  std::mutex ack_mutex;
+  std::vector<PendingAck> pending_acks;  // Guarded by ack_mutex
+  bool ack_drain_scheduled = false;      // Guarded by ack_mutex
+
+  // Written only by applyCommand()
+  std::atomic<celestrian::AudioNode *> soloed_node{nullptr};
+
+  // Capture mode. active_capture is published under capture_fence.
+  std::mutex capture_fence;
+  std::unique_ptr<celestrian::SessionCapture> capture;
+  std::atomic<celestrian::SessionCapture *> active_capture{nullptr};
+  std::atomic<bool> callback_running{false};
+
+  std::atomic<int64_t> memory_budget_bytes{kDefaultMemoryBudgetBytes};
+  mutable std::atomic<MemoryStatus> memory_status{MemoryStatus::Ok};
+  // The session total as of the last checkMemoryBudget(). Marked stale by
+  // changes it doesn't see: peak caches built, graph prepared, rings added.
+  mutable std::atomic<int64_t> memory_total_bytes{0};
+  mutable std::atomic<bool> memory_total_stale{true};
+
+  // Peak-cache jobs by clip uuid; they hold raw node pointers
+  std::mutex peak_jobs_mutex;
+  std::map<juce::String, JobSystem::JobHandle> peak_jobs;
+
+  // Graph queries running on the JobSystem; see addGraphQueryJob()
+  std::mutex graph_query_jobs_mutex;
+  std::vector<JobSystem::JobHandle> graph_query_jobs;
 
-  juce::String soloed_node_uuid;
+  // Declared last: destroyed first, so no job outlives the graph it reads
+  JobSystem job_system;
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioEngine)
 };
@@ -0,0 +1,199 @@
+#include "audio_memory_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if JUCE_WINDOWS
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace celestrian {
+
+namespace {
+
+#if JUCE_LINUX && defined(MAP_HUGETLB)
+constexpr int64_t kHugePageBytes = 2 * 1024 * 1024;
+#endif
+
+int64_t getPageBytes() {
+#if JUCE_WINDOWS
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (int64_t)info.dwPageSize;
+#else
+  return (int64_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+int64_t roundUp(int64_t value, int64_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+}  // namespace
+
+AudioMemoryArena::~AudioMemoryArena() {
+  jassert(allocations.empty());
+  release();
+}
+
+bool AudioMemoryArena::reserve(int64_t capacity_bytes) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (base != nullptr || capacity_bytes <= 0) return false;
+
+  int64_t size = roundUp(capacity_bytes, getPageBytes());
+  void *region = nullptr;
+#if JUCE_WINDOWS
+  region = VirtualAlloc(nullptr, (SIZE_T)size, MEM_RESERVE | MEM_COMMIT,
+                        PAGE_READWRITE);
+  if (region == nullptr) return false;
+  // The working set must have room for the pages before they can be locked
+  SIZE_T min_set = 0, max_set = 0;
+  if (GetProcessWorkingSetSize(GetCurrentProcess(), &min_set, &max_set))
+    SetProcessWorkingSetSize(GetCurrentProcess(), min_set + (SIZE_T)size,
+                             max_set + (SIZE_T)size);
+  is_locked = VirtualLock(region, (SIZE_T)size) != 0;
+#else
+#if JUCE_LINUX && defined(MAP_HUGETLB)
+  // Explicit huge pages only exist if the system reserved some
+  const int64_t huge_size = roundUp(capacity_bytes, kHugePageBytes);
+  region = mmap(nullptr, (size_t)huge_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (region != MAP_FAILED) {
+    size = huge_size;
+    is_huge = true;
+  } else {
+    region = nullptr;
+  }
+#endif
+  if (region == nullptr) {
+    region = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) return false;
+#if defined(MADV_HUGEPAGE)
+    // Transparent huge pages, where enabled
+    madvise(region, (size_t)size, MADV_HUGEPAGE);
+#endif
+  }
+  is_locked = mlock(region, (size_t)size) == 0;
+#endif
+
+  if (!is_locked)
+    juce::Logger::writeToLog(
+        "AudioMemoryArena: Couldn't lock " + juce::String(size) +
+        " bytes (raise the memlock limit); using it unlocked.");
+
+  // Touch every page now rather than on the device thread
+  std::memset(region, 0, (size_t)size);
+
+  base = static_cast<char *>(region);
+  capacity = size;
+  free_blocks[0] = size;
+  return true;
+}
+
+void AudioMemoryArena::release() {
+  if (base == nullptr) return;
+#if JUCE_WINDOWS
+  if (is_locked) VirtualUnlock(base, (SIZE_T)capacity);
+  VirtualFree(base, 0, MEM_RELEASE);
+#else
+  if (is_locked) munlock(base, (size_t)capacity);
+  munmap(base, (size_t)capacity);
+#endif
+  base = nullptr;
+}
+
+float *AudioMemoryArena::allocate(int64_t num_floats) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (base == nullptr || num_floats <= 0) return nullptr;
+  const int64_t size =
+      roundUp(num_floats * (int64_t)sizeof(float), kAlignment);
+
+  // First fit; blocks are kept aligned, so any fitting block will do
+  auto it = std::find_if(free_blocks.begin(), free_blocks.end(),
+                         [size](const auto &block) {
+                           return block.second >= size;
+                         });
+  if (it == free_blocks.end()) {
+    ++failed;
+    return nullptr;
+  }
+
+  const int64_t offset = it->first;
+  const int64_t remaining = it->second - size;
+  free_blocks.erase(it);
+  if (remaining > 0) free_blocks[offset + size] = remaining;
+  allocations[offset] = size;
+  used += size;
+  peak_used = std::max(peak_used, used);
+
+  // Freed blocks keep their old samples
+  auto *data = reinterpret_cast<float *>(base + offset);
+  std::memset(data, 0, (size_t)size);
+  return data;
+}
+
+void AudioMemoryArena::free(float *data) {
+  if (data == nullptr) return;
+  std::lock_guard<std::mutex> lock(mutex);
+  const int64_t offset = reinterpret_cast<char *>(data) - base;
+  auto found = allocations.find(offset);
+  jassert(found != allocations.end());
+  if (found == allocations.end()) return;
+
+  int64_t start = offset;
+  int64_t size = found->second;
+  allocations.erase(found);
+  used -= size;
+
+  // Merge with the free blocks either side
+  auto next = free_blocks.lower_bound(start);
+  if (next != free_blocks.end() && next->first == start + size) {
+    size += next->second;
+    next = free_blocks.erase(next);
+  }
+  if (next != free_blocks.begin()) {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == start) {
+      start = previous->first;
+      size += previous->second;
+      free_blocks.erase(previous);
+    }
+  }
+  free_blocks[start] = size;
+}
+
+AudioMemoryArena::Stats AudioMemoryArena::getStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  Stats stats;
+  stats.capacity_bytes = base != nullptr ? capacity : 0;
+  stats.used_bytes = used;
+  stats.peak_used_bytes = peak_used;
+  for (const auto &block : free_blocks)
+    stats.largest_free_bytes = std::max(stats.largest_free_bytes,
+                                        block.second);
+  stats.num_allocations = (int)allocations.size();
+  stats.failed_allocations = failed;
+  stats.locked = is_locked;
+  stats.huge_pages = is_huge;
+  return stats;
+}
+
+juce::var AudioMemoryArena::toVar() const {
+  const auto stats = getStats();
+  juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+  obj->setProperty("capacityBytes", (double)stats.capacity_bytes);
+  obj->setProperty("usedBytes", (double)stats.used_bytes);
+  obj->setProperty("peakUsedBytes", (double)stats.peak_used_bytes);
+  obj->setProperty("largestFreeBytes", (double)stats.largest_free_bytes);
+  obj->setProperty("allocations", stats.num_allocations);
+  obj->setProperty("failedAllocations", (double)stats.failed_allocations);
+  obj->setProperty("locked", stats.locked);
+  obj->setProperty("hugePages", stats.huge_pages);
+  return juce::var(obj.get());
+}
+
+}  // namespace celestrian
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+namespace celestrian {
+
+/**
+ * A fixed region of memory for clip audio that the device thread can touch
+ * without page faults: reserved once, backed by huge pages where the system
+ * has them, locked into RAM (mlock / VirtualLock) and prefaulted, so neither
+ * first touch nor memory pressure stalls a block.
+ *
+ * Allocation is first fit with coalescing, under a mutex: clips allocate
+ * when created and free when reclaimed, never on the audio thread. When the
+ * arena is full, callers fall back to the heap; getStats() counts those
+ * misses so the capacity can be planned.
+ */
+class AudioMemoryArena {
+ public:
+  // Every allocation starts on a cache line
+  static constexpr int64_t kAlignment = 64;
+
+  struct Stats {
+    int64_t capacity_bytes = 0;
+    int64_t used_bytes = 0;
+    int64_t peak_used_bytes = 0;
+    int64_t largest_free_bytes = 0;
+    int num_allocations = 0;
+    int64_t failed_allocations = 0;  // Requests that went to the heap
+    bool locked = false;             // Pinned in RAM
+    bool huge_pages = false;         // Backed by explicit huge pages
+  };
+
+  AudioMemoryArena() = default;
+
+  /** Every allocation must have been freed. */
+  ~AudioMemoryArena();
+
+  /**
+   * Maps, locks and prefaults `capacity_bytes` (rounded up to whole pages).
+   * Only once per arena. A region the system refuses to lock is still used,
+   * just unlocked; getStats() says which.
+   * @return False if the arena was already reserved or can't be mapped.
+   */
+  bool reserve(int64_t capacity_bytes);
+
+  bool isReserved() const { return base != nullptr; }
+
+  /**
+   * Returns zeroed storage for `num_floats` samples, or nullptr if the arena
+   * isn't reserved or has no block that large. Never on the audio thread.
+   */
+  float *allocate(int64_t num_floats);
+
+  /** Returns storage from allocate(). Any thread but the audio thread. */
+  void free(float *data);
+
+  Stats getStats() const;
+
+  /** Returns getStats() for the bridge. */
+  juce::var toVar() const;
+
+ private:
+  void release();
+
+  char *base = nullptr;
+  int64_t capacity = 0;
+  bool is_locked = false;
+  bool is_huge = false;
+
+  mutable std::mutex mutex;
+  std::map<int64_t, int64_t> free_blocks;  // Offset to size, coalesced
+  std::map<int64_t, int64_t> allocations;  // Offset to size
+  int64_t used = 0;
+  int64_t peak_used = 0;
+  int64_t failed = 0;
+
+  JUCE_DECLARE_NON_COPYABLE(AudioMemoryArena)
+};
+
+}  // namespace celestrian
@@ -4,27 +4,85 @@
 #include <juce_core/juce_core.h>
 
 #include <atomic>
+#include <memory>
+
+#include "dsp_profile.h"
+#include "memory_usage.h"
+#include "metadata_query.h"
+#include "node_state_table.h"
+#include "trace_recorder.h"
+#include "transport_scheduler.h"
 
 namespace celestrian {
 
+// Visual width of one quantum in the UI (mirrors `baseWidth` in app.js).
+constexpr double kQuantumWidthPixels = 200.0;
+
+class AudioNode;
+class NodeReclaimer;
+class RecordingLog;
+class RenderScratch;
+
+/**
+ * How much work the graph sheds to make the block deadline, cheapest first.
+ * Set by the engine's OverloadGovernor; each level includes the ones below.
+ */
+enum class ShedLevel {
+  None,
+  SkipMeters,          // No meter or waveform work
+  SkipSilenced,        // Silenced nodes skip work they still do when muted
+  DropLowPriority,     // Low priority clips fade out
+  DropNormalPriority,  // Normal priority clips fade out too
+};
+
+/**
+ * Which clips an overloaded engine drops first. Essential clips and clips
+ * that are recording are never dropped.
+ */
+enum class NodePriority { Low, Normal, Essential };
+
 /**
  * Context for audio processing, passed down the recursive graph.
  */
 struct ProcessContext {
   double sample_rate = 44100.0;
   int num_samples = 0;
+  // Set while the engine runs the graph at a fixed internal block size: the
+  // block is exactly this long, and selectLoopKernels() picks clip playback
+  // kernels specialized for it. 0 when blocks follow the device, or a
+  // transport event split this one.
+  int fixed_block_size = 0;
   bool is_playing = false;
   bool is_recording = false;
 
   // Global transport master position (in samples)
   int64_t master_pos = 0;
 
-  // Latency compensation (in samples)
+  // Samples the engine has rendered before this block; never wraps. Times
+  // for `scheduler`, which is null when a node is processed on its own.
+  int64_t sample_time = 0;
+  TransportScheduler *scheduler = nullptr;
+
+  // Where clips log recording starts and commits from the block thread;
+  // null when a node is processed on its own
+  RecordingLog *recording_log = nullptr;
+
+  // Latency compensation (in samples). output_latency includes the block
+  // adapter's FIFO when the engine uses a fixed internal block size.
   int input_latency = 0;
   int output_latency = 0;
 
-  // Solo state
-  juce::String solo_node_uuid;
+  // The soloed node, if any: everything outside its subtree is silenced
+  const AudioNode *solo_node = nullptr;
+
+  // Work the graph may skip this block to avoid a dropout
+  ShedLevel shed_level = ShedLevel::None;
+
+  // Where the transport wraps, as of the previous block, and a counter the
+  // engine bumps on every change that could alter what the graph renders.
+  // Together they tell RenderAhead whether its predictions still hold.
+  int64_t timeline_length = 0;
+  uint64_t graph_generation = 0;
 };
 
 /**
@@ -39,8 +97,12 @@ enum class NodeType { Clip, Box, Unknown };
 class AudioNode {
  public:
   AudioNode(juce::String node_name)
-      : node_name(std::move(node_name)), node_uuid(juce::Uuid().toString()) {}
-  virtual ~AudioNode() = default;
+      : node_name(std::move(node_name)), node_uuid(juce::Uuid().toString()) {
+    updateTraceLabel();
+  }
+  virtual ~AudioNode() {
+    if (loose_state == nullptr) states().release(state_handle);
+  }
 
   /**
    * Processes audio into the provided output channels or captures from input.
@@ -55,6 +117,71 @@ class AudioNode {
                        int num_output_channels,
                        const ProcessContext &context) = 0;
 
+  /**
+   * Allocates everything process() needs for blocks of up to
+   * `max_block_size` samples, so the audio thread never has to. Called
+   * before the node is published to the audio thread and again whenever the
+   * device restarts, never concurrently with process().
+   */
+  virtual void prepare(double sample_rate, int max_block_size,
+                       int num_channels) {
+    juce::ignoreUnused(sample_rate, max_block_size, num_channels);
+  }
+
+  /**
+   * Applies a scheduled transport event at its exact sample, between two
+   * process() calls. `context` describes the slice that starts there.
+   */
+  virtual void handleTransportEvent(const TransportEvent &event,
+                                    const ProcessContext &context) {
+    juce::ignoreUnused(context);
+    if (event.type == TransportEventType::Mute) setMuted(true);
+    if (event.type == TransportEventType::Unmute) setMuted(false);
+  }
+
+  /**
+   * Adds what process() would render for `context` to `outputs`, sample for
+   * sample, without changing any state, so a RenderAhead worker can run it
+   * ahead of time. Only playback is predictable this way.
+   * @param scratch The worker's working memory for boxes on the way down.
+   * @return False if the subtree isn't predictable (recording, or waiting
+   *         to start or stop) or can't be read right now; `outputs` are
+   *         then garbage.
+   */
+  virtual bool renderAhead(float *const *outputs, int num_outputs,
+                           const ProcessContext &context,
+                           RenderScratch &scratch) const {
+    juce::ignoreUnused(outputs, num_outputs, context, scratch);
+    return false;
+  }
+
+  /**
+   * Moves the UI playhead as process() would, for blocks whose audio came
+   * from a RenderAhead ring instead.
+   */
+  virtual void advancePlayhead(const ProcessContext &context) {
+    juce::ignoreUnused(context);
+  }
+
+  /**
+   * True if process() would add nothing to the outputs for `context` and
+   * needs none of the input, so the parent may skip it and call
+   * skipSilentBlock() instead. Must be cheap: it runs every block. Audio
+   * thread.
+   */
+  virtual bool isSilentFor(const ProcessContext &context) const {
+    juce::ignoreUnused(context);
+    return false;
+  }
+
+  /**
+   * Stands in for process() on a block isSilentFor() reported: moves the
+   * playhead and settles any state process() would have.
+   */
+  virtual void skipSilentBlock(const ProcessContext &context) {
+    advancePlayhead(context);
+  }
+
   /**
    * Generates waveform peaks for visualization.
    * @param num_peaks The number of peak samples to return.
@@ -63,33 +190,34 @@ class AudioNode {
 
   /**
    * Returns a JSON object containing node metadata for UI rendering.
+   * @param query Bounds on how deep and how wide the serialization goes.
    */
-  virtual juce::var getMetadata() const {
-    auto *obj = new juce::DynamicObject();
-    obj->setProperty("id", node_uuid);
-    obj->setProperty("name", node_name);
-    obj->setProperty("type", getNodeTypeString());
-    obj->setProperty("x", (double)x_pos.load());
-    obj->setProperty("y", (double)y_pos.load());
-    obj->setProperty("w", (double)width.load());
-    obj->setProperty("h", (double)height.load());
-    obj->setProperty("currentPeak", (float)last_block_peak.load());
-    if (isRecording())
-      obj->setProperty("duration", (double)live_duration_samples.load());
-    else
-      obj->setProperty("duration", (double)duration_samples.load());
-    obj->setProperty("loopStart", (double)loop_start_samples.load());
-    obj->setProperty("loopEnd", (double)loop_end_samples.load());
-    obj->setProperty("effectiveQuantum", (double)getEffectiveQuantum());
-    obj->setProperty("playhead", (double)playhead_pos.load());
-    obj->setProperty("isRecording", (bool)is_node_recording.load());
-    obj->setProperty("isMuted", (bool)is_muted.load());
-    obj->setProperty("anchorPhase", (double)anchor_phase_samples.load());
-    obj->setProperty("launchPoint", (double)launch_point_samples.load());
-    return juce::var(obj);
+  virtual juce::var getMetadata(const MetadataQuery &query) const {
+    juce::ignoreUnused(query);
+    return makeMetadata(getEffectiveQuantum());
+  }
+
+  void setName(const juce::String &new_name) {
+    node_name = new_name;
+    updateTraceLabel();
+  }
+
+  /**
+   * Interns the name as the trace label while tracing is on, and clears the
+   * label otherwise: interned strings are never freed, so untraced sessions
+   * intern nothing. AudioEngine::startTrace() updates every node's label.
+   */
+  void updateTraceLabel() const {
+    trace_label.store(TraceRecorder::isEnabled()
+                          ? TraceRecorder::intern(node_name)
+                          : "");
   }
 
-  void setName(const juce::String &new_name) { node_name = new_name; }
+  /**
+   * Returns the node name as a stable C string for trace events. Safe to call
+   * from the audio thread.
+   */
+  const char *getTraceLabel() const { return trace_label.load(); }
   juce::String getName() const { return node_name; }
   juce::String getUuid() const { return node_uuid; }
 
@@ -106,7 +234,7 @@ class AudioNode {
     }
   }
 
-  virtual bool isRecording() const { return is_node_recording.load(); }
+  virtual bool isRecording() const { return isNodeRecording(); }
 
   /**
    * Returns the latest peak sample level for real-time visualization.
@@ -114,48 +242,226 @@ class AudioNode {
   virtual float getCurrentPeak() const = 0;
 
   // Hierarchy
-  void setParent(AudioNode *p) { parent = p; }
-  AudioNode *getParent() const { return parent; }
+  // Atomic: a block may still be running a child its box just unlinked
+  void setParent(AudioNode *p) { parent.store(p); }
+  AudioNode *getParent() const { return parent.load(); }
+
+  /** True if `node` is this node or one of its ancestors. */
+  bool isInside(const AudioNode *node) const {
+    for (const AudioNode *ancestor = this; ancestor != nullptr;
+         ancestor = ancestor->getParent())
+      if (ancestor == node) return true;
+    return false;
+  }
+
+  /**
+   * Where nodes removed below this one are handed to be freed. The engine
+   * sets it on the root; null (the default) frees them on the spot.
+   */
+  void setReclaimer(NodeReclaimer *r) { reclaimer = r; }
+  NodeReclaimer *getReclaimer() const {
+    for (const AudioNode *node = this; node != nullptr;
+         node = node->getParent())
+      if (node->reclaimer != nullptr) return node->reclaimer;
+    return nullptr;
+  }
 
+  // Transport state. The fields the audio thread reads every block live in
+  // this node's NodeStateTable row, next to those of its siblings, or in
+  // loose_state if the table was full.
   void setLoopPoints(int64_t start, int64_t end) {
-    loop_start_samples.store(start);
-    loop_end_samples.store(end);
+    loopStartField().store(start);
+    loopEndField().store(end);
   }
+  int64_t getLoopStart() const { return loopStartField().load(); }
+  int64_t getLoopEnd() const { return loopEndField().load(); }
 
-  int64_t getLoopStart() const { return loop_start_samples.load(); }
-  int64_t getLoopEnd() const { return loop_end_samples.load(); }
+  /** Where in the loop playback is, from 0 to 1. */
+  double getPlayheadPosition() const { return playheadPosField().load(); }
+  void setPlayheadPosition(double position) {
+    playheadPosField().store(position);
+  }
+
+  /** Loop length in samples; 0 until something is recorded. */
+  int64_t getDurationSamples() const { return durationField().load(); }
+  void setDurationSamples(int64_t duration) {
+    durationField().store(duration);
+  }
+
+  /** Where playback starts, so the loop stays aligned (default: 0). */
+  int64_t getLaunchPoint() const { return launchPointField().load(); }
+  void setLaunchPoint(int64_t launch_point) {
+    launchPointField().store(launch_point);
+  }
+
+  bool isNodeRecording() const { return recordingFlagField().load(); }
+  void setNodeRecording(bool recording) {
+    recordingFlagField().store(recording);
+  }
+
+  bool isMuted() const { return mutedFlagField().load(); }
+  void setMuted(bool muted) { mutedFlagField().store(muted); }
+
+  float getLastBlockPeak() const { return lastBlockPeakField().load(); }
+  void setLastBlockPeak(float peak) { lastBlockPeakField().store(peak); }
+
+  /** Which nodes keep playing under overload; any thread may set it. */
+  NodePriority getPriority() const { return priority.load(); }
+  void setPriority(NodePriority node_priority) {
+    priority.store(node_priority);
+  }
+
+  /** Timing of this node's process(), filled in by whoever calls it. */
+  DspProfile &getDspProfile() { return dsp_profile; }
+  const DspProfile &getDspProfile() const { return dsp_profile; }
+
+  /** This node's row in the NodeStateTable, or kNoRow if it has none. */
+  NodeHandle getStateHandle() const { return state_handle; }
+
+  /**
+   * Moves this node's row into `group`'s runs, so it shares cache lines with
+   * the other nodes there. BoxNode::addChild() groups children by parent.
+   * Only while no other thread can reach the node.
+   */
+  void setStateGroup(const void *group) {
+    if (loose_state == nullptr)
+      state_handle = states().regroup(state_handle, group);
+  }
 
   // Quantum Logic
   virtual int64_t getIntrinsicDuration() const = 0;
   virtual int64_t getEffectiveQuantum() const {
-    if (parent) return parent->getEffectiveQuantum();
+    if (auto *p = getParent()) return p->getEffectiveQuantum();
     return 0;
   }
 
+  /**
+   * Returns the duration shown when this node appears in a collapsed summary.
+   * Containers return a cached aggregate instead of walking their subtree.
+   */
+  virtual int64_t getSummaryDuration() const { return getDurationSamples(); }
+
+  /**
+   * Returns getIntrinsicDuration() as of the last processed block.
+   * Containers return a cached aggregate instead of walking their subtree.
+   */
+  virtual int64_t getCachedIntrinsicDuration() const {
+    return getIntrinsicDuration();
+  }
+
+  /**
+   * Returns how many nodes the last processed block ran, this one included.
+   */
+  virtual int getActiveNodeCount() const { return 1; }
+
+  /**
+   * Returns the memory held by this node. Containers include their subtree.
+   */
+  virtual MemoryUsage getMemoryUsage() const { return {}; }
+
   // Spatial arrangement in the parent stack/plane
   std::atomic<double> x_pos{0.0}, y_pos{0.0};
   std::atomic<double> width{200.0}, height{100.0};
 
-  // Transport state
-  std::atomic<double> playhead_pos{0.0};          // 0.0 to 1.0 (normalized)
-  std::atomic<int64_t> duration_samples{0};       // Length of the loop
-  std::atomic<int64_t> live_duration_samples{0};  // Live count during recording
-  std::atomic<int64_t> loop_start_samples{0};
-  std::atomic<int64_t> loop_end_samples{0};
-  std::atomic<bool> is_node_recording{false};
-  std::atomic<bool> is_muted{false};
-  std::atomic<float> last_block_peak{0.0f};
+  // Live count during recording
+  std::atomic<int64_t> live_duration_samples{0};
 
   // Phase-aligned recording: where in the quantum grid this clip was recorded
   std::atomic<int64_t> anchor_phase_samples{0};
-  // Launch point: where playback starts to maintain alignment (default: 0)
-  std::atomic<int64_t> launch_point_samples{0};
-
-  AudioNode *parent = nullptr;
 
  protected:
+  /**
+   * The fields every node reports. `effective_quantum` is passed in, so a
+   * container works it out once for all of its children.
+   */
+  juce::var makeMetadata(int64_t effective_quantum) const {
+    auto *obj = new juce::DynamicObject();
+    obj->setProperty("id", node_uuid);
+    obj->setProperty("name", node_name);
+    obj->setProperty("type", getNodeTypeString());
+    obj->setProperty("x", (double)x_pos.load());
+    obj->setProperty("y", (double)y_pos.load());
+    obj->setProperty("w", (double)width.load());
+    obj->setProperty("h", (double)height.load());
+    obj->setProperty("currentPeak", (float)getLastBlockPeak());
+    if (isRecording())
+      obj->setProperty("duration", (double)live_duration_samples.load());
+    else
+      obj->setProperty("duration", (double)getDurationSamples());
+    obj->setProperty("loopStart", (double)getLoopStart());
+    obj->setProperty("loopEnd", (double)getLoopEnd());
+    obj->setProperty("effectiveQuantum", (double)effective_quantum);
+    obj->setProperty("playhead", (double)getPlayheadPosition());
+    obj->setProperty("isRecording", (bool)isNodeRecording());
+    obj->setProperty("isMuted", (bool)isMuted());
+    const auto node_priority = getPriority();
+    obj->setProperty("priority",
+                     node_priority == NodePriority::Low         ? "low"
+                     : node_priority == NodePriority::Essential ? "essential"
+                                                                : "normal");
+    obj->setProperty("anchorPhase", (double)anchor_phase_samples.load());
+    obj->setProperty("launchPoint", (double)getLaunchPoint());
+    if (DspProfile::isEnabled()) obj->setProperty("dsp", dsp_profile.toVar());
+    return juce::var(obj);
+  }
+
   juce::String node_name;
   juce::String node_uuid;
+
+ private:
+  static NodeStateTable &states() { return NodeStateTable::getInstance(); }
+
+  std::atomic<double> &playheadPosField() const {
+    return loose_state ? loose_state->playhead_pos
+                       : states().getPlayheadPos(state_handle);
+  }
+  std::atomic<int64_t> &durationField() const {
+    return loose_state ? loose_state->duration_samples
+                       : states().getDuration(state_handle);
+  }
+  std::atomic<int64_t> &loopStartField() const {
+    return loose_state ? loose_state->loop_start_samples
+                       : states().getLoopStart(state_handle);
+  }
+  std::atomic<int64_t> &loopEndField() const {
+    return loose_state ? loose_state->loop_end_samples
+                       : states().getLoopEnd(state_handle);
+  }
+  std::atomic<int64_t> &launchPointField() const {
+    return loose_state ? loose_state->launch_point_samples
+                       : states().getLaunchPoint(state_handle);
+  }
+  std::atomic<float> &lastBlockPeakField() const {
+    return loose_state ? loose_state->last_block_peak
+                       : states().getLastBlockPeak(state_handle);
+  }
+  std::atomic<bool> &recordingFlagField() const {
+    return loose_state ? loose_state->is_node_recording
+                       : states().getRecordingFlag(state_handle);
+  }
+  std::atomic<bool> &mutedFlagField() const {
+    return loose_state ? loose_state->is_muted
+                       : states().getMutedFlag(state_handle);
+  }
+
+  // Only read under overload, so set directly rather than by command
+  std::atomic<NodePriority> priority{NodePriority::Normal};
+
+  // Cost of this node's process() including its subtree, timed by the caller
+  DspProfile dsp_profile;
+
+  // Interned copy of node_name, readable without touching juce::String
+  mutable std::atomic<const char *> trace_label{""};
+
+  std::atomic<AudioNode *> parent{nullptr};
+  NodeReclaimer *reclaimer = nullptr;
+
+  NodeHandle state_handle{states().acquire()};
+  // The node's own fields once the table is full; null while it has a row
+  std::unique_ptr<NodeStateTable::LooseRow> loose_state{
+      state_handle == NodeStateTable::kNoRow
+          ? std::make_unique<NodeStateTable::LooseRow>()
+          : nullptr};
 };
 
 }  // namespace celestrian
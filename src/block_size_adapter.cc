@@ -0,0 +1,49 @@
+#include "block_size_adapter.h"
+
+#include <numeric>
+
+namespace celestrian {
+
+void BlockSizeAdapter::prepare(int new_block_size, int device_block_size,
+                               int num_inputs, int num_outputs) {
+  block_size = std::max(0, new_block_size);
+  initial_latency = 0;
+  if (block_size > 0 && device_block_size > 0)
+    initial_latency = block_size - std::gcd(block_size, device_block_size);
+  else if (block_size > 0)
+    initial_latency = block_size - 1;  // Works for any device block size
+
+  const int fifo_size = std::max(1, block_size);
+  input_fifo.setSize(std::max(1, num_inputs), fifo_size);
+  output_fifo.setSize(std::max(1, num_outputs), 2 * fifo_size);
+  render_outputs.assign((size_t)output_fifo.getNumChannels(), nullptr);
+  underruns.store(0, std::memory_order_relaxed);
+  reset();
+}
+
+void BlockSizeAdapter::reset() {
+  input_fifo.clear();
+  output_fifo.clear();
+  input_fill = 0;
+  // Primed with silence: the first blocks out are the latency
+  output_fill = initial_latency;
+  latency.store(initial_latency, std::memory_order_relaxed);
+}
+
+int BlockSizeAdapter::emit(float *const *outputs, int num_outputs, int offset,
+                           int max_samples) {
+  const int n = std::min(output_fill, max_samples);
+  if (n <= 0) return 0;
+
+  for (int ch = 0; ch < output_fifo.getNumChannels(); ++ch) {
+    auto *fifo = output_fifo.getWritePointer(ch);
+    if (ch < num_outputs && outputs[ch] != nullptr)
+      juce::FloatVectorOperations::copy(outputs[ch] + offset, fifo, n);
+    // Keep what's left at the front; at most one block
+    std::copy(fifo + n, fifo + output_fill, fifo);
+  }
+  output_fill -= n;
+  return n;
+}
+
+}  // namespace celestrian
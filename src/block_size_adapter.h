@@ -0,0 +1,121 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace celestrian {
+
+/**
+ * Runs a render function at a fixed block size whatever the device hands
+ * over. Input is buffered until a whole block is available; output goes
+ * through a FIFO primed with `getLatency()` samples of silence, so every
+ * device block can be filled.
+ *
+ * The latency is the smallest that works for the device block size given to
+ * prepare(): 0 when it is a multiple of the fixed size, at most one block
+ * less a sample otherwise. A device block of another size that would run the
+ * FIFO dry is padded with silence, which raises the latency for good (see
+ * `getUnderruns()`).
+ */
+class BlockSizeAdapter {
+ public:
+  /**
+   * Sizes the FIFOs and resets them. `block_size` 0 disables the adapter.
+   * Not realtime safe; call while no block is running.
+   */
+  void prepare(int block_size, int device_block_size, int num_inputs,
+               int num_outputs);
+
+  /** Drops buffered audio and restores the initial latency. */
+  void reset();
+
+  bool isActive() const { return block_size > 0; }
+  int getBlockSize() const { return block_size; }
+
+  /** Samples the output lags the input by. Safe from any thread. */
+  int getLatency() const { return latency.load(std::memory_order_relaxed); }
+
+  /** Input samples buffered towards the next block. Audio thread only. */
+  int getPendingInput() const { return input_fill; }
+
+  /** Device blocks that had to be padded with silence since prepare(). */
+  int64_t getUnderruns() const {
+    return underruns.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Feeds one device block through `render`, which is called with
+   * `(inputs, num_inputs, outputs, num_outputs, num_samples)` for each whole
+   * fixed-size block, outputs cleared. Audio thread only; doesn't allocate.
+   */
+  template <typename RenderFunction>
+  void process(const float *const *inputs, int num_inputs,
+               float *const *outputs, int num_outputs, int num_samples,
+               RenderFunction &&render) {
+    int consumed = 0;
+    int emitted = 0;
+    while (consumed < num_samples) {
+      const int take =
+          std::min(block_size - input_fill, num_samples - consumed);
+      for (int ch = 0; ch < input_fifo.getNumChannels(); ++ch) {
+        auto *dest = input_fifo.getWritePointer(ch, input_fill);
+        if (ch < num_inputs && inputs[ch] != nullptr)
+          juce::FloatVectorOperations::copy(dest, inputs[ch] + consumed, take);
+        else
+          juce::FloatVectorOperations::clear(dest, take);
+      }
+      input_fill += take;
+      consumed += take;
+
+      if (input_fill == block_size) {
+        // At most latency (< block_size) samples wait in the output FIFO
+        jassert(output_fill + block_size <= output_fifo.getNumSamples());
+        for (int ch = 0; ch < output_fifo.getNumChannels(); ++ch) {
+          render_outputs[(size_t)ch] =
+              output_fifo.getWritePointer(ch, output_fill);
+          juce::FloatVectorOperations::clear(render_outputs[(size_t)ch],
+                                             block_size);
+        }
+        render(input_fifo.getArrayOfReadPointers(),
+               input_fifo.getNumChannels(), render_outputs.data(),
+               output_fifo.getNumChannels(), block_size);
+        output_fill += block_size;
+        input_fill = 0;
+      }
+
+      emitted += emit(outputs, num_outputs, emitted, num_samples - emitted);
+    }
+
+    // Only a block of an unexpected size gets here short
+    if (emitted < num_samples) {
+      for (int ch = 0; ch < num_outputs; ++ch)
+        if (outputs[ch] != nullptr)
+          juce::FloatVectorOperations::clear(outputs[ch] + emitted,
+                                             num_samples - emitted);
+      latency.fetch_add(num_samples - emitted, std::memory_order_relaxed);
+      underruns.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  // Moves up to `max_samples` from the front of the output FIFO to the
+  // device outputs at `offset`. Returns how many moved.
+  int emit(float *const *outputs, int num_outputs, int offset,
+           int max_samples);
+
+  int block_size = 0;
+  int initial_latency = 0;
+  std::atomic<int> latency{0};
+  std::atomic<int64_t> underruns{0};
+
+  juce::AudioBuffer<float> input_fifo;
+  int input_fill = 0;
+  juce::AudioBuffer<float> output_fifo;
+  int output_fill = 0;
+  std::vector<float *> render_outputs;
+};
+
+}  // namespace celestrian
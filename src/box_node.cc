@@ -1,25 +1,160 @@
 #include "box_node.h"
 
+#include <limits>
+
+#include "node_reclaimer.h"
+#include "render_ahead.h"
+
 namespace celestrian {
 
+namespace {
+// The shorter of two durations, where 0 means none
+int64_t shortestPositive(int64_t shortest, int64_t duration) {
+  if (duration <= 0) return shortest;
+  return shortest == 0 ? duration : std::min(shortest, duration);
+}
+
+int64_t gcd(int64_t a, int64_t b) {
+  while (b != 0) {
+    int64_t t = b;
+    b = a % b;
+    a = t;
+  }
+  return a;
+}
+
+// The least common multiple of two durations, where 0 means none
+int64_t lcm(int64_t a, int64_t b) {
+  if (a <= 0 || b <= 0) return std::max<int64_t>(std::max(a, b), 0);
+  return (a / gcd(a, b)) * b;
+}
+}  // namespace
+
 BoxNode::BoxNode(juce::String node_name) : AudioNode(std::move(node_name)) {
-  // Basic stereo buffer for summing, resized as needed in process()
+  block_children_list = std::make_unique<const ChildList>();
+  block_children.store(block_children_list.get());
+  // Basic stereo buffer for summing until prepare() sizes it for the device
   mix_buffer.setSize(2, 512);
+  mix_buffer_bytes.store(MemoryUsage::bytesForSamples(2, 512));
 }
 
-juce::var BoxNode::getMetadata() const {
+BoxNode::~BoxNode() = default;
+
+void BoxNode::prepare(double sample_rate, int max_block_size,
+                      int num_channels) {
+  // Before children_mutex: the render-ahead worker takes the two the other
+  // way round
+  if (auto *ahead = render_ahead_ptr.load())
+    ahead->prepare(max_block_size, num_channels);
+
   std::lock_guard<std::recursive_mutex> lock(children_mutex);
-  auto base = AudioNode::getMetadata();
+  mix_buffer.setSize(std::max(1, num_channels), std::max(1, max_block_size),
+                     false, true, true);
+  mix_buffer_bytes.store(MemoryUsage::bytesForSamples(
+      mix_buffer.getNumChannels(), mix_buffer.getNumSamples()));
+
+  prepared_sample_rate.store(sample_rate);
+  prepared_num_channels.store(num_channels);
+  prepared_block_size.store(max_block_size);
+
+  for (auto &child : children)
+    child->prepare(sample_rate, max_block_size, num_channels);
+}
+
+juce::var BoxNode::getMetadata(const MetadataQuery &query) const {
+  std::unique_lock<std::recursive_mutex> lock(children_mutex, std::defer_lock);
+  {
+    CELESTRIAN_TRACE_SCOPE("lock", "BoxNode::children_mutex");
+    lock.lock();
+  }
+  // Worked out once for this box and all its children, from one level of
+  // cached durations: a bounded query never walks below what it returns. A
+  // summary only reads what the last block cached.
+  int64_t quantum = 0;
+  if (query.isDepthExhausted()) {
+    quantum = getCachedQuantum();
+  } else {
+    for (const auto &child : children)
+      quantum = shortestPositive(quantum, child->getCachedIntrinsicDuration());
+    if (quantum <= 0 && query.parent_quantum != MetadataQuery::kUnknownQuantum)
+      quantum = query.parent_quantum;
+    else if (quantum <= 0)
+      quantum = getCachedQuantum();
+  }
+
+  auto base = makeMetadata(quantum);
   auto *obj = base.getDynamicObject();
   obj->setProperty("childCount", (int)children.size());
+  obj->setProperty("longestDuration",
+                   (double)longest_child_duration_samples.load());
+  if (auto *ahead = render_ahead_ptr.load()) {
+    juce::DynamicObject::Ptr stats = new juce::DynamicObject();
+    stats->setProperty("enabled", ahead->isEnabled());
+    stats->setProperty("hits", (double)ahead->getNumHits());
+    stats->setProperty("misses", (double)ahead->getNumMisses());
+    obj->setProperty("renderAhead", juce::var(stats.get()));
+  }
+
+  if (query.isDepthExhausted()) {
+    addSummary(*obj);
+    return base;
+  }
+
+  auto child_query = query.forChildren();
+  child_query.parent_quantum = quantum;
   juce::Array<juce::var> childData;
   for (const auto &child : children) {
-    childData.add(child->getMetadata());
+    if (isChildVisible(*child, query, quantum))
+      childData.add(child->getMetadata(child_query));
   }
   obj->setProperty("nodes", childData);
   return base;
 }
 
+void BoxNode::addSummary(juce::DynamicObject &obj) const {
+  // Only cached values here: a summary must not cost more than one node.
+  obj.setProperty("isSummary", true);
+  obj.setProperty("peak", (float)getLastBlockPeak());
+  obj.setProperty("summaryDuration",
+                  (double)longest_child_duration_samples.load());
+}
+
+bool BoxNode::isChildVisible(const AudioNode &child,
+                             const MetadataQuery &query,
+                             int64_t quantum) const {
+  if (!query.visible_area.has_value())
+    return true;
+
+  // Match the UI's geometry: clips are drawn kQuantumWidthPixels per quantum,
+  // and looping clips repeat as ghosts across the whole timeline.
+  double visual_width = child.width.load();
+  int64_t duration = child.getDurationSamples();
+  if (quantum > 0 && duration > 0) {
+    visual_width = duration >= quantum
+                       ? std::numeric_limits<double>::infinity()
+                       : (double)duration / (double)quantum *
+                             kQuantumWidthPixels;
+  }
+
+  return query.isVisible(child.x_pos.load(), child.y_pos.load(), visual_width,
+                         child.height.load());
+}
+
+int64_t BoxNode::getCachedQuantum() const {
+  for (const AudioNode *node = this; node != nullptr;
+       node = node->getParent()) {
+    const int64_t duration = node->getCachedIntrinsicDuration();
+    if (duration > 0) return duration;
+  }
+  return 0;
+}
+
+int64_t BoxNode::getCachedTimelineLength(int64_t default_quantum) const {
+  int64_t quantum = getCachedQuantum();
+  if (quantum <= 0) quantum = default_quantum;
+  return lcm(quantum, child_duration_lcm_samples.load());
+}
+
 int64_t BoxNode::getIntrinsicDuration() const {
   std::lock_guard<std::recursive_mutex> lock(children_mutex);
   if (children.empty())
@@ -43,60 +178,216 @@ int64_t BoxNode::getEffectiveQuantum() const {
     return d;
 
   // 2. Try parent
-  if (parent)
-    return parent->getEffectiveQuantum();
+  if (auto *p = getParent())
+    return p->getEffectiveQuantum();
 
   return 0;
 }
 
 void BoxNode::addChild(std::unique_ptr<AudioNode> child) {
+  // Still ours alone, so its hot state can move in with its siblings'
+  child->setStateGroup(this);
+
+  // Allocate outside the lock the audio thread takes
+  double sample_rate = prepared_sample_rate.load();
+  int block_size = prepared_block_size.load();
+  int num_channels = prepared_num_channels.load();
+  if (block_size > 0) child->prepare(sample_rate, block_size, num_channels);
+
   std::lock_guard<std::recursive_mutex> lock(children_mutex);
+  // The device restarted in between: prepare for the new settings
+  if (prepared_block_size.load() != block_size ||
+      prepared_num_channels.load() != num_channels ||
+      prepared_sample_rate.load() != sample_rate)
+    child->prepare(prepared_sample_rate.load(), prepared_block_size.load(),
+                   prepared_num_channels.load());
+
   child->setParent(this);
   children.push_back(std::move(child));
+  publishChildren();
+}
+
+void BoxNode::publishChildren() {
+  auto list = std::make_unique<ChildList>();
+  list->reserve(children.size());
+  for (const auto &child : children) list->push_back(child.get());
+  block_children.store(list.get(), std::memory_order_release);
+
+  std::unique_ptr<const ChildList> replaced = std::move(block_children_list);
+  block_children_list = std::move(list);
+  // Blocks that started before the swap may still be walking the old list
+  if (auto *node_reclaimer = getReclaimer())
+    node_reclaimer->retireObject(std::move(replaced));
+}
+
+std::unique_ptr<AudioNode> BoxNode::detachChild(const juce::String &uuid) {
+  std::unique_ptr<AudioNode> removed;
+  {
+    std::lock_guard<std::recursive_mutex> lock(children_mutex);
+    auto it = std::find_if(children.begin(), children.end(),
+                           [&uuid](const std::unique_ptr<AudioNode> &node) {
+                             return node->getUuid() == uuid;
+                           });
+    if (it == children.end())
+      return nullptr;
+    removed = std::move(*it);
+    children.erase(it);
+    publishChildren();
+  }
+  removed->setParent(nullptr);
+  return removed;
 }
 
 void BoxNode::removeChild(const juce::String &uuid) {
+  if (auto removed = detachChild(uuid)) release(std::move(removed));
+}
+
+void BoxNode::release(std::unique_ptr<AudioNode> node) {
+  // Never free under children_mutex: the audio thread would wait for it
+  if (auto *node_reclaimer = getReclaimer())
+    node_reclaimer->retire(std::move(node));
+}
+
+int BoxNode::getNumChildren() const {
   std::lock_guard<std::recursive_mutex> lock(children_mutex);
-  auto it = std::find_if(children.begin(), children.end(),
-                         [&uuid](const std::unique_ptr<AudioNode> &node) {
-                           return node->getUuid() == uuid;
-                         });
-  if (it != children.end()) {
-    (*it)->setParent(nullptr);
-    children.erase(it);
+  return (int)children.size();
+}
+
+MemoryUsage BoxNode::getMemoryUsage() const {
+  MemoryUsage usage;
+  usage.scratch_bytes = mix_buffer_bytes.load();
+  if (auto *ahead = render_ahead_ptr.load())
+    usage.scratch_bytes += ahead->getRingBytes();
+
+  std::lock_guard<std::recursive_mutex> lock(children_mutex);
+  for (const auto &child : children)
+    usage += child->getMemoryUsage();
+  return usage;
+}
+
+void BoxNode::enableRenderAhead(RenderAheadPool &pool) {
+  if (auto *ahead = render_ahead_ptr.load()) {
+    ahead->setEnabled(true);
+    return;
   }
+
+  // Allocate the ring before the audio thread can see it
+  auto ahead = std::make_unique<RenderAhead>(*this, pool);
+  const int block_size = prepared_block_size.load();
+  ahead->prepare(block_size > 0 ? block_size : mix_buffer.getNumSamples(),
+                 std::max(1, prepared_num_channels.load()));
+
+  std::lock_guard<std::recursive_mutex> lock(children_mutex);
+  render_ahead = std::move(ahead);
+  render_ahead_ptr.store(render_ahead.get());
+}
+
+void BoxNode::disableRenderAhead() {
+  if (auto *ahead = render_ahead_ptr.load()) ahead->setEnabled(false);
+}
+
+bool BoxNode::isRenderAheadEnabled() const {
+  auto *ahead = render_ahead_ptr.load();
+  return ahead != nullptr && ahead->isEnabled();
 }
 
 void BoxNode::clearChildren() {
-  std::lock_guard<std::recursive_mutex> lock(children_mutex);
-  for (auto &child : children) {
+  std::vector<std::unique_ptr<AudioNode>> removed;
+  {
+    std::lock_guard<std::recursive_mutex> lock(children_mutex);
+    removed.swap(children);
+    publishChildren();
+  }
+  for (auto &child : removed) {
     child->setParent(nullptr);
+    release(std::move(child));
   }
-  children.clear();
 }
 
 void BoxNode::process(const float *const *input_channels,
                       float *const *output_channels, int num_input_channels,
                       int num_output_channels, const ProcessContext &context) {
 
-  // Ensure our mix buffer is large enough for this block
+  // Only an unprepared box (or a device exceeding the block size it was
+  // prepared with) gets here with too small a mix buffer
   if (mix_buffer.getNumSamples() < context.num_samples ||
       mix_buffer.getNumChannels() < num_output_channels) {
     mix_buffer.setSize(num_output_channels, context.num_samples, false, true,
                        true);
+    mix_buffer_bytes.store(MemoryUsage::bytesForSamples(
+        mix_buffer.getNumChannels(), mix_buffer.getNumSamples()));
   }
 
-  std::lock_guard<std::recursive_mutex> lock(children_mutex);
+  // Pre-rendered by the render-ahead worker: only the playheads move
+  auto *ahead = render_ahead_ptr.load();
+  if (ahead != nullptr &&
+      ahead->read(output_channels, num_output_channels, context)) {
+    advancePlayhead(context);
+    active_node_count.store(1);
+  } else {
+    processChildren(input_channels, output_channels, num_input_channels,
+                    num_output_channels, context);
+  }
+
+  // Box meter: peak of this box's own mix (the output holds only our sum).
+  // Frozen while the engine sheds load.
+  if (context.shed_level != ShedLevel::None) return;
+  float peak = 0.0f;
+  for (int ch = 0; ch < num_output_channels; ++ch) {
+    if (output_channels[ch] != nullptr) {
+      float low = 0.0f, high = 0.0f;
+      juce::FloatVectorOperations::findMinAndMax(output_channels[ch],
+                                                 context.num_samples, low,
+                                                 high);
+      peak = std::max(peak, std::max(std::abs(low), std::abs(high)));
+    }
+  }
+  setLastBlockPeak(peak);
+}
+
+void BoxNode::processChildren(const float *const *input_channels,
+                              float *const *output_channels,
+                              int num_input_channels, int num_output_channels,
+                              const ProcessContext &context) {
+  forgetSilence();
+
+  int64_t longest_duration = 0;
+  int64_t shortest_duration = 0;
+  int64_t duration_lcm = 0;
+  int active_nodes = 1;
+  // Read once the child has run, so a take committed this block counts
+  auto addDurations = [&](const AudioNode &child) {
+    longest_duration = std::max(longest_duration, child.getSummaryDuration());
+    shortest_duration = shortestPositive(shortest_duration,
+                                         child.getCachedIntrinsicDuration());
+    duration_lcm = lcm(duration_lcm, child.getCachedIntrinsicDuration());
+  };
 
   // Process each child and sum their results
-  for (const auto &child : children) {
+  for (auto *child : *block_children.load(std::memory_order_acquire)) {
+    // Nothing to mix: only its playheads move
+    if (child->isSilentFor(context)) {
+      {
+        ScopedDspTimer timer(child->getDspProfile(), context.num_samples,
+                             context.sample_rate);
+        child->skipSilentBlock(context);
+      }
+      addDurations(*child);
+      continue;
+    }
+
     // Clear mix buffer for this specific child
     mix_buffer.clear();
 
     // Pass the same input to children (effectively parallel input)
     // Output from child goes into our mix_buffer
-    child->process(input_channels, mix_buffer.getArrayOfWritePointers(),
-                   num_input_channels, num_output_channels, context);
+    {
+      CELESTRIAN_TRACE_SCOPE("audio", child->getTraceLabel());
+      ScopedDspTimer timer(child->getDspProfile(), context.num_samples,
+                           context.sample_rate);
+      child->process(input_channels, mix_buffer.getArrayOfWritePointers(),
+                     num_input_channels, num_output_channels, context);
+    }
 
     // Sum child output into our actual output channels
     for (int ch = 0; ch < num_output_channels; ++ch) {
@@ -106,7 +397,114 @@ void BoxNode::process(const float *const *input_channels,
                                          context.num_samples);
       }
     }
+
+    active_nodes += child->getActiveNodeCount();
+    addDurations(*child);
   }
+
+  longest_child_duration_samples.store(longest_duration);
+  shortest_child_duration_samples.store(shortest_duration);
+  child_duration_lcm_samples.store(duration_lcm);
+  active_node_count.store(active_nodes);
+}
+
+bool BoxNode::renderAhead(float *const *outputs, int num_outputs,
+                          const ProcessContext &context,
+                          RenderScratch &scratch) const {
+  auto &level = scratch.enter(num_outputs, context.num_samples);
+  const bool rendered =
+      copyChildren(level.children) &&
+      renderChildrenAhead(level.children, level.buffer, outputs, num_outputs,
+                          context, scratch);
+  scratch.leave();
+  return rendered;
+}
+
+bool BoxNode::copyChildren(std::vector<const AudioNode *> &copy) const {
+  // The audio thread takes children_mutex every block: never wait for it,
+  // and only hold it for the copy. The block renders live if it's busy.
+  for (;;) {
+    std::unique_lock<std::recursive_mutex> lock(children_mutex,
+                                                std::try_to_lock);
+    if (!lock.owns_lock()) return false;
+    if (children.size() <= copy.capacity()) {
+      copy.clear();
+      for (const auto &child : children) copy.push_back(child.get());
+      return true;
+    }
+    const size_t needed = children.size();
+    lock.unlock();
+    copy.reserve(needed * 2);  // Outside the lock
+  }
+}
+
+bool BoxNode::renderChildrenAhead(const std::vector<const AudioNode *> &copy,
+                                  juce::AudioBuffer<float> &child_buffer,
+                                  float *const *outputs, int num_outputs,
+                                  const ProcessContext &context,
+                                  RenderScratch &scratch) const {
+  // Same association as process(): each child on its own, then summed. The
+  // worker's reclaimer epoch keeps the copied children alive.
+  for (const auto *child : copy) {
+    for (int ch = 0; ch < num_outputs; ++ch)
+      child_buffer.clear(ch, 0, context.num_samples);
+    if (!child->renderAhead(child_buffer.getArrayOfWritePointers(),
+                            num_outputs, context, scratch))
+      return false;
+    for (int ch = 0; ch < num_outputs; ++ch) {
+      if (outputs[ch] != nullptr)
+        juce::FloatVectorOperations::add(
+            outputs[ch], child_buffer.getReadPointer(ch), context.num_samples);
+    }
+  }
+  return true;
+}
+
+bool BoxNode::isSilentFor(const ProcessContext &context) const {
+  // Asked again by processChildren() one level up: each box below walks its
+  // children once per block, not once per level above it
+  if (silence_checked && silence_sample_time == context.sample_time &&
+      silence_master_pos == context.master_pos)
+    return silent_for_block;
+
+  bool silent = true;
+  for (const auto *child : *block_children.load(std::memory_order_acquire)) {
+    if (!child->isSilentFor(context)) {
+      silent = false;
+      break;
+    }
+  }
+  silence_checked = true;
+  silent_for_block = silent;
+  silence_sample_time = context.sample_time;
+  silence_master_pos = context.master_pos;
+  return silent;
+}
+
+void BoxNode::skipSilentBlock(const ProcessContext &context) {
+  forgetSilence();
+  int64_t longest_duration = 0;
+  int64_t shortest_duration = 0;
+  int64_t duration_lcm = 0;
+  for (auto *child : *block_children.load(std::memory_order_acquire)) {
+    child->skipSilentBlock(context);
+    longest_duration =
+        std::max(longest_duration, child->getSummaryDuration());
+    shortest_duration = shortestPositive(shortest_duration,
+                                         child->getCachedIntrinsicDuration());
+    duration_lcm = lcm(duration_lcm, child->getCachedIntrinsicDuration());
+  }
+  longest_child_duration_samples.store(longest_duration);
+  shortest_child_duration_samples.store(shortest_duration);
+  child_duration_lcm_samples.store(duration_lcm);
+  active_node_count.store(1);
+  if (context.shed_level == ShedLevel::None) setLastBlockPeak(0.0f);
+}
+
+void BoxNode::advancePlayhead(const ProcessContext &context) {
+  forgetSilence();
+  for (auto *child : *block_children.load(std::memory_order_acquire))
+    child->advancePlayhead(context);
 }
 
 juce::var BoxNode::getWaveform(int num_peaks) const {
@@ -7,6 +7,9 @@
 
 namespace celestrian {
 
+class RenderAhead;
+class RenderAheadPool;
+
 /**
  * A container node that sums its children into a single output.
  * This enables the "boxes-within-boxes" hierarchical structure.
@@ -14,7 +17,7 @@ namespace celestrian {
 class BoxNode : public AudioNode {
 public:
   BoxNode(juce::String name);
-  ~BoxNode() override = default;
+  ~BoxNode() override;
 
   // AudioNode implementation
   /**
@@ -30,40 +33,83 @@ public:
                float *const *output_channels, int num_input_channels,
                int num_output_channels, const ProcessContext &context) override;
 
+  /**
+   * Sums the children's renderAhead() the way process() sums their output.
+   * Predictable only if every child is. Never waits for children_mutex: it
+   * copies the child list if the lock is free and renders from the copy.
+   */
+  bool renderAhead(float *const *outputs, int num_outputs,
+                   const ProcessContext &context,
+                   RenderScratch &scratch) const override;
+
+  /**
+   * Moves the children's playheads.
+   */
+  void advancePlayhead(const ProcessContext &context) override;
+
+  /**
+   * Silent if every child is. Skipping a box skips its whole subtree. The
+   * answer is kept until the block is processed, skipped or played from the
+   * ring, so the checks below it reuse what this walk found.
+   */
+  bool isSilentFor(const ProcessContext &context) const override;
+  void skipSilentBlock(const ProcessContext &context) override;
+
   /**
    * Aggregate waveform visualization for all children.
    */
   juce::var getWaveform(int num_peaks) const override;
 
   /**
-   * Aggregates metadata from all children for the UI.
+   * Aggregates metadata from children for the UI. Children are expanded up to
+   * `query.max_depth` levels and filtered by `query.visible_area`; a box at
+   * the depth limit reports only its cached summary.
    */
-  juce::var getMetadata() const override;
+  juce::var getMetadata(const MetadataQuery &query) const override;
 
   /**
    * Returns NodeType::Box.
    */
   NodeType getNodeType() const override { return NodeType::Box; }
 
+  /**
+   * Sizes the mix buffer and prepares every child. Children added later are
+   * prepared with the same settings before they are published.
+   */
+  void prepare(double sample_rate, int max_block_size,
+               int num_channels) override;
+
   juce::String getNodeTypeString() const override { return "box"; }
-  float getCurrentPeak() const override { return last_block_peak.load(); }
+  float getCurrentPeak() const override { return getLastBlockPeak(); }
 
   int64_t getIntrinsicDuration() const override;
   int64_t getEffectiveQuantum() const override;
 
   // Box-specific methods
   /**
-   * Adds a child node to this container.
+   * Adds a child node to this container, preparing it first if this box has
+   * been prepared. The child's NodeStateTable row moves next to its
+   * siblings', so it must not be reachable from another thread yet.
    */
   void addChild(std::unique_ptr<AudioNode> child);
 
   /**
-   * Removes a child node from this container.
+   * Unlinks a child node and hands it back, or returns nullptr if there is
+   * no child with `uuid`. The audio thread may still be using it: see
+   * NodeReclaimer before freeing it.
+   */
+  std::unique_ptr<AudioNode> detachChild(const juce::String &uuid);
+
+  /**
+   * Removes a child node from this container. It is freed by the graph's
+   * NodeReclaimer, if there is one, once the audio thread is done with it.
+   * Only for graphs the engine keeps nothing about (solo, scheduled events,
+   * jobs); a live session removes nodes through AudioEngine::removeNode().
    */
   void removeChild(const juce::String &uuid);
 
   /**
-   * Removes and deletes all child nodes.
+   * Removes and deletes all child nodes, like removeChild().
    */
   void clearChildren();
 
@@ -74,24 +120,169 @@ public:
   AudioNode *findNodeByUuid(const juce::String &uuid);
 
   /**
-   * Returns the number of children in this box.
+   * Returns the number of children in this box, under the children lock.
    */
-  int getNumChildren() const { return (int)children.size(); }
+  int getNumChildren() const;
 
   /**
-   * Returns a raw pointer to the child at the specified index.
+   * Calls `fn` for each direct child while holding the children lock. Not
+   * for the audio thread, which uses forEachChildInBlock().
    */
-  AudioNode *getChild(int index) { return children[index].get(); }
+  template <typename Fn>
+  void forEachChild(Fn &&fn) const {
+    std::lock_guard<std::recursive_mutex> lock(children_mutex);
+    for (const auto &child : children)
+      fn(static_cast<const AudioNode &>(*child));
+  }
+
+  /**
+   * Calls `fn` for each direct child in the list published for blocks,
+   * without locking or allocating. Audio thread only: replaced lists are
+   * freed through the NodeReclaimer, which only waits for blocks.
+   */
+  template <typename Fn>
+  void forEachChildInBlock(Fn &&fn) const {
+    for (const auto *child : *block_children.load(std::memory_order_acquire))
+      fn(*child);
+  }
+
+  /**
+   * Returns the longest child duration seen by the last processed block.
+   * Cached so summaries never need to walk the subtree.
+   */
+  int64_t getSummaryDuration() const override {
+    return longest_child_duration_samples.load();
+  }
+
+  /**
+   * Returns the shortest child duration seen by the last processed block.
+   */
+  int64_t getCachedIntrinsicDuration() const override {
+    return shortest_child_duration_samples.load();
+  }
+
+  /**
+   * Returns the least common multiple of the children's durations seen by
+   * the last processed block, or 0 if none has one.
+   */
+  int64_t getCachedDurationLcm() const {
+    return child_duration_lcm_samples.load();
+  }
+
+  /**
+   * getEffectiveQuantum() from the durations cached by the last processed
+   * block: no locks, and no walk below this box.
+   */
+  int64_t getCachedQuantum() const;
+
+  /**
+   * The length after which every child loops back to its start together:
+   * the LCM of the cached quantum (or `default_quantum` without one) and
+   * the children's durations. Lock-free, for the audio thread.
+   */
+  int64_t getCachedTimelineLength(int64_t default_quantum) const;
+
+  int getActiveNodeCount() const override { return active_node_count.load(); }
+
+  /**
+   * Returns this box's mix buffer plus the memory of every descendant.
+   */
+  MemoryUsage getMemoryUsage() const override;
+
+  /**
+   * Has `pool` render this subtree ahead of the audio thread whenever it is
+   * predictable; the box then only copies the pre-rendered blocks. Message
+   * thread. The pool must outlive the box.
+   */
+  void enableRenderAhead(RenderAheadPool &pool);
+  void disableRenderAhead();
+  bool isRenderAheadEnabled() const;
+
+  /** The render-ahead state, if it was ever enabled; for stats and tests. */
+  const RenderAhead *getRenderAhead() const { return render_ahead_ptr.load(); }
 
 private:
+  /**
+   * Renders every child live into `output_channels`.
+   */
+  void processChildren(const float *const *input_channels,
+                       float *const *output_channels, int num_input_channels,
+                       int num_output_channels, const ProcessContext &context);
+
+  /**
+   * Frees a removed child, through the reclaimer if there is one.
+   */
+  void release(std::unique_ptr<AudioNode> node);
+
+  /**
+   * Adds the cached aggregates used when this box is not expanded.
+   */
+  void addSummary(juce::DynamicObject &obj) const;
+
+  /**
+   * Returns true if the child falls inside the query's visible area, drawn
+   * against this box's effective `quantum`.
+   */
+  bool isChildVisible(const AudioNode &child, const MetadataQuery &query,
+                      int64_t quantum) const;
+
+  // renderAhead() steps: a copy of the child list, taken only if the lock
+  // is free, then the render from it
+  bool copyChildren(std::vector<const AudioNode *> &copy) const;
+  bool renderChildrenAhead(const std::vector<const AudioNode *> &copy,
+                           juce::AudioBuffer<float> &child_buffer,
+                           float *const *outputs, int num_outputs,
+                           const ProcessContext &context,
+                           RenderScratch &scratch) const;
+
+  /**
+   * Publishes a copy of `children` for blocks to read and retires the old
+   * one. With children_mutex held.
+   */
+  void publishChildren();
+
   std::vector<std::unique_ptr<AudioNode>> children;
 
   mutable std::recursive_mutex children_mutex;
 
+  // The children as blocks see them: an immutable copy of `children`,
+  // republished on every change, so the audio thread never takes
+  // children_mutex. A replaced list goes to the reclaimer like a removed
+  // node, since a block may still be walking it.
+  using ChildList = std::vector<AudioNode *>;
+  std::unique_ptr<const ChildList> block_children_list;
+  std::atomic<const ChildList *> block_children{nullptr};
+
   // Scratch buffer for summing children without affecting parent output
   // directly until ready
   juce::AudioBuffer<float> mix_buffer;
 
+  // Settings of the last prepare(); block size 0 until prepared
+  std::atomic<double> prepared_sample_rate{0.0};
+  std::atomic<int> prepared_block_size{0};
+  std::atomic<int> prepared_num_channels{0};
+
+  // Aggregates refreshed by process() for cheap summaries
+  std::atomic<int64_t> longest_child_duration_samples{0};
+  std::atomic<int64_t> shortest_child_duration_samples{0};
+  std::atomic<int64_t> child_duration_lcm_samples{0};
+  std::atomic<int> active_node_count{1};
+  // Size of mix_buffer. Only an unprepared box grows it on the audio thread.
+  std::atomic<int64_t> mix_buffer_bytes{0};
+
+  // isSilentFor()'s answer for the block in flight, and the block it was
+  // for; cleared once the block is done with. Audio thread only.
+  mutable bool silence_checked = false;
+  mutable bool silent_for_block = false;
+  mutable int64_t silence_sample_time = 0;
+  mutable int64_t silence_master_pos = 0;
+  void forgetSilence() const { silence_checked = false; }
+
+  // Created once, on the first enableRenderAhead(), and kept until the box
+  // goes. Declared after `children`, so it stops rendering them first.
+  std::unique_ptr<RenderAhead> render_ahead;
+  std::atomic<RenderAhead *> render_ahead_ptr{nullptr};
+
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BoxNode)
 };
 
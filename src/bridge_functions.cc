@@ -0,0 +1,352 @@
+#include "bridge_functions.h"
+
+#include <algorithm>
+
+namespace {
+constexpr const char* kBatchFunctionName = "batch";
+
+// A mutation's command id as the UI sees it
+juce::var commandId(uint64_t id) { return juce::var((juce::int64)id); }
+}  // namespace
+
+BridgeFunctions::BridgeFunctions(AudioEngine& engine,
+                                 JobSystem::Dispatcher dispatcher_to_use)
+    : audio_engine(engine), dispatcher(std::move(dispatcher_to_use)) {
+  registerHandlers();
+}
+
+BridgeFunctions::~BridgeFunctions() {
+  is_alive->store(false);
+  for (auto& job : pending_jobs) job->cancel();
+  for (auto& job : pending_jobs) job->wait(10000);
+}
+
+juce::var BridgeFunctions::call(const juce::String& name,
+                                const juce::Array<juce::var>& args) const {
+  auto it = handlers.find(name);
+  if (it == handlers.end()) {
+    juce::Logger::writeToLog("Bridge: Unknown native function " + name);
+    return {};
+  }
+  CELESTRIAN_TRACE_SCOPE("bridge",
+                         celestrian::TraceRecorder::isEnabled()
+                             ? celestrian::TraceRecorder::intern(name)
+                             : "");
+  return it->second(args);
+}
+
+void BridgeFunctions::invoke(const juce::String& name,
+                             const juce::Array<juce::var>& args,
+                             JobSystem::Completion completion) {
+  if (!isAsync(name, args)) {
+    completion(call(name, args));
+    return;
+  }
+
+  // Batches are serialized by the caller (the poll loop awaits each one), so
+  // they are never superseded.
+  auto it = async_handlers.find(name);
+  JobSystem::JobOptions options;
+  options.key = it != async_handlers.end() ? it->second(args) : "";
+  options.priority = JobSystem::Priority::Interactive;
+  options.dispatcher = dispatcher;
+
+  pending_jobs.erase(
+      std::remove_if(pending_jobs.begin(), pending_jobs.end(),
+                     [](const auto& job) { return job->isDone(); }),
+      pending_jobs.end());
+  pending_jobs.push_back(audio_engine.getJobSystem().schedule(
+      [this, name, args](JobSystem::JobContext&) { return call(name, args); },
+      [alive = is_alive, completion = std::move(completion)](
+          const juce::var& result) {
+        if (alive->load()) completion(result);
+      },
+      std::move(options)));
+  // A replaced graph waits for the queries reading it
+  audio_engine.addGraphQueryJob(pending_jobs.back());
+}
+
+bool BridgeFunctions::isAsync(const juce::String& name,
+                              const juce::Array<juce::var>& args) const {
+  if (name != kBatchFunctionName) return async_handlers.count(name) > 0;
+
+  // A batch leaves the message thread only if every operation may: mutations
+  // stay ordered with the rest of the UI's direct calls.
+  auto* list = args.size() > 0 ? args[0].getArray() : nullptr;
+  if (list == nullptr || list->isEmpty()) return false;
+  for (const auto& operation : *list) {
+    if (async_handlers.count(operation["name"].toString()) == 0) return false;
+  }
+  return true;
+}
+
+void BridgeFunctions::markAsync(const juce::String& name, SupersessionKey key) {
+  async_handlers[name] = std::move(key);
+}
+
+juce::var BridgeFunctions::runBatch(const juce::var& operations) const {
+  juce::Array<juce::var> results;
+  auto* list = operations.getArray();
+  if (list == nullptr) return results;
+
+  for (const auto& operation : *list) {
+    juce::String name = operation["name"].toString();
+    if (name == kBatchFunctionName) {
+      juce::Logger::writeToLog("Bridge: Nested batch rejected");
+      results.add(juce::var());
+      continue;
+    }
+
+    juce::Array<juce::var> args;
+    if (auto* arg_list = operation["args"].getArray()) args = *arg_list;
+    results.add(call(name, args));
+  }
+  return results;
+}
+
+void BridgeFunctions::registerHandlers() {
+  handlers["ping"] = [](const juce::Array<juce::var>&) -> juce::var {
+    return "pong";
+  };
+
+  handlers[kBatchFunctionName] =
+      [this](const juce::Array<juce::var>& args) -> juce::var {
+    return runBatch(args.size() > 0 ? args[0] : juce::var());
+  };
+
+  // Mutations return their command id (0: not sent) without waiting for
+  // the audio thread; isCommandApplied polls it
+  handlers["togglePlayback"] = [this](const juce::Array<juce::var>&) {
+    return commandId(audio_engine.togglePlayback());
+  };
+
+  handlers["startRecordingInNode"] =
+      [this](const juce::Array<juce::var>& args) {
+        if (args.size() < 1) return commandId(0);
+        return commandId(audio_engine.startRecordingInNode(args[0].toString()));
+      };
+
+  handlers["stopRecordingInNode"] = [this](const juce::Array<juce::var>& args) {
+    if (args.size() < 1) return commandId(0);
+    return commandId(audio_engine.stopRecordingInNode(args[0].toString()));
+  };
+
+  handlers["isCommandApplied"] = [this](const juce::Array<juce::var>& args) {
+    // args[0]: an id returned by a mutation
+    if (args.size() < 1) return juce::var(false);
+    return juce::var(
+        audio_engine.isCommandApplied((uint64_t)(juce::int64)args[0]));
+  };
+
+  handlers["getGraphState"] = [this](const juce::Array<juce::var>& args) {
+    // Optional args[0]: { depth, visibleRect: {x, y, w, h} }
+    return audio_engine.getGraphState(celestrian::MetadataQuery::fromVar(
+        args.size() > 0 ? args[0] : juce::var()));
+  };
+  markAsync("getGraphState",
+            [](const juce::Array<juce::var>&) { return "getGraphState"; });
+
+  handlers["getTransportClock"] = [this](const juce::Array<juce::var>&) {
+    return audio_engine.getTransportClock();
+  };
+
+  handlers["setDspProfilingEnabled"] =
+      [this](const juce::Array<juce::var>& args) {
+        audio_engine.setDspProfilingEnabled(args.size() > 0 && (bool)args[0]);
+        return juce::var(true);
+      };
+
+  handlers["getDspProfile"] = [this](const juce::Array<juce::var>&) {
+    return audio_engine.getDspProfile();
+  };
+  markAsync("getDspProfile",
+            [](const juce::Array<juce::var>&) { return "getDspProfile"; });
+
+  handlers["getCallbackStats"] = [this](const juce::Array<juce::var>&) {
+    return audio_engine.getCallbackStats();
+  };
+
+  handlers["getOverloadState"] = [this](const juce::Array<juce::var>&) {
+    return audio_engine.getOverloadState();
+  };
+
+  handlers["setOverloadThreshold"] =
+      [this](const juce::Array<juce::var>& args) {
+        // args[0]: callback load (elapsed / deadline) at which shedding starts
+        if (args.size() > 0) audio_engine.setOverloadThreshold((double)args[0]);
+        return audio_engine.getOverloadState();
+      };
+
+  handlers["getMemoryUsage"] = [this](const juce::Array<juce::var>&) {
+    return audio_engine.getMemoryUsage();
+  };
+  markAsync("getMemoryUsage",
+            [](const juce::Array<juce::var>&) { return "getMemoryUsage"; });
+
+  handlers["setMemoryBudget"] = [this](const juce::Array<juce::var>& args) {
+    // args[0]: budget in megabytes
+    if (args.size() > 0)
+      audio_engine.setMemoryBudget(
+          (int64_t)((double)args[0] * 1024.0 * 1024.0));
+    return juce::var(true);
+  };
+
+  handlers["reserveLockedAudioMemory"] =
+      [this](const juce::Array<juce::var>& args) {
+        // args[0]: capacity in megabytes
+        if (args.size() < 1) return juce::var(false);
+        return juce::var(audio_engine.reserveLockedAudioMemory(
+            (int64_t)((double)args[0] * 1024.0 * 1024.0)));
+      };
+
+  handlers["setInternalBlockSize"] =
+      [this](const juce::Array<juce::var>& args) {
+        // args[0]: samples per graph block, 0 to follow the device
+        audio_engine.setInternalBlockSize(args.size() > 0 ? (int)args[0] : 0);
+        return juce::var(audio_engine.getOutputLatency());
+      };
+
+  handlers["startTrace"] = [this](const juce::Array<juce::var>& args) {
+    // Optional args[0]: output path (default: celestrian_trace.json in cwd)
+    auto file = args.size() > 0 && args[0].toString().isNotEmpty()
+                    ? juce::File(args[0].toString())
+                    : juce::File::getCurrentWorkingDirectory().getChildFile(
+                          "celestrian_trace.json");
+    return juce::var(audio_engine.startTrace(file));
+  };
+
+  handlers["stopTrace"] = [](const juce::Array<juce::var>&) {
+    return juce::var(
+        (double)celestrian::TraceRecorder::getInstance().stop());
+  };
+
+  handlers["startCapture"] = [this](const juce::Array<juce::var>& args) {
+    // Optional args[0]: output path (default: celestrian_capture.ccap in cwd)
+    auto file = args.size() > 0 && args[0].toString().isNotEmpty()
+                    ? juce::File(args[0].toString())
+                    : juce::File::getCurrentWorkingDirectory().getChildFile(
+                          "celestrian_capture.ccap");
+    return juce::var(audio_engine.startCapture(file));
+  };
+
+  handlers["stopCapture"] = [this](const juce::Array<juce::var>&) {
+    return audio_engine.stopCapture();
+  };
+
+  handlers["getWaveform"] = [this](const juce::Array<juce::var>& args) {
+    if (args.size() >= 2)
+      return audio_engine.getWaveform(args[0].toString(), (int)args[1]);
+    return juce::var(juce::Array<juce::var>());
+  };
+  // A newer request for the same node (e.g. a new zoom level) wins
+  markAsync("getWaveform", [](const juce::Array<juce::var>& args) {
+    return "getWaveform:" + (args.size() > 0 ? args[0].toString() : "");
+  });
+
+  handlers["enterBox"] = [this](const juce::Array<juce::var>& args) {
+    if (args.size() > 0) audio_engine.enterBox(args[0].toString());
+    return juce::var(true);
+  };
+
+  handlers["exitBox"] = [this](const juce::Array<juce::var>&) {
+    audio_engine.exitBox();
+    return juce::var(true);
+  };
+
+  handlers["createNode"] = [this](const juce::Array<juce::var>& args) {
+    if (args.size() > 2)
+      audio_engine.createNode(args[0].toString(), (double)args[1],
+                              (double)args[2]);
+    else if (args.size() > 0)
+      audio_engine.createNode(args[0].toString());
+    return juce::var(true);
+  };
+
+  handlers["renameNode"] = [this](const juce::Array<juce::var>& args) {
+    if (args.size() > 1)
+      audio_engine.renameNode(args[0].toString(), args[1].toString());
+    return juce::var(true);
+  };
+
+  handlers["removeNode"] = [this](const juce::Array<juce::var>& args) {
+    if (args.size() < 1) return commandId(0);
+    return commandId(audio_engine.removeNode(args[0].toString()));
+  };
+
+  handlers["getInputList"] = [this](const juce::Array<juce::var>&) {
+    return audio_engine.getInputList();
+  };
+
+  handlers["setNodeInput"] = [this](const juce::Array<juce::var>& args) {
+    if (args.size() < 2) return commandId(0);
+    return commandId(
+        audio_engine.setNodeInput(args[0].toString(), (int)args[1]));
+  };
+
+  handlers["setLoopPoints"] = [this](const juce::Array<juce::var>& args) {
+    if (args.size() < 3) return commandId(0);
+    return commandId(audio_engine.setLoopPoints(
+        args[0].toString(), (juce::int64)args[1], (juce::int64)args[2]));
+  };
+
+  handlers["togglePlay"] = [this](const juce::Array<juce::var>& args) {
+    if (args.size() < 1) return commandId(0);
+    return commandId(audio_engine.togglePlay(args[0].toString()));
+  };
+
+  handlers["toggleSolo"] = [this](const juce::Array<juce::var>& args) {
+    if (args.size() < 1) return commandId(0);
+    return commandId(audio_engine.toggleSolo(args[0].toString()));
+  };
+
+  handlers["toggleMute"] = [this](const juce::Array<juce::var>& args) {
+    uint64_t id = 0;
+    if (args.size() > 0) {
+      if (args[0].isString())
+        id = audio_engine.toggleMute(args[0].toString());
+      else if (auto* obj = args[0].getDynamicObject())
+        id = audio_engine.toggleMute(obj->getProperty("uuid").toString());
+    }
+    return commandId(id);
+  };
+
+  handlers["setNodePriority"] = [this](const juce::Array<juce::var>& args) {
+    // args[0]: uuid, args[1]: "low", "normal" or "essential"
+    if (args.size() < 2) return juce::var(false);
+    const auto name = args[1].toString();
+    auto priority = celestrian::NodePriority::Normal;
+    if (name == "low")
+      priority = celestrian::NodePriority::Low;
+    else if (name == "essential")
+      priority = celestrian::NodePriority::Essential;
+    else if (name != "normal")
+      return juce::var(false);
+    return juce::var(
+        audio_engine.setNodePriority(args[0].toString(), priority));
+  };
+
+  handlers["setRenderAhead"] = [this](const juce::Array<juce::var>& args) {
+    // args[0]: uuid of a box, args[1]: true to render it ahead
+    if (args.size() < 2) return juce::var(false);
+    return juce::var(
+        audio_engine.setRenderAhead(args[0].toString(), (bool)args[1]));
+  };
+
+  handlers["nativeLog"] = [](const juce::Array<juce::var>& args) {
+    if (args.size() > 0) juce::Logger::writeToLog("[JS] " + args[0].toString());
+    return juce::var(true);
+  };
+
+  handlers["dumpStateToFile"] = [](const juce::Array<juce::var>& args) {
+    if (args.size() > 0) {
+      auto state_file = juce::File::getCurrentWorkingDirectory().getChildFile(
+          "celestrian_state.json");
+      state_file.replaceWithText(args[0].toString());
+      juce::Logger::writeToLog("State dumped to: " +
+                               state_file.getFullPathName());
+    }
+    return juce::var(true);
+  };
+  markAsync("dumpStateToFile",
+            [](const juce::Array<juce::var>&) { return "dumpStateToFile"; });
+}
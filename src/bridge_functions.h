@@ -0,0 +1,95 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "audio_engine.h"
+#include "job_system.h"
+
+/**
+ * Registry of the native functions the UI can call, keyed by name.
+ *
+ * Every handler is registered once here and exposed two ways: as its own
+ * `withNativeFunction` entry, and as an operation inside a `batch` call, so a
+ * busy UI frame can make many calls in a single bridge round trip.
+ *
+ * Heavy handlers (graph queries, waveforms, file writes) are marked async:
+ * `invoke` runs them on the engine's JobSystem, ahead of background engine
+ * work, and completes later, so the message thread never waits on them.
+ */
+class BridgeFunctions {
+ public:
+  using Handler = std::function<juce::var(const juce::Array<juce::var>&)>;
+  /** Maps an async call's arguments to its supersession key. */
+  using SupersessionKey =
+      std::function<juce::String(const juce::Array<juce::var>&)>;
+
+  /**
+   * @param dispatcher Where async completions run; defaults to the message
+   *                   thread (see JobSystem).
+   */
+  explicit BridgeFunctions(AudioEngine& engine,
+                           JobSystem::Dispatcher dispatcher = {});
+
+  /** Cancels async calls still pending and waits for running ones. */
+  ~BridgeFunctions();
+
+  /**
+   * Returns all registered handlers, for registration with the WebView.
+   */
+  const std::map<juce::String, Handler>& getHandlers() const {
+    return handlers;
+  }
+
+  /**
+   * Invokes a single handler by name.
+   * @return The handler's result, or a void var if the name is unknown.
+   */
+  juce::var call(const juce::String& name,
+                 const juce::Array<juce::var>& args) const;
+
+  /**
+   * Invokes a handler and reports its result through `completion`. Async
+   * handlers (and batches made only of them) run on a worker thread; a newer
+   * call with the same supersession key cancels an older one, which then
+   * completes with a void result. Everything else completes immediately.
+   */
+  void invoke(const juce::String& name, const juce::Array<juce::var>& args,
+              JobSystem::Completion completion);
+
+  /**
+   * Returns true if `invoke` would run this call off the message thread.
+   */
+  bool isAsync(const juce::String& name,
+               const juce::Array<juce::var>& args) const;
+
+  /**
+   * Runs a list of `{ name, args }` operations in order, in the current
+   * message-thread turn, and returns their results in the same order.
+   * Nested batches are rejected.
+   */
+  juce::var runBatch(const juce::var& operations) const;
+
+ private:
+  void registerHandlers();
+  void markAsync(const juce::String& name, SupersessionKey key);
+
+  AudioEngine& audio_engine;
+  std::map<juce::String, Handler> handlers;
+  std::map<juce::String, SupersessionKey> async_handlers;
+
+  // Async calls in flight on the engine's JobSystem; they run our handlers,
+  // so the destructor waits for them. Message thread only.
+  JobSystem::Dispatcher dispatcher;
+  std::vector<JobSystem::JobHandle> pending_jobs;
+  // Completions dispatched after we are gone are dropped
+  std::shared_ptr<std::atomic<bool>> is_alive =
+      std::make_shared<std::atomic<bool>>(true);
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BridgeFunctions)
+};
@@ -0,0 +1,121 @@
+#include "callback_monitor.h"
+
+#include <algorithm>
+
+namespace celestrian {
+
+double CallbackMonitor::endBlock(juce::int64 start_ticks, int num_samples,
+                                 double sample_rate, int64_t master_pos,
+                                 int active_nodes) {
+  auto elapsed = juce::Time::getHighResolutionTicks() - start_ticks;
+  return recordBlock(juce::Time::highResolutionTicksToSeconds(elapsed),
+                     num_samples, sample_rate, master_pos, active_nodes);
+}
+
+double CallbackMonitor::recordBlock(double elapsed_seconds, int num_samples,
+                                    double sample_rate, int64_t master_pos,
+                                    int active_nodes) {
+  if (num_samples <= 0 || sample_rate <= 0.0) return 0.0;
+
+  const double deadline = (double)num_samples / sample_rate;
+  const double load = elapsed_seconds / deadline;
+
+  // Single writer: plain load/store pairs are enough for the aggregates
+  num_blocks.store(num_blocks.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+  total_load.store(total_load.load(std::memory_order_relaxed) + load,
+                   std::memory_order_relaxed);
+  if (load > max_load.load(std::memory_order_relaxed))
+    max_load.store(load, std::memory_order_relaxed);
+
+  int bucket = std::min(kNumLoadBuckets - 1,
+                        std::max(0, (int)(load / kLoadBucketWidth)));
+  load_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+
+  if (load >= kNearMissLoad && load < kOverrunLoad)
+    num_near_misses.fetch_add(1, std::memory_order_relaxed);
+
+  if (load >= kOverrunLoad) {
+    num_overruns.fetch_add(1, std::memory_order_relaxed);
+
+    auto index = overrun_write_count.load(std::memory_order_relaxed);
+    auto& slot = overrun_history[index % kOverrunHistorySize];
+    auto seq = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.master_pos.store(master_pos, std::memory_order_relaxed);
+    slot.active_nodes.store(active_nodes, std::memory_order_relaxed);
+    slot.load.store(load, std::memory_order_relaxed);
+    slot.time_ns.store(
+        (uint64_t)(juce::Time::highResolutionTicksToSeconds(
+                       juce::Time::getHighResolutionTicks()) *
+                   1.0e9),
+        std::memory_order_relaxed);
+    slot.sequence.store(seq + 2, std::memory_order_release);
+    overrun_write_count.store(index + 1, std::memory_order_release);
+  }
+  return load;
+}
+
+juce::Array<CallbackMonitor::OverrunEvent> CallbackMonitor::getRecentOverruns()
+    const {
+  juce::Array<OverrunEvent> events;
+  auto written = overrun_write_count.load(std::memory_order_acquire);
+  auto first = std::max<int64_t>(0, written - kOverrunHistorySize);
+
+  for (auto i = first; i < written; ++i) {
+    const auto& slot = overrun_history[i % kOverrunHistorySize];
+    auto before = slot.sequence.load(std::memory_order_acquire);
+    OverrunEvent event;
+    event.master_pos = slot.master_pos.load(std::memory_order_relaxed);
+    event.active_nodes = slot.active_nodes.load(std::memory_order_relaxed);
+    event.load = slot.load.load(std::memory_order_relaxed);
+    event.time_ns = slot.time_ns.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Skip a slot the audio thread is rewriting right now
+    if ((before & 1u) == 0 &&
+        before == slot.sequence.load(std::memory_order_relaxed))
+      events.add(event);
+  }
+  return events;
+}
+
+juce::var CallbackMonitor::toVar() const {
+  auto blocks = num_blocks.load();
+  juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+  obj->setProperty("blocks", (double)blocks);
+  obj->setProperty("nearMisses", (double)num_near_misses.load());
+  obj->setProperty("overruns", (double)num_overruns.load());
+  obj->setProperty("maxLoad", max_load.load());
+  obj->setProperty("meanLoad", blocks > 0 ? total_load.load() / blocks : 0.0);
+  obj->setProperty("loadBucketWidth", kLoadBucketWidth);
+
+  juce::Array<juce::var> histogram;
+  for (const auto& bucket : load_histogram)
+    histogram.add((double)bucket.load());
+  obj->setProperty("loadHistogram", histogram);
+
+  juce::Array<juce::var> overruns;
+  for (const auto& event : getRecentOverruns()) {
+    juce::DynamicObject::Ptr entry = new juce::DynamicObject();
+    entry->setProperty("masterPos", (double)event.master_pos);
+    entry->setProperty("activeNodes", event.active_nodes);
+    entry->setProperty("load", event.load);
+    entry->setProperty("timeNs", (double)event.time_ns);
+    overruns.add(juce::var(entry.get()));
+  }
+  obj->setProperty("recentOverruns", overruns);
+  return juce::var(obj.get());
+}
+
+juce::String CallbackMonitor::getSummaryLine() const {
+  auto blocks = num_blocks.load();
+  auto mean = blocks > 0 ? total_load.load() / blocks : 0.0;
+  return "Callback: " + juce::String(blocks) + " blocks, mean load " +
+         juce::String(mean * 100.0, 1) + "%, max " +
+         juce::String(max_load.load() * 100.0, 1) + "%, " +
+         juce::String(num_near_misses.load()) + " near misses, " +
+         juce::String(num_overruns.load()) + " overruns";
+}
+
+}  // namespace celestrian
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace celestrian {
+
+/**
+ * Measures each audio callback against its deadline (num_samples /
+ * sample_rate) so glitches leave evidence.
+ *
+ * The audio thread is the only writer; every statistic is an atomic, so
+ * readers on other threads never block it. Overruns are also kept in a small
+ * ring with the transport position and graph size at the time.
+ */
+class CallbackMonitor {
+ public:
+  // Callback load (elapsed / deadline) at or above which a block counts as a
+  // near miss or an overrun.
+  static constexpr double kNearMissLoad = 0.8;
+  static constexpr double kOverrunLoad = 1.0;
+
+  // Load histogram: kLoadBucketWidth per bucket, last bucket open-ended.
+  static constexpr double kLoadBucketWidth = 0.05;
+  static constexpr int kNumLoadBuckets = 41;  // 0% .. 200%+
+
+  static constexpr int kOverrunHistorySize = 32;
+
+  struct OverrunEvent {
+    int64_t master_pos = 0;
+    int active_nodes = 0;
+    double load = 0.0;
+    uint64_t time_ns = 0;  // juce high-resolution clock
+  };
+
+  /**
+   * Returns a timestamp to pass to endBlock(). Audio thread only.
+   */
+  static juce::int64 beginBlock() {
+    return juce::Time::getHighResolutionTicks();
+  }
+
+  /**
+   * Closes the block opened by beginBlock(). Audio thread only.
+   * @return The block's load (elapsed / deadline).
+   */
+  double endBlock(juce::int64 start_ticks, int num_samples, double sample_rate,
+                  int64_t master_pos, int active_nodes);
+
+  /**
+   * Records one block with a known wall time. Audio thread only.
+   * @return The block's load, 0 for an empty block.
+   */
+  double recordBlock(double elapsed_seconds, int num_samples,
+                     double sample_rate, int64_t master_pos,
+                     int active_nodes);
+
+  int64_t getNumBlocks() const { return num_blocks.load(); }
+  int64_t getNumNearMisses() const { return num_near_misses.load(); }
+  int64_t getNumOverruns() const { return num_overruns.load(); }
+  double getMaxLoad() const { return max_load.load(); }
+
+  /**
+   * Returns up to kOverrunHistorySize most recent overruns, oldest first.
+   */
+  juce::Array<OverrunEvent> getRecentOverruns() const;
+
+  /**
+   * Returns every statistic as a JSON-compatible object for the bridge.
+   */
+  juce::var toVar() const;
+
+  /**
+   * One-line summary for the periodic log.
+   */
+  juce::String getSummaryLine() const;
+
+ private:
+  // Per-slot sequence lock: readers skip a slot being rewritten.
+  struct OverrunSlot {
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<int64_t> master_pos{0};
+    std::atomic<int> active_nodes{0};
+    std::atomic<double> load{0.0};
+    std::atomic<uint64_t> time_ns{0};
+  };
+
+  std::atomic<int64_t> num_blocks{0};
+  std::atomic<int64_t> num_near_misses{0};
+  std::atomic<int64_t> num_overruns{0};
+  std::atomic<double> max_load{0.0};
+  std::atomic<double> total_load{0.0};
+  std::array<std::atomic<int64_t>, kNumLoadBuckets> load_histogram{};
+
+  std::array<OverrunSlot, kOverrunHistorySize> overrun_history;
+  std::atomic<int64_t> overrun_write_count{0};
+};
+
+}  // namespace celestrian
@@ -2,22 +2,50 @@
 
 #include <juce_audio_basics/juce_audio_basics.h>
 
+#include <algorithm>
+#include <array>
+
 #include "box_node.h"
+#include "loop_kernels.h"
 
 namespace celestrian {
 
-ClipNode::ClipNode(juce::String node_name, double source_sample_rate)
-    : AudioNode(std::move(node_name)), sample_rate(source_sample_rate) {
-  // Initial size of 60 seconds
-  buffer.setSize(1, (int)(sample_rate * 60));
-  buffer.clear();
+ClipNode::ClipNode(juce::String node_name, double source_sample_rate,
+                   AudioMemoryArena *memory_arena)
+    : AudioNode(std::move(node_name)),
+      arena(memory_arena),
+      sample_rate(source_sample_rate) {
+  // Initial size of 60 seconds, locked in the arena if it has room
+  const int num_samples = (int)(sample_rate * 60);
+  if (arena != nullptr) arena_storage = arena->allocate(num_samples);
+  if (arena_storage != nullptr) {
+    float *const channels[] = {arena_storage};
+    buffer.setDataToReferTo(channels, 1, num_samples);  // Already zeroed
+  } else {
+    buffer.setSize(1, num_samples);
+    buffer.clear();
+  }
+
+  const int num_chunks =
+      (buffer.getNumSamples() + kSamplesPerCachedPeak - 1) /
+      kSamplesPerCachedPeak;
+  silent_chunks =
+      std::vector<std::atomic<uint64_t>>((size_t)(num_chunks + 63) / 64);
+}
+
+ClipNode::~ClipNode() {
+  if (arena_storage != nullptr) arena->free(arena_storage);
 }
 
-juce::var ClipNode::getMetadata() const {
-  auto base = AudioNode::getMetadata();
+juce::var ClipNode::getMetadata(const MetadataQuery &query) const {
+  // The parent box works the quantum out once for all of its children
+  const int64_t Q = query.parent_quantum != MetadataQuery::kUnknownQuantum
+                        ? query.parent_quantum
+                        : getEffectiveQuantum();
+  auto base = makeMetadata(Q);
   auto *obj = base.getDynamicObject();
   obj->setProperty("sampleRate", sample_rate);
-  obj->setProperty("inputChannel", preferred_input_channel);
+  obj->setProperty("inputChannel", preferred_input_channel.load());
   obj->setProperty("isPendingStart", (bool)is_pending_start.load());
   obj->setProperty("isAwaitingStop", (bool)is_awaiting_stop.load());
   obj->setProperty("isPlaying", (bool)is_playing.load());
@@ -30,10 +58,7 @@ juce::var ClipNode::getMetadata() const {
         ", current write_position=" + juce::String(write_position.load()));
   }
 
-  int64_t Q = getEffectiveQuantum();
-  obj->setProperty("effectiveQuantum", (double)Q);
-
-  if (Q > 0 && is_node_recording.load()) {
+  if (Q > 0 && isNodeRecording()) {
     obj->setProperty("recordingStartPhase",
                      (double)(trigger_master_position.load() % Q));
   }
@@ -41,17 +66,38 @@ juce::var ClipNode::getMetadata() const {
   return base;
 }
 
+MemoryUsage ClipNode::getMemoryUsage() const {
+  MemoryUsage usage;
+  // The buffer is only sized in the constructor, so reading it here is safe
+  usage.audio_bytes = MemoryUsage::bytesForSamples(buffer.getNumChannels(),
+                                                   buffer.getNumSamples());
+  int64_t used_samples = isNodeRecording() ? (int64_t)write_position.load()
+                                           : getDurationSamples();
+  usage.audio_used_bytes = std::min(
+      usage.audio_bytes,
+      MemoryUsage::bytesForSamples(buffer.getNumChannels(), 1) * used_samples);
+  usage.peak_cache_bytes = peak_cache_bytes.load();
+  return usage;
+}
+
 int64_t ClipNode::getEffectiveQuantum() const {
-  if (parent) return parent->getEffectiveQuantum();
+  if (auto *p = getParent()) return p->getEffectiveQuantum();
   return 0;
 }
 
 void ClipNode::process(const float *const *input_channels,
                        float *const *output_channels, int num_input_channels,
                        int num_output_channels, const ProcessContext &context) {
-  // Handle PLL Start Anchor
-  if (is_pending_start.load()) {
-    int64_t Q = getEffectiveQuantum();
+  // Where in this block recording starts, and playback after a commit
+  int record_offset = 0;
+  int play_from = 0;
+
+  // Handle PLL Start Anchor. Once the start is on the engine's scheduler
+  // there is nothing to check until it fires.
+  if (is_pending_start.load() && !start_scheduled.load()) {
+    // The quantum the sender looked up: getEffectiveQuantum() would lock and
+    // walk the boxes
+    const int64_t Q = start_quantum.load();
     bool should_start = true;
 
     if (Q > 0) {
@@ -78,23 +124,17 @@ void ClipNode::process(const float *const *input_channels,
 
       // Calculate visual X position based on context loop
       // context_loop = max(longest_existing_sibling_duration, Q)
-      int64_t Q = getEffectiveQuantum();
       int64_t context_loop = Q > 0 ? Q : 1;
 
       // Find longest sibling clip (the context loop)
-      if (parent != nullptr) {
-        auto *box = dynamic_cast<BoxNode *>(parent);
-        if (box != nullptr) {
-          for (int i = 0; i < box->getNumChildren(); ++i) {
-            auto *sibling = box->getChild(i);
-            if (sibling != this && !sibling->is_node_recording.load()) {
-              int64_t sib_dur = sibling->duration_samples.load();
-              if (sib_dur > context_loop) {
-                context_loop = sib_dur;
-              }
-            }
-          }
-        }
+      const auto *box = dynamic_cast<const BoxNode *>(getParent());
+      if (box != nullptr) {
+        box->forEachChildInBlock(
+            [this, &context_loop](const AudioNode &sibling) {
+              if (&sibling != this && !sibling.isNodeRecording())
+                context_loop =
+                    std::max(context_loop, sibling.getDurationSamples());
+            });
       }
 
       // base_width = 200px (1 quantum), base_x = column position
@@ -106,20 +146,15 @@ void ClipNode::process(const float *const *input_channels,
       // This is LOOP-RELATIVE, not global time. The user's intent is:
       // "I pressed record when the playhead was HERE in the loop"
       int64_t context_launch_point = 0;
-      if (parent != nullptr) {
-        auto *box = dynamic_cast<BoxNode *>(parent);
-        if (box != nullptr) {
-          for (int i = 0; i < box->getNumChildren(); ++i) {
-            auto *sibling = box->getChild(i);
-            if (sibling != this && !sibling->is_node_recording.load()) {
-              int64_t sib_dur = sibling->duration_samples.load();
-              if (sib_dur == context_loop) {
-                context_launch_point = sibling->launch_point_samples.load();
-                break;
-              }
-            }
+      if (box != nullptr) {
+        bool found = false;
+        box->forEachChildInBlock([&](const AudioNode &sibling) {
+          if (!found && &sibling != this && !sibling.isNodeRecording() &&
+              sibling.getDurationSamples() == context_loop) {
+            context_launch_point = sibling.getLaunchPoint();
+            found = true;
           }
-        }
+        });
       }
 
       // Calculate offset (same formula as playback uses)
@@ -153,27 +188,34 @@ void ClipNode::process(const float *const *input_channels,
         int64_t quantum_offset = future_effective_pos / Q;
         x_pos.store(base_x + quantum_offset * base_width);
 
-        juce::Logger::writeToLog(
-            "  → Waiting for Q: master_pos=" + juce::String(compensated_pos) +
-            ", next_q=" + juce::String(next_q_master) + ", anchor will be " +
-            juce::String(future_effective_pos));
-
         // If already at boundary, start immediately
         if (compensated_pos >= next_q_master ||
             next_q_master - compensated_pos < 512) {
           is_pending_start.store(false);
           is_recording.store(true);
-          is_node_recording.store(true);
+          setNodeRecording(true);
           trigger_master_position.store(next_q_master);  // Capture start time
           write_position.store(0);
           live_duration_samples.store(0);
-          juce::Logger::writeToLog(
-              "ClipNode: Recording Started (at Q boundary)");
+          logFromBlock(context, RecordingLog::EntryType::Started,
+                       next_q_master);
         } else {
           // Wait for the Q boundary
           awaiting_start_at.store(next_q_master);
-          juce::Logger::writeToLog("ClipNode: Awaiting start at " +
-                                   juce::String(next_q_master));
+          logFromBlock(context, RecordingLog::EntryType::AwaitingStart,
+                       next_q_master);
+
+          // A boundary past this block goes to the engine's scheduler, which
+          // splits the block it lands in; one inside this block is below
+          const int64_t delay = next_q_master - context.master_pos;
+          if (context.scheduler != nullptr && delay >= context.num_samples) {
+            TransportEvent event;
+            event.time = context.sample_time + delay;
+            event.type = TransportEventType::StartRecording;
+            event.target = this;
+            event.value = next_q_master;
+            start_scheduled.store(context.scheduler->schedule(event));
+          }
         }
       } else {
         // No Q established yet (first clip) - start immediately at anchor=0
@@ -181,34 +223,27 @@ void ClipNode::process(const float *const *input_channels,
         x_pos.store(base_x);
         is_pending_start.store(false);
         is_recording.store(true);
-        is_node_recording.store(true);
+        setNodeRecording(true);
         trigger_master_position.store(
             compensated_pos);  // Capture start time (immediate)
         write_position.store(0);
         live_duration_samples.store(0);
-        juce::Logger::writeToLog("ClipNode: Recording Started at master_pos=" +
-                                 juce::String(compensated_pos) +
-                                 " (anchor=0, first clip)");
+        logFromBlock(context, RecordingLog::EntryType::Started,
+                     compensated_pos);
       }
     }
 
-    // Check if we're waiting to start at a Q boundary
-    if (is_pending_start.load() && awaiting_start_at.load() > 0) {
+    // Check if we're waiting to start at a Q boundary in this block (the
+    // scheduler starts us on one it was given)
+    if (is_pending_start.load() && awaiting_start_at.load() > 0 &&
+        !start_scheduled.load()) {
       int64_t target = awaiting_start_at.load();
       int64_t start_p = context.master_pos;
       int64_t end_p = context.master_pos + context.num_samples;
 
       if (start_p < target && end_p >= target) {
-        is_pending_start.store(false);
-        awaiting_start_at.store(0);
-        is_recording.store(true);
-        is_node_recording.store(true);
-        trigger_master_position.store(target);  // Capture start time (delayed)
-        write_position.store(0);
-        live_duration_samples.store(0);
-        juce::Logger::writeToLog(
-            "ClipNode: Recording Started (crossed Q boundary at " +
-            juce::String(target) + ")");
+        record_offset = (int)(target - start_p);
+        beginRecording(target, context);
       }
     }
   }
@@ -217,170 +252,383 @@ void ClipNode::process(const float *const *input_channels,
   if (is_recording.load()) {
     if (context.is_recording && input_channels != nullptr &&
         num_input_channels > 0) {
-      const float *in = input_channels[std::min(preferred_input_channel,
-                                                num_input_channels - 1)];
-      int samples_to_write = std::min(
-          context.num_samples, buffer.getNumSamples() - write_position.load());
+      const float *in = input_channels[std::min(
+          preferred_input_channel.load(), num_input_channels - 1)];
+      const int64_t start_p = write_position.load();
+      int block_samples = context.num_samples - record_offset;
+
+      // A stop boundary inside this block ends the write on it; one past it
+      // goes to the scheduler, which stops us on the exact sample
+      bool stops_here = false;
+      int64_t stop_target = 0;
+      if (is_awaiting_stop.load() && !stop_scheduled.load()) {
+        stop_target = awaiting_stop_at.load();
+        const int64_t to_stop = stop_target - start_p;
+        if (to_stop <= block_samples) {
+          block_samples = (int)std::max<int64_t>(0, to_stop);
+          stops_here = true;
+        } else if (context.scheduler != nullptr) {
+          TransportEvent event;
+          event.time = context.sample_time + record_offset + to_stop;
+          event.type = TransportEventType::StopRecording;
+          event.target = this;
+          event.value = stop_target;
+          stop_scheduled.store(context.scheduler->schedule(event));
+        }
+      }
+
+      int samples_to_write =
+          std::min(block_samples, buffer.getNumSamples() - (int)start_p);
 
       if (samples_to_write > 0) {
-        buffer.copyFrom(0, write_position.load(), in, samples_to_write);
-
-        // Peak tracking
-        float blockPeak = 0.0f;
-        for (int ch = 0; ch < num_input_channels; ++ch) {
-          if (input_channels[ch] != nullptr) {
-            for (int i = 0; i < samples_to_write; ++i) {
-              blockPeak = std::max(blockPeak, std::abs(input_channels[ch][i]));
+        buffer.copyFrom(0, (int)start_p, in + record_offset, samples_to_write);
+
+        // Peak tracking; meters freeze while the engine sheds load
+        if (context.shed_level == ShedLevel::None) {
+          float blockPeak = 0.0f;
+          for (int ch = 0; ch < num_input_channels; ++ch) {
+            if (input_channels[ch] != nullptr) {
+              const float *channel = input_channels[ch] + record_offset;
+              for (int i = 0; i < samples_to_write; ++i) {
+                blockPeak = std::max(blockPeak, std::abs(channel[i]));
+              }
             }
           }
-        }
-        last_block_peak.store(blockPeak);
+          setLastBlockPeak(blockPeak);
 
-        if (blockPeak > current_max_peak.load()) {
-          current_max_peak.store(blockPeak);
+          if (blockPeak > current_max_peak.load()) {
+            current_max_peak.store(blockPeak);
+          }
         }
 
-        int64_t start_p = write_position.load();
         write_position.fetch_add(samples_to_write);
         int64_t end_p = write_position.load();
         live_duration_samples.store(end_p);  // Live update for UI visibility
+      }
 
-        if (is_awaiting_stop.load()) {
-          int64_t target = awaiting_stop_at.load();
-          if (start_p < target && end_p >= target) {
-            commit_master_pos.store(context.master_pos);
-            commitRecording(target);
-            is_awaiting_stop.store(false);
-            return;
-          }
-        }
-      } else {
+      if (stops_here) {
+        // Committed on the boundary's own sample; playback takes over there
+        play_from = record_offset + block_samples;
+        commit_master_pos.store(context.master_pos + play_from);
+        commitFromBlock(stop_target, stop_quantum.load(), context);
+      } else if (start_p >= buffer.getNumSamples()) {
         commit_master_pos.store(context.master_pos);
-        commitRecording();
+        commitFromBlock(-1, getCachedQuantum(), context);
       }
     }
   }
 
   // Handle Playback
   if (context.is_playing && is_playing) {
-    int64_t start = loop_start_samples.load();
-    int64_t end = loop_end_samples.load();
+    int64_t start = getLoopStart();
+    int64_t end = getLoopEnd();
     int64_t dur = end - start;
 
     if (dur > 0) {
-      bool isSilenced = is_muted.load() || (!context.solo_node_uuid.isEmpty());
-      if (isSilenced && !is_muted.load()) {
-        // Check if we or any ancestor is soloed
-        celestrian::AudioNode *curr = this;
-        while (curr != nullptr) {
-          if (curr->getUuid() == context.solo_node_uuid) {
-            isSilenced = false;
-            break;
-          }
-          curr = curr->getParent();
-        }
-      }
+      const bool isSilenced = isSilencedIn(context);
 
       // Audio Memory Principle: playback starts from launch_point to maintain
       // alignment with the audio context during recording.
       // launch_point is already calculated as (duration - anchor) % duration
       // so it represents the correct offset to start playback
-      int64_t launch = launch_point_samples.load();
+      int64_t launch = getLaunchPoint();
       int64_t offset = launch;  // Use launch_point directly - it's the offset
 
-      // DEBUG: Log first playback frame for this clip only
-      if (!debug_playback_logged_) {
-        debug_playback_logged_ = true;
-        juce::Logger::writeToLog(
-            "PLAYBACK DEBUG [" + getName() +
-            "]: master=" + juce::String(context.master_pos) +
-            ", launch=" + juce::String(launch) + ", dur=" + juce::String(dur) +
-            ", effective_pos=" +
-            juce::String((context.master_pos + offset) % dur));
+      // Silenced clips and silent stretches of the take skip the loop, and
+      // under overload dropped clips fade out and then skip it too
+      const float target_gain = isShedDropped(context) ? 0.0f : 1.0f;
+      const bool renders =
+          !isSilenced && !(shed_gain == 0.0f && target_gain == 0.0f) &&
+          !isLoopRangeSilent(context.master_pos + play_from,
+                             context.num_samples - play_from, start, dur,
+                             offset);
+      const float gain_step = 1.0f / (float)kShedFadeSamples;
+
+      if (renders && play_from < context.num_samples) {
+        shed_gain = mixLoop(
+            selectLoopKernels(num_output_channels, context.fixed_block_size),
+            buffer.getReadPointer(0), buffer.getNumSamples(), output_channels,
+            num_output_channels, play_from, context.num_samples - play_from,
+            start, dur, (context.master_pos + play_from + offset) % dur,
+            shed_gain, target_gain, gain_step);
       }
+      // Silence has nothing to fade
+      if (!renders) shed_gain = target_gain;
+    }
+    advancePlayhead(context);
+  }
+}
 
-      for (int i = 0; i < context.num_samples; ++i) {
-        // Calculate effective position with launch offset
-        int64_t current_master_pos = context.master_pos + i;
-        int64_t effective_pos = (current_master_pos + offset) % dur;
-        int current_read_position =
-            (int)((start + effective_pos) % buffer.getNumSamples());
-
-        for (int ch = 0; ch < num_output_channels; ++ch) {
-          if (output_channels[ch] != nullptr && !isSilenced) {
-            output_channels[ch][i] +=
-                buffer.getReadPointer(0)[current_read_position];
-          }
-        }
-      }
+void ClipNode::advancePlayhead(const ProcessContext &context) {
+  if (!context.is_playing || !is_playing) return;
 
-      // Update playhead position for UI
-      // Use effective_pos/dur for clean 0..1 range within the loop
-      int64_t effective_pos = (context.master_pos + offset) % dur;
-      if (dur > 0)
-        playhead_pos.store((double)effective_pos / (double)dur);
-      else
-        playhead_pos.store(0.0);
-    } else {
-      playhead_pos.store(0.0);
-    }
+  // Use effective_pos/dur for clean 0..1 range within the loop
+  const int64_t dur = getLoopEnd() - getLoopStart();
+  if (dur > 0) {
+    int64_t effective_pos = (context.master_pos + getLaunchPoint()) % dur;
+    setPlayheadPosition((double)effective_pos / (double)dur);
+  } else {
+    setPlayheadPosition(0.0);
+  }
+}
+
+bool ClipNode::renderAhead(float *const *outputs, int num_outputs,
+                           const ProcessContext &context,
+                           RenderScratch &scratch) const {
+  juce::ignoreUnused(scratch);
+  if (isNodeRecording() || is_pending_start.load() ||
+      is_awaiting_stop.load())
+    return false;
+  if (!context.is_playing || !is_playing) return true;
+
+  // The same samples, in the same order, as the playback loop in process()
+  const int64_t start = getLoopStart();
+  const int64_t dur = getLoopEnd() - start;
+  if (dur <= 0 || isSilencedIn(context)) return true;
+  const int64_t offset = getLaunchPoint();
+  if (isLoopRangeSilent(context.master_pos, context.num_samples, start, dur,
+                        offset))
+    return true;
+  mixLoop(selectLoopKernels(num_outputs, context.fixed_block_size),
+          buffer.getReadPointer(0), buffer.getNumSamples(), outputs,
+          num_outputs, 0, context.num_samples, start, dur,
+          (context.master_pos + offset) % dur, 1.0f, 1.0f, 0.0f);
+  return true;
+}
+
+bool ClipNode::isSilentFor(const ProcessContext &context) const {
+  if (is_recording.load() || isNodeRecording() ||
+      is_pending_start.load() || is_awaiting_stop.load())
+    return false;
+  if (!context.is_playing || !is_playing) return true;
+
+  const int64_t start = getLoopStart();
+  const int64_t dur = getLoopEnd() - start;
+  return dur <= 0 || isSilencedIn(context) ||
+         isLoopRangeSilent(context.master_pos, context.num_samples, start,
+                           dur, getLaunchPoint());
+}
+
+void ClipNode::skipSilentBlock(const ProcessContext &context) {
+  // Where process() would have left the overload fade after silence
+  if (context.is_playing && is_playing)
+    shed_gain = isShedDropped(context) ? 0.0f : 1.0f;
+  advancePlayhead(context);
+}
+
+bool ClipNode::isSilencedIn(const ProcessContext &context) const {
+  if (isMuted()) return true;
+  if (context.solo_node == nullptr) return false;
+
+  // Check if we or any ancestor is soloed
+  for (const AudioNode *curr = this; curr != nullptr;
+       curr = curr->getParent()) {
+    if (curr == context.solo_node) return false;
+  }
+  return true;
+}
+
+bool ClipNode::isLoopRangeSilent(int64_t master_pos, int num_samples,
+                                 int64_t loop_start, int64_t loop_length,
+                                 int64_t offset) const {
+  // Not while buildPeakCache() rewrites the map
+  const uint32_t sequence =
+      silence_map_sequence.load(std::memory_order_acquire);
+  if ((sequence & 1u) != 0) return false;
+
+  // Only a map of the take being played counts
+  if (silence_map_take.load(std::memory_order_relaxed) !=
+          take_generation.load() ||
+      num_samples <= 0 || loop_start < 0 ||
+      loop_start + loop_length >
+          silence_map_samples.load(std::memory_order_relaxed))
+    return false;
+
+  bool silent = false;
+  if (num_samples >= loop_length) {
+    silent = areChunksSilent(loop_start, loop_start + loop_length);
+  } else {
+    // The block's stretch of the loop, wrapping once at most
+    const int64_t first = (master_pos + offset) % loop_length;
+    const int64_t last = first + num_samples;
+    if (last <= loop_length)
+      silent = areChunksSilent(loop_start + first, loop_start + last);
+    else
+      silent =
+          areChunksSilent(loop_start + first, loop_start + loop_length) &&
+          areChunksSilent(loop_start, loop_start + last - loop_length);
+  }
+
+  // A rewrite that started after the first check may have torn the words
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return silent &&
+         silence_map_sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+bool ClipNode::areChunksSilent(int64_t begin, int64_t end) const {
+  const int64_t last_chunk = (end - 1) / kSamplesPerCachedPeak;
+  for (int64_t chunk = begin / kSamplesPerCachedPeak; chunk <= last_chunk;
+       ++chunk) {
+    const uint64_t word =
+        silent_chunks[(size_t)(chunk / 64)].load(std::memory_order_relaxed);
+    if (((word >> (chunk % 64)) & 1u) == 0) return false;
+  }
+  return true;
+}
+
+void ClipNode::beginRecording(int64_t trigger_position,
+                              const ProcessContext &context) {
+  is_pending_start.store(false);
+  awaiting_start_at.store(0);
+  start_scheduled.store(false);
+  is_recording.store(true);
+  setNodeRecording(true);
+  trigger_master_position.store(trigger_position);  // Capture start time
+  write_position.store(0);
+  live_duration_samples.store(0);
+  logFromBlock(context, RecordingLog::EntryType::Started, trigger_position);
+}
+
+void ClipNode::logFromBlock(const ProcessContext &context,
+                            RecordingLog::EntryType type,
+                            int64_t master_pos) const {
+  RecordingLog::Entry entry;
+  entry.type = type;
+  entry.master_pos = master_pos;
+  logFromBlock(context, entry);
+}
+
+void ClipNode::logFromBlock(const ProcessContext &context,
+                            const RecordingLog::Entry &entry) const {
+  if (context.recording_log != nullptr) context.recording_log->add(entry);
+}
+
+int64_t ClipNode::getCachedQuantum() const {
+  const auto *box = dynamic_cast<const BoxNode *>(getParent());
+  return box != nullptr ? box->getCachedQuantum() : 0;
+}
+
+void ClipNode::handleTransportEvent(const TransportEvent &event,
+                                    const ProcessContext &context) {
+  switch (event.type) {
+    case TransportEventType::StartRecording:
+      // Stale if recording was restarted or stopped since it was scheduled
+      if (!is_pending_start.load() || awaiting_start_at.load() != event.value) {
+        start_scheduled.store(false);
+      } else if (!context.is_playing) {
+        // The transport stopped first: wait for it to reach the boundary
+        start_scheduled.store(false);
+      } else {
+        beginRecording(event.value, context);
+      }
+      break;
+    case TransportEventType::StopRecording:
+      stop_scheduled.store(false);
+      // A later stopRecording() may have moved the boundary: the next block
+      // picks it up
+      if (is_recording.load() && is_awaiting_stop.load() &&
+          awaiting_stop_at.load() == event.value) {
+        commit_master_pos.store(context.master_pos);
+        commitFromBlock(event.value, stop_quantum.load(), context);
+      }
+      break;
+    case TransportEventType::StartPlayback:
+      startPlayback();
+      break;
+    case TransportEventType::StopPlayback:
+      stopPlayback();
+      break;
+    default:
+      AudioNode::handleTransportEvent(event, context);
+      break;
   }
 }
 
-void ClipNode::startRecording() {
-  buffer.clear();
+void ClipNode::prepareRecording() {
+  if (!is_playing.load() && !isNodeRecording()) buffer.clear();
+}
+
+void ClipNode::startRecording() { startRecording(getEffectiveQuantum()); }
+
+void ClipNode::startRecording(int64_t quantum) {
+  start_quantum.store(quantum);
   write_position.store(0);
   read_position.store(0);
   current_max_peak.store(0.0f);
 
   is_pending_start.store(true);
+  start_scheduled.store(false);
+  stop_scheduled.store(false);
   is_recording.store(false);
-  is_node_recording.store(true);
+  setNodeRecording(true);
 
-  duration_samples.store(0);
+  setDurationSamples(0);
   is_playing.store(false);
+  take_generation.fetch_add(1);  // The old take's peaks are stale
 }
 
-void ClipNode::stopRecording() {
-  if (is_node_recording.load()) {
+bool ClipNode::stopRecording(int64_t quantum) {
+  if (!isNodeRecording()) return false;
+
+  if (quantum > 0) {
     int64_t L = (int64_t)write_position.load();
-    int64_t Q = getEffectiveQuantum();
+    int64_t Q = quantum;
 
-    if (Q > 0) {
-      // ALWAYS wait for the next clean quantum boundary
-      // No tolerance check - recording always extends to next Q
-      int64_t nextB = ((L / Q) + 1) * Q;
-
-      // Also check subdivisions for short recordings (< Q/2)
-      if (L < Q / 2) {
-        for (int d : {2, 4, 8}) {
-          int64_t sub = Q / d;
-          if (sub > L && sub < nextB) nextB = sub;
-        }
-      }
+    // ALWAYS wait for the next clean quantum boundary
+    // No tolerance check - recording always extends to next Q
+    int64_t nextB = ((L / Q) + 1) * Q;
 
-      awaiting_stop_at.store(nextB);
-      is_awaiting_stop.store(true);
-      juce::Logger::writeToLog(
-          "ClipNode: Waiting for next Q boundary B=" + juce::String(nextB) +
-          " (current L=" + juce::String(L) + ")");
-      return;
+    // Also check subdivisions for short recordings (< Q/2)
+    if (L < Q / 2) {
+      for (int d : {2, 4, 8}) {
+        int64_t sub = Q / d;
+        if (sub > L && sub < nextB) nextB = sub;
+      }
     }
 
-    commitRecording();
+    stop_quantum.store(quantum);
+    awaiting_stop_at.store(nextB);
+    is_awaiting_stop.store(true);
+    return false;
   }
+
+  // No grid: the take ends here, and is committed off the audio thread
+  is_pending_start.store(false);
+  is_recording.store(false);
+  return true;
+}
+
+void ClipNode::stopRecording() {
+  if (stopRecording(getEffectiveQuantum())) commitRecording();
 }
 
 void ClipNode::commitRecording(int64_t final_duration) {
-  if (is_node_recording.load()) {
+  RecordingLog::Entry entry;
+  if (applyCommit(final_duration, getEffectiveQuantum(), false, entry))
+    juce::Logger::writeToLog(RecordingLog::describe(entry));
+}
+
+void ClipNode::commitFromBlock(int64_t final_duration, int64_t quantum,
+                               const ProcessContext &context) {
+  RecordingLog::Entry entry;
+  if (applyCommit(final_duration, quantum, true, entry))
+    logFromBlock(context, entry);
+}
+
+bool ClipNode::applyCommit(int64_t final_duration, int64_t quantum,
+                           bool in_block, RecordingLog::Entry &entry) {
+  CELESTRIAN_TRACE_SCOPE("audio", "ClipNode::commitRecording");
+  if (isNodeRecording()) {
     is_recording.store(false);
     is_pending_start.store(false);
     is_awaiting_stop.store(false);
-    is_node_recording.store(false);
+    setNodeRecording(false);
 
     int64_t L = (int64_t)write_position.load();
-    int64_t Q = getEffectiveQuantum();
+    int64_t Q = quantum;
     int64_t duration = L;
+    entry.type = RecordingLog::EntryType::Committed;
+    entry.recorded_samples = L;
 
     if (Q > 0 && final_duration <= 0) {
       // Hysteresis Snapping Logic
@@ -391,12 +639,10 @@ void ClipNode::commitRecording(int64_t final_duration) {
       int64_t floor_multiple = (L / Q) * Q;
       int64_t ceil_multiple = floor_multiple + Q;
 
-      // Also consider subdivisions for short recordings
-      std::vector<int64_t> candidates = {floor_multiple, ceil_multiple};
-      for (int d : {2, 4, 8}) {
-        int64_t sub = Q / d;
-        if (sub > 0) candidates.push_back(sub);
-      }
+      // Also consider subdivisions for short recordings. A fixed array: this
+      // runs on the audio thread when a stop lands on a boundary.
+      const std::array<int64_t, 5> candidates = {floor_multiple, ceil_multiple,
+                                                 Q / 2, Q / 4, Q / 8};
 
       int64_t best_B = -1;
       int64_t min_diff = std::numeric_limits<int64_t>::max();
@@ -413,11 +659,8 @@ void ClipNode::commitRecording(int64_t final_duration) {
       if (best_B != -1 &&
           min_diff < (int64_t)(HYSTERESIS_THRESHOLD * (double)Q)) {
         duration = best_B;
-        juce::Logger::writeToLog(
-            "ClipNode: Late Snap to B=" + juce::String(best_B) +
-            " (L=" + juce::String(L) + ")");
-        loop_start_samples.store(0);
-        loop_end_samples.store(duration);
+        entry.snap = RecordingLog::Snap::Late;
+        setLoopPoints(0, duration);
       } else {
         // Outside tolerance: Keep raw duration but snap loop region to previous
         // clean multiple.
@@ -428,44 +671,43 @@ void ClipNode::commitRecording(int64_t final_duration) {
             loop_end = Q / 2;  // Default subdivision if too short
         }
 
-        loop_start_samples.store(0);
-        loop_end_samples.store(loop_end);
-
-        juce::Logger::writeToLog(
-            "ClipNode: Instant Stop at L=" + juce::String(L) +
-            " (Outside tolerance). " + "Loop Region set to " +
-            juce::String(loop_end));
+        setLoopPoints(0, loop_end);
+        entry.snap = RecordingLog::Snap::Outside;
       }
     } else if (final_duration > 0) {
       duration = final_duration;
-      juce::Logger::writeToLog("ClipNode: Anticipatory Snap to B=" +
-                               juce::String(duration));
-      loop_start_samples.store(0);
-      loop_end_samples.store(duration);
+      entry.snap = RecordingLog::Snap::Anticipatory;
+      setLoopPoints(0, duration);
     } else {
       // No quantum or fallback
-      loop_end_samples.store(duration);
+      setLoopPoints(getLoopStart(), duration);
     }
 
-    duration_samples.store(
-        duration);  // CRITICAL: Store final duration so UI knows clip is valid!
+    // prepareRecording() leaves the old take in place if it was playing
+    const int64_t stale_end =
+        std::min<int64_t>(duration, buffer.getNumSamples());
+    if (stale_end > L)
+      buffer.clear(0, (int)L, (int)(stale_end - L));
+
+    // CRITICAL: Store final duration so UI knows clip is valid!
+    setDurationSamples(duration);
 
     // 1. Determine Context Loop (siblings) to find preferred Visual Position
     // note: Q is already defined at top of function
     int64_t context_loop = (Q > 0) ? Q : 1;
 
-    // Find longest sibling to define the context grid
-    if (parent != nullptr) {
-      if (auto *box = dynamic_cast<BoxNode *>(parent)) {
-        for (int i = 0; i < box->getNumChildren(); ++i) {
-          auto *sibling = box->getChild(i);
-          // Use generic AudioNode interface (NO CASTING)
-          if (sibling != this && !sibling->isRecording()) {
-            int64_t sd = sibling->getIntrinsicDuration();
-            if (sd > context_loop) context_loop = sd;
-          }
-        }
-      }
+    // Find longest sibling to define the context grid. Sub-boxes report
+    // what they cached, so the commit never walks below the siblings.
+    if (const auto *box = dynamic_cast<const BoxNode *>(getParent())) {
+      auto longest = [this, &context_loop](const AudioNode &sibling) {
+        if (&sibling != this && !sibling.isRecording())
+          context_loop =
+              std::max(context_loop, sibling.getCachedIntrinsicDuration());
+      };
+      if (in_block)
+        box->forEachChildInBlock(longest);
+      else
+        box->forEachChild(longest);
     }
 
     // 2. Calculate Preferred Visual Position (based on Context)
@@ -544,27 +786,18 @@ void ClipNode::commitRecording(int64_t final_duration) {
 
       int64_t rotation = audio_anchor;
 
-      if (rotation > 0 && rotation < duration) {
-        juce::AudioBuffer<float> temp;
-        temp.makeCopyOf(buffer);
-
-        // Rotate: New[i] = Old[i - rotation]
+      if (rotation > 0 && rotation < duration &&
+          duration <= buffer.getNumSamples()) {
+        // Rotate: New[i] = Old[i - rotation], in place. Commits can run on
+        // the audio thread, so no scratch copy of the buffer.
         // Part A: [0..rotation-1] comes from End of buffer
         // Part B: [rotation..end] comes from Start of buffer
-
-        int64_t partA_len = rotation;
-        int64_t partB_len = duration - rotation;
-
-        // Copy Part B (Old Start) to New [rotation]
-        buffer.copyFrom(0, rotation, temp.getReadPointer(0), partB_len);
-        // Copy Part A (Old End) to New [0]
-        buffer.copyFrom(0, 0, temp.getReadPointer(0, partB_len), partA_len);
+        float *samples = buffer.getWritePointer(0);
+        std::rotate(samples, samples + (duration - rotation),
+                    samples + duration);
 
         rotated = true;
 
-        juce::Logger::writeToLog("ClipNode: Rotated buffer by " +
-                                 juce::String(rotation) + " samples.");
-
         // Reset phases because we physically moved the audio
         final_anchor = 0;
       }
@@ -590,22 +823,34 @@ void ClipNode::commitRecording(int64_t final_duration) {
     int64_t current_pos = commit_master_pos.load();
     int64_t launch_point =
         (duration > 0) ? (duration - (current_pos % duration)) % duration : 0;
-    launch_point_samples.store(launch_point);
+    setLaunchPoint(launch_point);
 
-    juce::Logger::writeToLog(
-        "ClipNode: Commit. Duration=" + juce::String(duration) +
-        ", StartTime=" + juce::String(trigger_pos) +
-        ", IdealX=" + juce::String(ideal_anchor) +
-        ", AudioPhase=" + juce::String(audio_anchor) +
-        ", Rotated=" + juce::String(rotated ? "YES" : "NO") +
-        ", FinalAnchor=" + juce::String(final_anchor));
+    entry.master_pos = trigger_pos;
+    entry.duration = duration;
+    entry.loop_end = getLoopEnd();
+    entry.ideal_anchor = ideal_anchor;
+    entry.audio_phase = audio_anchor;
+    entry.final_anchor = final_anchor;
+    entry.rotated = rotated;
 
+    take_generation.fetch_add(1);
     is_playing.store(true);
+    return true;
   }
+  return false;
+}
+
+bool ClipNode::isShedDropped(const ProcessContext &context) const {
+  const auto node_priority = getPriority();
+  if (node_priority == NodePriority::Essential || isNodeRecording())
+    return false;
+  if (context.shed_level == ShedLevel::DropNormalPriority) return true;
+  return context.shed_level == ShedLevel::DropLowPriority &&
+         node_priority == NodePriority::Low;
 }
 
 void ClipNode::startPlayback() {
-  if (duration_samples.load() > 0) {
+  if (getDurationSamples() > 0) {
     read_position.store(0);
     is_playing.store(true);
   }
@@ -615,12 +860,31 @@ void ClipNode::stopPlayback() { is_playing.store(false); }
 
 juce::var ClipNode::getWaveform(int num_peaks) const {
   juce::Array<juce::var> peaks;
-  int total_samples = (int)duration_samples;
+  int total_samples = (int)getDurationSamples();
   if (total_samples <= 0) total_samples = write_position.load();
 
   if (total_samples <= 0) return peaks;
 
   int window_size = std::max(1, total_samples / num_peaks);
+
+  // Zoomed out far enough: combine cached peaks instead of scanning audio
+  auto cache = getCurrentPeakCache();
+  if (cache != nullptr && cache->num_samples == total_samples &&
+      window_size >= kSamplesPerCachedPeak) {
+    const int num_cached = (int)cache->peaks.size();
+    for (int i = 0; i < num_peaks; ++i) {
+      int first = i * window_size / kSamplesPerCachedPeak;
+      int last = std::min(num_cached, ((i + 1) * window_size +
+                                       kSamplesPerCachedPeak - 1) /
+                                          kSamplesPerCachedPeak);
+      float peak = 0.0f;
+      for (int p = first; p < last; ++p)
+        peak = std::max(peak, cache->peaks[(size_t)p]);
+      peaks.add(peak);
+    }
+    return peaks;
+  }
+
   const float *data = buffer.getReadPointer(0);
 
   for (int i = 0; i < num_peaks; ++i) {
@@ -638,4 +902,77 @@ juce::var ClipNode::getWaveform(int num_peaks) const {
   return peaks;
 }
 
+bool ClipNode::needsPeakCache() const {
+  return !isNodeRecording() && getDurationSamples() > 0 &&
+         getCurrentPeakCache() == nullptr;
+}
+
+std::shared_ptr<const ClipNode::PeakCache> ClipNode::getCurrentPeakCache()
+    const {
+  std::lock_guard<std::mutex> lock(peak_cache_mutex);
+  if (peak_cache == nullptr || isNodeRecording() ||
+      peak_cache->take != take_generation.load())
+    return nullptr;
+  return peak_cache;
+}
+
+bool ClipNode::buildPeakCache(JobSystem::JobContext &context) {
+  const int64_t take = take_generation.load();
+  const int total_samples =
+      (int)std::min<int64_t>(getDurationSamples(), buffer.getNumSamples());
+  if (isNodeRecording() || total_samples <= 0) return false;
+
+  auto cache = std::make_shared<PeakCache>();
+  cache->take = take;
+  cache->num_samples = total_samples;
+  const int num_cached =
+      (total_samples + kSamplesPerCachedPeak - 1) / kSamplesPerCachedPeak;
+  cache->peaks.resize((size_t)num_cached);
+
+  const float *data = buffer.getReadPointer(0);
+  for (int p = 0; p < num_cached; ++p) {
+    if (p % 1024 == 0) {
+      if (context.isCancelled() || take_generation.load() != take)
+        return false;
+      context.setProgress((float)p / (float)num_cached);
+    }
+    const int start = p * kSamplesPerCachedPeak;
+    const int length = std::min(kSamplesPerCachedPeak, total_samples - start);
+    float lowest = 0.0f, highest = 0.0f;
+    juce::FloatVectorOperations::findMinAndMax(data + start, length, lowest,
+                                               highest);
+    cache->peaks[(size_t)p] = std::max(std::abs(lowest), std::abs(highest));
+  }
+
+  // A new take started while we read the old one
+  if (take_generation.load() != take) return false;
+
+  // Chunks whose peak is zero are digital silence. The audio thread ignores
+  // the map while it is rewritten: an odd sequence, or one that changed
+  // while it read.
+  const uint32_t sequence =
+      silence_map_sequence.load(std::memory_order_relaxed);
+  silence_map_sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  const int num_words = (num_cached + 63) / 64;
+  for (int w = 0; w < (int)silent_chunks.size(); ++w) {
+    uint64_t word = 0;
+    for (int bit = 0; bit < 64; ++bit) {
+      const int p = w * 64 + bit;
+      if (p < num_cached && cache->peaks[(size_t)p] == 0.0f)
+        word |= (uint64_t)1 << bit;
+    }
+    silent_chunks[(size_t)w].store(word, std::memory_order_relaxed);
+  }
+  silence_map_samples.store(total_samples, std::memory_order_relaxed);
+  silence_map_take.store(take, std::memory_order_relaxed);
+  silence_map_sequence.store(sequence + 2, std::memory_order_release);
+
+  std::lock_guard<std::mutex> lock(peak_cache_mutex);
+  peak_cache = std::move(cache);
+  peak_cache_bytes.store((int64_t)num_cached * (int64_t)sizeof(float) +
+                         (int64_t)num_words * (int64_t)sizeof(uint64_t));
+  return true;
+}
+
 }  // namespace celestrian
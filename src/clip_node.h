@@ -2,7 +2,14 @@
 
 #include <juce_audio_basics/juce_audio_basics.h>
 
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "audio_memory_arena.h"
 #include "audio_node.h"
+#include "job_system.h"
+#include "recording_log.h"
 
 namespace celestrian {
 
@@ -12,8 +19,14 @@ namespace celestrian {
  */
 class ClipNode : public AudioNode {
  public:
-  ClipNode(juce::String name, double source_sample_rate = 44100.0);
-  ~ClipNode() override = default;
+  /**
+   * @param arena Locked memory for the recording buffer, if the engine has
+   *              one; the heap is used when it's absent or full. Must
+   *              outlive the clip.
+   */
+  ClipNode(juce::String name, double source_sample_rate = 44100.0,
+           AudioMemoryArena *arena = nullptr);
+  ~ClipNode() override;
 
   // AudioNode implementation
   /**
@@ -23,6 +36,24 @@ class ClipNode : public AudioNode {
                float *const *output_channels, int num_input_channels,
                int num_output_channels, const ProcessContext &context) override;
 
+  /**
+   * Plays the committed loop like process() does at full gain. Not
+   * predictable while recording or waiting to start or stop.
+   */
+  bool renderAhead(float *const *outputs, int num_outputs,
+                   const ProcessContext &context,
+                   RenderScratch &scratch) const override;
+
+  void advancePlayhead(const ProcessContext &context) override;
+
+  /**
+   * Silent when stopped, muted, outside the soloed subtree, or when the loop
+   * only covers digital silence this block (once the peak cache is built).
+   * Never while recording or waiting to start or stop.
+   */
+  bool isSilentFor(const ProcessContext &context) const override;
+  void skipSilentBlock(const ProcessContext &context) override;
+
   /**
    * Overrides GetWaveform to return peak data from the internal buffer.
    */
@@ -34,27 +65,58 @@ class ClipNode : public AudioNode {
   NodeType getNodeType() const override { return NodeType::Clip; }
 
   int64_t getIntrinsicDuration() const override {
-    return duration_samples.load();
+    return getDurationSamples();
   }
   int64_t getEffectiveQuantum() const override;
 
   /**
    * Returns clip-specific metadata (sample rate, etc.).
    */
-  juce::var getMetadata() const override;
+  juce::var getMetadata(const MetadataQuery &query) const override;
+
+  /**
+   * Returns the recording buffer size and how much of it holds audio.
+   */
+  MemoryUsage getMemoryUsage() const override;
 
   /**
-   * Assigns the preferred hardware input channel for this clip.
+   * Assigns the preferred hardware input channel for this clip. The engine
+   * calls this between blocks (see AudioEngine::setNodeInput()).
    */
-  void setInputChannel(int index) { preferred_input_channel = index; }
+  void setInputChannel(int index) { preferred_input_channel.store(index); }
+  int getInputChannel() const { return preferred_input_channel.load(); }
   // Clip-specific methods
   /**
-   * Starts capturing hardware input into the internal buffer.
+   * Clears the previous take ahead of startRecording(), off the audio thread.
+   * Skipped while the callback still reads the buffer (the clip is playing or
+   * recording); the commit then zeroes whatever the new take leaves behind.
+   */
+  void prepareRecording();
+
+  /**
+   * Starts capturing hardware input into the internal buffer, on the next
+   * boundary of `quantum` if there is one. Only resets flags and positions,
+   * so it can run between two blocks.
+   */
+  void startRecording(int64_t quantum);
+
+  /**
+   * Starts recording on the clip's own quantum.
    */
   void startRecording();
 
   /**
-   * Signals the recording thread to stop and flush the buffer.
+   * Ends the take on the next boundary of `quantum`, or, with no quantum,
+   * stops capturing at once. Only sets flags, so it can run between two
+   * blocks.
+   * @return True if the take stopped and the caller should commitRecording()
+   *         it, off the audio thread.
+   */
+  bool stopRecording(int64_t quantum);
+
+  /**
+   * Stops recording on the clip's own quantum, committing straight away if
+   * there is none.
    */
   void stopRecording();
 
@@ -68,10 +130,17 @@ class ClipNode : public AudioNode {
    */
   void stopPlayback();
 
+  /**
+   * Starts or stops recording (or playback) on the event's exact sample.
+   */
+  void handleTransportEvent(const TransportEvent &event,
+                            const ProcessContext &context) override;
+
   bool isRecording() const override { return is_recording.load(); }
   bool isPlaying() const { return is_playing.load(); }
   bool isPendingStart() const { return is_pending_start.load(); }
   bool isAwaitingStop() const { return is_awaiting_stop.load(); }
+  int64_t getAwaitingStopAt() const { return awaiting_stop_at.load(); }
   int64_t getCommitMasterPos() const { return commit_master_pos.load(); }
 
   /**
@@ -87,13 +156,87 @@ class ClipNode : public AudioNode {
   /**
    * Returns the latest peak sample level captured by the process loop.
    */
-  float getCurrentPeak() const override { return last_block_peak.load(); }
+  float getCurrentPeak() const override { return getLastBlockPeak(); }
 
+  /**
+   * Ends the take and sets up its loop: snaps its length to the quantum,
+   * or to `final_duration` if given, and rotates its phase into place.
+   * Logs what it did. Off the audio thread: a take that stops on a
+   * boundary is committed there by process() or the scheduled stop, which
+   * leave the log line to the engine's RecordingLog instead.
+   */
   void commitRecording(int64_t final_duration = -1);
   const juce::AudioBuffer<float> &getAudioBuffer() const { return buffer; }
 
+  /** True if the recording buffer lives in an AudioMemoryArena. */
+  bool usesArena() const { return arena_storage != nullptr; }
+
+  // Peak cache
+  // Samples summarized by each cached peak, and by each bit of the silence
+  // map
+  static constexpr int kSamplesPerCachedPeak = 256;
+
+  /**
+   * True if there is a committed take whose peak cache is missing or stale.
+   */
+  bool needsPeakCache() const;
+
+  /**
+   * Builds the peak cache of the committed take, which getWaveform() then
+   * reads instead of scanning the audio, and the map of its silent regions
+   * the audio thread skips. For a JobSystem worker, never the audio thread.
+   * Gives up (returning false) if the job is cancelled or a new take starts
+   * meanwhile.
+   */
+  bool buildPeakCache(JobSystem::JobContext &context);
+
+  // Fade length when an overloaded engine drops or restores this clip
+  static constexpr int kShedFadeSamples = 256;
+
  private:
+  // Starts writing at the beginning of the buffer; `trigger_position` is the
+  // master position of its first sample
+  void beginRecording(int64_t trigger_position,
+                      const ProcessContext &context);
+
+  // commitRecording() against `quantum`, filling in `entry`; false if there
+  // was no take. Writes no log, and takes no lock `in_block`, so a block may
+  // run it.
+  bool applyCommit(int64_t final_duration, int64_t quantum, bool in_block,
+                   RecordingLog::Entry &entry);
+
+  // A commit from the block thread, logged to the context's RecordingLog
+  void commitFromBlock(int64_t final_duration, int64_t quantum,
+                       const ProcessContext &context);
+
+  // Adds to the context's RecordingLog, if it has one
+  void logFromBlock(const ProcessContext &context, RecordingLog::EntryType type,
+                    int64_t master_pos) const;
+  void logFromBlock(const ProcessContext &context,
+                    const RecordingLog::Entry &entry) const;
+
+  // The parent's quantum as of its last processed block
+  int64_t getCachedQuantum() const;
+
+  // True if the context's shed level drops clips of this one's priority
+  bool isShedDropped(const ProcessContext &context) const;
+
+  // True if muted, or outside the soloed subtree
+  bool isSilencedIn(const ProcessContext &context) const;
+
+  // True if the silence map covers every sample the loop plays from
+  // `master_pos` for `num_samples`, and all of them are zero
+  bool isLoopRangeSilent(int64_t master_pos, int num_samples,
+                         int64_t loop_start, int64_t loop_length,
+                         int64_t offset) const;
+
+  // True if every chunk overlapping buffer samples [begin, end) is silent
+  bool areChunksSilent(int64_t begin, int64_t end) const;
+
   juce::AudioBuffer<float> buffer;
+  // The arena `buffer` refers into, if any
+  AudioMemoryArena *arena = nullptr;
+  float *arena_storage = nullptr;
 
   std::atomic<int> write_position{0};
   std::atomic<int> read_position{0};
@@ -102,19 +245,53 @@ class ClipNode : public AudioNode {
   std::atomic<bool> is_pending_start{false};
   std::atomic<bool> is_awaiting_stop{false};
   std::atomic<bool> is_playing{false};
+  // A start or stop boundary is queued on the engine's TransportScheduler
+  std::atomic<bool> start_scheduled{false};
+  std::atomic<bool> stop_scheduled{false};
 
   std::atomic<int64_t> trigger_master_position{0};
   std::atomic<int64_t> awaiting_start_at{
       0};  // When to actually start recording
   std::atomic<int64_t> awaiting_stop_at{0};
+  // The quantum the pending start was given; it waits for its boundary
+  std::atomic<int64_t> start_quantum{0};
+  // The quantum the pending stop was given; the commit snaps to it
+  std::atomic<int64_t> stop_quantum{0};
   std::atomic<int64_t> commit_master_pos{
       0};  // Master pos when recording commits
 
   double sample_rate;
   std::atomic<float> current_max_peak{0.0f};
 
-  int preferred_input_channel = 0;
-  mutable bool debug_playback_logged_ = false;  // DEBUG: One-time playback log
+  std::atomic<int> preferred_input_channel{0};
+
+  // Playback gain ramped by overload shedding. Audio thread only.
+  float shed_gain = 1.0f;
+
+  // Counts takes, so a peak cache knows which one it summarizes
+  std::atomic<int64_t> take_generation{0};
+
+  struct PeakCache {
+    int64_t take = -1;
+    int64_t num_samples = 0;
+    std::vector<float> peaks;  // Max |sample| per kSamplesPerCachedPeak
+  };
+  // Returns the cache if it matches the committed take, else null
+  std::shared_ptr<const PeakCache> getCurrentPeakCache() const;
+
+  // Swapped whole by buildPeakCache(); never touched by the audio thread
+  mutable std::mutex peak_cache_mutex;
+  std::shared_ptr<const PeakCache> peak_cache;
+  std::atomic<int64_t> peak_cache_bytes{0};
+
+  // One bit per kSamplesPerCachedPeak buffer samples, set if they are all
+  // zero. Sized with the buffer; rewritten by buildPeakCache() under a
+  // sequence lock (odd while writing), and trusted by the audio thread only
+  // while silence_map_take is the current take.
+  std::vector<std::atomic<uint64_t>> silent_chunks;
+  std::atomic<uint32_t> silence_map_sequence{0};
+  std::atomic<int64_t> silence_map_take{-1};
+  std::atomic<int64_t> silence_map_samples{0};
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ClipNode)
 };
@@ -0,0 +1,16 @@
+#include "command_queue.h"
+
+namespace celestrian {
+
+uint64_t CommandQueue::push(const EngineCommand &command) {
+  const uint64_t index = write_index.load(std::memory_order_relaxed);
+  if (index - read_index.load(std::memory_order_acquire) >=
+      (uint64_t)kCapacity)
+    return 0;
+
+  commands[(size_t)(index & kMask)] = command;
+  write_index.store(index + 1, std::memory_order_release);
+  return index + 1;
+}
+
+}  // namespace celestrian
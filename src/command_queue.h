@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace celestrian {
+
+class AudioNode;
+
+enum class EngineCommandType {
+  TogglePlayback,
+  StartRecording,
+  StopRecording,
+  ToggleSolo,
+  TogglePlay,
+  ToggleMute,
+  SetNodeInput,
+  SetLoopPoints,
+  RemoveNode,
+};
+
+/**
+ * A change to engine or node state, applied by the audio thread between two
+ * blocks. `target` is resolved from its uuid before the command is sent;
+ * `first`/`second` are the arguments (SetNodeInput: channel; SetLoopPoints:
+ * start and end; StartRecording: first clip or not, and the clip's quantum;
+ * StopRecording: the clip's quantum). RemoveNode targets a subtree already
+ * unlinked from the graph, so the audio thread can drop what it keeps
+ * pointing into it.
+ */
+struct EngineCommand {
+  EngineCommandType type = EngineCommandType::TogglePlayback;
+  AudioNode *target = nullptr;
+  int64_t first = 0;
+  int64_t second = 0;
+};
+
+/**
+ * Wait-free single-producer, single-consumer ring of engine commands.
+ *
+ * Each command gets an id, counting from 1; the consumer acknowledges it by
+ * advancing the read index past it, so `isApplied(id)` tells the sender when
+ * it has taken effect. Fixed capacity, so neither side allocates or locks.
+ * Several threads may send only if they serialize push() among themselves
+ * (the engine does, off the audio thread).
+ */
+class CommandQueue {
+ public:
+  static constexpr int kCapacity = 256;
+  static_assert((kCapacity & (kCapacity - 1)) == 0,
+                "kCapacity must be a power of two");
+
+  /**
+   * Queues a command. Producer side.
+   * @return The command's id, or 0 if the queue is full.
+   */
+  uint64_t push(const EngineCommand &command);
+
+  /**
+   * Passes every queued command to `apply`, oldest first, acknowledging each
+   * once it returns. Consumer side. Returns how many were applied.
+   */
+  template <typename Apply>
+  int drain(Apply &&apply) {
+    const uint64_t first = read_index.load(std::memory_order_relaxed);
+    const uint64_t last = write_index.load(std::memory_order_acquire);
+    for (uint64_t index = first; index != last; ++index) {
+      apply(commands[(size_t)(index & kMask)]);
+      read_index.store(index + 1, std::memory_order_release);
+    }
+    return (int)(last - first);
+  }
+
+  /** True once the command with `id` has been applied. Safe from any thread. */
+  bool isApplied(uint64_t id) const {
+    return read_index.load(std::memory_order_acquire) >= id;
+  }
+
+  /** Commands waiting to be applied. Safe from any thread. */
+  int getNumPending() const {
+    return (int)(write_index.load(std::memory_order_acquire) -
+                 read_index.load(std::memory_order_acquire));
+  }
+
+  /**
+   * Drops every queued command, acknowledging them unapplied. Only while
+   * neither side is running, e.g. when the graph they target is replaced.
+   */
+  void clear() {
+    read_index.store(write_index.load(std::memory_order_acquire),
+                     std::memory_order_release);
+  }
+
+ private:
+  static constexpr uint64_t kMask = kCapacity - 1;
+
+  std::array<EngineCommand, kCapacity> commands;
+  // Free-running: a command's id is its write index plus one
+  std::atomic<uint64_t> write_index{0};
+  std::atomic<uint64_t> read_index{0};
+};
+
+}  // namespace celestrian
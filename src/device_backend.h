@@ -0,0 +1,60 @@
+#pragma once
+
+#include <juce_audio_devices/juce_audio_devices.h>
+
+namespace celestrian {
+
+/**
+ * Shape of the device an engine is running on.
+ */
+struct DeviceConfig {
+  double sample_rate = 44100.0;
+  int block_size = 512;
+  int num_inputs = 1;
+  int num_outputs = 2;
+  int input_latency = 0;   // samples
+  int output_latency = 0;  // samples
+};
+
+/**
+ * Where the engine's audio callback comes from.
+ *
+ * `HardwareDeviceBackend` runs it from the system's audio device;
+ * `OfflineDeviceBackend` runs it on demand from the calling thread, with
+ * scripted input, for tests, benchmarks and faster-than-realtime rendering.
+ */
+class DeviceBackend {
+ public:
+  virtual ~DeviceBackend() = default;
+
+  /**
+   * Starts delivering blocks to `callback`. The callback must outlive the
+   * backend, or close() must be called first.
+   */
+  virtual void open(juce::AudioIODeviceCallback &callback) = 0;
+
+  /**
+   * Stops delivering blocks. After this returns the callback is not running
+   * and won't be called again.
+   */
+  virtual void close() = 0;
+
+  /**
+   * Returns the current device shape. Safe to call from the audio callback.
+   */
+  virtual DeviceConfig getConfig() const = 0;
+
+  /**
+   * Returns the names of the device's input channels.
+   */
+  virtual juce::StringArray getInputChannelNames() const = 0;
+
+  /**
+   * True if blocks arrive on their own thread, in real time. False if they
+   * are rendered on demand from the caller's thread, so nothing renders
+   * while the caller is doing something else.
+   */
+  virtual bool isRealtime() const = 0;
+};
+
+}  // namespace celestrian
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+namespace celestrian {
+
+/**
+ * Per-node DSP cost, measured around each `process()` call.
+ *
+ * The audio thread accumulates one-second windows (by processed samples) in
+ * plain fields it alone touches, then publishes mean / p99 / max for the last
+ * complete window through atomics. Readers never block the audio thread.
+ *
+ * Profiling is off by default. When off, `ScopedDspTimer` costs one relaxed
+ * atomic load per node per block and reads no clocks.
+ */
+class DspProfile {
+ public:
+  struct Summary {
+    double mean_us = 0.0;
+    double p99_us = 0.0;
+    double max_us = 0.0;
+    int blocks = 0;  // Blocks in the window the figures come from
+  };
+
+  static void setEnabled(bool should_enable) {
+    enabled.store(should_enable, std::memory_order_relaxed);
+  }
+  static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+  /**
+   * Adds one block's cost. Audio thread only.
+   * @param elapsed_ns  Time spent in process() for this block.
+   * @param num_samples Block size, used to close one-second windows.
+   * @param sample_rate Samples per window.
+   */
+  void record(uint64_t elapsed_ns, int num_samples, double sample_rate) {
+    ++window_blocks;
+    window_total_ns += elapsed_ns;
+    window_max_ns = std::max(window_max_ns, elapsed_ns);
+    ++window_histogram[bucketFor(elapsed_ns)];
+
+    window_samples += num_samples;
+    if ((double)window_samples >= sample_rate) publishWindow();
+  }
+
+  /**
+   * Returns the figures for the last complete one-second window.
+   */
+  Summary getSummary() const {
+    Summary summary;
+    summary.mean_us = mean_us.load(std::memory_order_relaxed);
+    summary.p99_us = p99_us.load(std::memory_order_relaxed);
+    summary.max_us = max_us.load(std::memory_order_relaxed);
+    summary.blocks = blocks.load(std::memory_order_relaxed);
+    return summary;
+  }
+
+  juce::var toVar() const {
+    auto summary = getSummary();
+    auto* obj = new juce::DynamicObject();
+    obj->setProperty("meanUs", summary.mean_us);
+    obj->setProperty("p99Us", summary.p99_us);
+    obj->setProperty("maxUs", summary.max_us);
+    obj->setProperty("blocks", summary.blocks);
+    return juce::var(obj);
+  }
+
+ private:
+  // Four buckets per octave of nanoseconds: p99 is accurate to ~19%.
+  static constexpr int kSubBucketBits = 2;
+  static constexpr int kNumBuckets = 64 << kSubBucketBits;
+
+  static int bucketFor(uint64_t ns) {
+    if (ns < (1u << kSubBucketBits)) return (int)ns;
+    int octave = (int)std::bit_width(ns) - 1;
+    int sub = (int)(ns >> (octave - kSubBucketBits)) &
+              ((1 << kSubBucketBits) - 1);
+    return ((octave - kSubBucketBits + 1) << kSubBucketBits) + sub;
+  }
+
+  // Upper bound (ns) of a bucket, the conservative value to report
+  static double bucketUpperNs(int bucket) {
+    if (bucket < (1 << kSubBucketBits)) return (double)bucket + 1.0;
+    int octave = (bucket >> kSubBucketBits) + kSubBucketBits - 1;
+    int sub = bucket & ((1 << kSubBucketBits) - 1);
+    double step = std::ldexp(1.0, octave - kSubBucketBits);
+    return std::ldexp(1.0, octave) + step * (sub + 1);
+  }
+
+  void publishWindow() {
+    const int p99_rank = (int)std::ceil(window_blocks * 0.99);
+    int seen = 0, p99_bucket = 0;
+    for (int i = 0; i < kNumBuckets; ++i) {
+      seen += window_histogram[i];
+      if (seen >= p99_rank) {
+        p99_bucket = i;
+        break;
+      }
+    }
+
+    mean_us.store((double)window_total_ns / window_blocks / 1000.0,
+                  std::memory_order_relaxed);
+    p99_us.store(std::min(bucketUpperNs(p99_bucket), (double)window_max_ns) /
+                     1000.0,
+                 std::memory_order_relaxed);
+    max_us.store((double)window_max_ns / 1000.0, std::memory_order_relaxed);
+    blocks.store(window_blocks, std::memory_order_relaxed);
+
+    window_blocks = 0;
+    window_samples = 0;
+    window_total_ns = 0;
+    window_max_ns = 0;
+    window_histogram.fill(0);
+  }
+
+  static inline std::atomic<bool> enabled{false};
+
+  // Current window (audio thread only)
+  int window_blocks = 0;
+  int64_t window_samples = 0;
+  uint64_t window_total_ns = 0;
+  uint64_t window_max_ns = 0;
+  std::array<int, kNumBuckets> window_histogram{};
+
+  // Last complete window (read from any thread)
+  std::atomic<double> mean_us{0.0};
+  std::atomic<double> p99_us{0.0};
+  std::atomic<double> max_us{0.0};
+  std::atomic<int> blocks{0};
+};
+
+/**
+ * Times the enclosing scope into a DspProfile when profiling is enabled.
+ */
+class ScopedDspTimer {
+ public:
+  ScopedDspTimer(DspProfile& profile, int num_samples, double sample_rate)
+      : profile(profile),
+        num_samples(num_samples),
+        sample_rate(sample_rate),
+        start_ticks(DspProfile::isEnabled()
+                        ? juce::Time::getHighResolutionTicks()
+                        : 0) {}
+
+  ~ScopedDspTimer() {
+    if (start_ticks == 0) return;
+    auto elapsed = juce::Time::getHighResolutionTicks() - start_ticks;
+    auto ns = juce::Time::highResolutionTicksToSeconds(elapsed) * 1.0e9;
+    profile.record((uint64_t)std::max(0.0, ns), num_samples, sample_rate);
+  }
+
+ private:
+  DspProfile& profile;
+  const int num_samples;
+  const double sample_rate;
+  const juce::int64 start_ticks;
+
+  JUCE_DECLARE_NON_COPYABLE(ScopedDspTimer)
+};
+
+}  // namespace celestrian
@@ -0,0 +1,56 @@
+#include "hardware_device_backend.h"
+
+namespace celestrian {
+
+HardwareDeviceBackend::HardwareDeviceBackend(int max_inputs, int num_outputs)
+    : max_inputs(max_inputs), num_outputs(num_outputs) {}
+
+HardwareDeviceBackend::~HardwareDeviceBackend() { close(); }
+
+void HardwareDeviceBackend::open(juce::AudioIODeviceCallback &callback) {
+  close();
+
+  // Ask for max_inputs, but accept whatever the hardware provides
+  device_manager.initialiseWithDefaultDevices(max_inputs, num_outputs);
+  if (auto *device = device_manager.getCurrentAudioDevice()) {
+    juce::Logger::writeToLog(
+        "HardwareDeviceBackend: Initialized with " +
+        juce::String(device->getActiveInputChannels().countNumberOfSetBits()) +
+        " input channels.");
+  } else {
+    juce::Logger::writeToLog(
+        "HardwareDeviceBackend: FAILED to get current audio device.");
+  }
+
+  active_callback = &callback;
+  device_manager.addAudioCallback(active_callback);
+}
+
+void HardwareDeviceBackend::close() {
+  if (active_callback == nullptr) return;
+  device_manager.removeAudioCallback(active_callback);
+  active_callback = nullptr;
+}
+
+DeviceConfig HardwareDeviceBackend::getConfig() const {
+  DeviceConfig config;
+  config.num_outputs = num_outputs;
+  if (auto *device = device_manager.getCurrentAudioDevice()) {
+    config.sample_rate = device->getCurrentSampleRate();
+    config.block_size = device->getCurrentBufferSizeSamples();
+    config.num_inputs = device->getActiveInputChannels().countNumberOfSetBits();
+    config.num_outputs =
+        device->getActiveOutputChannels().countNumberOfSetBits();
+    config.input_latency = device->getInputLatencyInSamples();
+    config.output_latency = device->getOutputLatencyInSamples();
+  }
+  return config;
+}
+
+juce::StringArray HardwareDeviceBackend::getInputChannelNames() const {
+  if (auto *device = device_manager.getCurrentAudioDevice())
+    return device->getInputChannelNames();
+  return {};
+}
+
+}  // namespace celestrian
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <juce_audio_devices/juce_audio_devices.h>
+
+#include "device_backend.h"
+
+namespace celestrian {
+
+/**
+ * Drives the engine from the system's default audio device.
+ */
+class HardwareDeviceBackend : public DeviceBackend {
+ public:
+  /**
+   * @param max_inputs  Input channels to ask for; the device may have fewer.
+   * @param num_outputs Output channels to open.
+   */
+  explicit HardwareDeviceBackend(int max_inputs = 8, int num_outputs = 2);
+  ~HardwareDeviceBackend() override;
+
+  void open(juce::AudioIODeviceCallback &callback) override;
+  void close() override;
+  DeviceConfig getConfig() const override;
+  juce::StringArray getInputChannelNames() const override;
+  bool isRealtime() const override { return true; }
+
+ private:
+  const int max_inputs;
+  const int num_outputs;
+  juce::AudioDeviceManager device_manager;
+  juce::AudioIODeviceCallback *active_callback = nullptr;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HardwareDeviceBackend)
+};
+
+}  // namespace celestrian
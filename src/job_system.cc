@@ -0,0 +1,222 @@
+#include "job_system.h"
+
+#include <juce_events/juce_events.h>
+
+#include <algorithm>
+
+#include "trace_recorder.h"
+
+class JobSystem::Worker : public juce::Thread {
+ public:
+  explicit Worker(JobSystem& owner)
+      : juce::Thread("Celestrian Jobs"), system(owner) {}
+
+  void run() override {
+    // Analysis jobs run DSP too
+    juce::ScopedNoDenormals no_denormals;
+    system.workerLoop(*this);
+  }
+
+ private:
+  JobSystem& system;
+};
+
+bool JobSystem::JobContext::isCancelled() const {
+  return job.isCancelled();
+}
+
+void JobSystem::JobContext::setProgress(float fraction) {
+  job.progress.store(juce::jlimit(0.0f, 1.0f, fraction));
+}
+
+JobSystem::JobSystem(int num_threads, Dispatcher dispatcher_to_use)
+    : dispatcher(std::move(dispatcher_to_use)) {
+  if (!dispatcher) {
+    dispatcher = [](std::function<void()> fn) {
+      juce::MessageManager::callAsync(std::move(fn));
+    };
+  }
+  for (int i = 0; i < std::max(1, num_threads); ++i) {
+    workers.push_back(std::make_unique<Worker>(*this));
+    workers.back()->startThread(juce::Thread::Priority::low);
+  }
+}
+
+JobSystem::~JobSystem() {
+  shared->is_alive.store(false);
+  std::vector<JobHandle> skipped;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    for (auto& queue : ready) {
+      skipped.insert(skipped.end(), queue.begin(), queue.end());
+      queue.clear();
+    }
+    skipped.insert(skipped.end(), waiting.begin(), waiting.end());
+    waiting.clear();
+  }
+  work_available.notify_all();
+
+  // Running jobs reference objects owned next to us (the engine); wait for
+  // them rather than letting them outlive their captures.
+  for (auto& worker : workers) worker->stopThread(10000);
+
+  for (auto& job : skipped) {
+    job->cancel();
+    job->state.store(Job::State::Cancelled);
+    job->dependents.clear();
+    job->done.signal();
+  }
+}
+
+JobSystem::JobHandle JobSystem::schedule(JobWork work, Completion completion,
+                                         JobOptions options) {
+  auto job = std::make_shared<Job>();
+  job->work = std::move(work);
+  job->completion = std::move(completion);
+  job->dispatcher = options.dispatcher ? std::move(options.dispatcher)
+                                       : dispatcher;
+  job->priority = options.priority;
+  job->key = options.key;
+  job->trace_name = celestrian::TraceRecorder::isEnabled()
+                        ? celestrian::TraceRecorder::intern(
+                              options.key.isEmpty() ? "job"
+                                                    : "job " + options.key)
+                        : "job";
+  num_pending.fetch_add(1);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (options.key.isNotEmpty()) {
+      auto& latest = latest_by_key[options.key];
+      if (auto older = latest.lock()) {
+        if (!older->isDone() && !older->isCancelled()) {
+          older->cancel();
+          shared->num_superseded.fetch_add(1);
+        }
+      }
+      latest = job;
+    }
+
+    for (auto& dependency : options.dependencies) {
+      if (dependency == nullptr) continue;
+      if (dependency->isDone()) {
+        if (dependency->getState() == Job::State::Cancelled) job->cancel();
+        continue;
+      }
+      dependency->dependents.push_back(job);
+      ++job->remaining_dependencies;
+    }
+
+    if (stopping) {
+      if (job->key.isNotEmpty()) latest_by_key.erase(job->key);
+      job->cancel();
+      job->state.store(Job::State::Cancelled);
+      job->done.signal();
+      num_pending.fetch_sub(1);
+      return job;
+    }
+    if (job->remaining_dependencies > 0)
+      waiting.push_back(job);
+    else
+      enqueue(job);
+  }
+  work_available.notify_one();
+  return job;
+}
+
+void JobSystem::submit(const juce::String& key, Work work,
+                       Completion completion) {
+  JobOptions options;
+  options.key = key;
+  schedule([work = std::move(work)](JobContext&) { return work(); },
+           std::move(completion), std::move(options));
+}
+
+int JobSystem::getNumKeys() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return (int)latest_by_key.size();
+}
+
+void JobSystem::enqueue(const JobHandle& job) {
+  job->state.store(Job::State::Queued);
+  ready[(size_t)job->priority].push_back(job);
+}
+
+void JobSystem::workerLoop(Worker& worker) {
+  for (;;) {
+    JobHandle job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      work_available.wait(lock, [this] {
+        return stopping || std::any_of(ready.begin(), ready.end(),
+                                       [](const auto& queue) {
+                                         return !queue.empty();
+                                       });
+      });
+      if (stopping || worker.threadShouldExit()) return;
+
+      // Highest priority first
+      for (auto queue = ready.rbegin(); queue != ready.rend(); ++queue) {
+        if (queue->empty()) continue;
+        job = std::move(queue->front());
+        queue->pop_front();
+        break;
+      }
+    }
+    run(job);
+  }
+}
+
+void JobSystem::run(const JobHandle& job) {
+  CELESTRIAN_TRACE_SCOPE("jobs", job->trace_name);
+  juce::var result;
+  // Skip the work entirely if the job was cancelled while it was queued
+  if (!job->isCancelled()) {
+    job->state.store(Job::State::Running);
+    JobContext context(*job);
+    result = job->work(context);
+  }
+  job->work = nullptr;  // Release its captures on the worker
+  finish(job, std::move(result));
+}
+
+void JobSystem::finish(const JobHandle& job, juce::var result) {
+  const bool cancelled = job->isCancelled();
+  if (cancelled)
+    result = juce::var();
+  else
+    job->progress.store(1.0f);
+
+  bool released = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job->state.store(cancelled ? Job::State::Cancelled : Job::State::Finished);
+    for (auto& dependent : job->dependents) {
+      if (cancelled) dependent->cancel();
+      if (--dependent->remaining_dependencies > 0 || stopping) continue;
+      waiting.erase(std::remove(waiting.begin(), waiting.end(), dependent),
+                    waiting.end());
+      enqueue(dependent);
+      released = true;
+    }
+    job->dependents.clear();
+
+    // A newer job with the same key still needs the entry
+    if (job->key.isNotEmpty()) {
+      auto latest = latest_by_key.find(job->key);
+      if (latest != latest_by_key.end() && latest->second.lock() == job)
+        latest_by_key.erase(latest);
+    }
+  }
+  if (released) work_available.notify_all();
+
+  if (job->completion) {
+    job->dispatcher([state = shared, completion = std::move(job->completion),
+                     result = std::move(result)] {
+      if (state->is_alive.load()) completion(result);
+    });
+  }
+  num_pending.fetch_sub(1);
+  job->done.signal();
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Runs slow, non-realtime work (large graph queries, waveform and peak
+ * building, analysis, file I/O) on a shared pool of background threads, so
+ * neither the audio thread nor the message thread waits on it.
+ *
+ * Jobs run highest priority first, and in submission order within a
+ * priority. A job may depend on others: it is queued once they all finish,
+ * and cancelled if any of them was. Running jobs can report progress and
+ * check for cancellation through their JobContext.
+ *
+ * Jobs may carry a supersession key. Submitting a job with the same key as
+ * an older one cancels the older job: if it hasn't started it is skipped,
+ * and if it is already running its result is discarded. Cancelled jobs still
+ * complete, with a void result, so the caller never waits forever.
+ */
+class JobSystem {
+ public:
+  enum class Priority { Background, Normal, Interactive };
+
+  class Job;
+  using JobHandle = std::shared_ptr<Job>;
+
+  /** What a running job sees of itself. */
+  class JobContext {
+   public:
+    /** True once the job was cancelled; long work should stop early. */
+    bool isCancelled() const;
+
+    /** Reports how far the job got, 0 to 1. */
+    void setProgress(float fraction);
+
+   private:
+    friend class JobSystem;
+    explicit JobContext(Job& running_job) : job(running_job) {}
+    Job& job;
+  };
+
+  using Work = std::function<juce::var()>;
+  using JobWork = std::function<juce::var(JobContext&)>;
+  using Completion = std::function<void(const juce::var&)>;
+  /** Delivers a finished job's completion to the thread that should run it. */
+  using Dispatcher = std::function<void(std::function<void()>)>;
+
+  struct JobOptions {
+    juce::String key;  // Supersession key; empty is never superseded
+    Priority priority = Priority::Normal;
+    std::vector<JobHandle> dependencies;
+    Dispatcher dispatcher;  // Overrides the system's for this completion
+  };
+
+  /**
+   * A submitted job. Handles are shared by the submitter and the system;
+   * dropping one doesn't cancel the job.
+   */
+  class Job {
+   public:
+    enum class State { Waiting, Queued, Running, Finished, Cancelled };
+
+    State getState() const { return state.load(); }
+    bool isDone() const {
+      auto current = state.load();
+      return current == State::Finished || current == State::Cancelled;
+    }
+    float getProgress() const { return progress.load(); }
+
+    /**
+     * Skips the job if it hasn't started, or discards its result if it has;
+     * it then completes with a void result. A waiting job is released once
+     * its dependencies finish.
+     */
+    void cancel() { cancelled.store(true); }
+    bool isCancelled() const { return cancelled.load(); }
+
+    /**
+     * Blocks until the work has finished or been skipped and its completion
+     * has been handed to the dispatcher. Don't wait on a worker thread.
+     * @return false on timeout.
+     */
+    bool wait(int timeout_ms = -1) const { return done.wait(timeout_ms); }
+
+   private:
+    friend class JobSystem;
+
+    JobWork work;
+    Completion completion;
+    Dispatcher dispatcher;
+    Priority priority = Priority::Normal;
+    juce::String key;
+    const char* trace_name = "job";
+
+    std::atomic<State> state{State::Waiting};
+    std::atomic<bool> cancelled{false};
+    std::atomic<float> progress{0.0f};
+    juce::WaitableEvent done{true};
+
+    // Guarded by the system's mutex
+    int remaining_dependencies = 0;
+    std::vector<JobHandle> dependents;
+  };
+
+  /**
+   * @param num_threads Worker threads in the pool.
+   * @param dispatcher  Where completions run. Defaults to the message thread.
+   */
+  explicit JobSystem(int num_threads = 2, Dispatcher dispatcher = {});
+
+  /**
+   * Skips every job that hasn't started and waits for the running ones.
+   * Completions that haven't run yet are dropped.
+   */
+  ~JobSystem();
+
+  /**
+   * Queues `work` (once its dependencies finish) and later calls
+   * `completion`, if any, with its result via the dispatcher.
+   */
+  JobHandle schedule(JobWork work, Completion completion,
+                     JobOptions options);
+  JobHandle schedule(JobWork work, Completion completion = {}) {
+    return schedule(std::move(work), std::move(completion), JobOptions());
+  }
+
+  /**
+   * Queues `work` on a worker thread and later calls `completion` with its
+   * result (via the dispatcher).
+   * @param key Supersession key; empty means the job is never superseded.
+   */
+  void submit(const juce::String& key, Work work, Completion completion);
+
+  /**
+   * Number of jobs that were skipped or discarded because a newer job with
+   * the same key arrived.
+   */
+  int getNumSuperseded() const { return shared->num_superseded.load(); }
+
+  /** Jobs submitted that haven't finished yet. */
+  int getNumPending() const { return num_pending.load(); }
+
+  /** Supersession keys whose latest job hasn't finished yet. */
+  int getNumKeys() const;
+
+ private:
+  class Worker;
+
+  // Outlives the JobSystem while completions are still queued on the
+  // dispatcher, so late completions can see that we are gone.
+  struct SharedState {
+    std::atomic<int> num_superseded{0};
+    std::atomic<bool> is_alive{true};
+  };
+
+  void workerLoop(Worker& worker);
+  void run(const JobHandle& job);
+  // Marks `job` done, releases its dependents and dispatches its completion
+  void finish(const JobHandle& job, juce::var result);
+  // Called with `mutex` held
+  void enqueue(const JobHandle& job);
+
+  Dispatcher dispatcher;
+  std::shared_ptr<SharedState> shared = std::make_shared<SharedState>();
+
+  mutable std::mutex mutex;
+  std::condition_variable work_available;
+  std::array<std::deque<JobHandle>, 3> ready;  // One queue per Priority
+  std::vector<JobHandle> waiting;  // Jobs with unfinished dependencies
+  // Erased once the latest job for the key is done
+  std::map<juce::String, std::weak_ptr<Job>> latest_by_key;
+  bool stopping = false;
+  std::atomic<int> num_pending{0};
+
+  std::vector<std::unique_ptr<Worker>> workers;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(JobSystem)
+};
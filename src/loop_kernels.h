@@ -0,0 +1,158 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace celestrian {
+
+/**
+ * The inner loops of clip playback, specialized at compile time for the
+ * output channel count (1, 2, or any) and for unity gain versus a gain
+ * fade. A block picks its kernels once with selectLoopKernels(), and the
+ * wrap at the loop end is resolved per run of contiguous samples, never
+ * per sample. Fades only run while an overloaded engine drops or restores
+ * a clip. When the engine runs a fixed internal block size, a run that
+ * covers the whole block uses an add whose length is a compile-time
+ * constant too.
+ *
+ * Unity-gain runs go through juce::FloatVectorOperations, so they use the
+ * SIMD instructions (SSE on x86, NEON on ARM) JUCE was built for.
+ */
+struct LoopKernels {
+  // Adds `source` to outputs [offset, offset + num_samples)
+  void (*add)(float *const *outputs, int num_outputs, int offset,
+              const float *source, int num_samples);
+
+  // Adds `source` times a gain stepped from `gain` towards `target` by
+  // `step` before each sample; returns the final gain
+  float (*fade)(float *const *outputs, int num_outputs, int offset,
+                const float *source, int num_samples, float gain,
+                float target, float step);
+
+  // add() for exactly `block_size` samples; null (and block_size 0) unless
+  // blocks have one of the fixed sizes it is specialized for
+  void (*add_block)(float *const *outputs, int num_outputs, int offset,
+                    const float *source) = nullptr;
+  int block_size = 0;
+};
+
+namespace loop_kernels {
+
+// kChannels of 0 means any count, read from num_outputs
+template <int kChannels>
+void add(float *const *outputs, int num_outputs, int offset,
+         const float *source, int num_samples) {
+  const int channels = kChannels > 0 ? kChannels : num_outputs;
+  for (int ch = 0; ch < channels; ++ch) {
+    if (outputs[ch] != nullptr)
+      juce::FloatVectorOperations::add(outputs[ch] + offset, source,
+                                       num_samples);
+  }
+}
+
+// A fixed trip count the compiler unrolls and vectorizes in full
+template <int kChannels, int kLength>
+void addBlock(float *const *outputs, int num_outputs, int offset,
+              const float *source) {
+  const int channels = kChannels > 0 ? kChannels : num_outputs;
+  for (int ch = 0; ch < channels; ++ch) {
+    float *output = outputs[ch];
+    if (output == nullptr) continue;
+    output += offset;
+    for (int i = 0; i < kLength; ++i) output[i] += source[i];
+  }
+}
+
+template <int kChannels>
+float fade(float *const *outputs, int num_outputs, int offset,
+           const float *source, int num_samples, float gain, float target,
+           float step) {
+  const int channels = kChannels > 0 ? kChannels : num_outputs;
+  for (int i = 0; i < num_samples; ++i) {
+    gain = target > gain ? std::min(target, gain + step)
+                         : std::max(target, gain - step);
+    const float sample = source[i] * gain;
+    for (int ch = 0; ch < channels; ++ch) {
+      if (outputs[ch] != nullptr) outputs[ch][offset + i] += sample;
+    }
+  }
+  return gain;
+}
+
+template <int kChannels>
+LoopKernels make(int fixed_block_size) {
+  LoopKernels kernels{&add<kChannels>, &fade<kChannels>};
+  switch (fixed_block_size) {
+    case 32:
+      kernels.add_block = &addBlock<kChannels, 32>;
+      break;
+    case 64:
+      kernels.add_block = &addBlock<kChannels, 64>;
+      break;
+    case 128:
+      kernels.add_block = &addBlock<kChannels, 128>;
+      break;
+    default:
+      return kernels;
+  }
+  kernels.block_size = fixed_block_size;
+  return kernels;
+}
+
+}  // namespace loop_kernels
+
+/**
+ * Returns the kernels for `num_outputs` output channels and, if the engine
+ * runs a fixed internal block size (ProcessContext::fixed_block_size, 0
+ * otherwise), for whole blocks of that length.
+ */
+inline LoopKernels selectLoopKernels(int num_outputs,
+                                     int fixed_block_size = 0) {
+  switch (num_outputs) {
+    case 1:
+      return loop_kernels::make<1>(fixed_block_size);
+    case 2:
+      return loop_kernels::make<2>(fixed_block_size);
+    default:
+      return loop_kernels::make<0>(fixed_block_size);
+  }
+}
+
+/**
+ * Adds `num_samples` of a loop to outputs from `offset` on, starting
+ * `position` samples into the loop [loop_start, loop_start + loop_length)
+ * of `source` (wrapping at `source_size` too). The gain fades from `gain`
+ * to `target` by `step` per sample, then stays there.
+ * @return The gain after the last sample.
+ */
+inline float mixLoop(const LoopKernels &kernels, const float *source,
+                     int source_size, float *const *outputs, int num_outputs,
+                     int offset, int num_samples, int64_t loop_start,
+                     int64_t loop_length, int64_t position, float gain,
+                     float target, float step) {
+  while (num_samples > 0) {
+    // The longest run of samples that sit next to each other in `source`
+    const int index = (int)((loop_start + position) % source_size);
+    int run = (int)std::min<int64_t>(num_samples, loop_length - position);
+    run = std::min(run, source_size - index);
+
+    // Unity gain is a plain vector add; silence adds nothing
+    const bool settled = gain == target;
+    if (settled && gain == 1.0f && run == kernels.block_size)
+      kernels.add_block(outputs, num_outputs, offset, source + index);
+    else if (settled && gain == 1.0f)
+      kernels.add(outputs, num_outputs, offset, source + index, run);
+    else if (!settled || gain != 0.0f)
+      gain = kernels.fade(outputs, num_outputs, offset, source + index, run,
+                          gain, target, step);
+
+    offset += run;
+    num_samples -= run;
+    position = (position + run) % loop_length;
+  }
+  return gain;
+}
+
+}  // namespace celestrian
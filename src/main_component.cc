@@ -6,198 +6,48 @@
 #include <cstring>
 #include <vector>
 
-MainComponent::MainComponent()
-    : web_browser(
-          juce::WebBrowserComponent::Options{}
-              .withNativeIntegrationEnabled()
-              .withResourceProvider(
-                  [this](const juce::String &path)
-                      -> std::optional<juce::WebBrowserComponent::Resource> {
-                    return getResource(path);
-                  })
-              .withNativeFunction(
-                  "ping", [](const juce::Array<juce::var> &args,
-                             juce::WebBrowserComponent::NativeFunctionCompletion
-                                 completion) { completion("pong"); })
-              .withNativeFunction(
-                  "togglePlayback",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    audio_engine.togglePlayback();
-                    completion(true);
-                  })
-              .withNativeFunction(
-                  "startRecordingInNode",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    if (args.size() > 0)
-                      audio_engine.startRecordingInNode(args[0].toString());
-                    completion(true);
-                  })
-              .withNativeFunction(
-                  "stopRecordingInNode",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    if (args.size() > 0)
-                      audio_engine.stopRecordingInNode(args[0].toString());
-                    completion(true);
-                  })
-              .withNativeFunction(
-                  "getGraphState",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    completion(audio_engine.getGraphState());
-                  })
-              .withNativeFunction(
-                  "getWaveform",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    if (args.size() >= 2) {
-                      completion(audio_engine.getWaveform(args[0].toString(),
-                                                          (int)args[1]));
-                    } else {
-                      completion(juce::Array<juce::var>());
-                    }
-                  })
-              .withNativeFunction(
-                  "enterBox",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    if (args.size() > 0)
-                      audio_engine.enterBox(args[0].toString());
-                    completion(true);
-                  })
-              .withNativeFunction(
-                  "exitBox",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    audio_engine.exitBox();
-                    completion(true);
-                  })
-              .withNativeFunction(
-                  "createNode",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    if (args.size() > 2)
-                      audio_engine.createNode(args[0].toString(),
-                                              (double)args[1], (double)args[2]);
-                    else if (args.size() > 0)
-                      audio_engine.createNode(args[0].toString());
-                    completion(true);
-                  })
-              .withNativeFunction(
-                  "renameNode",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    if (args.size() > 1)
-                      audio_engine.renameNode(args[0].toString(),
-                                              args[1].toString());
-                    completion(true);
-                  })
-              .withNativeFunction(
-                  "getInputList",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    completion(audio_engine.getInputList());
-                  })
-              .withNativeFunction(
-                  "setNodeInput",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    if (args.size() > 1) {
-                      audio_engine.setNodeInput(args[0].toString(),
-                                                (int)args[1]);
-                    }
-                    completion(true);
-                  })
-              .withNativeFunction(
-                  "setLoopPoints",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    if (args.size() > 2) {
-                      audio_engine.setLoopPoints(args[0].toString(),
-                                                 (int64_t)args[1],
-                                                 (int64_t)args[2]);
-                    }
-                    completion(true);
-                  })
-              .withNativeFunction(
-                  "togglePlay",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    if (args.size() > 0)
-                      audio_engine.togglePlay(args[0].toString());
-                    completion(true);
-                  })
-              .withNativeFunction(
-                  "toggleSolo",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    if (args.size() > 0)
-                      audio_engine.toggleSolo(args[0].toString());
-                    completion(true);
-                  })
-              .withNativeFunction(
-                  "toggleMute",
-                  [this](const juce::Array<juce::var> &args,
-                         juce::WebBrowserComponent::NativeFunctionCompletion
-                             completion) {
-                    if (args.size() > 0) {
-                      if (args[0].isString())
-                        audio_engine.toggleMute(args[0].toString());
-                      else if (auto *obj = args[0].getDynamicObject())
-                        audio_engine.toggleMute(
-                            obj->getProperty("uuid").toString());
-                    }
-                    completion(true);
-                  })
-              .withNativeFunction(
-                  "nativeLog",
-                  [](const juce::Array<juce::var> &args,
-                     juce::WebBrowserComponent::NativeFunctionCompletion
-                         completion) {
-                    if (args.size() > 0)
-                      juce::Logger::writeToLog("[JS] " + args[0].toString());
-                    completion(true);
-                  })
-              .withNativeFunction(
-                  "dumpStateToFile",
-                  [](const juce::Array<juce::var> &args,
-                     juce::WebBrowserComponent::NativeFunctionCompletion
-                         completion) {
-                    if (args.size() > 0) {
-                      auto stateFile =
-                          juce::File::getCurrentWorkingDirectory().getChildFile(
-                              "celestrian_state.json");
-                      stateFile.replaceWithText(args[0].toString());
-                      juce::Logger::writeToLog("State dumped to: " +
-                                               stateFile.getFullPathName());
-                    }
-                    completion(true);
-                  })) {
+MainComponent::MainComponent() : web_browser(createBrowserOptions()) {
   addAndMakeVisible(web_browser);
 
   web_browser.goToURL(juce::WebBrowserComponent::getResourceProviderRoot());
 
   setSize(800, 600);
+
+  // Periodic audio callback health summary
+  startTimer(kCallbackSummaryIntervalMs);
 }
 
 MainComponent::~MainComponent() {}
-void MainComponent::timerCallback() {}
+
+juce::WebBrowserComponent::Options MainComponent::createBrowserOptions() {
+  auto options =
+      juce::WebBrowserComponent::Options{}
+          .withNativeIntegrationEnabled()
+          .withResourceProvider(
+              [this](const juce::String &path)
+                  -> std::optional<juce::WebBrowserComponent::Resource> {
+                return getResource(path);
+              });
+
+  for (const auto &entry : bridge_functions.getHandlers()) {
+    const auto name = entry.first;
+    options = options.withNativeFunction(
+        name, [this, name](const juce::Array<juce::var> &args,
+                           juce::WebBrowserComponent::NativeFunctionCompletion
+                               completion) {
+          bridge_functions.invoke(name, args, std::move(completion));
+        });
+  }
+  return options;
+}
+void MainComponent::timerCallback() {
+  juce::Logger::writeToLog("AudioEngine: " +
+                           audio_engine.getCallbackSummary());
+  for (const auto &line : audio_engine.takeOverloadLog())
+    juce::Logger::writeToLog("AudioEngine: " + line);
+  for (const auto &line : audio_engine.takeRecordingLog())
+    juce::Logger::writeToLog(line);
+}
 void MainComponent::paint(juce::Graphics &g) {
   g.fillAll(
       getLookAndFeel().findColour(juce::ResizableWindow::backgroundColourId));
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "audio_engine.h"
+#include "bridge_functions.h"
+#include "hardware_device_backend.h"
 #include <juce_gui_extra/juce_gui_extra.h>
 
 class MainComponent : public juce::Component, public juce::Timer {
@@ -13,11 +15,22 @@ public:
   void timerCallback() override;
 
 private:
-  juce::WebBrowserComponent web_browser;
-  AudioEngine audio_engine;
+  static constexpr int kCallbackSummaryIntervalMs = 10000;
+
+  /**
+   * Builds the WebView options, registering every BridgeFunctions handler as
+   * a native function.
+   */
+  juce::WebBrowserComponent::Options createBrowserOptions();
 
   std::optional<juce::WebBrowserComponent::Resource>
   getResource(const juce::String &path);
 
+  // Declared before web_browser: native functions capture both.
+  AudioEngine audio_engine{
+      std::make_unique<celestrian::HardwareDeviceBackend>()};
+  BridgeFunctions bridge_functions{audio_engine};
+  juce::WebBrowserComponent web_browser;
+
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MainComponent)
 };
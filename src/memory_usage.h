@@ -0,0 +1,55 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <cstdint>
+
+namespace celestrian {
+
+/**
+ * Bytes held by a node (or a subtree), by kind of storage.
+ *
+ * Figures are what the node has allocated, not what it has filled:
+ * `audio_used_bytes` tells how much of `audio_bytes` holds recorded audio.
+ */
+struct MemoryUsage {
+  int64_t audio_bytes = 0;       // Sample storage (recording buffers)
+  int64_t audio_used_bytes = 0;  // Part of audio_bytes holding audio
+  int64_t peak_cache_bytes = 0;  // Precomputed waveform peaks
+  int64_t scratch_bytes = 0;     // Per-block mixing / processing buffers
+
+  int64_t total() const {
+    return audio_bytes + peak_cache_bytes + scratch_bytes;
+  }
+
+  MemoryUsage &operator+=(const MemoryUsage &other) {
+    audio_bytes += other.audio_bytes;
+    audio_used_bytes += other.audio_used_bytes;
+    peak_cache_bytes += other.peak_cache_bytes;
+    scratch_bytes += other.scratch_bytes;
+    return *this;
+  }
+
+  /**
+   * Returns the figures as a JSON-compatible object (bytes as doubles).
+   */
+  juce::var toVar() const {
+    auto *obj = new juce::DynamicObject();
+    obj->setProperty("audioBytes", (double)audio_bytes);
+    obj->setProperty("audioUsedBytes", (double)audio_used_bytes);
+    obj->setProperty("peakCacheBytes", (double)peak_cache_bytes);
+    obj->setProperty("scratchBytes", (double)scratch_bytes);
+    obj->setProperty("totalBytes", (double)total());
+    return juce::var(obj);
+  }
+
+  /**
+   * Bytes held by a float buffer of the given shape.
+   */
+  static int64_t bytesForSamples(int num_channels, int num_samples) {
+    return (int64_t)num_channels * (int64_t)num_samples *
+           (int64_t)sizeof(float);
+  }
+};
+
+}  // namespace celestrian
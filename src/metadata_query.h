@@ -0,0 +1,95 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <algorithm>
+#include <optional>
+
+namespace celestrian {
+
+/**
+ * Bounds how much of the graph a metadata query serializes, so the cost of
+ * `getGraphState` follows what the UI actually draws instead of the size of
+ * the whole subtree.
+ */
+struct MetadataQuery {
+  static constexpr int kUnlimitedDepth = -1;
+  static constexpr int64_t kUnknownQuantum = -1;
+
+  /**
+   * A rectangle in the queried box's coordinate space (same units as
+   * `x_pos`/`y_pos`/`width`/`height`).
+   */
+  struct VisibleArea {
+    double x = 0.0;
+    double y = 0.0;
+    double width = 0.0;
+    double height = 0.0;
+  };
+
+  // Levels of descendants serialized in full. Boxes at the limit are
+  // summarized from cached aggregates instead of recursing.
+  int max_depth = kUnlimitedDepth;
+
+  // When set, direct children outside this area are omitted. Only the first
+  // level is filtered because each box has its own coordinate space.
+  std::optional<VisibleArea> visible_area;
+
+  // The effective quantum of the box whose children are being serialized,
+  // worked out once by that box so each child needn't walk back up for it.
+  // kUnknownQuantum at the top of a query.
+  int64_t parent_quantum = kUnknownQuantum;
+
+  /**
+   * Returns true when a box at this level must be summarized, not expanded.
+   */
+  bool isDepthExhausted() const { return max_depth == 0; }
+
+  /**
+   * Returns the query to apply one level further down the tree.
+   */
+  MetadataQuery forChildren() const {
+    MetadataQuery child_query;
+    child_query.max_depth =
+        max_depth == kUnlimitedDepth ? kUnlimitedDepth : max_depth - 1;
+    return child_query;
+  }
+
+  /**
+   * Returns true if a node with the given bounds overlaps the visible area.
+   * Pass an infinite width for content that repeats across the timeline.
+   */
+  bool isVisible(double x, double y, double width, double height) const {
+    if (!visible_area.has_value()) return true;
+    const auto &area = *visible_area;
+    bool overlaps_x = x < area.x + area.width && x + width > area.x;
+    bool overlaps_y = y < area.y + area.height && y + height > area.y;
+    return overlaps_x && overlaps_y;
+  }
+
+  /**
+   * Parses bridge options of the form
+   * `{ depth: 1, visibleRect: { x, y, w, h } }`. Missing fields keep their
+   * unbounded defaults.
+   */
+  static MetadataQuery fromVar(const juce::var &options) {
+    MetadataQuery query;
+    auto *obj = options.getDynamicObject();
+    if (obj == nullptr) return query;
+
+    if (obj->hasProperty("depth"))
+      query.max_depth = std::max(0, (int)obj->getProperty("depth"));
+
+    if (auto *rect = obj->getProperty("visibleRect").getDynamicObject()) {
+      VisibleArea area;
+      area.x = (double)rect->getProperty("x");
+      area.y = (double)rect->getProperty("y");
+      area.width = (double)rect->getProperty("w");
+      area.height = (double)rect->getProperty("h");
+      query.visible_area = area;
+    }
+    return query;
+  }
+};
+
+}  // namespace celestrian
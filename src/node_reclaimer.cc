@@ -0,0 +1,82 @@
+#include "node_reclaimer.h"
+
+#include <algorithm>
+
+#include "audio_node.h"
+
+namespace celestrian {
+
+class NodeReclaimer::CollectorThread : public juce::Thread {
+ public:
+  explicit CollectorThread(NodeReclaimer &owner)
+      : juce::Thread("Celestrian Node Reclaimer"), reclaimer(owner) {}
+
+  void run() override {
+    while (!threadShouldExit()) {
+      reclaimer.collect();
+      wait(kCollectIntervalMs);
+    }
+  }
+
+ private:
+  NodeReclaimer &reclaimer;
+};
+
+NodeReclaimer::NodeReclaimer() {
+  collector_thread = std::make_unique<CollectorThread>(*this);
+  collector_thread->startThread(juce::Thread::Priority::low);
+}
+
+NodeReclaimer::~NodeReclaimer() {
+  collector_thread->stopThread(1000);
+  endBlock();
+  endRenderAhead();
+  collect();
+}
+
+void NodeReclaimer::retire(std::unique_ptr<AudioNode> node) {
+  if (node == nullptr) return;
+
+  // Blocks that start from here on can't reach the node
+  const uint64_t epoch = global_epoch.fetch_add(1) + 1;
+  std::lock_guard<std::mutex> lock(retired_mutex);
+  retired.push_back({std::move(node), nullptr, epoch});
+  num_pending.fetch_add(1);
+}
+
+void NodeReclaimer::retireObject(std::shared_ptr<const void> object) {
+  if (object == nullptr) return;
+
+  const uint64_t epoch = global_epoch.fetch_add(1) + 1;
+  std::lock_guard<std::mutex> lock(retired_mutex);
+  retired.push_back({nullptr, std::move(object), epoch});
+}
+
+int NodeReclaimer::collect() {
+  std::vector<RetiredNode> to_free;
+  int num_freed = 0;
+  {
+    std::lock_guard<std::mutex> lock(retired_mutex);
+    // Read after every listed node's epoch was taken: a block that was
+    // already running then shows up here with an older epoch
+    const uint64_t active =
+        std::min(active_epoch.load(), render_ahead_epoch.load());
+    auto it = retired.begin();
+    while (it != retired.end()) {
+      if (active >= it->epoch) {
+        if (it->node != nullptr) ++num_freed;
+        to_free.push_back(std::move(*it));
+        it = retired.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    num_pending.fetch_sub(num_freed);
+  }
+
+  // Outside the lock: freeing minutes of audio takes a while
+  to_free.clear();
+  return num_freed;
+}
+
+}  // namespace celestrian
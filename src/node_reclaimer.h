@@ -0,0 +1,97 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace celestrian {
+
+class AudioNode;
+
+/**
+ * Frees nodes removed from the graph on a background thread, once the audio
+ * thread can no longer be using them, so removing a node (and its audio)
+ * never costs the audio thread or the lock it takes anything.
+ *
+ * Epoch based: retiring a node advances a global epoch, and the audio
+ * thread records the epoch each block starts in. A node retired at epoch E
+ * is freed once the audio thread is between blocks, or inside a block that
+ * started at E or later (and so never saw it). The render-ahead worker
+ * holds an epoch for each round in the same way.
+ *
+ * Only nodes no longer reachable from the graph may be retired, and nothing
+ * the audio thread keeps across blocks (solo, scheduled events, queued
+ * commands) may still point at them.
+ */
+class NodeReclaimer {
+ public:
+  static constexpr int kCollectIntervalMs = 20;
+
+  NodeReclaimer();
+
+  /**
+   * Frees everything still pending. The audio thread and the render-ahead
+   * worker must have stopped reading the graph.
+   */
+  ~NodeReclaimer();
+
+  /** Hands over an unlinked node. Any thread but the audio thread. */
+  void retire(std::unique_ptr<AudioNode> node);
+
+  /**
+   * Hands over anything else a block may still be reading, such as a box's
+   * replaced child list, to be freed on the same terms as a node.
+   */
+  void retireObject(std::shared_ptr<const void> object);
+
+  /** Brackets each block on the audio thread. Wait-free. */
+  void beginBlock() { active_epoch.store(global_epoch.load()); }
+  void endBlock() { active_epoch.store(kIdle); }
+
+  /**
+   * Brackets each round of the render-ahead worker, which reads the graph
+   * as the audio thread does; nodes it may see wait for it the same way.
+   */
+  void beginRenderAhead() { render_ahead_epoch.store(global_epoch.load()); }
+  void endRenderAhead() { render_ahead_epoch.store(kIdle); }
+
+  /**
+   * Frees every retired node the audio thread has moved past. Runs on the
+   * collector thread; callable directly, e.g. from tests.
+   * @return The number of nodes freed.
+   */
+  int collect();
+
+  /** Nodes waiting to be freed. Safe from any thread. */
+  int getNumPending() const { return num_pending.load(); }
+
+ private:
+  class CollectorThread;
+
+  static constexpr uint64_t kIdle = std::numeric_limits<uint64_t>::max();
+
+  struct RetiredNode {
+    std::unique_ptr<AudioNode> node;
+    std::shared_ptr<const void> object;  // Instead of a node
+    uint64_t epoch = 0;
+  };
+
+  std::atomic<uint64_t> global_epoch{1};
+  std::atomic<uint64_t> active_epoch{kIdle};
+  std::atomic<uint64_t> render_ahead_epoch{kIdle};
+
+  std::mutex retired_mutex;
+  std::vector<RetiredNode> retired;
+  std::atomic<int> num_pending{0};
+
+  std::unique_ptr<CollectorThread> collector_thread;
+
+  JUCE_DECLARE_NON_COPYABLE(NodeReclaimer)
+};
+
+}  // namespace celestrian
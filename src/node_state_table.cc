@@ -0,0 +1,121 @@
+#include "node_state_table.h"
+
+#include <algorithm>
+
+namespace celestrian {
+
+NodeStateTable &NodeStateTable::getInstance() {
+  static NodeStateTable instance;
+  return instance;
+}
+
+NodeHandle NodeStateTable::acquire(const void *group) {
+  std::lock_guard<std::mutex> lock(mutex);
+  const NodeHandle handle = takeRow(group);
+  if (handle == kNoRow) return kNoRow;
+  reset(handle);
+  num_live.fetch_add(1);
+  return handle;
+}
+
+NodeHandle NodeStateTable::regroup(NodeHandle handle, const void *group) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (runs[handle / kRowsPerRun].group == group) return handle;
+  const NodeHandle moved = takeRow(group);
+  if (moved == kNoRow) return handle;
+  copyRow(handle, moved);
+  freeRow(handle);
+  return moved;
+}
+
+void NodeStateTable::release(NodeHandle handle) {
+  std::lock_guard<std::mutex> lock(mutex);
+  freeRow(handle);
+  num_live.fetch_sub(1);
+}
+
+bool NodeStateTable::addChunk() {
+  const int index = num_chunks.load();
+  if (index >= kMaxChunks) return false;
+  auto chunk = std::make_unique<Chunk>();
+  chunks[(size_t)index].store(chunk.get(), std::memory_order_release);
+  owned_chunks.push_back(std::move(chunk));
+  num_chunks.store(index + 1);
+
+  // Room for every run, so freeRow() never reallocates. Low runs go out
+  // first, so groups created together sit together.
+  constexpr int kRunsPerChunk = kRowsPerChunk / kRowsPerRun;
+  runs.resize((size_t)(index + 1) * kRunsPerChunk);
+  free_runs.reserve(runs.size());
+  for (int run = kRunsPerChunk - 1; run >= 0; --run)
+    free_runs.push_back((uint32_t)(index * kRunsPerChunk + run));
+  return true;
+}
+
+NodeHandle NodeStateTable::takeRow(const void *group) {
+  auto &owned_runs = group_runs[group];
+  auto it = std::find_if(owned_runs.begin(), owned_runs.end(),
+                         [this](uint32_t run) {
+                           return runs[run].used_rows != kFullRun;
+                         });
+  uint32_t index;
+  if (it != owned_runs.end()) {
+    index = *it;
+  } else {
+    if (free_runs.empty() && !addChunk()) {
+      if (owned_runs.empty()) group_runs.erase(group);
+      return kNoRow;
+    }
+    index = free_runs.back();
+    free_runs.pop_back();
+    runs[index].group = group;
+    owned_runs.push_back(index);
+  }
+
+  // Lowest free row, so a run fills from the front
+  Run &run = runs[index];
+  int row = 0;
+  while ((run.used_rows >> row) & 1) ++row;
+  run.used_rows = (uint8_t)(run.used_rows | (1 << row));
+  return (NodeHandle)(index * kRowsPerRun + row);
+}
+
+void NodeStateTable::freeRow(NodeHandle handle) {
+  const uint32_t index = handle / kRowsPerRun;
+  Run &run = runs[index];
+  run.used_rows = (uint8_t)(run.used_rows & ~(1 << (handle % kRowsPerRun)));
+  if (run.used_rows != 0) return;
+
+  // Empty: hand the whole run back so any group can take it
+  auto owner = group_runs.find(run.group);
+  jassert(owner != group_runs.end());
+  auto &owned_runs = owner->second;
+  owned_runs.erase(std::find(owned_runs.begin(), owned_runs.end(), index));
+  if (owned_runs.empty()) group_runs.erase(owner);
+  run.group = nullptr;
+  free_runs.push_back(index);
+}
+
+void NodeStateTable::reset(NodeHandle handle) {
+  getPlayheadPos(handle).store(0.0);
+  getDuration(handle).store(0);
+  getLoopStart(handle).store(0);
+  getLoopEnd(handle).store(0);
+  getLaunchPoint(handle).store(0);
+  getLastBlockPeak(handle).store(0.0f);
+  getRecordingFlag(handle).store(false);
+  getMutedFlag(handle).store(false);
+}
+
+void NodeStateTable::copyRow(NodeHandle from, NodeHandle to) {
+  getPlayheadPos(to).store(getPlayheadPos(from).load());
+  getDuration(to).store(getDuration(from).load());
+  getLoopStart(to).store(getLoopStart(from).load());
+  getLoopEnd(to).store(getLoopEnd(from).load());
+  getLaunchPoint(to).store(getLaunchPoint(from).load());
+  getLastBlockPeak(to).store(getLastBlockPeak(from).load());
+  getRecordingFlag(to).store(getRecordingFlag(from).load());
+  getMutedFlag(to).store(getMutedFlag(from).load());
+}
+
+}  // namespace celestrian
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace celestrian {
+
+// Index of a node's row in the NodeStateTable
+using NodeHandle = uint32_t;
+
+/**
+ * The transport and loop state the audio thread reads for every node every
+ * block, kept out of the node objects in structure-of-arrays form: one
+ * contiguous, cache-line-aligned column per field, so sibling nodes share
+ * cache lines instead of each pulling in its own heap object.
+ *
+ * Rows are handed out in runs of kRowsPerRun, one cache line of the widest
+ * column. Each run belongs to one group (a parent box): its rows go only to
+ * that group's nodes, so siblings stay together however much the graph
+ * churns. A run is reused by another group only once every row in it is
+ * free; until then a parent that lost children may span more runs than it
+ * needs, but never shares one with another parent's children.
+ *
+ * Rows live in fixed-size chunks that never move once allocated, so a row
+ * stays valid until it is released. acquire(), regroup() and release() lock
+ * and allocate and must not run on the audio thread; the columns themselves
+ * are atomics any thread may read and write.
+ *
+ * The chunk index holds kMaxChunks. Once every chunk is full, acquire()
+ * returns kNoRow and the node keeps its fields in a LooseRow of its own.
+ */
+class NodeStateTable {
+ public:
+  static constexpr int kCacheLineBytes = 64;
+  static constexpr int kRowsPerChunk = 1024;
+  static constexpr int kMaxChunks = 4096;
+  static constexpr int kRowsPerRun = kCacheLineBytes / (int)sizeof(double);
+
+  // Returned by acquire() when every chunk is full
+  static constexpr NodeHandle kNoRow = std::numeric_limits<NodeHandle>::max();
+
+  /** One node's fields, for a node the table had no row for. */
+  struct LooseRow {
+    std::atomic<double> playhead_pos{0.0};
+    std::atomic<int64_t> duration_samples{0};
+    std::atomic<int64_t> loop_start_samples{0};
+    std::atomic<int64_t> loop_end_samples{0};
+    std::atomic<int64_t> launch_point_samples{0};
+    std::atomic<float> last_block_peak{0.0f};
+    std::atomic<bool> is_node_recording{false};
+    std::atomic<bool> is_muted{false};
+  };
+
+  static NodeStateTable &getInstance();
+
+  /**
+   * Returns a free row in one of `group`'s runs, reset to the defaults, or
+   * kNoRow if the table is full. Nodes not yet in a box use the null group.
+   * Allocates a chunk when every run is taken; never call from the audio
+   * thread.
+   */
+  NodeHandle acquire(const void *group = nullptr);
+
+  /**
+   * Moves a row's values into a row of `group` and releases the old one,
+   * returning the new handle (or `handle` if it is already in the group or
+   * the table is full). Only for rows no other thread is using.
+   */
+  NodeHandle regroup(NodeHandle handle, const void *group);
+
+  /** Returns a row for reuse. Its references must no longer be used. */
+  void release(NodeHandle handle);
+
+  std::atomic<double> &getPlayheadPos(NodeHandle handle) {
+    return getChunk(handle).playhead_pos[getRow(handle)];
+  }
+  std::atomic<int64_t> &getDuration(NodeHandle handle) {
+    return getChunk(handle).duration_samples[getRow(handle)];
+  }
+  std::atomic<int64_t> &getLoopStart(NodeHandle handle) {
+    return getChunk(handle).loop_start_samples[getRow(handle)];
+  }
+  std::atomic<int64_t> &getLoopEnd(NodeHandle handle) {
+    return getChunk(handle).loop_end_samples[getRow(handle)];
+  }
+  std::atomic<int64_t> &getLaunchPoint(NodeHandle handle) {
+    return getChunk(handle).launch_point_samples[getRow(handle)];
+  }
+  std::atomic<float> &getLastBlockPeak(NodeHandle handle) {
+    return getChunk(handle).last_block_peak[getRow(handle)];
+  }
+  std::atomic<bool> &getRecordingFlag(NodeHandle handle) {
+    return getChunk(handle).is_node_recording[getRow(handle)];
+  }
+  std::atomic<bool> &getMutedFlag(NodeHandle handle) {
+    return getChunk(handle).is_muted[getRow(handle)];
+  }
+
+  /** Rows in use. */
+  int getNumLive() const { return num_live.load(); }
+
+  /** Memory held by the allocated chunks. */
+  int64_t getBytes() const {
+    return (int64_t)num_chunks.load() * (int64_t)sizeof(Chunk);
+  }
+
+ private:
+  NodeStateTable() = default;
+
+  // One column per field, each starting on its own cache line
+  struct alignas(kCacheLineBytes) Chunk {
+    template <typename T>
+    using Column = std::array<std::atomic<T>, kRowsPerChunk>;
+
+    alignas(kCacheLineBytes) Column<double> playhead_pos;
+    alignas(kCacheLineBytes) Column<int64_t> duration_samples;
+    alignas(kCacheLineBytes) Column<int64_t> loop_start_samples;
+    alignas(kCacheLineBytes) Column<int64_t> loop_end_samples;
+    alignas(kCacheLineBytes) Column<int64_t> launch_point_samples;
+    alignas(kCacheLineBytes) Column<float> last_block_peak;
+    alignas(kCacheLineBytes) Column<bool> is_node_recording;
+    alignas(kCacheLineBytes) Column<bool> is_muted;
+  };
+
+  static int getRow(NodeHandle handle) {
+    return (int)(handle % kRowsPerChunk);
+  }
+  Chunk &getChunk(NodeHandle handle) {
+    return *chunks[handle / kRowsPerChunk].load(std::memory_order_acquire);
+  }
+
+  // Which group a run belongs to and which of its rows are taken
+  struct Run {
+    const void *group = nullptr;
+    uint8_t used_rows = 0;
+  };
+  static constexpr uint8_t kFullRun = (uint8_t)((1 << kRowsPerRun) - 1);
+  static_assert(kRowsPerRun <= 8, "Run::used_rows holds one bit per row");
+  static_assert(kRowsPerChunk % kRowsPerRun == 0, "Runs never span chunks");
+
+  // All called with the mutex held. addChunk() and takeRow() fail once
+  // kMaxChunks are allocated.
+  bool addChunk();
+  NodeHandle takeRow(const void *group);
+  void freeRow(NodeHandle handle);
+  void reset(NodeHandle handle);
+  void copyRow(NodeHandle from, NodeHandle to);
+
+  // Published once each and never freed before the table
+  std::array<std::atomic<Chunk *>, kMaxChunks> chunks{};
+  std::atomic<int> num_chunks{0};
+  std::atomic<int> num_live{0};
+
+  std::mutex mutex;
+  std::vector<std::unique_ptr<Chunk>> owned_chunks;
+  std::vector<Run> runs;           // Indexed by handle / kRowsPerRun
+  std::vector<uint32_t> free_runs;  // Runs with no row taken
+  // Runs with at least one row taken, per group
+  std::unordered_map<const void *, std::vector<uint32_t>> group_runs;
+
+  JUCE_DECLARE_NON_COPYABLE(NodeStateTable)
+};
+
+}  // namespace celestrian
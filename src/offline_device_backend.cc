@@ -0,0 +1,109 @@
+#include "offline_device_backend.h"
+
+#include <cmath>
+
+namespace celestrian {
+
+OfflineDeviceBackend::OfflineDeviceBackend(DeviceConfig config)
+    : config(config) {
+  input_buffer.setSize(std::max(1, config.num_inputs), config.block_size);
+  output_buffer.setSize(std::max(1, config.num_outputs), config.block_size);
+}
+
+void OfflineDeviceBackend::open(juce::AudioIODeviceCallback &callback) {
+  // There is no juce::AudioIODevice to hand to audioDeviceAboutToStart():
+  // callbacks read the device shape from getConfig() instead.
+  close();
+  callback.audioDeviceAboutToStart(nullptr);
+  active_callback = &callback;
+}
+
+void OfflineDeviceBackend::close() {
+  if (active_callback == nullptr) return;
+  active_callback->audioDeviceStopped();
+  active_callback = nullptr;
+}
+
+juce::StringArray OfflineDeviceBackend::getInputChannelNames() const {
+  juce::StringArray names;
+  for (int ch = 0; ch < config.num_inputs; ++ch)
+    names.add("Offline Input " + juce::String(ch + 1));
+  return names;
+}
+
+void OfflineDeviceBackend::setInputSignal(Signal signal) {
+  input_signal = signal ? std::move(signal) : silence();
+}
+
+int OfflineDeviceBackend::renderBlocks(int num_blocks,
+                                       const OutputSink &sink) {
+  if (active_callback == nullptr) return 0;
+
+  for (int block = 0; block < num_blocks; ++block)
+    renderBlock(config.block_size, sink);
+  return num_blocks;
+}
+
+bool OfflineDeviceBackend::renderBlock(int num_samples,
+                                       const OutputSink &sink) {
+  if (active_callback == nullptr || num_samples <= 0 ||
+      num_samples > config.block_size)
+    return false;
+
+  for (int ch = 0; ch < config.num_inputs; ++ch) {
+    auto *in = input_buffer.getWritePointer(ch);
+    for (int i = 0; i < num_samples; ++i)
+      in[i] = input_signal(ch, samples_rendered + i);
+  }
+
+  auto host_time_ns = (uint64_t)std::llround((double)samples_rendered *
+                                             1.0e9 / config.sample_rate);
+  juce::AudioIODeviceCallbackContext context;
+  context.hostTimeNs = &host_time_ns;
+
+  active_callback->audioDeviceIOCallbackWithContext(
+      input_buffer.getArrayOfReadPointers(), config.num_inputs,
+      output_buffer.getArrayOfWritePointers(), config.num_outputs, num_samples,
+      context);
+
+  if (sink)
+    sink(output_buffer.getArrayOfReadPointers(), config.num_outputs,
+         num_samples);
+  samples_rendered += num_samples;
+  return true;
+}
+
+int64_t OfflineDeviceBackend::renderSamples(int64_t num_samples,
+                                            const OutputSink &sink) {
+  if (config.block_size <= 0) return 0;
+  auto num_blocks =
+      (int)((num_samples + config.block_size - 1) / config.block_size);
+  return (int64_t)renderBlocks(num_blocks, sink) * config.block_size;
+}
+
+OfflineDeviceBackend::Signal OfflineDeviceBackend::silence() {
+  return [](int, int64_t) { return 0.0f; };
+}
+
+OfflineDeviceBackend::Signal OfflineDeviceBackend::constant(float value) {
+  return [value](int, int64_t) { return value; };
+}
+
+OfflineDeviceBackend::Signal OfflineDeviceBackend::sine(double frequency_hz,
+                                                        float amplitude,
+                                                        double sample_rate) {
+  const double step = juce::MathConstants<double>::twoPi * frequency_hz /
+                      sample_rate;
+  return [amplitude, step](int, int64_t index) {
+    return amplitude * (float)std::sin(step * (double)index);
+  };
+}
+
+OfflineDeviceBackend::Signal OfflineDeviceBackend::impulses(int64_t period,
+                                                            float amplitude) {
+  return [period, amplitude](int, int64_t index) {
+    return period > 0 && index % period == 0 ? amplitude : 0.0f;
+  };
+}
+
+}  // namespace celestrian
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <juce_audio_devices/juce_audio_devices.h>
+
+#include <functional>
+
+#include "device_backend.h"
+
+namespace celestrian {
+
+/**
+ * A device with no hardware behind it. Blocks are rendered only when asked,
+ * on the calling thread and as fast as the engine can go, with input taken
+ * from a scripted signal. Runs are deterministic: the same signal and the
+ * same calls produce the same output.
+ *
+ * Host time is simulated from the samples rendered, so transport anchors
+ * behave as if the device ran in real time.
+ */
+class OfflineDeviceBackend : public DeviceBackend {
+ public:
+  /** Returns the input sample for `channel` at absolute sample `index`. */
+  using Signal = std::function<float(int channel, int64_t index)>;
+
+  /** Receives each rendered block, e.g. to write it to a file. */
+  using OutputSink = std::function<void(const float *const *channels,
+                                        int num_channels, int num_samples)>;
+
+  explicit OfflineDeviceBackend(DeviceConfig config = {});
+
+  void open(juce::AudioIODeviceCallback &callback) override;
+  void close() override;
+  DeviceConfig getConfig() const override { return config; }
+  juce::StringArray getInputChannelNames() const override;
+  bool isRealtime() const override { return false; }
+
+  /**
+   * Sets the input for subsequent blocks. The default is silence.
+   */
+  void setInputSignal(Signal signal);
+
+  /**
+   * Renders `num_blocks` blocks of `config.block_size` samples.
+   * @return The number of blocks rendered (0 if the backend isn't open).
+   */
+  int renderBlocks(int num_blocks, const OutputSink &sink = {});
+
+  /**
+   * Renders one block of `num_samples`, at most `config.block_size`, e.g. to
+   * follow a device that delivered uneven blocks.
+   * @return false if the backend isn't open or the size is out of range.
+   */
+  bool renderBlock(int num_samples, const OutputSink &sink = {});
+
+  /**
+   * Renders whole blocks until at least `num_samples` samples are done.
+   * @return The number of samples rendered.
+   */
+  int64_t renderSamples(int64_t num_samples, const OutputSink &sink = {});
+
+  /** Samples rendered since construction. */
+  int64_t getSamplesRendered() const { return samples_rendered; }
+
+  /** The output of the last rendered block. */
+  const juce::AudioBuffer<float> &getLastOutput() const {
+    return output_buffer;
+  }
+
+  // Scripted input signals
+  static Signal silence();
+  static Signal constant(float value);
+  static Signal sine(double frequency_hz, float amplitude, double sample_rate);
+  /** `amplitude` every `period` samples, zero elsewhere. */
+  static Signal impulses(int64_t period, float amplitude = 1.0f);
+
+ private:
+  const DeviceConfig config;
+  Signal input_signal = silence();
+  juce::AudioBuffer<float> input_buffer;
+  juce::AudioBuffer<float> output_buffer;
+  juce::AudioIODeviceCallback *active_callback = nullptr;
+  int64_t samples_rendered = 0;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OfflineDeviceBackend)
+};
+
+}  // namespace celestrian
@@ -0,0 +1,142 @@
+#include "overload_governor.h"
+
+#include <algorithm>
+
+#include "callback_monitor.h"
+
+namespace celestrian {
+
+ShedLevel OverloadGovernor::update(double load, int64_t master_pos,
+                                   bool can_shed) {
+  if (!can_shed) {
+    smoothed_load.store(0.0, std::memory_order_relaxed);
+    blocks_over = blocks_under = hold_blocks = 0;
+    if (level.load(std::memory_order_relaxed) != ShedLevel::None)
+      setLevel(ShedLevel::None, master_pos);
+    return ShedLevel::None;
+  }
+
+  const double smoothed =
+      smoothed_load.load(std::memory_order_relaxed) +
+      kLoadSmoothing * (load - smoothed_load.load(std::memory_order_relaxed));
+  smoothed_load.store(smoothed, std::memory_order_relaxed);
+
+  const double threshold = shed_load.load(std::memory_order_relaxed);
+  const bool overrun = load >= CallbackMonitor::kOverrunLoad;
+  if (smoothed >= threshold || overrun) {
+    ++blocks_over;
+    blocks_under = 0;
+  } else if (smoothed < threshold * kRecoverFraction) {
+    ++blocks_under;
+    blocks_over = 0;
+  } else {
+    blocks_over = blocks_under = 0;
+  }
+  if (hold_blocks > 0) --hold_blocks;
+
+  // Give each step a few blocks to take effect before the next one
+  const auto current = level.load(std::memory_order_relaxed);
+  if ((blocks_over >= kBlocksToEscalate || overrun) && hold_blocks == 0 &&
+      current != ShedLevel::DropNormalPriority) {
+    setLevel((ShedLevel)((int)current + 1), master_pos);
+    blocks_over = 0;
+    hold_blocks = kBlocksToEscalate;
+  } else if (blocks_under >= kBlocksToRecover && current != ShedLevel::None) {
+    setLevel((ShedLevel)((int)current - 1), master_pos);
+    blocks_under = 0;
+  }
+  return level.load(std::memory_order_relaxed);
+}
+
+void OverloadGovernor::setShedLoad(double load) {
+  shed_load.store(juce::jlimit(0.1, 1.0, load));
+}
+
+void OverloadGovernor::setLevel(ShedLevel new_level, int64_t master_pos) {
+  auto index = action_write_count.load(std::memory_order_relaxed);
+  auto &slot = action_history[index % kActionHistorySize];
+  auto seq = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.from.store(level.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+  slot.to.store(new_level, std::memory_order_relaxed);
+  slot.load.store(smoothed_load.load(std::memory_order_relaxed),
+                  std::memory_order_relaxed);
+  slot.master_pos.store(master_pos, std::memory_order_relaxed);
+  slot.sequence.store(seq + 2, std::memory_order_release);
+  action_write_count.store(index + 1, std::memory_order_release);
+
+  level.store(new_level);
+}
+
+juce::Array<OverloadGovernor::Action> OverloadGovernor::getActionsSince(
+    int64_t first_index) const {
+  juce::Array<Action> actions;
+  auto written = action_write_count.load(std::memory_order_acquire);
+  auto first = std::max<int64_t>(
+      {0, first_index, written - (int64_t)kActionHistorySize});
+
+  for (auto i = first; i < written; ++i) {
+    const auto &slot = action_history[i % kActionHistorySize];
+    auto before = slot.sequence.load(std::memory_order_acquire);
+    Action action;
+    action.index = i;
+    action.from = slot.from.load(std::memory_order_relaxed);
+    action.to = slot.to.load(std::memory_order_relaxed);
+    action.load = slot.load.load(std::memory_order_relaxed);
+    action.master_pos = slot.master_pos.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Skip a slot the audio thread is rewriting right now
+    if ((before & 1u) == 0 &&
+        before == slot.sequence.load(std::memory_order_relaxed))
+      actions.add(action);
+  }
+  return actions;
+}
+
+juce::var OverloadGovernor::toVar() const {
+  juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+  obj->setProperty("level", getLevelName(getLevel()));
+  obj->setProperty("smoothedLoad", getSmoothedLoad());
+  obj->setProperty("shedLoad", getShedLoad());
+  obj->setProperty("actions", (double)getNumActions());
+
+  juce::Array<juce::var> recent;
+  for (const auto &action : getActionsSince(0)) {
+    juce::DynamicObject::Ptr entry = new juce::DynamicObject();
+    entry->setProperty("from", getLevelName(action.from));
+    entry->setProperty("to", getLevelName(action.to));
+    entry->setProperty("load", action.load);
+    entry->setProperty("masterPos", (double)action.master_pos);
+    recent.add(juce::var(entry.get()));
+  }
+  obj->setProperty("recentActions", recent);
+  return juce::var(obj.get());
+}
+
+juce::String OverloadGovernor::getLevelName(ShedLevel shed_level) {
+  switch (shed_level) {
+    case ShedLevel::None:
+      return "none";
+    case ShedLevel::SkipMeters:
+      return "skipMeters";
+    case ShedLevel::SkipSilenced:
+      return "skipSilenced";
+    case ShedLevel::DropLowPriority:
+      return "dropLowPriority";
+    case ShedLevel::DropNormalPriority:
+      return "dropNormalPriority";
+  }
+  return "unknown";
+}
+
+juce::String OverloadGovernor::describe(const Action &action) {
+  const bool escalated = (int)action.to > (int)action.from;
+  return juce::String("Overload: ") + (escalated ? "shedding " : "restoring ") +
+         getLevelName(action.from) + " -> " + getLevelName(action.to) +
+         " at load " + juce::String(action.load * 100.0, 1) +
+         "%, master_pos " + juce::String(action.master_pos);
+}
+
+}  // namespace celestrian
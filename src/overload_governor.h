@@ -0,0 +1,109 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "audio_node.h"
+
+namespace celestrian {
+
+/**
+ * Picks how much work the graph sheds (ShedLevel) from the measured load of
+ * each audio callback, so a CPU spike degrades the mix instead of dropping
+ * out.
+ *
+ * Deterministic: the load is smoothed, and the level climbs one step after
+ * a run of blocks above the shed threshold (or at once on an overrun),
+ * then holds for a few blocks before it may climb again. It falls one step
+ * after a long run below the recover threshold.
+ *
+ * The audio thread is the only writer. Every change is recorded, with the
+ * load and transport position that caused it, in a ring that other threads
+ * read without blocking it.
+ */
+class OverloadGovernor {
+ public:
+  static constexpr double kDefaultShedLoad = 0.85;
+  // Fraction of the shed threshold below which the load counts as recovered
+  static constexpr double kRecoverFraction = 0.7;
+  // Weight of the newest block in the smoothed load
+  static constexpr double kLoadSmoothing = 0.25;
+  static constexpr int kBlocksToEscalate = 4;
+  static constexpr int kBlocksToRecover = 400;
+
+  static constexpr int kActionHistorySize = 32;
+
+  struct Action {
+    int64_t index = 0;  // Counts every action since the engine started
+    ShedLevel from = ShedLevel::None;
+    ShedLevel to = ShedLevel::None;
+    double load = 0.0;  // Smoothed load that triggered it
+    int64_t master_pos = 0;
+  };
+
+  /**
+   * Feeds one block's load (elapsed / deadline) and returns the level for
+   * the next block. Pass `can_shed` false where the output must not depend
+   * on timing (offline rendering, captures): the level then returns to
+   * None. Audio thread only.
+   */
+  ShedLevel update(double load, int64_t master_pos, bool can_shed);
+
+  ShedLevel getLevel() const { return level.load(); }
+  double getSmoothedLoad() const { return smoothed_load.load(); }
+
+  /**
+   * Load at which shedding starts; clamped to [0.1, 1]. Any thread.
+   */
+  void setShedLoad(double load);
+  double getShedLoad() const { return shed_load.load(); }
+
+  /**
+   * Returns the recorded actions with an index of at least `first_index`,
+   * oldest first (at most kActionHistorySize). Any thread.
+   */
+  juce::Array<Action> getActionsSince(int64_t first_index) const;
+
+  int64_t getNumActions() const { return action_write_count.load(); }
+
+  /**
+   * Returns the level, loads and recent actions for the bridge.
+   */
+  juce::var toVar() const;
+
+  static juce::String getLevelName(ShedLevel shed_level);
+
+  /**
+   * One log line describing `action`.
+   */
+  static juce::String describe(const Action &action);
+
+ private:
+  // Per-slot sequence lock, as in CallbackMonitor
+  struct ActionSlot {
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<ShedLevel> from{ShedLevel::None};
+    std::atomic<ShedLevel> to{ShedLevel::None};
+    std::atomic<double> load{0.0};
+    std::atomic<int64_t> master_pos{0};
+  };
+
+  void setLevel(ShedLevel new_level, int64_t master_pos);
+
+  std::atomic<double> shed_load{kDefaultShedLoad};
+  std::atomic<ShedLevel> level{ShedLevel::None};
+  std::atomic<double> smoothed_load{0.0};
+
+  // Audio thread only
+  int blocks_over = 0;
+  int blocks_under = 0;
+  int hold_blocks = 0;
+
+  std::array<ActionSlot, kActionHistorySize> action_history;
+  std::atomic<int64_t> action_write_count{0};
+};
+
+}  // namespace celestrian
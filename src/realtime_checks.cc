@@ -0,0 +1,255 @@
+#include "realtime_checks.h"
+
+#if CELESTRIAN_REALTIME_CHECKS
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace celestrian::realtime {
+
+namespace {
+// Stack traces are expensive and noisy; only the first few are logged.
+constexpr int kMaxLoggedViolations = 8;
+
+thread_local int realtime_depth = 0;
+thread_local int allow_depth = 0;
+// Set while we report, so the report's own allocations aren't counted
+thread_local bool is_reporting = false;
+
+std::atomic<int64_t> allocation_count{0};
+std::atomic<int64_t> lock_count{0};
+std::atomic<int64_t> blocking_call_count{0};
+std::atomic<int> logged_count{0};
+
+const char* describe(Violation kind) {
+  switch (kind) {
+    case Violation::Allocation:
+      return "allocation";
+    case Violation::Lock:
+      return "lock";
+    case Violation::BlockingCall:
+      return "blocking call";
+  }
+  return "violation";
+}
+}  // namespace
+
+bool isRealtimeThread() {
+  return realtime_depth > 0 && allow_depth == 0 && !is_reporting;
+}
+
+void reportViolation(Violation kind, const char* what) {
+  if (!isRealtimeThread()) return;
+  is_reporting = true;
+
+  switch (kind) {
+    case Violation::Allocation:
+      allocation_count.fetch_add(1);
+      break;
+    case Violation::Lock:
+      lock_count.fetch_add(1);
+      break;
+    case Violation::BlockingCall:
+      blocking_call_count.fetch_add(1);
+      break;
+  }
+
+  if (logged_count.fetch_add(1) < kMaxLoggedViolations) {
+    juce::Logger::writeToLog("REALTIME VIOLATION (" +
+                             juce::String(describe(kind)) + ": " + what +
+                             ") on the audio thread:\n" +
+                             juce::SystemStats::getStackBacktrace());
+  }
+
+  is_reporting = false;
+}
+
+ViolationCounts getViolationCounts() {
+  ViolationCounts counts;
+  counts.allocations = allocation_count.load();
+  counts.locks = lock_count.load();
+  counts.blocking_calls = blocking_call_count.load();
+  return counts;
+}
+
+void resetViolationCounts() {
+  allocation_count.store(0);
+  lock_count.store(0);
+  blocking_call_count.store(0);
+  logged_count.store(0);
+}
+
+ScopedRealtimeThread::ScopedRealtimeThread() { ++realtime_depth; }
+ScopedRealtimeThread::~ScopedRealtimeThread() { --realtime_depth; }
+
+ScopedAllowViolations::ScopedAllowViolations() { ++allow_depth; }
+ScopedAllowViolations::~ScopedAllowViolations() { --allow_depth; }
+
+}  // namespace celestrian::realtime
+
+// --- Hooks ---
+//
+// operator new is replaceable by definition. The C functions are interposed:
+// on Linux by defining them in the executable and forwarding to the next
+// definition (libc) via dlsym(RTLD_NEXT); on macOS through dyld's
+// __interpose section.
+
+namespace {
+using celestrian::realtime::reportViolation;
+using celestrian::realtime::Violation;
+
+void* checkedAlloc(std::size_t size) {
+  reportViolation(Violation::Allocation, "operator new");
+  if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+  throw std::bad_alloc();
+}
+
+void* checkedAlignedAlloc(std::size_t size, std::align_val_t alignment) {
+  reportViolation(Violation::Allocation, "operator new (aligned)");
+  void* p = nullptr;
+  auto align = std::max(sizeof(void*), static_cast<std::size_t>(alignment));
+  if (posix_memalign(&p, align, size == 0 ? 1 : size) != 0)
+    throw std::bad_alloc();
+  return p;
+}
+}  // namespace
+
+void* operator new(std::size_t size) { return checkedAlloc(size); }
+void* operator new[](std::size_t size) { return checkedAlloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return checkedAlloc(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return checkedAlloc(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return checkedAlignedAlloc(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return checkedAlignedAlloc(size, alignment);
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+#if defined(__APPLE__)
+
+namespace {
+int checkedMutexLock(pthread_mutex_t* mutex) {
+  reportViolation(Violation::Lock, "pthread_mutex_lock");
+  return pthread_mutex_lock(mutex);
+}
+int checkedCondWait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
+  reportViolation(Violation::BlockingCall, "pthread_cond_wait");
+  return pthread_cond_wait(cond, mutex);
+}
+int checkedNanosleep(const timespec* request, timespec* remaining) {
+  reportViolation(Violation::BlockingCall, "nanosleep");
+  return nanosleep(request, remaining);
+}
+int checkedUsleep(useconds_t usec) {
+  reportViolation(Violation::BlockingCall, "usleep");
+  return usleep(usec);
+}
+ssize_t checkedWrite(int fd, const void* buf, size_t count) {
+  reportViolation(Violation::BlockingCall, "write");
+  return write(fd, buf, count);
+}
+ssize_t checkedRead(int fd, void* buf, size_t count) {
+  reportViolation(Violation::BlockingCall, "read");
+  return read(fd, buf, count);
+}
+
+struct Interpose {
+  const void* replacement;
+  const void* original;
+};
+}  // namespace
+
+__attribute__((used, section("__DATA,__interpose")))
+static const Interpose kInterposers[] = {
+    {(const void*)&checkedMutexLock, (const void*)&pthread_mutex_lock},
+    {(const void*)&checkedCondWait, (const void*)&pthread_cond_wait},
+    {(const void*)&checkedNanosleep, (const void*)&nanosleep},
+    {(const void*)&checkedUsleep, (const void*)&usleep},
+    {(const void*)&checkedWrite, (const void*)&write},
+    {(const void*)&checkedRead, (const void*)&read},
+};
+
+#else
+
+namespace {
+template <typename Fn>
+Fn nextSymbol(Fn& cache, const char* name) {
+  if (cache == nullptr) cache = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+  return cache;
+}
+}  // namespace
+
+extern "C" {
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) {
+  static int (*next)(pthread_mutex_t*) = nullptr;
+  reportViolation(Violation::Lock, "pthread_mutex_lock");
+  return nextSymbol(next, "pthread_mutex_lock")(mutex);
+}
+
+int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
+  static int (*next)(pthread_cond_t*, pthread_mutex_t*) = nullptr;
+  reportViolation(Violation::BlockingCall, "pthread_cond_wait");
+  return nextSymbol(next, "pthread_cond_wait")(cond, mutex);
+}
+
+int nanosleep(const struct timespec* request, struct timespec* remaining) {
+  static int (*next)(const struct timespec*, struct timespec*) = nullptr;
+  reportViolation(Violation::BlockingCall, "nanosleep");
+  return nextSymbol(next, "nanosleep")(request, remaining);
+}
+
+int usleep(useconds_t usec) {
+  static int (*next)(useconds_t) = nullptr;
+  reportViolation(Violation::BlockingCall, "usleep");
+  return nextSymbol(next, "usleep")(usec);
+}
+
+ssize_t write(int fd, const void* buf, size_t count) {
+  static ssize_t (*next)(int, const void*, size_t) = nullptr;
+  reportViolation(Violation::BlockingCall, "write");
+  return nextSymbol(next, "write")(fd, buf, count);
+}
+
+ssize_t read(int fd, void* buf, size_t count) {
+  static ssize_t (*next)(int, void*, size_t) = nullptr;
+  reportViolation(Violation::BlockingCall, "read");
+  return nextSymbol(next, "read")(fd, buf, count);
+}
+
+}  // extern "C"
+
+#endif  // __APPLE__
+
+#endif  // CELESTRIAN_REALTIME_CHECKS
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <cstdint>
+
+/**
+ * Realtime-safety detector for the audio thread.
+ *
+ * Built only with the CELESTRIAN_REALTIME_CHECKS CMake option. In that mode
+ * the device callback marks its thread as realtime, and the process-wide
+ * hooks in realtime_checks.cc catch heap allocation (operator new), mutex
+ * locks (pthread_mutex_lock, which covers std::mutex and
+ * std::recursive_mutex) and blocking syscalls (sleep, condition waits,
+ * read/write) on a realtime thread. Each violation is counted, and the first
+ * few are logged with a stack trace.
+ *
+ * Without the option, everything here compiles to nothing.
+ */
+namespace celestrian::realtime {
+
+enum class Violation { Allocation, Lock, BlockingCall };
+
+struct ViolationCounts {
+  int64_t allocations = 0;
+  int64_t locks = 0;
+  int64_t blocking_calls = 0;
+
+  int64_t total() const { return allocations + locks + blocking_calls; }
+};
+
+#if CELESTRIAN_REALTIME_CHECKS
+
+constexpr bool kChecksEnabled = true;
+
+/**
+ * Returns true if the calling thread is inside a ScopedRealtimeThread and not
+ * inside a ScopedAllowViolations.
+ */
+bool isRealtimeThread();
+
+/**
+ * Counts a violation on the calling thread (if it is realtime) and logs a
+ * stack trace for the first few. Called by the hooks.
+ */
+void reportViolation(Violation kind, const char* what);
+
+ViolationCounts getViolationCounts();
+void resetViolationCounts();
+
+/**
+ * Marks the calling thread as realtime for the lifetime of the object.
+ */
+class ScopedRealtimeThread {
+ public:
+  ScopedRealtimeThread();
+  ~ScopedRealtimeThread();
+  JUCE_DECLARE_NON_COPYABLE(ScopedRealtimeThread)
+};
+
+/**
+ * Suspends detection on the calling thread, for known and accepted
+ * violations (e.g. diagnostics that are only enabled while debugging).
+ */
+class ScopedAllowViolations {
+ public:
+  ScopedAllowViolations();
+  ~ScopedAllowViolations();
+  JUCE_DECLARE_NON_COPYABLE(ScopedAllowViolations)
+};
+
+#else
+
+constexpr bool kChecksEnabled = false;
+
+inline bool isRealtimeThread() { return false; }
+inline void reportViolation(Violation, const char*) {}
+inline ViolationCounts getViolationCounts() { return {}; }
+inline void resetViolationCounts() {}
+
+class ScopedRealtimeThread {
+ public:
+  ScopedRealtimeThread() {}
+};
+
+class ScopedAllowViolations {
+ public:
+  ScopedAllowViolations() {}
+};
+
+#endif
+
+}  // namespace celestrian::realtime
@@ -0,0 +1,97 @@
+#include "recording_log.h"
+
+#include <algorithm>
+
+namespace celestrian {
+
+void RecordingLog::add(const Entry &entry) {
+  auto index = write_count.load(std::memory_order_relaxed);
+  auto &slot = history[index % kHistorySize];
+  auto seq = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.type.store(entry.type, std::memory_order_relaxed);
+  slot.master_pos.store(entry.master_pos, std::memory_order_relaxed);
+  slot.snap.store(entry.snap, std::memory_order_relaxed);
+  slot.recorded_samples.store(entry.recorded_samples,
+                              std::memory_order_relaxed);
+  slot.duration.store(entry.duration, std::memory_order_relaxed);
+  slot.loop_end.store(entry.loop_end, std::memory_order_relaxed);
+  slot.ideal_anchor.store(entry.ideal_anchor, std::memory_order_relaxed);
+  slot.audio_phase.store(entry.audio_phase, std::memory_order_relaxed);
+  slot.final_anchor.store(entry.final_anchor, std::memory_order_relaxed);
+  slot.rotated.store(entry.rotated, std::memory_order_relaxed);
+  slot.sequence.store(seq + 2, std::memory_order_release);
+  write_count.store(index + 1, std::memory_order_release);
+}
+
+juce::Array<RecordingLog::Entry> RecordingLog::getEntriesSince(
+    int64_t first_index) const {
+  juce::Array<Entry> entries;
+  auto written = write_count.load(std::memory_order_acquire);
+  auto first =
+      std::max<int64_t>({0, first_index, written - (int64_t)kHistorySize});
+
+  for (auto i = first; i < written; ++i) {
+    const auto &slot = history[i % kHistorySize];
+    auto before = slot.sequence.load(std::memory_order_acquire);
+    Entry entry;
+    entry.index = i;
+    entry.type = slot.type.load(std::memory_order_relaxed);
+    entry.master_pos = slot.master_pos.load(std::memory_order_relaxed);
+    entry.snap = slot.snap.load(std::memory_order_relaxed);
+    entry.recorded_samples =
+        slot.recorded_samples.load(std::memory_order_relaxed);
+    entry.duration = slot.duration.load(std::memory_order_relaxed);
+    entry.loop_end = slot.loop_end.load(std::memory_order_relaxed);
+    entry.ideal_anchor = slot.ideal_anchor.load(std::memory_order_relaxed);
+    entry.audio_phase = slot.audio_phase.load(std::memory_order_relaxed);
+    entry.final_anchor = slot.final_anchor.load(std::memory_order_relaxed);
+    entry.rotated = slot.rotated.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Skip a slot the block thread is rewriting right now
+    if ((before & 1u) == 0 &&
+        before == slot.sequence.load(std::memory_order_relaxed))
+      entries.add(entry);
+  }
+  return entries;
+}
+
+juce::String RecordingLog::describe(const Entry &entry) {
+  switch (entry.type) {
+    case EntryType::AwaitingStart:
+      return "ClipNode: Awaiting start at " + juce::String(entry.master_pos);
+    case EntryType::Started:
+      return "ClipNode: Recording Started at master_pos=" +
+             juce::String(entry.master_pos);
+    case EntryType::Committed:
+      break;
+  }
+
+  juce::String snap;
+  switch (entry.snap) {
+    case Snap::None:
+      snap = "No quantum";
+      break;
+    case Snap::Anticipatory:
+      snap = "Anticipatory Snap to B=" + juce::String(entry.duration);
+      break;
+    case Snap::Late:
+      snap = "Late Snap to B=" + juce::String(entry.duration);
+      break;
+    case Snap::Outside:
+      snap = "Instant Stop (Outside tolerance), Loop Region set to " +
+             juce::String(entry.loop_end);
+      break;
+  }
+  return "ClipNode: Commit. " + snap +
+         ". L=" + juce::String(entry.recorded_samples) +
+         ", Duration=" + juce::String(entry.duration) +
+         ", StartTime=" + juce::String(entry.master_pos) +
+         ", IdealX=" + juce::String(entry.ideal_anchor) +
+         ", AudioPhase=" + juce::String(entry.audio_phase) +
+         ", Rotated=" + juce::String(entry.rotated ? "YES" : "NO") +
+         ", FinalAnchor=" + juce::String(entry.final_anchor);
+}
+
+}  // namespace celestrian
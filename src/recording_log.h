@@ -0,0 +1,84 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace celestrian {
+
+/**
+ * What recording did on the audio thread, for the message thread to log.
+ * Clips starting and committing takes on a boundary add an entry instead of
+ * writing to juce::Logger, which would build strings and take a lock there.
+ *
+ * One writer: whichever thread is running blocks. Entries go into a ring
+ * that other threads read without blocking it, as OverloadGovernor's
+ * actions do.
+ */
+class RecordingLog {
+ public:
+  static constexpr int kHistorySize = 64;
+
+  enum class EntryType { AwaitingStart, Started, Committed };
+
+  // How a committed take's length was chosen
+  enum class Snap {
+    None,          // No quantum: the take is as long as it was recorded
+    Anticipatory,  // Stopped on the boundary the stop waited for
+    Late,          // Snapped to the nearest multiple of the quantum
+    Outside,       // Too far from one: the loop region was snapped instead
+  };
+
+  struct Entry {
+    int64_t index = 0;  // Counts every entry since the log was created
+    EntryType type = EntryType::Started;
+    // Where recording starts (or will), or the committed take started
+    int64_t master_pos = 0;
+    // Committed takes only
+    Snap snap = Snap::None;
+    int64_t recorded_samples = 0;
+    int64_t duration = 0;
+    int64_t loop_end = 0;
+    int64_t ideal_anchor = 0;
+    int64_t audio_phase = 0;
+    int64_t final_anchor = 0;
+    bool rotated = false;
+  };
+
+  /** Records `entry`; its index is assigned here. Block thread only. */
+  void add(const Entry &entry);
+
+  /**
+   * Returns the entries with an index of at least `first_index`, oldest
+   * first (at most kHistorySize). Any thread.
+   */
+  juce::Array<Entry> getEntriesSince(int64_t first_index) const;
+
+  int64_t getNumEntries() const { return write_count.load(); }
+
+  /** One log line describing `entry`. */
+  static juce::String describe(const Entry &entry);
+
+ private:
+  // Per-slot sequence lock, as in OverloadGovernor
+  struct Slot {
+    std::atomic<uint32_t> sequence{0};
+    std::atomic<EntryType> type{EntryType::Started};
+    std::atomic<int64_t> master_pos{0};
+    std::atomic<Snap> snap{Snap::None};
+    std::atomic<int64_t> recorded_samples{0};
+    std::atomic<int64_t> duration{0};
+    std::atomic<int64_t> loop_end{0};
+    std::atomic<int64_t> ideal_anchor{0};
+    std::atomic<int64_t> audio_phase{0};
+    std::atomic<int64_t> final_anchor{0};
+    std::atomic<bool> rotated{false};
+  };
+
+  std::array<Slot, kHistorySize> history;
+  std::atomic<int64_t> write_count{0};
+};
+
+}  // namespace celestrian
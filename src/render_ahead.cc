@@ -0,0 +1,271 @@
+#include "render_ahead.h"
+
+#include <algorithm>
+
+#include "node_reclaimer.h"
+
+namespace celestrian {
+
+void RenderScratch::prepare(int max_block_size, int num_channels) {
+  block_size = std::max(1, max_block_size);
+  channels = std::max(1, num_channels);
+  if (levels.empty()) levels.push_back(std::make_unique<Level>());
+  for (auto &level : levels)
+    level->buffer.setSize(channels, block_size, false, false, true);
+}
+
+RenderScratch::Level &RenderScratch::enter(int num_channels,
+                                           int num_samples) {
+  if (depth == (int)levels.size()) {
+    levels.push_back(std::make_unique<Level>());
+    levels.back()->buffer.setSize(channels, block_size);
+  }
+  auto &level = *levels[(size_t)depth++];
+  if (level.buffer.getNumChannels() < num_channels ||
+      level.buffer.getNumSamples() < num_samples)
+    level.buffer.setSize(std::max(1, num_channels), num_samples, false,
+                         false, true);
+  return level;
+}
+
+RenderAhead::RenderAhead(AudioNode &subtree_to_render,
+                         RenderAheadPool &owner)
+    : subtree(subtree_to_render), pool(owner) {
+  pool.add(*this);
+}
+
+RenderAhead::~RenderAhead() { pool.remove(*this); }
+
+void RenderAhead::prepare(int max_block_size, int num_channels) {
+  std::lock_guard<std::mutex> lock(ring_mutex);
+  ring.setSize(std::max(1, num_channels),
+               std::max(1, max_block_size) * kRingBlocks, false, true, false);
+  ring_block_size.store(std::max(1, max_block_size));
+  ring_bytes.store(MemoryUsage::bytesForSamples(ring.getNumChannels(),
+                                                ring.getNumSamples()));
+  slot.resize((size_t)ring.getNumChannels());
+  scratch.prepare(max_block_size, num_channels);
+
+  // Anything rendered for the old settings is gone
+  consumer_anchor = Anchor();
+  consumer_anchor.epoch = anchor_epoch.load() + 1;
+  consumed.store(0);
+  publishAnchor(consumer_anchor);
+}
+
+int64_t RenderAhead::predictMasterPos(const Anchor &anchor,
+                                      int64_t block) const {
+  // The transport advances a block at a time and wraps at the end of one
+  const int64_t length = anchor.timeline_length;
+  const int64_t step = (int64_t)anchor.block_size % length;
+  return (anchor.master_pos + ((block % length) * step) % length) % length;
+}
+
+bool RenderAhead::read(float *const *outputs, int num_outputs,
+                       const ProcessContext &context) {
+  auto &anchor = consumer_anchor;
+  const int num_samples = context.num_samples;
+
+  bool on_track = anchor.valid && enabled.load(std::memory_order_relaxed) &&
+                  context.is_playing &&
+                  num_samples == anchor.block_size &&
+                  num_outputs <= ring.getNumChannels() &&
+                  context.timeline_length == anchor.timeline_length &&
+                  context.graph_generation == anchor.graph_generation &&
+                  context.solo_node == anchor.solo_node &&
+                  context.sample_rate == anchor.sample_rate;
+  int64_t block = 0;
+  if (on_track) {
+    const int64_t elapsed = context.sample_time - anchor.sample_time;
+    block = elapsed / num_samples;
+    on_track = elapsed >= 0 && elapsed % num_samples == 0 &&
+               predictMasterPos(anchor, block) == context.master_pos;
+  }
+
+  if (!on_track) {
+    // Re-anchor on the next block; this one renders live
+    Anchor next;
+    next.epoch = anchor.epoch + 1;
+    next.valid = enabled.load() && context.is_playing &&
+                 context.timeline_length > 0 && num_samples > 0 &&
+                 num_samples <= ring_block_size.load() &&
+                 num_outputs <= ring.getNumChannels();
+    if (!next.valid && !anchor.valid) return false;
+    if (next.valid) {
+      next.sample_time = context.sample_time + num_samples;
+      next.master_pos =
+          (context.master_pos + num_samples) % context.timeline_length;
+      next.timeline_length = context.timeline_length;
+      next.block_size = num_samples;
+      next.graph_generation = context.graph_generation;
+      next.sample_rate = context.sample_rate;
+      next.solo_node = context.solo_node;
+    }
+    anchor = next;
+    consumed.store(0, std::memory_order_release);
+    publishAnchor(anchor);
+    num_misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  const uint64_t published = progress.load(std::memory_order_acquire);
+  const bool ready = (uint32_t)(published >> 32) == anchor.epoch &&
+                     (int64_t)(uint32_t)published > block;
+  if (ready) {
+    const int start = (int)(block % kRingBlocks) * ring_block_size.load();
+    for (int ch = 0; ch < num_outputs; ++ch) {
+      if (outputs[ch] != nullptr)
+        juce::FloatVectorOperations::add(
+            outputs[ch], ring.getReadPointer(ch, start), num_samples);
+    }
+    num_hits.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    // The producer fell behind: it skips ahead to the blocks still to come
+    num_misses.fetch_add(1, std::memory_order_relaxed);
+  }
+  consumed.store(block + 1, std::memory_order_release);
+  return ready;
+}
+
+bool RenderAhead::renderNext() {
+  std::lock_guard<std::mutex> lock(ring_mutex);
+  const Anchor anchor = loadAnchor();
+  const int block_size = ring_block_size.load();
+  if (!anchor.valid || anchor.block_size <= 0 ||
+      anchor.block_size > block_size)
+    return false;
+
+  // Only this thread writes `progress`
+  const uint64_t published = progress.load(std::memory_order_relaxed);
+  int64_t next = (uint32_t)(published >> 32) == anchor.epoch
+                     ? (int64_t)(uint32_t)published
+                     : 0;
+  // If the consumer re-anchored since loadAnchor(), this block goes out
+  // under the old epoch and is ignored
+  const int64_t done = consumed.load(std::memory_order_acquire);
+  next = std::max(next, done);
+  if (next - done >= kLeadBlocks) return false;
+
+  const int start = (int)(next % kRingBlocks) * block_size;
+  for (int ch = 0; ch < ring.getNumChannels(); ++ch) {
+    slot[(size_t)ch] = ring.getWritePointer(ch, start);
+    juce::FloatVectorOperations::clear(slot[(size_t)ch], anchor.block_size);
+  }
+
+  ProcessContext context;
+  context.sample_rate = anchor.sample_rate;
+  context.num_samples = anchor.block_size;
+  context.is_playing = true;
+  context.master_pos = predictMasterPos(anchor, next);
+  context.sample_time = anchor.sample_time + next * anchor.block_size;
+  context.solo_node = anchor.solo_node;
+  context.timeline_length = anchor.timeline_length;
+  context.graph_generation = anchor.graph_generation;
+  if (!subtree.renderAhead(slot.data(), (int)slot.size(), context, scratch))
+    return false;
+
+  progress.store(((uint64_t)anchor.epoch << 32) | (uint32_t)(next + 1),
+                 std::memory_order_release);
+  return true;
+}
+
+void RenderAhead::publishAnchor(const Anchor &anchor) {
+  auto seq = anchor_sequence.load(std::memory_order_relaxed);
+  anchor_sequence.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  anchor_epoch.store(anchor.epoch, std::memory_order_relaxed);
+  anchor_valid.store(anchor.valid, std::memory_order_relaxed);
+  anchor_sample_time.store(anchor.sample_time, std::memory_order_relaxed);
+  anchor_master_pos.store(anchor.master_pos, std::memory_order_relaxed);
+  anchor_timeline_length.store(anchor.timeline_length,
+                               std::memory_order_relaxed);
+  anchor_block_size.store(anchor.block_size, std::memory_order_relaxed);
+  anchor_graph_generation.store(anchor.graph_generation,
+                                std::memory_order_relaxed);
+  anchor_sample_rate.store(anchor.sample_rate, std::memory_order_relaxed);
+  anchor_solo_node.store(anchor.solo_node, std::memory_order_relaxed);
+  anchor_sequence.store(seq + 2, std::memory_order_release);
+}
+
+RenderAhead::Anchor RenderAhead::loadAnchor() const {
+  for (;;) {
+    const auto before = anchor_sequence.load(std::memory_order_acquire);
+    Anchor anchor;
+    anchor.epoch = anchor_epoch.load(std::memory_order_relaxed);
+    anchor.valid = anchor_valid.load(std::memory_order_relaxed);
+    anchor.sample_time = anchor_sample_time.load(std::memory_order_relaxed);
+    anchor.master_pos = anchor_master_pos.load(std::memory_order_relaxed);
+    anchor.timeline_length =
+        anchor_timeline_length.load(std::memory_order_relaxed);
+    anchor.block_size = anchor_block_size.load(std::memory_order_relaxed);
+    anchor.graph_generation =
+        anchor_graph_generation.load(std::memory_order_relaxed);
+    anchor.sample_rate = anchor_sample_rate.load(std::memory_order_relaxed);
+    anchor.solo_node = anchor_solo_node.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Retry while the audio thread is rewriting it; it never waits on us
+    if ((before & 1u) == 0 &&
+        before == anchor_sequence.load(std::memory_order_relaxed))
+      return anchor;
+  }
+}
+
+class RenderAheadPool::Worker : public juce::Thread {
+ public:
+  explicit Worker(RenderAheadPool &owner)
+      : juce::Thread("Celestrian Render Ahead"), pool(owner) {}
+
+  void run() override {
+    // As on the audio thread, so the rendered blocks match it
+    juce::ScopedNoDenormals no_denormals;
+    while (!threadShouldExit()) {
+      if (pool.renderRound() == 0) wait(kIdleWaitMs);
+    }
+  }
+
+ private:
+  RenderAheadPool &pool;
+};
+
+RenderAheadPool::RenderAheadPool(bool start_worker) {
+  if (start_worker) {
+    worker = std::make_unique<Worker>(*this);
+    worker->startThread(juce::Thread::Priority::high);
+  }
+}
+
+RenderAheadPool::~RenderAheadPool() {
+  if (worker != nullptr) worker->stopThread(1000);
+}
+
+void RenderAheadPool::setReclaimer(NodeReclaimer *node_reclaimer) {
+  std::lock_guard<std::mutex> lock(mutex);
+  reclaimer = node_reclaimer;
+}
+
+void RenderAheadPool::add(RenderAhead &render_ahead) {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.push_back(&render_ahead);
+}
+
+void RenderAheadPool::remove(RenderAhead &render_ahead) {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.erase(std::remove(entries.begin(), entries.end(), &render_ahead),
+                entries.end());
+}
+
+int RenderAheadPool::renderRound() {
+  std::lock_guard<std::mutex> lock(mutex);
+  // Boxes render from copies of their child lists, not under their locks:
+  // the epoch keeps the nodes in those copies alive
+  if (reclaimer != nullptr) reclaimer->beginRenderAhead();
+  int num_rendered = 0;
+  for (auto *entry : entries) {
+    // Top each ring up to its lead
+    while (entry->isEnabled() && entry->renderNext()) ++num_rendered;
+  }
+  if (reclaimer != nullptr) reclaimer->endRenderAhead();
+  return num_rendered;
+}
+
+}  // namespace celestrian
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "audio_node.h"
+
+namespace celestrian {
+
+class NodeReclaimer;
+class RenderAheadPool;
+
+/**
+ * Working memory for one renderAhead() pass: a mix buffer and a copy of the
+ * child list for each box level it goes down. Owned by the RenderAhead that
+ * runs the pass and sized in its prepare(), so the worker doesn't allocate
+ * per block.
+ */
+class RenderScratch {
+ public:
+  struct Level {
+    juce::AudioBuffer<float> buffer;
+    std::vector<const AudioNode *> children;
+  };
+
+  /** Sizes every level's buffer, keeping at least one level. */
+  void prepare(int max_block_size, int num_channels);
+
+  /**
+   * Goes a box level down, returning that level with a buffer of at least
+   * `num_channels` by `num_samples`. Allocates only if the subtree got
+   * deeper, or the block longer, than what prepare() saw.
+   */
+  Level &enter(int num_channels, int num_samples);
+  void leave() { --depth; }
+
+ private:
+  std::vector<std::unique_ptr<Level>> levels;  // Stable while deeper ones grow
+  int depth = 0;
+  int block_size = 1;
+  int channels = 1;
+};
+
+/**
+ * Renders one box's subtree a few blocks ahead of the audio thread, while
+ * the subtree is predictable (committed, looping playback only: see
+ * AudioNode::renderAhead()), so the device callback only copies it.
+ *
+ * The audio thread is the consumer. Each block it checks that the transport
+ * moved as the last anchor predicted (same block size, timeline and graph
+ * generation); if so it takes the pre-rendered block from a lock-free ring,
+ * otherwise it re-anchors and the box renders live. A RenderAheadPool
+ * worker is the producer: it renders the blocks the anchor predicts through
+ * AudioNode::renderAhead(), which matches process() sample for sample.
+ */
+class RenderAhead {
+ public:
+  // Blocks the ring holds, and how many the producer renders ahead
+  static constexpr int kRingBlocks = 8;
+  static constexpr int kLeadBlocks = 4;
+
+  RenderAhead(AudioNode &subtree, RenderAheadPool &pool);
+
+  /** Leaves the pool, waiting for a render of this subtree to finish. */
+  ~RenderAhead();
+
+  /**
+   * Sizes the ring. Never concurrently with read(); the producer is held
+   * off while it runs.
+   */
+  void prepare(int max_block_size, int num_channels);
+
+  /** Consumer side switch. Any thread; takes effect at the next block. */
+  void setEnabled(bool should_enable) { enabled.store(should_enable); }
+  bool isEnabled() const { return enabled.load(); }
+
+  /**
+   * Adds the pre-rendered block `context` describes to `outputs`, if there
+   * is one. Otherwise re-anchors on this block, when needed, and returns
+   * false: the caller renders live. Audio thread only; wait-free.
+   */
+  bool read(float *const *outputs, int num_outputs,
+            const ProcessContext &context);
+
+  /**
+   * Renders the next predicted block, if the ring has room and the subtree
+   * is predictable. Called by the pool's worker.
+   * @return True if a block was rendered.
+   */
+  bool renderNext();
+
+  int64_t getNumHits() const { return num_hits.load(); }
+  int64_t getNumMisses() const { return num_misses.load(); }
+  int64_t getRingBytes() const { return ring_bytes.load(); }
+
+ private:
+  // Where the consumer expects the transport to be, written by the audio
+  // thread under a sequence lock
+  struct Anchor {
+    uint32_t epoch = 0;
+    bool valid = false;
+    int64_t sample_time = 0;  // Start of block 0
+    int64_t master_pos = 0;   // Transport position at block 0
+    int64_t timeline_length = 0;
+    int block_size = 0;
+    uint64_t graph_generation = 0;
+    double sample_rate = 44100.0;
+    const AudioNode *solo_node = nullptr;  // Compared, never dereferenced
+  };
+
+  void publishAnchor(const Anchor &anchor);
+  Anchor loadAnchor() const;
+  int64_t predictMasterPos(const Anchor &anchor, int64_t block) const;
+
+  AudioNode &subtree;
+  RenderAheadPool &pool;
+  std::atomic<bool> enabled{true};
+
+  // Held by the producer and prepare(), never by the audio thread
+  std::mutex ring_mutex;
+  juce::AudioBuffer<float> ring;  // kRingBlocks blocks, end to end
+  std::vector<float *> slot;      // The ring block being rendered
+  RenderScratch scratch;
+  std::atomic<int> ring_block_size{0};
+  std::atomic<int64_t> ring_bytes{0};
+
+  std::atomic<uint32_t> anchor_sequence{0};
+  std::atomic<uint32_t> anchor_epoch{0};
+  std::atomic<bool> anchor_valid{false};
+  std::atomic<int64_t> anchor_sample_time{0};
+  std::atomic<int64_t> anchor_master_pos{0};
+  std::atomic<int64_t> anchor_timeline_length{0};
+  std::atomic<int> anchor_block_size{0};
+  std::atomic<uint64_t> anchor_graph_generation{0};
+  std::atomic<double> anchor_sample_rate{44100.0};
+  std::atomic<const AudioNode *> anchor_solo_node{nullptr};
+
+  // Epoch in the high 32 bits, index of the next block to render in the low
+  // 32: the two are published together
+  std::atomic<uint64_t> progress{0};
+  // Blocks of the current epoch the consumer is done with
+  std::atomic<int64_t> consumed{0};
+
+  // Audio thread only
+  Anchor consumer_anchor;
+
+  std::atomic<int64_t> num_hits{0};
+  std::atomic<int64_t> num_misses{0};
+
+  JUCE_DECLARE_NON_COPYABLE(RenderAhead)
+};
+
+/**
+ * The worker thread that keeps every enabled RenderAhead topped up.
+ */
+class RenderAheadPool {
+ public:
+  // How long the worker sleeps when every ring is full or idle
+  static constexpr int kIdleWaitMs = 1;
+
+  /**
+   * @param start_worker False leaves rendering to renderRound() calls, e.g.
+   *                     from tests.
+   */
+  explicit RenderAheadPool(bool start_worker = true);
+
+  /** Every RenderAhead must have left the pool by now. */
+  ~RenderAheadPool();
+
+  /**
+   * The graph's NodeReclaimer. Each round holds an epoch in it, so nodes
+   * removed while the worker renders them stay alive until it's done. Waits
+   * for the current round; set nullptr before the reclaimer goes.
+   */
+  void setReclaimer(NodeReclaimer *node_reclaimer);
+
+  void add(RenderAhead &render_ahead);
+
+  /** Returns once the worker no longer renders `render_ahead`. */
+  void remove(RenderAhead &render_ahead);
+
+  /**
+   * Tops every enabled ring up to its lead.
+   * @return The number of blocks rendered.
+   */
+  int renderRound();
+
+ private:
+  class Worker;
+
+  std::mutex mutex;
+  std::vector<RenderAhead *> entries;
+  NodeReclaimer *reclaimer = nullptr;  // Guarded by mutex
+  std::unique_ptr<Worker> worker;
+
+  JUCE_DECLARE_NON_COPYABLE(RenderAheadPool)
+};
+
+}  // namespace celestrian
@@ -0,0 +1,325 @@
+#include "session_capture.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace celestrian {
+
+namespace {
+constexpr int kMagic = 0x50414343;  // "CCAP"
+constexpr int kVersion = 2;  // 2: internal block size
+constexpr int kWriterIntervalMs = 20;
+constexpr double kRingSeconds = 2.0;
+constexpr int kCompressionLevel = 1;  // Fast: the writer must keep up
+constexpr int kMaxBlockSamples = 1 << 20;
+
+enum RecordTag : char {
+  kCommandTag = 'C',
+  kBlockTag = 'B',
+  kEndTag = 'E',
+};
+}  // namespace
+
+uint64_t hashAudioBlock(const float *const *channels, int num_channels,
+                        int num_samples) {
+  uint64_t hash = 14695981039346656037ULL;
+  auto mix = [&hash](uint32_t word) {
+    for (int byte = 0; byte < 4; ++byte) {
+      hash ^= (word >> (8 * byte)) & 0xff;
+      hash *= 1099511628211ULL;
+    }
+  };
+  for (int ch = 0; ch < num_channels; ++ch) {
+    const float *data = channels != nullptr ? channels[ch] : nullptr;
+    for (int i = 0; i < num_samples; ++i) {
+      uint32_t bits = 0;
+      if (data != nullptr) std::memcpy(&bits, data + i, sizeof(bits));
+      mix(bits);
+    }
+  }
+  return hash;
+}
+
+// --- SessionCapture ---
+
+class SessionCapture::WriterThread : public juce::Thread {
+ public:
+  explicit WriterThread(SessionCapture &owner)
+      : juce::Thread("Celestrian Capture Writer"), capture(owner) {}
+
+  void run() override {
+    while (!threadShouldExit()) {
+      capture.drain();
+      wait(kWriterIntervalMs);
+    }
+  }
+
+ private:
+  SessionCapture &capture;
+};
+
+std::unique_ptr<SessionCapture> SessionCapture::create(
+    const juce::File &file, const CaptureHeader &header) {
+  file.deleteFile();
+  auto file_stream = std::make_unique<juce::FileOutputStream>(file);
+  if (!file_stream->openedOk()) {
+    juce::Logger::writeToLog("SessionCapture: cannot open " +
+                             file.getFullPathName());
+    return nullptr;
+  }
+  auto stream = std::make_unique<juce::GZIPCompressorOutputStream>(
+      file_stream.release(), kCompressionLevel, true);
+  return std::unique_ptr<SessionCapture>(
+      new SessionCapture(file, header, std::move(stream)));
+}
+
+SessionCapture::SessionCapture(const juce::File &file,
+                               const CaptureHeader &header,
+                               std::unique_ptr<juce::OutputStream> stream)
+    : file(file),
+      header(header),
+      max_block_size(std::max(1, header.config.block_size)),
+      output(std::move(stream)) {
+  const int num_slots = std::max(
+      64, (int)std::ceil(kRingSeconds * header.config.sample_rate /
+                         max_block_size));
+  slots.resize((size_t)num_slots);
+  slot_samples.resize((size_t)num_slots *
+                      (size_t)std::max(0, header.config.num_inputs) *
+                      (size_t)max_block_size);
+
+  output->writeInt(kMagic);
+  output->writeInt(kVersion);
+  output->writeDouble(header.config.sample_rate);
+  output->writeInt(header.config.block_size);
+  output->writeInt(header.config.num_inputs);
+  output->writeInt(header.config.num_outputs);
+  output->writeInt(header.config.input_latency);
+  output->writeInt(header.config.output_latency);
+  output->writeString(header.root_uuid);
+  output->writeInt(header.internal_block_size);
+
+  writer_thread = std::make_unique<WriterThread>(*this);
+  writer_thread->startThread(juce::Thread::Priority::low);
+  juce::Logger::writeToLog("SessionCapture: capturing to " +
+                           file.getFullPathName());
+}
+
+SessionCapture::~SessionCapture() { finish(); }
+
+void SessionCapture::addCommand(const CapturedCommand &command) {
+  std::lock_guard<std::mutex> lock(commands_mutex);
+  pending_commands.push_back(command);
+}
+
+void SessionCapture::captureBlock(const float *const *input_channels,
+                                  int num_input_channels,
+                                  const float *const *output_channels,
+                                  int num_output_channels, int num_samples,
+                                  int64_t master_pos) {
+  const auto index = next_block.load(std::memory_order_relaxed);
+  next_block.store(index + 1, std::memory_order_release);
+
+  const auto write = write_count.load(std::memory_order_relaxed);
+  if (write - read_count.load(std::memory_order_acquire) >= slots.size() ||
+      num_samples > max_block_size ||
+      num_input_channels != header.config.num_inputs) {
+    dropped_blocks.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  const auto slot_index = (size_t)(write % slots.size());
+  auto &slot = slots[slot_index];
+  slot.index = index;
+  slot.master_pos = master_pos;
+  slot.num_samples = num_samples;
+  slot.output_hash =
+      hashAudioBlock(output_channels, num_output_channels, num_samples);
+
+  float *samples = slot_samples.data() +
+                   slot_index * (size_t)num_input_channels * max_block_size;
+  for (int ch = 0; ch < num_input_channels; ++ch) {
+    float *dest = samples + (size_t)ch * max_block_size;
+    if (input_channels[ch] != nullptr)
+      std::memcpy(dest, input_channels[ch], sizeof(float) * num_samples);
+    else
+      std::memset(dest, 0, sizeof(float) * num_samples);
+  }
+  write_count.store(write + 1, std::memory_order_release);
+}
+
+void SessionCapture::drain() {
+  std::lock_guard<std::mutex> lock(output_mutex);
+  if (output == nullptr) return;
+
+  std::vector<CapturedCommand> commands;
+  {
+    std::lock_guard<std::mutex> commands_lock(commands_mutex);
+    commands.swap(pending_commands);
+  }
+
+  // Commands logged before a block was captured can only precede a later
+  // block, so read the ring after taking the commands
+  auto read = read_count.load(std::memory_order_relaxed);
+  const auto write = write_count.load(std::memory_order_acquire);
+  size_t next_command = 0;
+  const int num_inputs = header.config.num_inputs;
+
+  for (; read < write; ++read) {
+    const auto slot_index = (size_t)(read % slots.size());
+    const auto &slot = slots[slot_index];
+    while (next_command < commands.size() &&
+           commands[next_command].block <= slot.index)
+      writeCommand(commands[next_command++]);
+
+    output->writeByte(kBlockTag);
+    output->writeInt64(slot.index);
+    output->writeInt64(slot.master_pos);
+    output->writeInt64((juce::int64)slot.output_hash);
+    output->writeInt(slot.num_samples);
+    // Host byte order: little-endian on every platform we ship
+    const float *samples = slot_samples.data() +
+                           slot_index * (size_t)num_inputs * max_block_size;
+    for (int ch = 0; ch < num_inputs; ++ch)
+      output->write(samples + (size_t)ch * max_block_size,
+                    sizeof(float) * (size_t)slot.num_samples);
+    ++num_blocks_written;
+  }
+  read_count.store(read, std::memory_order_release);
+
+  // Commands for blocks not captured yet wait for the next drain
+  if (next_command < commands.size()) {
+    std::lock_guard<std::mutex> commands_lock(commands_mutex);
+    pending_commands.insert(pending_commands.begin(),
+                            commands.begin() + (std::ptrdiff_t)next_command,
+                            commands.end());
+  }
+}
+
+void SessionCapture::writeCommand(const CapturedCommand &command) {
+  output->writeByte(kCommandTag);
+  output->writeInt((int)command.type);
+  output->writeInt64(command.block);
+  output->writeInt64(command.master_pos);
+  output->writeString(command.uuid);
+  output->writeString(command.text);
+  output->writeInt64(command.first);
+  output->writeInt64(command.second);
+  output->writeDouble(command.x);
+  output->writeDouble(command.y);
+  ++num_commands;
+}
+
+juce::var SessionCapture::finish() {
+  if (writer_thread != nullptr) {
+    writer_thread->stopThread(1000);
+    writer_thread.reset();
+  }
+  drain();
+
+  std::lock_guard<std::mutex> lock(output_mutex);
+  juce::DynamicObject::Ptr summary = new juce::DynamicObject();
+  summary->setProperty("file", file.getFullPathName());
+  if (output == nullptr) return juce::var(summary.get());
+
+  // Commands after the last block still run in a replay, before it ends
+  {
+    std::lock_guard<std::mutex> commands_lock(commands_mutex);
+    for (const auto &command : pending_commands) writeCommand(command);
+    pending_commands.clear();
+  }
+
+  const auto dropped = dropped_blocks.load();
+  output->writeByte(kEndTag);
+  output->writeInt64(num_blocks_written);
+  output->writeInt64(num_commands);
+  output->writeInt64(dropped);
+  output.reset();
+
+  summary->setProperty("blocks", (double)num_blocks_written);
+  summary->setProperty("commands", (double)num_commands);
+  summary->setProperty("droppedBlocks", (double)dropped);
+  summary->setProperty("bytes", (double)file.getSize());
+  juce::Logger::writeToLog(
+      "SessionCapture: wrote " + juce::String(num_blocks_written) +
+      " blocks and " + juce::String(num_commands) + " commands to " +
+      file.getFullPathName() +
+      (dropped > 0 ? " (" + juce::String(dropped) +
+                         " blocks DROPPED: replay will diverge)"
+                   : juce::String()));
+  return juce::var(summary.get());
+}
+
+// --- CaptureReader ---
+
+CaptureReader::CaptureReader(const juce::File &file) {
+  auto file_stream = file.createInputStream();
+  if (file_stream == nullptr) return;
+  input = std::make_unique<juce::GZIPDecompressorInputStream>(
+      file_stream.release(), true);
+
+  if (input->readInt() != kMagic) return;
+  const int version = input->readInt();
+  if (version < 1 || version > kVersion) return;
+  header.config.sample_rate = input->readDouble();
+  header.config.block_size = input->readInt();
+  header.config.num_inputs = input->readInt();
+  header.config.num_outputs = input->readInt();
+  header.config.input_latency = input->readInt();
+  header.config.output_latency = input->readInt();
+  header.root_uuid = input->readString();
+  if (version >= 2) header.internal_block_size = input->readInt();
+  valid = !input->isExhausted() && header.config.sample_rate > 0.0 &&
+          header.config.num_inputs >= 0 && header.config.num_outputs >= 0;
+}
+
+bool CaptureReader::readNext(Record &record, CapturedCommand &command,
+                             CapturedBlock &block) {
+  if (!valid || input->isExhausted()) return false;
+
+  switch (input->readByte()) {
+    case kCommandTag:
+      record = Record::Command;
+      command.type = (CaptureCommandType)input->readInt();
+      command.block = input->readInt64();
+      command.master_pos = input->readInt64();
+      command.uuid = input->readString();
+      command.text = input->readString();
+      command.first = input->readInt64();
+      command.second = input->readInt64();
+      command.x = input->readDouble();
+      command.y = input->readDouble();
+      return !input->isExhausted();
+
+    case kBlockTag: {
+      record = Record::Block;
+      block.index = input->readInt64();
+      block.master_pos = input->readInt64();
+      block.output_hash = (uint64_t)input->readInt64();
+      block.num_samples = input->readInt();
+      if (block.num_samples <= 0 || block.num_samples > kMaxBlockSamples)
+        return false;
+      const int num_inputs = header.config.num_inputs;
+      block.input.setSize(std::max(1, num_inputs), block.num_samples, false,
+                          false, true);
+      const auto bytes = (int)sizeof(float) * block.num_samples;
+      for (int ch = 0; ch < num_inputs; ++ch) {
+        if (input->read(block.input.getWritePointer(ch), bytes) != bytes)
+          return false;
+      }
+      return true;
+    }
+
+    case kEndTag:
+      record = Record::End;
+      input->readInt64();  // blocks
+      input->readInt64();  // commands
+      dropped_blocks = input->readInt64();
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+}  // namespace celestrian
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "device_backend.h"
+
+namespace celestrian {
+
+/**
+ * Engine commands that change what the audio thread renders. Values are
+ * stored in capture files: append only.
+ */
+enum class CaptureCommandType : int32_t {
+  TogglePlayback = 1,
+  StartRecording = 2,
+  StopRecording = 3,
+  CreateNode = 4,
+  EnterBox = 5,
+  ExitBox = 6,
+  ToggleSolo = 7,
+  TogglePlay = 8,
+  ToggleMute = 9,
+  SetNodeInput = 10,
+  SetLoopPoints = 11,
+  RemoveNode = 12,
+};
+
+struct CapturedCommand {
+  CaptureCommandType type = CaptureCommandType::TogglePlayback;
+  int64_t block = 0;       // Index of the block the command ran before
+  int64_t master_pos = 0;  // Transport position when it ran
+  juce::String uuid;       // Target node; for CreateNode, the new node
+  juce::String text;       // CreateNode: node type
+  int64_t first = 0;       // SetNodeInput: channel; SetLoopPoints: start
+  int64_t second = 0;      // SetLoopPoints: end
+  double x = -1.0, y = -1.0;  // CreateNode position
+};
+
+/**
+ * One rendered block: its input, and a hash of the engine's output.
+ */
+struct CapturedBlock {
+  int64_t index = 0;
+  int64_t master_pos = 0;
+  uint64_t output_hash = 0;
+  int num_samples = 0;
+  juce::AudioBuffer<float> input;
+};
+
+struct CaptureHeader {
+  DeviceConfig config;
+  juce::String root_uuid;  // Commands may target the session root
+  int internal_block_size = 0;  // AudioEngine::setInternalBlockSize()
+};
+
+/**
+ * FNV-1a over the bits of every sample, so replays can prove bit-identical
+ * output. Null channels hash as silence.
+ */
+uint64_t hashAudioBlock(const float *const *channels, int num_channels,
+                        int num_samples);
+
+/**
+ * Records a session's raw input and engine commands to a compact binary
+ * file, for deterministic offline replay (see `replayCapture`).
+ *
+ * The audio thread copies each block's input and output hash into a
+ * preallocated single-producer ring; commands are logged by the thread
+ * that runs them, stamped with the block they precede. A background thread
+ * interleaves both into a gzip stream. `AudioEngine` keeps commands and
+ * blocks from overlapping while capturing, so the stamps are exact.
+ *
+ * A block that doesn't fit (ring full, or larger than the device block
+ * size) is dropped and counted: such a capture won't replay identically.
+ */
+class SessionCapture {
+ public:
+  /**
+   * Opens `file` (replacing it) and writes the header.
+   * @return nullptr if the file can't be opened.
+   */
+  static std::unique_ptr<SessionCapture> create(const juce::File &file,
+                                                const CaptureHeader &header);
+
+  ~SessionCapture();
+
+  /**
+   * The index the next captured block will have. Stable while the caller
+   * keeps the audio thread out (the engine's capture fence).
+   */
+  int64_t getNextBlock() const {
+    return next_block.load(std::memory_order_acquire);
+  }
+
+  /** Logs a command. Not for the audio thread. */
+  void addCommand(const CapturedCommand &command);
+
+  /**
+   * Copies a block's input and hashes its output. Audio thread: no locks,
+   * no allocation.
+   */
+  void captureBlock(const float *const *input_channels, int num_input_channels,
+                    const float *const *output_channels,
+                    int num_output_channels, int num_samples,
+                    int64_t master_pos);
+
+  /**
+   * Stops the writer, writes everything still pending and closes the file.
+   * The audio thread must no longer call captureBlock().
+   * @return `{ file, blocks, commands, droppedBlocks, bytes }`.
+   */
+  juce::var finish();
+
+ private:
+  class WriterThread;
+
+  struct BlockSlot {
+    int64_t index = 0;
+    int64_t master_pos = 0;
+    uint64_t output_hash = 0;
+    int num_samples = 0;
+  };
+
+  SessionCapture(const juce::File &file, const CaptureHeader &header,
+                 std::unique_ptr<juce::OutputStream> stream);
+
+  void drain();
+  void writeCommand(const CapturedCommand &command);
+
+  const juce::File file;
+  const CaptureHeader header;
+  const int max_block_size;
+
+  // Single-producer (audio thread), single-consumer (writer) ring
+  std::vector<BlockSlot> slots;
+  std::vector<float> slot_samples;  // slots x inputs x max_block_size
+  std::atomic<uint64_t> write_count{0};
+  std::atomic<uint64_t> read_count{0};
+  std::atomic<int64_t> next_block{0};
+  std::atomic<int64_t> dropped_blocks{0};
+
+  std::mutex commands_mutex;
+  std::vector<CapturedCommand> pending_commands;
+  int64_t num_commands = 0;
+
+  std::mutex output_mutex;  // drain vs. finish
+  std::unique_ptr<juce::OutputStream> output;
+  std::unique_ptr<WriterThread> writer_thread;
+  int64_t num_blocks_written = 0;
+
+  JUCE_DECLARE_NON_COPYABLE(SessionCapture)
+};
+
+/**
+ * Reads a capture file record by record, in the order replay must apply
+ * them: each block's commands come before the block.
+ */
+class CaptureReader {
+ public:
+  enum class Record { Command, Block, End };
+
+  explicit CaptureReader(const juce::File &file);
+
+  /** False if the file is missing or not a capture. */
+  bool isValid() const { return valid; }
+  const CaptureHeader &getHeader() const { return header; }
+
+  /**
+   * Reads the next record into `command` or `block`.
+   * @return false at the end of the file, or if it is truncated.
+   */
+  bool readNext(Record &record, CapturedCommand &command, CapturedBlock &block);
+
+  /** Blocks the live run dropped, known once the End record is read. */
+  int64_t getDroppedBlocks() const { return dropped_blocks; }
+
+ private:
+  std::unique_ptr<juce::InputStream> input;
+  CaptureHeader header;
+  bool valid = false;
+  int64_t dropped_blocks = 0;
+
+  JUCE_DECLARE_NON_COPYABLE(CaptureReader)
+};
+
+}  // namespace celestrian
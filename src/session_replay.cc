@@ -0,0 +1,149 @@
+#include "session_replay.h"
+
+#include <map>
+
+#include "audio_engine.h"
+#include "session_capture.h"
+
+namespace celestrian {
+
+namespace {
+using UuidMap = std::map<juce::String, juce::String>;
+
+void applyCommand(AudioEngine &engine, const CapturedCommand &command,
+                  UuidMap &uuids) {
+  auto it = uuids.find(command.uuid);
+  const auto uuid = it != uuids.end() ? it->second : command.uuid;
+
+  switch (command.type) {
+    case CaptureCommandType::TogglePlayback:
+      engine.togglePlayback();
+      break;
+    case CaptureCommandType::StartRecording:
+      engine.startRecordingInNode(uuid);
+      break;
+    case CaptureCommandType::StopRecording:
+      engine.stopRecordingInNode(uuid);
+      break;
+    case CaptureCommandType::CreateNode: {
+      auto created = engine.createNode(command.text, command.x, command.y);
+      if (command.uuid.isNotEmpty()) uuids[command.uuid] = created;
+      break;
+    }
+    case CaptureCommandType::EnterBox:
+      engine.enterBox(uuid);
+      break;
+    case CaptureCommandType::ExitBox:
+      engine.exitBox();
+      break;
+    case CaptureCommandType::ToggleSolo:
+      engine.toggleSolo(uuid);
+      break;
+    case CaptureCommandType::TogglePlay:
+      engine.togglePlay(uuid);
+      break;
+    case CaptureCommandType::ToggleMute:
+      engine.toggleMute(uuid);
+      break;
+    case CaptureCommandType::SetNodeInput:
+      engine.setNodeInput(uuid, (int)command.first);
+      break;
+    case CaptureCommandType::SetLoopPoints:
+      engine.setLoopPoints(uuid, command.first, command.second);
+      break;
+    case CaptureCommandType::RemoveNode:
+      engine.removeNode(uuid);
+      break;
+  }
+}
+}  // namespace
+
+juce::var ReplayResult::toVar() const {
+  juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+  obj->setProperty("complete", complete);
+  obj->setProperty("identical", isIdentical());
+  if (error.isNotEmpty()) obj->setProperty("error", error);
+  obj->setProperty("blocks", (double)blocks);
+  obj->setProperty("commands", (double)commands);
+  obj->setProperty("samples", (double)samples);
+  obj->setProperty("mismatchedBlocks", (double)mismatched_blocks);
+  obj->setProperty("firstMismatchBlock", (double)first_mismatch_block);
+  obj->setProperty("droppedBlocks", (double)dropped_blocks);
+  obj->setProperty("renderMs", render_ms);
+  obj->setProperty("realtimeFactor", getRealtimeFactor());
+  return juce::var(obj.get());
+}
+
+ReplayResult replayCapture(const juce::File &file,
+                           const ReplayOptions &options) {
+  ReplayResult result;
+  CaptureReader reader(file);
+  if (!reader.isValid()) {
+    result.error = "Not a capture file: " + file.getFullPathName();
+    return result;
+  }
+
+  const auto &config = reader.getHeader().config;
+  result.sample_rate = config.sample_rate;
+
+  auto backend_owner = std::make_unique<OfflineDeviceBackend>(config);
+  auto &backend = *backend_owner;
+  AudioEngine engine(std::move(backend_owner));
+  engine.setInternalBlockSize(reader.getHeader().internal_block_size);
+
+  MetadataQuery root_query;
+  root_query.max_depth = 0;
+  UuidMap uuids{{reader.getHeader().root_uuid,
+                 engine.getGraphState(root_query)["id"].toString()}};
+
+  CapturedBlock block;
+  int64_t block_start = 0;
+  backend.setInputSignal([&](int channel, int64_t index) {
+    return block.input.getSample(channel, (int)(index - block_start));
+  });
+
+  CaptureReader::Record record;
+  CapturedCommand command;
+  while (reader.readNext(record, command, block)) {
+    if (record == CaptureReader::Record::End) {
+      result.complete = true;
+      break;
+    }
+    if (record == CaptureReader::Record::Command) {
+      applyCommand(engine, command, uuids);
+      ++result.commands;
+      continue;
+    }
+
+    block_start = backend.getSamplesRendered();
+    const double start_ms = juce::Time::getMillisecondCounterHiRes();
+    if (!backend.renderBlock(block.num_samples)) {
+      result.error = "Block " + juce::String(block.index) +
+                     " is larger than the device block size";
+      break;
+    }
+    result.render_ms += juce::Time::getMillisecondCounterHiRes() - start_ms;
+
+    const auto *const *output =
+        backend.getLastOutput().getArrayOfReadPointers();
+    if (hashAudioBlock(output, config.num_outputs, block.num_samples) !=
+        block.output_hash) {
+      if (result.mismatched_blocks++ == 0)
+        result.first_mismatch_block = block.index;
+    }
+    if (options.sink)
+      options.sink(output, config.num_outputs, block.num_samples);
+
+    ++result.blocks;
+    result.samples += block.num_samples;
+    if (options.stop_on_mismatch && result.mismatched_blocks > 0) break;
+  }
+
+  result.dropped_blocks = reader.getDroppedBlocks();
+  if (!result.complete && result.error.isEmpty() &&
+      !(options.stop_on_mismatch && result.mismatched_blocks > 0))
+    result.error = "Capture ends early (the live run didn't stop cleanly?)";
+  return result;
+}
+
+}  // namespace celestrian
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include "offline_device_backend.h"
+
+namespace celestrian {
+
+struct ReplayOptions {
+  /** Receives each replayed block, e.g. to write it to a WAV file. */
+  OfflineDeviceBackend::OutputSink sink;
+
+  /** Stop at the first block whose output differs from the live run. */
+  bool stop_on_mismatch = false;
+};
+
+struct ReplayResult {
+  bool complete = false;  // Read through to the end of the capture
+  juce::String error;
+  double sample_rate = 0.0;
+  int64_t blocks = 0;
+  int64_t commands = 0;
+  int64_t samples = 0;
+  int64_t mismatched_blocks = 0;
+  int64_t first_mismatch_block = -1;  // Live block index
+  int64_t dropped_blocks = 0;         // Lost by the live run
+  double render_ms = 0.0;             // Engine time, excluding decoding
+
+  /** True if every block matched a complete, lossless capture. */
+  bool isIdentical() const {
+    return complete && dropped_blocks == 0 && mismatched_blocks == 0;
+  }
+
+  /** Audio time rendered per unit of engine time. */
+  double getRealtimeFactor() const {
+    return render_ms > 0.0 ? 1000.0 * (double)samples / sample_rate / render_ms
+                           : 0.0;
+  }
+
+  juce::var toVar() const;
+};
+
+/**
+ * Replays a capture written by `AudioEngine::startCapture` through a fresh
+ * engine on an OfflineDeviceBackend shaped like the live device, as fast
+ * as it will go. Each command runs before the block it preceded live, with
+ * node uuids mapped to the nodes the replay creates, and each block's output
+ * is checked against the live run's hash.
+ *
+ * Replays are bit-identical on the machine and build that captured; a
+ * different compiler or CPU may round differently.
+ */
+ReplayResult replayCapture(const juce::File &file,
+                           const ReplayOptions &options = {});
+
+}  // namespace celestrian
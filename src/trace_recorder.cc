@@ -0,0 +1,212 @@
+#include "trace_recorder.h"
+
+#include <juce_events/juce_events.h>
+
+#include "realtime_checks.h"
+
+namespace celestrian {
+
+namespace {
+constexpr int kFlushIntervalMs = 50;
+
+thread_local const char* current_thread_name = nullptr;
+
+// Writes `text` as the body of a JSON string: quotes, backslashes and control
+// characters are escaped, other bytes (UTF-8 included) pass through.
+void writeJsonString(juce::OutputStream& out, const char* text) {
+  for (auto* c = text; *c != 0; ++c) {
+    auto byte = (unsigned char)*c;
+    if (byte == '"' || byte == '\\') {
+      out.writeByte('\\');
+      out.writeByte((char)byte);
+    } else if (byte < 0x20) {
+      out << "\\u" << juce::String::toHexString((int)byte).paddedLeft('0', 4);
+    } else {
+      out.writeByte((char)byte);
+    }
+  }
+}
+}  // namespace
+
+class TraceRecorder::FlushThread : public juce::Thread {
+ public:
+  explicit FlushThread(TraceRecorder& owner)
+      : juce::Thread("Celestrian Trace Flush"), recorder(owner) {}
+
+  void run() override {
+    while (!threadShouldExit()) {
+      recorder.drain();
+      wait(kFlushIntervalMs);
+    }
+  }
+
+ private:
+  TraceRecorder& recorder;
+};
+
+TraceRecorder& TraceRecorder::getInstance() {
+  static TraceRecorder instance;
+  return instance;
+}
+
+TraceRecorder::~TraceRecorder() { stop(); }
+
+bool TraceRecorder::start(const juce::File& file) {
+  std::lock_guard<std::mutex> lock(output_mutex);
+  if (output != nullptr) return false;
+
+  file.deleteFile();
+  auto stream = std::make_unique<juce::FileOutputStream>(file);
+  if (!stream->openedOk()) {
+    juce::Logger::writeToLog("TraceRecorder: cannot open " +
+                             file.getFullPathName());
+    return false;
+  }
+
+  // Discard anything recorded after a previous stop()
+  {
+    std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+    for (auto& buffer : buffers) {
+      buffer->read_count.store(buffer->write_count.load());
+      buffer->dropped.store(0);
+    }
+  }
+
+  output = std::move(stream);
+  *output << "[\n";
+  wrote_first_event = false;
+  start_ticks = juce::Time::getHighResolutionTicks();
+
+  flush_thread = std::make_unique<FlushThread>(*this);
+  flush_thread->startThread(juce::Thread::Priority::low);
+  enabled.store(true);
+
+  juce::Logger::writeToLog("TraceRecorder: tracing to " +
+                           file.getFullPathName());
+  return true;
+}
+
+int64_t TraceRecorder::stop() {
+  if (flush_thread == nullptr) return 0;
+
+  enabled.store(false);
+  flush_thread->stopThread(1000);
+  flush_thread.reset();
+  drain();
+
+  int64_t dropped = 0;
+  std::lock_guard<std::mutex> lock(output_mutex);
+  {
+    std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+    for (auto& buffer : buffers) {
+      dropped += buffer->dropped.load();
+      // Thread names as metadata events, so the viewer labels each track
+      if (auto* name = buffer->name.load()) {
+        auto* args = new juce::DynamicObject();
+        args->setProperty("name", juce::String(name));
+        auto* meta = new juce::DynamicObject();
+        meta->setProperty("ph", "M");
+        meta->setProperty("name", "thread_name");
+        meta->setProperty("pid", 1);
+        meta->setProperty("tid", buffer->tid);
+        meta->setProperty("args", juce::var(args));
+        *output << (wrote_first_event ? ",\n" : "")
+                << juce::JSON::toString(juce::var(meta), true);
+        wrote_first_event = true;
+      }
+    }
+  }
+
+  *output << "\n]\n";
+  output->flush();
+  output.reset();
+
+  juce::Logger::writeToLog("TraceRecorder: stopped (" + juce::String(dropped) +
+                           " events dropped)");
+  return dropped;
+}
+
+const char* TraceRecorder::intern(const juce::String& name) {
+  static std::mutex intern_mutex;
+  static std::set<std::string> interned;
+  std::lock_guard<std::mutex> lock(intern_mutex);
+  return interned.insert(name.toStdString()).first->c_str();
+}
+
+void TraceRecorder::nameCurrentThread(const char* name) {
+  if (current_thread_name == name) return;
+  current_thread_name = name;
+  if (isEnabled()) getInstance().getBufferForCurrentThread().name.store(name);
+}
+
+void TraceRecorder::record(char phase, const char* category,
+                           const char* name) {
+  auto& buffer = getInstance().getBufferForCurrentThread();
+  buffer.push({category, name, juce::Time::getHighResolutionTicks(), phase});
+}
+
+TraceRecorder::ThreadBuffer& TraceRecorder::getBufferForCurrentThread() {
+  thread_local ThreadBuffer* buffer = nullptr;
+  if (buffer != nullptr) return *buffer;
+
+  // One-off per thread, and only while tracing: accepted on the audio thread
+  realtime::ScopedAllowViolations allow_setup;
+  std::lock_guard<std::mutex> lock(buffers_mutex);
+  buffers.push_back(std::make_unique<ThreadBuffer>((int)buffers.size() + 1));
+  buffer = buffers.back().get();
+
+  const char* name = current_thread_name;
+  if (name == nullptr) {
+    if (juce::MessageManager::existsAndIsCurrentThread())
+      name = "Message Thread";
+    else if (auto* thread = juce::Thread::getCurrentThread())
+      name = intern(thread->getThreadName());
+  }
+  buffer->name.store(name);
+  return *buffer;
+}
+
+bool TraceRecorder::ThreadBuffer::push(const Event& event) {
+  auto write = write_count.load(std::memory_order_relaxed);
+  if (write - read_count.load(std::memory_order_acquire) >= kCapacity) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  events[write % kCapacity] = event;
+  write_count.store(write + 1, std::memory_order_release);
+  return true;
+}
+
+void TraceRecorder::drain() {
+  std::lock_guard<std::mutex> lock(output_mutex);
+  if (output == nullptr) return;
+
+  std::lock_guard<std::mutex> buffers_lock(buffers_mutex);
+  for (auto& buffer : buffers) {
+    auto read = buffer->read_count.load(std::memory_order_relaxed);
+    auto write = buffer->write_count.load(std::memory_order_acquire);
+    for (; read < write; ++read)
+      writeEvent(*buffer, buffer->events[read % ThreadBuffer::kCapacity]);
+    buffer->read_count.store(read, std::memory_order_release);
+  }
+  output->flush();
+}
+
+void TraceRecorder::writeEvent(const ThreadBuffer& buffer,
+                               const Event& event) {
+  auto ts_us = juce::Time::highResolutionTicksToSeconds(event.ticks -
+                                                        start_ticks) *
+               1.0e6;
+  // Events are hand-formatted: building a DynamicObject per event would
+  // dominate the flush. Node names are user text, so strings are escaped.
+  *output << (wrote_first_event ? ",\n" : "") << "{\"ph\":\"" << event.phase
+          << "\",\"cat\":\"";
+  writeJsonString(*output, event.category);
+  *output << "\",\"name\":\"";
+  writeJsonString(*output, event.name);
+  *output << "\",\"pid\":1,\"tid\":" << buffer.tid
+          << ",\"ts\":" << juce::String(ts_us, 3) << "}";
+  wrote_first_event = true;
+}
+
+}  // namespace celestrian
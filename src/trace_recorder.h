@@ -0,0 +1,139 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace celestrian {
+
+/**
+ * Opt-in timeline tracing in Chrome trace-event format (opens in Perfetto or
+ * chrome://tracing).
+ *
+ * Each thread records begin/end events into its own single-producer ring, so
+ * tracing never takes a lock on the hot path. A background thread drains the
+ * rings into a JSON file. Event names must outlive the trace: use string
+ * literals, or `intern()` for dynamic names (node names, bridge functions).
+ *
+ * The first event on a thread allocates that thread's ring. While tracing is
+ * off, a scope costs one relaxed atomic load.
+ */
+class TraceRecorder {
+ public:
+  static TraceRecorder& getInstance();
+
+  static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+  /**
+   * Starts writing a trace to `file`, replacing any existing file.
+   * @return false if a trace is already running or the file can't be opened.
+   */
+  bool start(const juce::File& file);
+
+  /**
+   * Stops tracing, drains every ring and closes the file.
+   * @return The number of events dropped because a ring was full.
+   */
+  int64_t stop();
+
+  /**
+   * Returns a stable C string equal to `name`. Interned strings are never
+   * freed. Not for the audio thread.
+   */
+  static const char* intern(const juce::String& name);
+
+  /**
+   * Labels the calling thread in the trace (e.g. "Audio Device"). `name` must
+   * be a string literal.
+   */
+  static void nameCurrentThread(const char* name);
+
+  /** Records a begin ('B') or end ('E') event on the calling thread. */
+  static void record(char phase, const char* category, const char* name);
+
+  ~TraceRecorder();
+
+ private:
+  struct Event {
+    const char* category;
+    const char* name;
+    juce::int64 ticks;
+    char phase;
+  };
+
+  // Single-producer (owning thread), single-consumer (flush thread) ring
+  struct ThreadBuffer {
+    static constexpr int kCapacity = 1 << 15;
+
+    explicit ThreadBuffer(int tid) : tid(tid), events(kCapacity) {}
+
+    bool push(const Event& event);
+
+    const int tid;
+    std::atomic<const char*> name{nullptr};
+    std::vector<Event> events;
+    std::atomic<uint64_t> write_count{0};
+    std::atomic<uint64_t> read_count{0};
+    std::atomic<int64_t> dropped{0};
+  };
+
+  class FlushThread;
+
+  TraceRecorder() = default;
+
+  ThreadBuffer& getBufferForCurrentThread();
+  void drain();
+  void writeEvent(const ThreadBuffer& buffer, const Event& event);
+
+  static inline std::atomic<bool> enabled{false};
+
+  std::mutex buffers_mutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+  std::mutex output_mutex;  // start/stop vs. drain
+  std::unique_ptr<juce::FileOutputStream> output;
+  std::unique_ptr<FlushThread> flush_thread;
+  juce::int64 start_ticks = 0;
+  bool wrote_first_event = false;
+
+  JUCE_DECLARE_NON_COPYABLE(TraceRecorder)
+};
+
+/**
+ * Records a begin event now and the matching end event when destroyed.
+ */
+class ScopedTrace {
+ public:
+  ScopedTrace(const char* category, const char* name)
+      : category(category), name(name), active(TraceRecorder::isEnabled()) {
+    if (active) TraceRecorder::record('B', category, name);
+  }
+
+  ~ScopedTrace() {
+    if (active) TraceRecorder::record('E', category, name);
+  }
+
+ private:
+  const char* category;
+  const char* name;
+  const bool active;
+
+  JUCE_DECLARE_NON_COPYABLE(ScopedTrace)
+};
+
+}  // namespace celestrian
+
+#define CELESTRIAN_TRACE_CONCAT_INNER(a, b) a##b
+#define CELESTRIAN_TRACE_CONCAT(a, b) CELESTRIAN_TRACE_CONCAT_INNER(a, b)
+
+/**
+ * Traces the rest of the enclosing scope as one slice on the timeline.
+ */
+#define CELESTRIAN_TRACE_SCOPE(category, name)           \
+  ::celestrian::ScopedTrace CELESTRIAN_TRACE_CONCAT(     \
+      celestrian_trace_scope_, __LINE__)(category, name)
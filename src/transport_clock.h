@@ -0,0 +1,95 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <cstdint>
+
+namespace celestrian {
+
+/**
+ * Where the transport was at a known instant. The UI extrapolates playheads
+ * from the latest anchor instead of polling for every frame.
+ */
+struct TransportAnchor {
+  // Master position of the first sample of the anchored block
+  int64_t master_position = 0;
+  // Length at which the master position wraps (LCM timeline), 0 if unknown
+  int64_t timeline_length = 0;
+  double sample_rate = 44100.0;
+  // Device host time of the block, 0 if the driver does not provide one
+  uint64_t host_time_ns = 0;
+  // When the block started, on the TransportClock::nowNs() clock
+  uint64_t anchor_time_ns = 0;
+  int output_latency = 0;
+  bool is_playing = false;
+};
+
+/**
+ * Single-writer transport snapshot. The audio thread publishes one anchor per
+ * block without blocking; readers on any thread get a consistent copy
+ * (sequence-lock: readers retry if a write raced with them).
+ */
+class TransportClock {
+ public:
+  /**
+   * Publishes a new anchor. Audio thread only; wait-free.
+   */
+  void publish(const TransportAnchor& anchor) {
+    auto next = sequence.load(std::memory_order_relaxed) + 1;
+    sequence.store(next, std::memory_order_relaxed);  // odd: write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+
+    master_position.store(anchor.master_position, std::memory_order_relaxed);
+    timeline_length.store(anchor.timeline_length, std::memory_order_relaxed);
+    sample_rate.store(anchor.sample_rate, std::memory_order_relaxed);
+    host_time_ns.store(anchor.host_time_ns, std::memory_order_relaxed);
+    anchor_time_ns.store(anchor.anchor_time_ns, std::memory_order_relaxed);
+    output_latency.store(anchor.output_latency, std::memory_order_relaxed);
+    is_playing.store(anchor.is_playing, std::memory_order_relaxed);
+
+    sequence.store(next + 1, std::memory_order_release);
+  }
+
+  /**
+   * Returns the latest consistent anchor. Safe from any thread.
+   */
+  TransportAnchor read() const {
+    TransportAnchor anchor;
+    uint32_t before = 0, after = 0;
+    do {
+      before = sequence.load(std::memory_order_acquire);
+      anchor.master_position = master_position.load(std::memory_order_relaxed);
+      anchor.timeline_length = timeline_length.load(std::memory_order_relaxed);
+      anchor.sample_rate = sample_rate.load(std::memory_order_relaxed);
+      anchor.host_time_ns = host_time_ns.load(std::memory_order_relaxed);
+      anchor.anchor_time_ns = anchor_time_ns.load(std::memory_order_relaxed);
+      anchor.output_latency = output_latency.load(std::memory_order_relaxed);
+      anchor.is_playing = is_playing.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence.load(std::memory_order_relaxed);
+    } while ((before & 1u) != 0 || before != after);
+    return anchor;
+  }
+
+  /**
+   * Monotonic clock used for `anchor_time_ns`. Readers compare it with the
+   * anchor to know how old the anchor is.
+   */
+  static uint64_t nowNs() {
+    auto ticks = juce::Time::getHighResolutionTicks();
+    return (uint64_t)(juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e9);
+  }
+
+ private:
+  std::atomic<uint32_t> sequence{0};
+  std::atomic<int64_t> master_position{0};
+  std::atomic<int64_t> timeline_length{0};
+  std::atomic<double> sample_rate{44100.0};
+  std::atomic<uint64_t> host_time_ns{0};
+  std::atomic<uint64_t> anchor_time_ns{0};
+  std::atomic<int> output_latency{0};
+  std::atomic<bool> is_playing{false};
+};
+
+}  // namespace celestrian
@@ -0,0 +1,19 @@
+#include "transport_scheduler.h"
+
+namespace celestrian {
+
+bool TransportScheduler::schedule(const TransportEvent &event) {
+  if (num_events >= kCapacity) return false;
+
+  // Insertion sort from the back: after any events due at the same time
+  int i = num_events;
+  while (i > 0 && events[(size_t)i - 1].time > event.time) {
+    events[(size_t)i] = events[(size_t)i - 1];
+    --i;
+  }
+  events[(size_t)i] = event;
+  setNumEvents(num_events + 1);
+  return true;
+}
+
+}  // namespace celestrian
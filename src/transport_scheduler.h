@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+namespace celestrian {
+
+class AudioNode;
+
+enum class TransportEventType {
+  StartRecording,
+  StopRecording,
+  StartPlayback,
+  StopPlayback,
+  Mute,
+  Unmute,
+};
+
+/**
+ * A transition due at an exact sample. `time` counts samples the engine has
+ * rendered (ProcessContext::sample_time), so it never wraps with the
+ * timeline; `value` is the event's argument, e.g. the quantum boundary a
+ * recording starts on.
+ */
+struct TransportEvent {
+  int64_t time = 0;
+  TransportEventType type = TransportEventType::StartRecording;
+  AudioNode *target = nullptr;
+  int64_t value = 0;
+};
+
+/**
+ * The engine's queue of timed transport events, kept sorted by time (events
+ * due at the same sample keep the order they were scheduled in). The engine
+ * splits each block at the next event, so every event lands on its exact
+ * sample and nodes waiting on a boundary don't have to check for it every
+ * block.
+ *
+ * Audio thread only: nodes schedule from process(), the engine dispatches
+ * between slices. Fixed capacity, so it never allocates.
+ */
+class TransportScheduler {
+ public:
+  static constexpr int kCapacity = 256;
+  static constexpr int64_t kNoEvent = std::numeric_limits<int64_t>::max();
+
+  /**
+   * Queues an event. Returns false if the queue is full; the caller should
+   * then fall back to checking for its boundary itself.
+   */
+  bool schedule(const TransportEvent &event);
+
+  /** Time of the earliest pending event, or kNoEvent. */
+  int64_t getNextEventTime() const {
+    return num_events > 0 ? events[0].time : kNoEvent;
+  }
+
+  /**
+   * Removes every event due at or before `time`, in order, and passes each
+   * to `dispatch`. Events dispatched may schedule new ones.
+   */
+  template <typename Dispatch>
+  void dispatchDue(int64_t time, Dispatch &&dispatch) {
+    while (num_events > 0 && events[0].time <= time) {
+      const auto event = events[0];
+      for (int i = 1; i < num_events; ++i)
+        events[(size_t)i - 1] = events[(size_t)i];
+      setNumEvents(num_events - 1);
+      dispatch(event);
+    }
+  }
+
+  /**
+   * Drops every pending event `should_remove` returns true for, keeping the
+   * rest in order, e.g. those targeting a removed node.
+   */
+  template <typename Predicate>
+  void removeIf(Predicate &&should_remove) {
+    int kept = 0;
+    for (int i = 0; i < num_events; ++i) {
+      if (!should_remove(events[(size_t)i]))
+        events[(size_t)kept++] = events[(size_t)i];
+    }
+    setNumEvents(kept);
+  }
+
+  /** Drops every pending event, e.g. when the graph is replaced. */
+  void clear() { setNumEvents(0); }
+
+  /** Pending events. Safe from any thread. */
+  int getNumPending() const {
+    return num_pending.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void setNumEvents(int count) {
+    num_events = count;
+    num_pending.store(count, std::memory_order_relaxed);
+  }
+
+  std::array<TransportEvent, kCapacity> events;
+  int num_events = 0;
+  std::atomic<int> num_pending{0};
+};
+
+}  // namespace celestrian
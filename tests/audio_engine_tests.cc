@@ -1,8 +1,12 @@
 #include <juce_core/juce_core.h>
 
+#include <atomic>
+#include <vector>
+
 #include "../src/audio_engine.h"
 #include "../src/box_node.h"
 #include "../src/clip_node.h"
+#include "../src/trace_recorder.h"
 
 namespace celestrian {
 
@@ -204,6 +208,170 @@ class AudioEngineTests : public juce::UnitTest {
       phase = (pos + clip3_launch_point) % clip3_duration;
       expectEquals(phase, (int64_t)(6 * Q));
     }
+
+    beginTest("Transport Clock: Anchor Per Block");
+    {
+      AudioEngine engine;
+      engine.togglePlayback();
+
+      const int block_size = 512;
+      std::vector<float> left(block_size, 0.0f), right(block_size, 0.0f);
+      float* outputs[] = {left.data(), right.data()};
+
+      uint64_t host_time = 123456789;
+      juce::AudioIODeviceCallbackContext context;
+      context.hostTimeNs = &host_time;
+
+      auto before = TransportClock::nowNs();
+      engine.audioDeviceIOCallbackWithContext(nullptr, 0, outputs, 2,
+                                              block_size, context);
+      engine.audioDeviceIOCallbackWithContext(nullptr, 0, outputs, 2,
+                                              block_size, context);
+
+      auto clock = engine.getTransportClock();
+      // The anchor describes the start of the last rendered block
+      expectEquals((int64_t)clock["masterPos"], (int64_t)block_size);
+      expect((bool)clock["isPlaying"]);
+      expectEquals((double)clock["hostTimeNs"], (double)host_time);
+      expect((double)clock["sampleRate"] > 0.0);
+      expect((double)clock["anchorTimeNs"] >= (double)before);
+      expect((double)clock["nowNs"] >= (double)clock["anchorTimeNs"]);
+
+      auto state = engine.getGraphState();
+      expect(state["transport"].isObject(),
+             "Graph state should carry the transport anchor");
+    }
+
+    beginTest("Transport Clock: Read Returns Last Published Anchor");
+    {
+      TransportClock clock;
+      TransportAnchor anchor;
+      anchor.master_position = 96000;
+      anchor.timeline_length = 176400;
+      anchor.sample_rate = 48000.0;
+      anchor.output_latency = 256;
+      anchor.is_playing = true;
+      clock.publish(anchor);
+
+      auto read = clock.read();
+      expectEquals(read.master_position, anchor.master_position);
+      expectEquals(read.timeline_length, anchor.timeline_length);
+      expectEquals(read.sample_rate, anchor.sample_rate);
+      expectEquals(read.output_latency, anchor.output_latency);
+      expect(read.is_playing);
+    }
+
+    beginTest("Session: Replace Root Node");
+    {
+      AudioEngine engine;
+      engine.createNode("box");
+      auto box_id = engine.getGraphState()["nodes"][0]["id"].toString();
+      engine.enterBox(box_id);
+
+      auto root = std::make_unique<BoxNode>("Loaded Session");
+      auto clip = std::make_unique<ClipNode>("Loaded Clip", 44100.0);
+      auto clip_id = clip->getUuid();
+      root->addChild(std::move(clip));
+      auto root_id = root->getUuid();
+      engine.setRootNode(std::move(root));
+
+      // Focus is back at the new root, whatever was entered before
+      auto state = engine.getGraphState();
+      expectEquals(state["focusedId"].toString(), root_id);
+      expectEquals(state["nodes"].size(), 1);
+      expectEquals(state["nodes"][0]["id"].toString(), clip_id);
+    }
+
+    beginTest("Session: Replacing The Root Waits For Graph Queries");
+    {
+      AudioEngine engine;
+      engine.createNode("clip");
+
+      // A bridge-style query already walking the graph on a worker
+      std::atomic<bool> started{false};
+      auto query = engine.getJobSystem().schedule(
+          [&engine, &started](JobSystem::JobContext &) {
+            started.store(true);
+            juce::Thread::sleep(50);
+            return engine.getMemoryUsage();
+          });
+      engine.addGraphQueryJob(query);
+      while (!started.load()) juce::Thread::sleep(1);
+
+      engine.setRootNode(std::make_unique<BoxNode>("Loaded Session"));
+      expect(query->isDone(), "The old root outlives queries reading it.");
+    }
+
+    beginTest("Tracing: Node Labels Are Interned Only While Tracing");
+    {
+      AudioEngine engine;
+      auto root = std::make_unique<BoxNode>("Traced Session");
+      auto clip = std::make_unique<ClipNode>("Traced Clip", 44100.0);
+      auto *root_ptr = root.get();
+      auto *clip_ptr = clip.get();
+      root->addChild(std::move(clip));
+      engine.setRootNode(std::move(root));
+      expectEquals(juce::String(clip_ptr->getTraceLabel()), juce::String());
+
+      juce::TemporaryFile temp(".json");
+      expect(engine.startTrace(temp.getFile()));
+      expectEquals(juce::String(root_ptr->getTraceLabel()),
+                   juce::String("Traced Session"));
+      expectEquals(juce::String(clip_ptr->getTraceLabel()),
+                   juce::String("Traced Clip"));
+      TraceRecorder::getInstance().stop();
+
+      clip_ptr->setName("Renamed Clip");
+      expectEquals(juce::String(clip_ptr->getTraceLabel()), juce::String());
+    }
+
+    beginTest("Memory Accounting: Per-Node Totals And Budget");
+    {
+      AudioEngine engine;
+      engine.createNode("clip");
+      engine.createNode("box");
+
+      auto usage = engine.getMemoryUsage();
+      auto *nodes = usage["nodes"].getArray();
+      expect(nodes != nullptr);
+      expectEquals(nodes->size(), 3);  // root, clip, box
+
+      // A clip holds its 60 s recording buffer whether or not it has audio
+      const double clip_audio_bytes = 44100.0 * 60.0 * sizeof(float);
+      auto clip = (*nodes)[1];
+      expectEquals(clip["type"].toString(), juce::String("clip"));
+      expectEquals((double)clip["audioBytes"], clip_audio_bytes);
+      expectEquals((double)clip["audioUsedBytes"], 0.0);
+
+      // Boxes total their subtree plus their own mix buffer
+      auto root = (*nodes)[0];
+      auto box = (*nodes)[2];
+      expect((double)box["scratchBytes"] > 0.0);
+      expectEquals((double)root["totalBytes"],
+                   (double)root["scratchBytes"] + clip_audio_bytes +
+                       (double)box["totalBytes"]);
+      expectEquals((double)usage["totalBytes"], (double)root["totalBytes"]);
+      expectEquals(usage["status"].toString(), juce::String("ok"));
+
+      // Graph state carries only the cached session total, not per-node
+      // figures that would re-walk every box on each poll
+      auto graph_state = engine.getGraphState();
+      expectEquals((double)graph_state["memory"]["totalBytes"],
+                   (double)usage["totalBytes"]);
+      expect(!graph_state["nodes"][0].getDynamicObject()->hasProperty(
+          "memory"));
+
+      // A budget below the session total flags it everywhere
+      engine.setMemoryBudget(1024 * 1024);
+      expectEquals(engine.getMemoryUsage()["status"].toString(),
+                   juce::String("overBudget"));
+      expectEquals(engine.getGraphState()["memory"]["status"].toString(),
+                   juce::String("overBudget"));
+
+      engine.setMemoryBudget((int64_t)(clip_audio_bytes * 1.1));
+      expectEquals(engine.getMemoryUsage()["status"].toString(),
+                   juce::String("warning"));
+    }
   }
 };
 
@@ -0,0 +1,118 @@
+#include <juce_core/juce_core.h>
+
+#include <cstdint>
+
+#include "../src/audio_memory_arena.h"
+#include "../src/clip_node.h"
+
+namespace celestrian {
+
+class AudioMemoryArenaTests : public juce::UnitTest {
+ public:
+  AudioMemoryArenaTests()
+      : juce::UnitTest("AudioMemoryArena", "Audio Engine") {}
+
+  void runTest() override {
+    beginTest("Unreserved Arena Allocates Nothing");
+    {
+      AudioMemoryArena arena;
+      expect(!arena.isReserved());
+      expect(arena.allocate(64) == nullptr);
+      expectEquals(arena.getStats().capacity_bytes, (int64_t)0);
+    }
+
+    beginTest("Allocations Are Aligned, Zeroed And Counted");
+    {
+      AudioMemoryArena arena;
+      expect(arena.reserve(1 << 20));
+      expect(!arena.reserve(1 << 20));  // Only once
+      const int64_t capacity = arena.getStats().capacity_bytes;
+      expect(capacity >= (1 << 20));
+
+      float *first = arena.allocate(100);
+      float *second = arena.allocate(1000);
+      expect(first != nullptr && second != nullptr);
+      expectEquals((int)((uintptr_t)first % AudioMemoryArena::kAlignment), 0);
+      expectEquals((int)((uintptr_t)second % AudioMemoryArena::kAlignment),
+                   0);
+
+      // 100 floats round up to a whole number of cache lines
+      auto stats = arena.getStats();
+      expectEquals(stats.used_bytes, (int64_t)(448 + 4032));
+      expectEquals(stats.num_allocations, 2);
+
+      // Reused storage comes back zeroed
+      first[0] = 1.0f;
+      arena.free(first);
+      first = arena.allocate(100);
+      expectEquals(first[0], 0.0f);
+
+      arena.free(first);
+      arena.free(second);
+      stats = arena.getStats();
+      expectEquals(stats.used_bytes, (int64_t)0);
+      expectEquals(stats.peak_used_bytes, (int64_t)(448 + 4032));
+
+      // Freed blocks merge back into one
+      expectEquals(stats.largest_free_bytes, capacity);
+      float *all = arena.allocate(capacity / (int64_t)sizeof(float));
+      expect(all != nullptr);
+      arena.free(all);
+    }
+
+    beginTest("Full Arena Falls Back");
+    {
+      AudioMemoryArena arena;
+      expect(arena.reserve(1 << 20));
+      const int64_t capacity = arena.getStats().capacity_bytes;
+      float *all = arena.allocate(capacity / (int64_t)sizeof(float));
+      expect(all != nullptr);
+      expect(arena.allocate(1) == nullptr);
+      expectEquals(arena.getStats().failed_allocations, (int64_t)1);
+      arena.free(all);
+    }
+
+    beginTest("Clips Record And Play From The Arena");
+    {
+      AudioMemoryArena arena;
+      expect(arena.reserve(64 << 20));
+      {
+        ClipNode clip("Clip", 44100.0, &arena);
+        expect(clip.usesArena());
+        expect(arena.getStats().used_bytes > 0);
+
+        float input[64];
+        for (int i = 0; i < 64; ++i) input[i] = 0.25f;
+        float *const inputs[] = {input};
+        ProcessContext context;
+        context.num_samples = 64;
+        context.is_recording = true;
+        clip.startRecording();
+        clip.process(inputs, nullptr, 1, 0, context);
+        clip.stopRecording();
+        expectEquals(clip.getWritePosition(), 64);
+        expectEquals((float)clip.getWaveform(1)[0], 0.25f);
+
+        clip.startPlayback();
+        expect(clip.isPlaying());
+        float output[64] = {};
+        float *const outputs[] = {output};
+        ProcessContext play_context;
+        play_context.num_samples = 64;
+        play_context.is_playing = true;
+        clip.process(nullptr, outputs, 0, 1, play_context);
+      }
+      expectEquals(arena.getStats().used_bytes, (int64_t)0);
+
+      // Too big for the arena: the clip uses the heap instead
+      AudioMemoryArena small;
+      expect(small.reserve(4096));
+      ClipNode clip("Clip", 44100.0, &small);
+      expect(!clip.usesArena());
+    }
+  }
+};
+
+static AudioMemoryArenaTests audioMemoryArenaTests;
+
+}  // namespace celestrian
@@ -0,0 +1,124 @@
+#include <juce_core/juce_core.h>
+
+#include <vector>
+
+#include "../src/audio_engine.h"
+#include "../src/block_size_adapter.h"
+#include "../src/offline_device_backend.h"
+
+namespace celestrian {
+
+class BlockSizeAdapterTests : public juce::UnitTest {
+ public:
+  BlockSizeAdapterTests()
+      : juce::UnitTest("BlockSizeAdapter", "Audio Engine") {}
+
+  void runTest() override {
+    beginTest("Odd Device Blocks Become Fixed Blocks");
+    {
+      BlockSizeAdapter adapter;
+      adapter.prepare(64, 100, 1, 1);
+      expectEquals(adapter.getLatency(), 60);  // 64 - gcd(64, 100)
+
+      auto result = passThrough(adapter, {100, 100, 100, 100, 100, 100});
+      expect(result.fixed_blocks_only, "Every render should be 64 samples");
+      expect(result.delayed_by == adapter.getLatency(),
+             "Output should be the input, delayed by the latency");
+      expectEquals(adapter.getUnderruns(), (int64_t)0);
+    }
+
+    beginTest("Multiples Of The Block Size Add No Latency");
+    {
+      BlockSizeAdapter adapter;
+      adapter.prepare(32, 128, 1, 1);
+      expectEquals(adapter.getLatency(), 0);
+      auto result = passThrough(adapter, {128, 128, 128});
+      expect(result.fixed_blocks_only);
+      expectEquals(result.delayed_by, 0);
+    }
+
+    beginTest("An Unexpected Block Size Pads Once");
+    {
+      BlockSizeAdapter adapter;
+      adapter.prepare(64, 128, 1, 1);
+      // 100 samples can't all be rendered yet: pad, then stay continuous
+      auto result = passThrough(adapter, {128, 100, 128, 128, 128}, 228);
+      expectEquals(adapter.getUnderruns(), (int64_t)1);
+      expectEquals(adapter.getLatency(), 36);
+      expect(result.fixed_blocks_only);
+      expectEquals(result.delayed_by, 36);
+    }
+
+    beginTest("Engine Reports The Adapter Latency");
+    {
+      DeviceConfig config;
+      config.block_size = 100;
+      config.output_latency = 10;
+      AudioEngine engine(std::make_unique<OfflineDeviceBackend>(config));
+      auto &backend =
+          static_cast<OfflineDeviceBackend &>(engine.getDeviceBackend());
+
+      engine.setInternalBlockSize(64);
+      expectEquals(engine.getInternalBlockSize(), 64);
+      expectEquals(engine.getOutputLatency(), 70);
+
+      engine.togglePlayback();
+      expectEquals(backend.renderBlocks(8), 8);
+      auto clock = engine.getTransportClock();
+      expectEquals((int)clock["outputLatency"], 70);
+      // The transport only moves in whole internal blocks
+      expectEquals((int64_t)(double)engine.getGraphState()["masterPos"] % 64,
+                   (int64_t)0);
+
+      engine.setInternalBlockSize(0);
+      expectEquals(engine.getOutputLatency(), 10);
+    }
+  }
+
+ private:
+  struct PassThroughResult {
+    bool fixed_blocks_only = true;
+    int delayed_by = -1;  // -1: output isn't a delayed copy of the input
+  };
+
+  // Feeds a ramp through an identity render in device blocks of the given
+  // sizes and works out how far behind the input the output is, checking
+  // from output sample `check_from` on.
+  static PassThroughResult passThrough(BlockSizeAdapter &adapter,
+                                       const std::vector<int> &block_sizes,
+                                       int check_from = 0) {
+    PassThroughResult result;
+    std::vector<float> input, output;
+    float next = 1.0f;
+    for (int num_samples : block_sizes) {
+      std::vector<float> in((size_t)num_samples), out((size_t)num_samples);
+      for (auto &sample : in) sample = next++;
+      const float *inputs[] = {in.data()};
+      float *outputs[] = {out.data()};
+      adapter.process(inputs, 1, outputs, 1, num_samples,
+                      [&](const float *const *render_in, int,
+                          float *const *render_out, int, int render_samples) {
+                        result.fixed_blocks_only &=
+                            render_samples == adapter.getBlockSize();
+                        juce::FloatVectorOperations::copy(
+                            render_out[0], render_in[0], render_samples);
+                      });
+      input.insert(input.end(), in.begin(), in.end());
+      output.insert(output.end(), out.begin(), out.end());
+    }
+
+    // The ramp counts samples, so the last ones give the delay
+    const int delay = (int)(input.back() - output.back());
+    for (int i = 0; i < (int)output.size(); ++i) {
+      const float expected =
+          i < delay ? 0.0f : input[(size_t)(i - delay)];
+      if (i >= check_from && output[(size_t)i] != expected) return result;
+    }
+    result.delayed_by = delay;
+    return result;
+  }
+};
+
+static BlockSizeAdapterTests blockSizeAdapterTests;
+
+}  // namespace celestrian
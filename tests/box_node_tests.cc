@@ -4,6 +4,25 @@
 
 namespace celestrian {
 
+namespace {
+// An audible leaf that counts how often it is asked about silence
+class CountingNode : public AudioNode {
+public:
+  CountingNode() : AudioNode("Counting") {}
+  void process(const float *const *, float *const *, int, int,
+               const ProcessContext &) override {}
+  juce::var getWaveform(int) const override { return {}; }
+  NodeType getNodeType() const override { return NodeType::Unknown; }
+  float getCurrentPeak() const override { return 0.0f; }
+  int64_t getIntrinsicDuration() const override { return 0; }
+  bool isSilentFor(const ProcessContext &) const override {
+    ++num_checks;
+    return false;
+  }
+  mutable int num_checks = 0;
+};
+}  // namespace
+
 class BoxNodeTests : public juce::UnitTest {
 public:
   BoxNodeTests() : juce::UnitTest("BoxNode", "Audio Engine") {}
@@ -53,6 +72,8 @@ public:
       clip2->process(inputs2, nullptr, 1, 0, recCtx);
       clip2->stopRecording();
 
+      auto *clip1Ptr = clip1.get();
+      auto *clip2Ptr = clip2.get();
       root.addChild(std::move(clip1));
       root.addChild(std::move(clip2));
 
@@ -69,8 +90,8 @@ public:
       playCtx.is_playing = true;
 
       // Start playback on both children
-      static_cast<ClipNode *>(root.getChild(0))->startPlayback();
-      static_cast<ClipNode *>(root.getChild(1))->startPlayback();
+      clip1Ptr->startPlayback();
+      clip2Ptr->startPlayback();
 
       root.process(nullptr, outputs, 0, 2, playCtx);
 
@@ -174,7 +195,7 @@ public:
       ProcessContext playCtx;
       playCtx.num_samples = 10;
       playCtx.is_playing = true;
-      playCtx.solo_node_uuid = ""; // No solo
+      playCtx.solo_node = nullptr; // No solo
 
       root.process(nullptr, outputs, 0, 2, playCtx);
       expect(std::abs(outL[0] - 1.0f) < 0.0001f,
@@ -185,12 +206,237 @@ public:
         outL[i] = 0.0f;
         outR[i] = 0.0f;
       }
-      playCtx.solo_node_uuid = clip1Ptr->getUuid();
+      playCtx.solo_node = clip1Ptr;
 
       root.process(nullptr, outputs, 0, 2, playCtx);
       expect(std::abs(outL[0] - 0.3f) < 0.0001f,
              "With clip1 soloed, only clip1 should play.");
     }
+
+    beginTest("Depth-Limited Metadata");
+    {
+      BoxNode root("Root");
+      auto sub = std::make_unique<BoxNode>("SubBox");
+      auto *subPtr = sub.get();
+      auto clip = std::make_unique<ClipNode>("Clip", 44100.0);
+
+      float in[10];
+      for (int i = 0; i < 10; ++i)
+        in[i] = 0.4f;
+      float *const ins[] = {in};
+      ProcessContext recCtx;
+      recCtx.num_samples = 10;
+      recCtx.is_recording = true;
+      clip->startRecording();
+      clip->process(ins, nullptr, 1, 0, recCtx);
+      clip->stopRecording();
+
+      subPtr->addChild(std::move(clip));
+      root.addChild(std::move(sub));
+
+      // One processed block refreshes the cached aggregates
+      float outL[10] = {0.0f};
+      float outR[10] = {0.0f};
+      float *const outputs[] = {outL, outR};
+      ProcessContext playCtx;
+      playCtx.num_samples = 10;
+      playCtx.is_playing = true;
+      root.process(nullptr, outputs, 0, 2, playCtx);
+
+      // Unbounded: the sub-box is expanded
+      auto full = root.getMetadata(MetadataQuery{});
+      auto *subFull = full["nodes"][0].getDynamicObject();
+      expect(subFull->getProperty("nodes").isArray());
+      expect(!subFull->hasProperty("isSummary"));
+      expectEquals((double)subFull->getProperty("effectiveQuantum"), 10.0);
+      expectEquals((double)full["nodes"][0]["nodes"][0]["effectiveQuantum"],
+                   10.0, "Children get the quantum their box worked out.");
+
+      // Depth 1: the sub-box is summarized from its cached aggregates
+      MetadataQuery query;
+      query.max_depth = 1;
+      auto bounded = root.getMetadata(query);
+      auto *subSummary = bounded["nodes"][0].getDynamicObject();
+      expect(!subSummary->hasProperty("nodes"),
+             "Summarized boxes should not serialize children.");
+      expect((bool)subSummary->getProperty("isSummary"));
+      expectEquals((int)subSummary->getProperty("childCount"), 1);
+      expectEquals((double)subSummary->getProperty("summaryDuration"), 10.0);
+      expectEquals((double)subSummary->getProperty("effectiveQuantum"), 10.0,
+                   "Summaries read the quantum the last block cached.");
+      expectWithinAbsoluteError((float)subSummary->getProperty("peak"), 0.4f,
+                                0.0001f);
+    }
+
+    beginTest("Visible Area Filtering");
+    {
+      BoxNode root("Root");
+      auto near = std::make_unique<BoxNode>("Near");
+      near->x_pos = 0.0;
+      near->y_pos = 0.0;
+      auto far = std::make_unique<BoxNode>("Far");
+      far->x_pos = 5000.0;
+      far->y_pos = 5000.0;
+      auto nearUuid = near->getUuid();
+      root.addChild(std::move(near));
+      root.addChild(std::move(far));
+
+      MetadataQuery query;
+      query.visible_area = MetadataQuery::VisibleArea{-100.0, -100.0, 800.0,
+                                                       600.0};
+      auto state = root.getMetadata(query);
+      auto *nodes = state["nodes"].getArray();
+      expectEquals(nodes->size(), 1);
+      expectEquals((*nodes)[0]["id"].toString(), nearUuid);
+      expectEquals((int)state["childCount"], 2,
+                   "childCount reports all children, visible or not.");
+    }
+
+    beginTest("DSP Profiling");
+    {
+      BoxNode root("Root");
+      auto sub = std::make_unique<BoxNode>("Sub");
+      auto *subPtr = sub.get();
+      root.addChild(std::move(sub));
+
+      ProcessContext ctx;
+      ctx.sample_rate = 1024.0;  // One-second window = two blocks
+      ctx.num_samples = 512;
+      std::vector<float> l(512), r(512);
+      float *outputs[] = {l.data(), r.data()};
+
+      // Disabled: nothing recorded, nothing serialized
+      root.process(nullptr, outputs, 0, 2, ctx);
+      root.process(nullptr, outputs, 0, 2, ctx);
+      expectEquals(subPtr->getDspProfile().getSummary().blocks, 0);
+      expect(!root.getMetadata({})["nodes"][0].getDynamicObject()->hasProperty(
+          "dsp"));
+
+      DspProfile::setEnabled(true);
+      root.process(nullptr, outputs, 0, 2, ctx);
+      root.process(nullptr, outputs, 0, 2, ctx);
+      auto summary = subPtr->getDspProfile().getSummary();
+      expectEquals(summary.blocks, 2);
+      expect(summary.max_us >= summary.mean_us);
+      expect(summary.p99_us <= summary.max_us);
+      expect(root.getMetadata({})["nodes"][0]["dsp"].isObject());
+      DspProfile::setEnabled(false);
+    }
+
+    beginTest("DSP Profile Percentiles");
+    {
+      DspProfile profile;
+      // 99 fast blocks and one slow one in a 100-block window
+      for (int i = 0; i < 99; ++i) profile.record(10000, 1, 100.0);
+      profile.record(1000000, 1, 100.0);
+
+      auto summary = profile.getSummary();
+      expectEquals(summary.blocks, 100);
+      expectWithinAbsoluteError(summary.mean_us, 19.9, 0.001);
+      expectWithinAbsoluteError(summary.max_us, 1000.0, 0.001);
+      // p99 lands in the fast bucket (10us, reported at its upper bound)
+      expect(summary.p99_us >= 10.0 && summary.p99_us < 13.0);
+    }
+
+    beginTest("Silent Children Are Skipped");
+    {
+      BoxNode root("Root");
+      auto audible = std::make_unique<ClipNode>("Audible", 44100.0);
+      auto muted = std::make_unique<ClipNode>("Muted", 44100.0);
+      auto *audiblePtr = audible.get();
+      auto *mutedPtr = muted.get();
+      for (auto *clip : {audible.get(), muted.get()}) {
+        float in[100];
+        for (int i = 0; i < 100; ++i) in[i] = 0.25f;
+        float *const inputs[] = {in};
+        ProcessContext recCtx;
+        recCtx.num_samples = 100;
+        recCtx.is_recording = true;
+        clip->startRecording();
+        clip->process(inputs, nullptr, 1, 0, recCtx);
+        clip->stopRecording();
+      }
+      mutedPtr->setMuted(true);
+      root.addChild(std::move(audible));
+      root.addChild(std::move(muted));
+
+      ProcessContext ctx;
+      ctx.num_samples = 10;
+      ctx.is_playing = true;
+      ctx.master_pos = 25;
+      float out[10] = {0.0f};
+      float *const outputs[] = {out};
+      expect(!root.isSilentFor(ctx));
+      root.process(nullptr, outputs, 0, 1, ctx);
+      expectEquals(out[0], 0.25f);
+
+      // Skipped, yet its playhead follows the transport
+      expectEquals(root.getActiveNodeCount(), 2);
+      expectEquals(mutedPtr->getPlayheadPosition(), 0.25);
+
+      // A box of silent children is silent as a whole
+      audiblePtr->setMuted(true);
+      expect(root.isSilentFor(ctx));
+    }
+
+    beginTest("Silence Is Checked Once Per Level");
+    {
+      // Root > 4 nested boxes > an audible leaf
+      BoxNode root("Root");
+      auto leaf = std::make_unique<CountingNode>();
+      auto *leafPtr = leaf.get();
+      std::unique_ptr<AudioNode> chain = std::move(leaf);
+      for (int depth = 0; depth < 4; ++depth) {
+        auto box = std::make_unique<BoxNode>("Level");
+        box->addChild(std::move(chain));
+        chain = std::move(box);
+      }
+      root.addChild(std::move(chain));
+      root.prepare(44100.0, 16, 1);
+
+      ProcessContext ctx;
+      ctx.num_samples = 16;
+      ctx.is_playing = true;
+      float out[16] = {0.0f};
+      float *const outputs[] = {out};
+      root.process(nullptr, outputs, 0, 1, ctx);
+      // Once by the walk from the top, once by its own parent
+      expectEquals(leafPtr->num_checks, 2);
+
+      ctx.sample_time += ctx.num_samples;
+      ctx.master_pos += ctx.num_samples;
+      root.process(nullptr, outputs, 0, 1, ctx);
+      expectEquals(leafPtr->num_checks, 4, "Nothing cached across blocks");
+    }
+
+    beginTest("Prepare Sizes Scratch Up Front");
+    {
+      BoxNode root("Root");
+      auto sub = std::make_unique<BoxNode>("Sub");
+      auto *subPtr = sub.get();
+      root.addChild(std::move(sub));
+
+      root.prepare(48000.0, 256, 2);
+      expectEquals(subPtr->getMemoryUsage().scratch_bytes,
+                   MemoryUsage::bytesForSamples(2, 256));
+
+      // Children added later are prepared before they're published
+      auto late = std::make_unique<BoxNode>("Late");
+      auto *latePtr = late.get();
+      subPtr->addChild(std::move(late));
+      expectEquals(latePtr->getMemoryUsage().scratch_bytes,
+                   MemoryUsage::bytesForSamples(2, 256));
+
+      // A block that fits doesn't grow anything
+      ProcessContext ctx;
+      ctx.sample_rate = 48000.0;
+      ctx.num_samples = 256;
+      std::vector<float> l(256), r(256);
+      float *outputs[] = {l.data(), r.data()};
+      root.process(nullptr, outputs, 0, 2, ctx);
+      expectEquals(root.getMemoryUsage().scratch_bytes,
+                   3 * MemoryUsage::bytesForSamples(2, 256));
+    }
   }
 };
 
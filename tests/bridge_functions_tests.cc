@@ -0,0 +1,112 @@
+#include <juce_core/juce_core.h>
+
+#include "../src/bridge_functions.h"
+
+class BridgeFunctionsTests : public juce::UnitTest {
+ public:
+  BridgeFunctionsTests() : juce::UnitTest("BridgeFunctions", "Bridge") {}
+
+  void runTest() override {
+    beginTest("Single Call Dispatch");
+    {
+      AudioEngine engine;
+      BridgeFunctions bridge(engine);
+      expectEquals(bridge.call("ping", {}).toString(), juce::String("pong"));
+      expect(bridge.call("doesNotExist", {}).isVoid());
+    }
+
+    beginTest("Batch Runs Operations In Order");
+    {
+      AudioEngine engine;
+      BridgeFunctions bridge(engine);
+
+      auto makeOperation = [](const juce::String& name,
+                              const juce::Array<juce::var>& args) {
+        juce::DynamicObject::Ptr op = new juce::DynamicObject();
+        op->setProperty("name", name);
+        op->setProperty("args", args);
+        return juce::var(op.get());
+      };
+
+      // A mutation followed by a query must observe the mutation
+      juce::Array<juce::var> operations;
+      operations.add(makeOperation("createNode", {"clip", 10.0, 10.0}));
+      operations.add(makeOperation("getGraphState", {}));
+      operations.add(makeOperation("ping", {}));
+
+      auto results = bridge.call("batch", {juce::var(operations)});
+      expect(results.isArray());
+      expectEquals(results.size(), 3);
+      expect((bool)results[0]);
+      expectEquals(results[1]["nodes"].size(), 1);
+      expectEquals(results[2].toString(), juce::String("pong"));
+    }
+
+    beginTest("Nested Batch Is Rejected");
+    {
+      AudioEngine engine;
+      BridgeFunctions bridge(engine);
+
+      juce::DynamicObject::Ptr nested = new juce::DynamicObject();
+      nested->setProperty("name", "batch");
+      nested->setProperty("args", juce::Array<juce::var>());
+      juce::Array<juce::var> operations;
+      operations.add(juce::var(nested.get()));
+
+      auto results = bridge.runBatch(operations);
+      expectEquals(results.size(), 1);
+      expect(results[0].isVoid());
+    }
+
+    beginTest("Heavy Calls Run Async");
+    {
+      AudioEngine engine;
+      BridgeFunctions bridge(engine,
+                             [](std::function<void()> fn) { fn(); });
+
+      expect(!bridge.isAsync("ping", {}));
+      expect(!bridge.isAsync("createNode", {"clip"}));
+      expect(bridge.isAsync("getGraphState", {}));
+      expect(bridge.isAsync("getWaveform", {"uuid", 100}));
+
+      // Light calls complete before invoke returns
+      juce::var ping_result;
+      bridge.invoke("ping", {},
+                    [&](const juce::var& value) { ping_result = value; });
+      expectEquals(ping_result.toString(), juce::String("pong"));
+
+      // Heavy calls complete later, from the job system
+      juce::WaitableEvent done;
+      juce::var state;
+      bridge.invoke("getGraphState", {}, [&](const juce::var& value) {
+        state = value;
+        done.signal();
+      });
+      expect(done.wait(5000), "getGraphState should complete");
+      expect(state["nodes"].isArray());
+    }
+
+    beginTest("Batch Is Async Only If Every Operation Is");
+    {
+      AudioEngine engine;
+      BridgeFunctions bridge(engine);
+
+      auto makeOperation = [](const juce::String& name) {
+        juce::DynamicObject::Ptr op = new juce::DynamicObject();
+        op->setProperty("name", name);
+        return juce::var(op.get());
+      };
+
+      juce::Array<juce::var> reads;
+      reads.add(makeOperation("getGraphState"));
+      reads.add(makeOperation("getWaveform"));
+      expect(bridge.isAsync("batch", {juce::var(reads)}));
+
+      juce::Array<juce::var> mixed = reads;
+      mixed.add(makeOperation("createNode"));
+      expect(!bridge.isAsync("batch", {juce::var(mixed)}));
+    }
+  }
+};
+
+static BridgeFunctionsTests bridgeFunctionsTests;
@@ -0,0 +1,66 @@
+#include <juce_core/juce_core.h>
+
+#include "../src/callback_monitor.h"
+
+namespace celestrian {
+
+class CallbackMonitorTests : public juce::UnitTest {
+ public:
+  CallbackMonitorTests()
+      : juce::UnitTest("CallbackMonitor", "Audio Engine") {}
+
+  void runTest() override {
+    const int block = 512;
+    const double sr = 48000.0;
+    const double deadline = block / sr;
+
+    beginTest("Classifies Blocks By Load");
+    {
+      CallbackMonitor monitor;
+      monitor.recordBlock(deadline * 0.12, block, sr, 0, 3);
+      monitor.recordBlock(deadline * 0.87, block, sr, 512, 3);
+      monitor.recordBlock(deadline * 1.52, block, sr, 1024, 7);
+
+      expectEquals(monitor.getNumBlocks(), (int64_t)3);
+      expectEquals(monitor.getNumNearMisses(), (int64_t)1);
+      expectEquals(monitor.getNumOverruns(), (int64_t)1);
+      expectWithinAbsoluteError(monitor.getMaxLoad(), 1.52, 1e-9);
+
+      auto stats = monitor.toVar();
+      auto* histogram = stats["loadHistogram"].getArray();
+      expectEquals(histogram->size(), CallbackMonitor::kNumLoadBuckets);
+      expectEquals((int)(*histogram)[2], 1);   // 10-15%
+      expectEquals((int)(*histogram)[17], 1);  // 85-90%
+      expectEquals((int)(*histogram)[30], 1);  // 150-155%
+    }
+
+    beginTest("Records Overrun Context");
+    {
+      CallbackMonitor monitor;
+      monitor.recordBlock(deadline * 2.0, block, sr, 4096, 12);
+
+      auto overruns = monitor.getRecentOverruns();
+      expectEquals(overruns.size(), 1);
+      expectEquals(overruns[0].master_pos, (int64_t)4096);
+      expectEquals(overruns[0].active_nodes, 12);
+      expectWithinAbsoluteError(overruns[0].load, 2.0, 1e-9);
+    }
+
+    beginTest("Overrun History Keeps The Most Recent");
+    {
+      CallbackMonitor monitor;
+      const int total = CallbackMonitor::kOverrunHistorySize + 5;
+      for (int i = 0; i < total; ++i)
+        monitor.recordBlock(deadline * 1.2, block, sr, i, 1);
+
+      auto overruns = monitor.getRecentOverruns();
+      expectEquals(overruns.size(), CallbackMonitor::kOverrunHistorySize);
+      expectEquals(overruns.getFirst().master_pos, (int64_t)5);
+      expectEquals(overruns.getLast().master_pos, (int64_t)(total - 1));
+    }
+  }
+};
+
+static CallbackMonitorTests callbackMonitorTests;
+
+}  // namespace celestrian
@@ -2,6 +2,8 @@
 #include "../src/clip_node.h"
 #include <juce_core/juce_core.h>
 
+#include <vector>
+
 namespace celestrian {
 
 class ClipNodeTests : public juce::UnitTest {
@@ -136,6 +138,97 @@ public:
       expectWithinAbsoluteError(node.getCurrentPeak(), 0.7f, 0.001f);
     }
 
+    beginTest("Peak Cache Matches The Scanned Waveform");
+    {
+      ClipNode node("Cached", 44100.0);
+      std::vector<float> input(4096, 0.0f);
+      input[3000] = -0.75f;
+      input[100] = 0.25f;
+      float *const inputs[] = {input.data()};
+      ProcessContext ctx;
+      ctx.num_samples = (int)input.size();
+      ctx.is_recording = true;
+      node.startRecording();
+      node.process(inputs, nullptr, 1, 0, ctx);
+      node.stopRecording();
+
+      expect(node.needsPeakCache());
+      auto scanned = node.getWaveform(4);
+
+      JobSystem jobs(1, [](std::function<void()> fn) { fn(); });
+      auto job = jobs.schedule([&node](JobSystem::JobContext &context) {
+        return juce::var(node.buildPeakCache(context));
+      });
+      expect(job->wait(5000));
+      expect(job->getState() == JobSystem::Job::State::Finished);
+      expect(!node.needsPeakCache());
+
+      auto cached = node.getWaveform(4);
+      expectEquals(cached.size(), scanned.size());
+      for (int i = 0; i < cached.size(); ++i)
+        expectEquals((float)cached[i], (float)scanned[i]);
+      expectEquals((float)cached[2], 0.75f);
+
+      // A new take makes the cache stale
+      node.startRecording();
+      expect(!node.needsPeakCache());
+      node.process(inputs, nullptr, 1, 0, ctx);
+      node.stopRecording();
+      expect(node.needsPeakCache());
+    }
+
+    beginTest("Silent Regions And Muted Clips Report Silence");
+    {
+      ClipNode node("Sparse", 44100.0);
+      std::vector<float> input(4096, 0.0f);
+      for (int i = 1024; i < 1280; ++i) input[(size_t)i] = 0.5f;
+      float *const inputs[] = {input.data()};
+      ProcessContext ctx;
+      ctx.num_samples = (int)input.size();
+      ctx.is_recording = true;
+      node.startRecording();
+      expect(!node.isSilentFor(ctx));
+      node.process(inputs, nullptr, 1, 0, ctx);
+      node.stopRecording();
+
+      ProcessContext play;
+      play.num_samples = 512;
+      play.is_playing = true;
+      // Unknown until the peak cache has mapped the take
+      expect(!node.isSilentFor(play));
+
+      JobSystem jobs(1, [](std::function<void()> fn) { fn(); });
+      auto job = jobs.schedule([&node](JobSystem::JobContext &context) {
+        return juce::var(node.buildPeakCache(context));
+      });
+      expect(job->wait(5000));
+      expect(node.isSilentFor(play));
+
+      play.master_pos = 1000;  // Reaches into the audio
+      expect(!node.isSilentFor(play));
+      play.master_pos = 3800;  // Wraps round to the silent start
+      expect(node.isSilentFor(play));
+
+      // Skipped blocks render what process() would: nothing
+      std::vector<float> output(512, 0.0f);
+      float *const outputs[] = {output.data()};
+      node.process(nullptr, outputs, 0, 1, play);
+      expectEquals(output[0], 0.0f);
+      play.master_pos = 1024;
+      node.process(nullptr, outputs, 0, 1, play);
+      expectEquals(output[0], 0.5f);
+
+      // Muted or stopped is silent anywhere, but the playhead still moves
+      node.setMuted(true);
+      expect(node.isSilentFor(play));
+      play.master_pos = 2048;
+      node.skipSilentBlock(play);
+      expectEquals(node.getPlayheadPosition(), 0.5);
+      node.setMuted(false);
+      play.is_playing = false;
+      expect(node.isSilentFor(play));
+    }
+
     beginTest("Cyclic Shift (Rotation)");
     {
       const double SR = 100.0;
@@ -180,7 +273,7 @@ public:
       // 50 is Q/2. 50 is exactly Q/2, so it snaps to 50.
       nodePtr->stopRecording();
 
-      expectEquals(nodePtr->duration_samples.load(), (int64_t)50);
+      expectEquals(nodePtr->getDurationSamples(), (int64_t)50);
 
       // The phase was 125 % 50 (if snapped to 50) = 25.
       // Or 125 % 100 = 25.
@@ -235,7 +328,7 @@ public:
 
       clipPtr->process(nullptr, outputs, 0, 2, playCtx);
       // Verify playhead is within loop region
-      expect(clipPtr->playhead_pos.load() >= 0.0);
+      expect(clipPtr->getPlayheadPosition() >= 0.0);
     }
 
     beginTest("Phase Alignment Mid-Track Recording");
@@ -358,8 +451,8 @@ public:
       dummy->stopRecording();
       parent.addChild(std::move(dummy));
 
+      auto *nodePtr = node.get();
       parent.addChild(std::move(node));
-      auto *nodePtr = dynamic_cast<ClipNode *>(parent.getChild(1));
 
       // Start recording
       nodePtr->startRecording();
@@ -0,0 +1,194 @@
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../src/audio_engine.h"
+#include "../src/command_queue.h"
+#include "../src/offline_device_backend.h"
+
+namespace celestrian {
+
+namespace {
+// An offline backend that claims to be a realtime device, so the engine
+// leaves commands to the callback instead of applying them itself
+class RealtimeTestBackend : public OfflineDeviceBackend {
+ public:
+  bool isRealtime() const override { return true; }
+};
+}  // namespace
+
+class CommandQueueTests : public juce::UnitTest {
+ public:
+  CommandQueueTests() : juce::UnitTest("CommandQueue", "Audio Engine") {}
+
+  void runTest() override {
+    beginTest("Applies In Order And Acknowledges");
+    {
+      CommandQueue queue;
+      const auto first = queue.push(makeCommand(1));
+      const auto second = queue.push(makeCommand(2));
+      expectEquals((int)first, 1);
+      expectEquals((int)second, 2);
+      expectEquals(queue.getNumPending(), 2);
+      expect(!queue.isApplied(first));
+
+      std::vector<int64_t> applied;
+      const int num_applied = queue.drain([&](const EngineCommand &command) {
+        applied.push_back(command.first);
+      });
+      expectEquals(num_applied, 2);
+      expect(applied == std::vector<int64_t>({1, 2}));
+      expect(queue.isApplied(second));
+      expectEquals(queue.getNumPending(), 0);
+    }
+
+    beginTest("Refuses Commands When Full");
+    {
+      CommandQueue queue;
+      for (int i = 0; i < CommandQueue::kCapacity; ++i)
+        expect(queue.push(makeCommand(i)) != 0);
+      expectEquals((int)queue.push(makeCommand(0)), 0);
+
+      queue.drain([](const EngineCommand &) {});
+      expect(queue.push(makeCommand(0)) != 0, "Space again once drained");
+    }
+
+    beginTest("A Realtime Device Applies Commands Between Blocks");
+    {
+      AudioEngine engine(std::make_unique<RealtimeTestBackend>());
+      auto &backend =
+          static_cast<OfflineDeviceBackend &>(engine.getDeviceBackend());
+      auto uuid = engine.createNode("clip");
+
+      // No block runs: the sender gets an id back without waiting
+      const auto playback_id = engine.togglePlayback();
+      expect(playback_id != 0);
+      expect(!engine.isCommandApplied(playback_id));
+      expect(!engine.isPlaying(), "Still queued");
+      backend.renderBlocks(1);
+      expect(engine.isCommandApplied(playback_id));
+      expect(engine.isPlaying(), "Applied by the next block");
+
+      // With blocks running, the ids are acknowledged in order
+      std::atomic<bool> rendering{true};
+      std::thread audio_thread([&] {
+        while (rendering.load()) backend.renderBlocks(1);
+      });
+      expect(engine.toggleSolo(uuid) != 0);
+      expect(engine.setLoopPoints(uuid, 0, 0) != 0);
+      const auto input_id = engine.setNodeInput(uuid, 1);
+      expect(input_id != 0);
+      while (!engine.isCommandApplied(input_id)) std::this_thread::yield();
+      rendering.store(false);
+      audio_thread.join();
+
+      auto node = engine.getGraphState()["nodes"][0];
+      expectEquals(engine.getGraphState()["soloedId"].toString(), uuid);
+      expectEquals((int)node["inputChannel"], 1);
+      expectEquals((int)engine.toggleMute("no-such-node"), 0);
+    }
+
+    beginTest("Acknowledgements Share One Worker");
+    {
+      AudioEngine engine(std::make_unique<RealtimeTestBackend>());
+      auto &backend =
+          static_cast<OfflineDeviceBackend &>(engine.getDeviceBackend());
+      auto uuid = engine.createNode("clip");
+
+      // Each toggle has a follow-up waiting for its acknowledgement
+      uint64_t last_id = 0;
+      for (int i = 0; i < 6; ++i) last_id = engine.toggleMute(uuid);
+      expect(last_id != 0);
+      expectEquals(engine.getJobSystem().getNumPending(), 1,
+                   "One drain job, however many commands wait");
+
+      backend.renderBlocks(1);
+      expect(engine.isCommandApplied(last_id));
+      for (int i = 0; i < 1000 && engine.getJobSystem().getNumPending() > 0;
+           ++i)
+        juce::Thread::sleep(1);
+      expectEquals(engine.getJobSystem().getNumPending(), 0);
+    }
+
+    beginTest("Removing A Node Clears What Points Into It");
+    {
+      AudioEngine engine(std::make_unique<RealtimeTestBackend>());
+      auto &backend =
+          static_cast<OfflineDeviceBackend &>(engine.getDeviceBackend());
+      auto box_uuid = engine.createNode("box");
+      engine.enterBox(box_uuid);
+      auto clip_uuid = engine.createNode("clip");
+      engine.toggleSolo(clip_uuid);
+      backend.renderBlocks(1);
+      expectEquals(engine.getGraphState()["soloedId"].toString(), clip_uuid);
+
+      const auto id = engine.removeNode(box_uuid);
+      expect(id != 0);
+      expectEquals(engine.getGraphState()["nodes"].size(), 0,
+                   "Unlinked, and the focus is back on the root");
+      expect(!engine.isCommandApplied(id));
+
+      backend.renderBlocks(1);
+      expect(engine.isCommandApplied(id));
+      expect(engine.getGraphState()["soloedId"].toString().isEmpty(),
+             "The solo went with the subtree");
+      expectEquals((int)engine.removeNode(box_uuid), 0);
+      expectEquals(
+          (int)engine.removeNode(engine.getGraphState()["id"].toString()), 0,
+          "Never the root");
+    }
+
+    beginTest("Nodes Can Be Removed While Blocks Render");
+    {
+      AudioEngine engine(std::make_unique<RealtimeTestBackend>());
+      auto &backend =
+          static_cast<OfflineDeviceBackend &>(engine.getDeviceBackend());
+      const auto root_uuid = engine.getGraphState()["id"].toString();
+      engine.togglePlayback();
+
+      std::atomic<bool> rendering{true};
+      std::atomic<int> blocks{0};
+      std::thread audio_thread([&] {
+        while (rendering.load()) {
+          backend.renderBlocks(1);
+          blocks.fetch_add(1);
+        }
+      });
+
+      // Every block works out the timeline from the focused box's children
+      // while they come and go, the focused box included
+      for (int round = 0; round < 100; ++round) {
+        const auto box_uuid = engine.createNode("box");
+        engine.enterBox(box_uuid);
+        std::vector<juce::String> clips;
+        for (int i = 0; i < 8; ++i) clips.push_back(engine.createNode("clip"));
+        for (const auto &uuid : clips) expect(engine.removeNode(uuid) != 0);
+        const auto id = engine.removeNode(box_uuid);
+        expect(id != 0);
+        while (!engine.isCommandApplied(id)) std::this_thread::yield();
+      }
+      const int rendered = blocks.load();
+      while (blocks.load() < rendered + 2) std::this_thread::yield();
+      rendering.store(false);
+      audio_thread.join();
+
+      auto state = engine.getGraphState();
+      expectEquals(state["focusedId"].toString(), root_uuid);
+      expectEquals(state["nodes"].size(), 0);
+    }
+  }
+
+ private:
+  static EngineCommand makeCommand(int64_t value) {
+    EngineCommand command;
+    command.type = EngineCommandType::SetNodeInput;
+    command.first = value;
+    return command;
+  }
+};
+
+static CommandQueueTests commandQueueTests;
+
+}  // namespace celestrian
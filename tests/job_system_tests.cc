@@ -0,0 +1,196 @@
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "../src/job_system.h"
+
+class JobSystemTests : public juce::UnitTest {
+ public:
+  JobSystemTests() : juce::UnitTest("JobSystem", "Bridge") {}
+
+  void runTest() override {
+    // Completions run inline on the worker; there is no message loop here
+    auto inlineDispatcher = [](std::function<void()> fn) { fn(); };
+
+    beginTest("Completes Off The Calling Thread");
+    {
+      JobSystem jobs(2, inlineDispatcher);
+      juce::WaitableEvent done;
+      juce::var result;
+      std::atomic<bool> ran_on_caller{true};
+      auto caller = juce::Thread::getCurrentThreadId();
+
+      jobs.submit(
+          "",
+          [&] {
+            ran_on_caller = juce::Thread::getCurrentThreadId() == caller;
+            return juce::var(42);
+          },
+          [&](const juce::var& value) {
+            result = value;
+            done.signal();
+          });
+
+      expect(done.wait(5000), "Job should complete");
+      expectEquals((int)result, 42);
+      expect(!ran_on_caller.load());
+    }
+
+    beginTest("Newer Job Supersedes Older With Same Key");
+    {
+      JobSystem jobs(1, inlineDispatcher);
+      juce::WaitableEvent release_blocker, all_done;
+      std::atomic<int> completions{0};
+      std::atomic<int> work_runs{0};
+      juce::var stale_result = "unset", fresh_result;
+
+      auto onComplete = [&](juce::var* target) {
+        return [&, target](const juce::var& value) {
+          *target = value;
+          if (++completions == 2) all_done.signal();
+        };
+      };
+
+      // Occupy the single worker so both keyed jobs queue up behind it
+      jobs.submit(
+          "",
+          [&] {
+            release_blocker.wait(5000);
+            return juce::var();
+          },
+          [](const juce::var&) {});
+
+      jobs.submit(
+          "waveform:a",
+          [&] {
+            ++work_runs;
+            return juce::var("zoom 1");
+          },
+          onComplete(&stale_result));
+      jobs.submit(
+          "waveform:a",
+          [&] {
+            ++work_runs;
+            return juce::var("zoom 2");
+          },
+          onComplete(&fresh_result));
+
+      release_blocker.signal();
+      expect(all_done.wait(5000), "Both keyed jobs should complete");
+
+      expect(stale_result.isVoid(), "Superseded job completes with void");
+      expectEquals(fresh_result.toString(), juce::String("zoom 2"));
+      expectEquals(work_runs.load(), 1, "Superseded work should be skipped");
+      expectEquals(jobs.getNumSuperseded(), 1);
+      expectEquals(jobs.getNumKeys(), 0, "Finished keys should be erased");
+    }
+
+    beginTest("Runs Higher Priorities First");
+    {
+      JobSystem jobs(1, inlineDispatcher);
+      juce::WaitableEvent release_blocker;
+      std::mutex order_mutex;
+      juce::StringArray order;
+
+      auto blocker = jobs.schedule([&](JobSystem::JobContext&) {
+        release_blocker.wait(5000);
+        return juce::var();
+      });
+      auto makeJob = [&](const juce::String& name,
+                         JobSystem::Priority priority) {
+        JobSystem::JobOptions options;
+        options.priority = priority;
+        return jobs.schedule(
+            [&, name](JobSystem::JobContext&) {
+              std::lock_guard<std::mutex> lock(order_mutex);
+              order.add(name);
+              return juce::var();
+            },
+            {}, options);
+      };
+      auto background = makeJob("background", JobSystem::Priority::Background);
+      auto normal = makeJob("normal", JobSystem::Priority::Normal);
+      auto interactive =
+          makeJob("interactive", JobSystem::Priority::Interactive);
+
+      release_blocker.signal();
+      expect(background->wait(5000));
+      expectEquals(order.joinIntoString(","),
+                   juce::String("interactive,normal,background"));
+      expectEquals(jobs.getNumPending(), 0);
+    }
+
+    beginTest("Dependencies Run After Their Inputs");
+    {
+      JobSystem jobs(2, inlineDispatcher);
+      std::atomic<int> produced{0};
+
+      auto producer = jobs.schedule([&](JobSystem::JobContext&) {
+        juce::Thread::sleep(20);
+        produced.store(7);
+        return juce::var();
+      });
+      JobSystem::JobOptions after_producer;
+      after_producer.dependencies = {producer};
+      juce::var consumed;
+      auto consumer = jobs.schedule(
+          [&](JobSystem::JobContext&) { return juce::var(produced.load()); },
+          [&](const juce::var& value) { consumed = value; }, after_producer);
+
+      expect(consumer->wait(5000));
+      expectEquals((int)consumed, 7);
+      expect(consumer->getState() == JobSystem::Job::State::Finished);
+
+      // A cancelled input cancels what depends on it
+      juce::WaitableEvent release_input;
+      auto input = jobs.schedule([&](JobSystem::JobContext&) {
+        release_input.wait(5000);
+        return juce::var();
+      });
+      JobSystem::JobOptions after_input;
+      after_input.dependencies = {input};
+      std::atomic<bool> dependent_ran{false};
+      auto dependent = jobs.schedule(
+          [&](JobSystem::JobContext&) {
+            dependent_ran.store(true);
+            return juce::var();
+          },
+          {}, after_input);
+      expect(dependent->getState() == JobSystem::Job::State::Waiting);
+
+      input->cancel();
+      release_input.signal();
+      expect(dependent->wait(5000));
+      expect(!dependent_ran.load());
+      expect(dependent->getState() == JobSystem::Job::State::Cancelled);
+    }
+
+    beginTest("Cancellation Stops Running Work And Reports Progress");
+    {
+      JobSystem jobs(1, inlineDispatcher);
+      juce::WaitableEvent halfway;
+      juce::var result = "unset";
+
+      auto job = jobs.schedule(
+          [&](JobSystem::JobContext& context) {
+            for (int step = 0; step < 1000 && !context.isCancelled(); ++step) {
+              context.setProgress((float)step / 1000.0f);
+              if (step == 500) halfway.signal();
+              juce::Thread::sleep(1);
+            }
+            return juce::var("finished");
+          },
+          [&](const juce::var& value) { result = value; });
+
+      expect(halfway.wait(5000));
+      expect(job->getProgress() >= 0.5f);
+      job->cancel();
+      expect(job->wait(5000));
+      expect(job->getState() == JobSystem::Job::State::Cancelled);
+      expect(result.isVoid(), "A cancelled job completes with void");
+    }
+  }
+};
+
+static JobSystemTests jobSystemTests;
@@ -0,0 +1,123 @@
+#include <juce_core/juce_core.h>
+
+#include <vector>
+
+#include "../src/loop_kernels.h"
+
+namespace celestrian {
+
+class LoopKernelsTests : public juce::UnitTest {
+ public:
+  LoopKernelsTests() : juce::UnitTest("LoopKernels", "Audio Engine") {}
+
+  void runTest() override {
+    std::vector<float> source(1000);
+    for (size_t i = 0; i < source.size(); ++i)
+      source[i] = (float)i / 1000.0f - 0.5f;
+
+    beginTest("Every Channel Count Matches The Per-Sample Loop");
+    {
+      for (int channels : {1, 2, 3}) {
+        // Wraps at the loop end twice within the block
+        const int num_samples = 300;
+        const int64_t loop_start = 100, loop_length = 128, position = 90;
+        auto expected = reference(source, channels, num_samples, loop_start,
+                                  loop_length, position, 1.0f, 1.0f, 0.0f);
+
+        Outputs actual(channels, num_samples);
+        mixLoop(selectLoopKernels(channels), source.data(),
+                (int)source.size(), actual.pointers.data(), channels, 0,
+                num_samples, loop_start, loop_length, position, 1.0f, 1.0f,
+                0.0f);
+        expect(actual.data == expected.data,
+               juce::String(channels) + " channels");
+      }
+    }
+
+    beginTest("Fixed Block Kernels Match The Per-Sample Loop");
+    {
+      expectEquals(selectLoopKernels(2, 64).block_size, 64);
+      expect(selectLoopKernels(2, 48).add_block == nullptr,
+             "Only the specialized sizes get a block kernel.");
+
+      for (int channels : {1, 2, 3}) {
+        // One whole-block run, then one split at the loop end
+        for (int64_t position : {0, 100}) {
+          const int num_samples = 64;
+          auto expected = reference(source, channels, num_samples, 0, 128,
+                                    position, 1.0f, 1.0f, 0.0f);
+
+          Outputs actual(channels, num_samples);
+          mixLoop(selectLoopKernels(channels, num_samples), source.data(),
+                  (int)source.size(), actual.pointers.data(), channels, 0,
+                  num_samples, 0, 128, position, 1.0f, 1.0f, 0.0f);
+          expect(actual.data == expected.data,
+                 juce::String(channels) + " channels from " +
+                     juce::String(position));
+        }
+      }
+    }
+
+    beginTest("Fades Step Sample By Sample And Then Settle");
+    {
+      const int num_samples = 200;
+      const float step = 1.0f / 64.0f;
+      auto expected = reference(source, 2, num_samples, 0, 1000, 950, 1.0f,
+                                0.0f, step);
+
+      Outputs actual(2, num_samples);
+      const float gain =
+          mixLoop(selectLoopKernels(2), source.data(), (int)source.size(),
+                  actual.pointers.data(), 2, 0, num_samples, 0, 1000, 950,
+                  1.0f, 0.0f, step);
+      expectEquals(gain, 0.0f);
+      expect(actual.data == expected.data);
+      expectEquals(actual.data[0][num_samples - 1], 0.0f);
+    }
+
+    beginTest("Missing Outputs Are Skipped");
+    {
+      Outputs actual(2, 64);
+      actual.pointers[0] = nullptr;
+      mixLoop(selectLoopKernels(2), source.data(), (int)source.size(),
+              actual.pointers.data(), 2, 16, 48, 0, 1000, 0, 1.0f, 1.0f,
+              0.0f);
+      expectEquals(actual.data[0][20], 0.0f);
+      expectEquals(actual.data[1][15], 0.0f);
+      expectEquals(actual.data[1][16], source[0]);
+    }
+  }
+
+ private:
+  struct Outputs {
+    Outputs(int channels, int num_samples)
+        : data((size_t)channels,
+               std::vector<float>((size_t)num_samples, 0.0f)) {
+      for (auto &channel : data) pointers.push_back(channel.data());
+    }
+    std::vector<std::vector<float>> data;
+    std::vector<float *> pointers;
+  };
+
+  // The straightforward loop the kernels replace
+  static Outputs reference(const std::vector<float> &source, int channels,
+                           int num_samples, int64_t loop_start,
+                           int64_t loop_length, int64_t position, float gain,
+                           float target, float step) {
+    Outputs outputs(channels, num_samples);
+    for (int i = 0; i < num_samples; ++i) {
+      const float sample =
+          source[(size_t)((loop_start + (position + i) % loop_length) %
+                          (int64_t)source.size())];
+      if (gain != target)
+        gain = target > gain ? std::min(target, gain + step)
+                             : std::max(target, gain - step);
+      for (auto &channel : outputs.data) channel[(size_t)i] += sample * gain;
+    }
+    return outputs;
+  }
+};
+
+static LoopKernelsTests loopKernelsTests;
+
+}  // namespace celestrian
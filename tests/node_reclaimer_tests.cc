@@ -0,0 +1,90 @@
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+
+#include "../src/box_node.h"
+#include "../src/clip_node.h"
+#include "../src/node_reclaimer.h"
+
+namespace celestrian {
+
+namespace {
+// A box that reports when it is freed
+class TrackedBox : public BoxNode {
+ public:
+  explicit TrackedBox(std::atomic<bool> &freed_flag)
+      : BoxNode("Tracked"), freed(freed_flag) {}
+  ~TrackedBox() override { freed.store(true); }
+
+ private:
+  std::atomic<bool> &freed;
+};
+}  // namespace
+
+class NodeReclaimerTests : public juce::UnitTest {
+ public:
+  NodeReclaimerTests() : juce::UnitTest("NodeReclaimer", "Audio Engine") {}
+
+  void runTest() override {
+    beginTest("Waits For The Block That Could See The Node");
+    {
+      std::atomic<bool> freed{false};
+      NodeReclaimer reclaimer;
+
+      reclaimer.beginBlock();
+      reclaimer.retire(std::make_unique<TrackedBox>(freed));
+      expectEquals(reclaimer.collect(), 0);
+      juce::Thread::sleep(3 * NodeReclaimer::kCollectIntervalMs);
+      expect(!freed.load(), "Still in use by the running block");
+      expectEquals(reclaimer.getNumPending(), 1);
+
+      // A block that starts after the retire never saw it
+      reclaimer.endBlock();
+      reclaimer.beginBlock();
+      expect(waitUntilFreed(freed));
+      expectEquals(reclaimer.getNumPending(), 0);
+      reclaimer.endBlock();
+    }
+
+    beginTest("Removed Children Are Freed Off The Caller");
+    {
+      std::atomic<bool> freed{false};
+      NodeReclaimer reclaimer;
+      BoxNode root("Root");
+      root.setReclaimer(&reclaimer);
+
+      auto child = std::make_unique<TrackedBox>(freed);
+      child->addChild(std::make_unique<ClipNode>("Minutes Of Audio", 44100.0));
+      auto uuid = child->getUuid();
+      root.addChild(std::move(child));
+
+      reclaimer.beginBlock();
+      root.removeChild(uuid);
+      expectEquals(root.getNumChildren(), 0);
+      expect(!freed.load());
+
+      reclaimer.endBlock();
+      expect(waitUntilFreed(freed));
+    }
+
+    beginTest("Frees On The Spot Without A Reclaimer");
+    {
+      BoxNode root("Root");
+      std::atomic<bool> freed{false};
+      root.addChild(std::make_unique<TrackedBox>(freed));
+      root.clearChildren();
+      expect(freed.load());
+    }
+  }
+
+ private:
+  static bool waitUntilFreed(const std::atomic<bool> &freed) {
+    for (int i = 0; i < 100 && !freed.load(); ++i)
+      juce::Thread::sleep(NodeReclaimer::kCollectIntervalMs);
+    return freed.load();
+  }
+};
+
+static NodeReclaimerTests nodeReclaimerTests;
+
+}  // namespace celestrian
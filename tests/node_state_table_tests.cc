@@ -0,0 +1,115 @@
+#include <juce_core/juce_core.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../src/box_node.h"
+#include "../src/clip_node.h"
+#include "../src/node_state_table.h"
+
+namespace celestrian {
+
+class NodeStateTableTests : public juce::UnitTest {
+ public:
+  NodeStateTableTests() : juce::UnitTest("NodeStateTable", "Audio Engine") {}
+
+  void runTest() override {
+    auto &table = NodeStateTable::getInstance();
+
+    beginTest("Node Fields Live In The Table");
+    {
+      const int live = table.getNumLive();
+      {
+        ClipNode clip("Clip", 44100.0);
+        expectEquals(table.getNumLive(), live + 1);
+
+        clip.setLoopPoints(0, 480);
+        clip.setMuted(true);
+        expectEquals(table.getLoopEnd(clip.getStateHandle()).load(),
+                     (int64_t)480);
+        expect(table.getMutedFlag(clip.getStateHandle()).load());
+        table.getPlayheadPos(clip.getStateHandle()).store(0.5);
+        expectEquals(clip.getPlayheadPosition(), 0.5);
+      }
+      expectEquals(table.getNumLive(), live);
+      expect(table.getBytes() > 0);
+    }
+
+    beginTest("Released Rows Come Back Reset");
+    {
+      const int group = 0;
+      const NodeHandle handle = table.acquire(&group);
+      table.getLaunchPoint(handle).store(99);
+      table.getRecordingFlag(handle).store(true);
+      table.release(handle);
+
+      // The freed row is the next one handed out
+      const NodeHandle reused = table.acquire(&group);
+      expectEquals((int64_t)reused, (int64_t)handle);
+      expectEquals(table.getLaunchPoint(reused).load(), (int64_t)0);
+      expect(!table.getRecordingFlag(reused).load());
+      table.release(reused);
+    }
+
+    beginTest("Siblings Share A Run However The Graph Churns");
+    {
+      BoxNode first("First");
+      BoxNode second("Second");
+      auto runOf = [](const AudioNode &node) {
+        return node.getStateHandle() / NodeStateTable::kRowsPerRun;
+      };
+
+      // Interleaved creation would scatter rows handed out in order
+      std::vector<AudioNode *> firsts, seconds;
+      for (int i = 0; i < 4; ++i) {
+        auto clip = std::make_unique<ClipNode>("Clip", 44100.0);
+        clip->setLaunchPoint(i);
+        firsts.push_back(clip.get());
+        first.addChild(std::move(clip));
+        auto other = std::make_unique<ClipNode>("Clip", 44100.0);
+        seconds.push_back(other.get());
+        second.addChild(std::move(other));
+      }
+      const auto run = runOf(*firsts[0]);
+      for (int i = 0; i < 4; ++i) {
+        expectEquals((int64_t)runOf(*firsts[(size_t)i]), (int64_t)run);
+        expectEquals(firsts[(size_t)i]->getLaunchPoint(), (int64_t)i);
+        expect(runOf(*seconds[(size_t)i]) != run);
+      }
+
+      // A new sibling takes the row a removed one left behind
+      const NodeHandle freed = firsts[1]->getStateHandle();
+      first.removeChild(firsts[1]->getUuid());
+      second.addChild(std::make_unique<ClipNode>("Clip", 44100.0));
+      first.addChild(std::make_unique<ClipNode>("Clip", 44100.0));
+      NodeHandle newest = 0;
+      first.forEachChild(
+          [&](const AudioNode &child) { newest = child.getStateHandle(); });
+      expectEquals((int64_t)newest, (int64_t)freed);
+    }
+
+    beginTest("Columns Are Contiguous And Aligned");
+    {
+      ClipNode clip("Clip", 44100.0);
+      const NodeHandle handle = clip.getStateHandle();
+      const NodeHandle first = handle - handle % NodeStateTable::kRowsPerChunk;
+
+      // Neighbouring rows of a column are neighbours in memory
+      const NodeHandle next = handle == first ? handle + 1 : handle - 1;
+      auto here = (uintptr_t)&table.getLoopStart(handle);
+      auto there = (uintptr_t)&table.getLoopStart(next);
+      expectEquals((int64_t)(here > there ? here - there : there - here),
+                   (int64_t)sizeof(std::atomic<int64_t>));
+
+      auto column = (uintptr_t)&table.getDuration(first);
+      expectEquals((int)(column % NodeStateTable::kCacheLineBytes), 0);
+      column = (uintptr_t)&table.getMutedFlag(first);
+      expectEquals((int)(column % NodeStateTable::kCacheLineBytes), 0);
+    }
+  }
+};
+
+static NodeStateTableTests nodeStateTableTests;
+
+}  // namespace celestrian
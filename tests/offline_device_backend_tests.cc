@@ -0,0 +1,104 @@
+#include <juce_core/juce_core.h>
+
+#include "../src/audio_engine.h"
+#include "../src/offline_device_backend.h"
+
+namespace celestrian {
+
+class OfflineDeviceBackendTests : public juce::UnitTest {
+ public:
+  OfflineDeviceBackendTests()
+      : juce::UnitTest("OfflineDeviceBackend", "Audio Engine") {}
+
+  void runTest() override {
+    beginTest("Nothing Renders Until Opened");
+    {
+      OfflineDeviceBackend backend;
+      expectEquals(backend.renderBlocks(4), 0);
+      expectEquals(backend.getSamplesRendered(), (int64_t)0);
+    }
+
+    beginTest("Scripted Signals");
+    {
+      auto impulses = OfflineDeviceBackend::impulses(100, 0.5f);
+      expectEquals(impulses(0, 0), 0.5f);
+      expectEquals(impulses(0, 50), 0.0f);
+      expectEquals(impulses(1, 200), 0.5f);
+
+      auto sine = OfflineDeviceBackend::sine(441.0, 1.0f, 44100.0);
+      expectWithinAbsoluteError(sine(0, 25), 1.0f, 1.0e-5f);  // quarter cycle
+      expectEquals(OfflineDeviceBackend::constant(0.25f)(0, 12345), 0.25f);
+    }
+
+    beginTest("Records And Plays Back Without Hardware");
+    {
+      auto first = recordAndPlay();
+      auto second = recordAndPlay();
+
+      // The clip was recorded from a constant 0.5 input and loops it back
+      expectEquals(first.getSample(0, 0), 0.5f);
+      expectEquals(first.getSample(1, first.getNumSamples() - 1), 0.5f);
+
+      // Same script, same output
+      bool identical = true;
+      for (int ch = 0; ch < first.getNumChannels(); ++ch)
+        for (int i = 0; i < first.getNumSamples(); ++i)
+          identical &= first.getSample(ch, i) == second.getSample(ch, i);
+      expect(identical, "Offline renders should be deterministic");
+    }
+
+    beginTest("Simulated Host Time Follows Rendered Samples");
+    {
+      DeviceConfig config;
+      config.sample_rate = 48000.0;
+      config.block_size = 480;
+      AudioEngine engine(std::make_unique<OfflineDeviceBackend>(config));
+      auto &backend =
+          static_cast<OfflineDeviceBackend &>(engine.getDeviceBackend());
+
+      expectEquals(backend.renderSamples(4800), (int64_t)4800);
+      expectEquals(backend.getSamplesRendered(), (int64_t)4800);
+
+      // The anchor belongs to the last block, which started 9 blocks in
+      auto clock = engine.getTransportClock();
+      expectEquals((double)clock["hostTimeNs"], 9 * 480 * 1.0e9 / 48000.0);
+      // The engine runs at the device's rate, not a hard-coded one
+      expectEquals((double)clock["sampleRate"], 48000.0);
+
+      auto inputs = engine.getInputList()["inputs"];
+      expectEquals(inputs.size(), 1);
+    }
+  }
+
+ private:
+  // Records one second of constant input into a clip, then returns the
+  // next ten blocks of playback.
+  static juce::AudioBuffer<float> recordAndPlay() {
+    AudioEngine engine;
+    auto &backend =
+        static_cast<OfflineDeviceBackend &>(engine.getDeviceBackend());
+    engine.createNode("clip");
+    auto uuid = engine.getGraphState()["nodes"][0]["id"].toString();
+
+    backend.setInputSignal(OfflineDeviceBackend::constant(0.5f));
+    engine.startRecordingInNode(uuid);
+    backend.renderSamples(44100);
+    engine.stopRecordingInNode(uuid);
+    backend.setInputSignal(OfflineDeviceBackend::silence());
+
+    const int block_size = backend.getConfig().block_size;
+    juce::AudioBuffer<float> played(2, block_size * 10);
+    int offset = 0;
+    backend.renderBlocks(10, [&](const float *const *channels,
+                                 int num_channels, int num_samples) {
+      for (int ch = 0; ch < num_channels; ++ch)
+        played.copyFrom(ch, offset, channels[ch], num_samples);
+      offset += num_samples;
+    });
+    return played;
+  }
+};
+
+static OfflineDeviceBackendTests offlineDeviceBackendTests;
+
+}  // namespace celestrian
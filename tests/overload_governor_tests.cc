@@ -0,0 +1,135 @@
+#include <juce_core/juce_core.h>
+
+#include <vector>
+
+#include "../src/clip_node.h"
+#include "../src/overload_governor.h"
+
+namespace celestrian {
+
+class OverloadGovernorTests : public juce::UnitTest {
+ public:
+  OverloadGovernorTests()
+      : juce::UnitTest("OverloadGovernor", "Audio Engine") {}
+
+  void runTest() override {
+    beginTest("Sustained Load Sheds One Step At A Time");
+    {
+      OverloadGovernor governor;
+      for (int i = 0; i < 50; ++i) governor.update(0.5, i, true);
+      expect(governor.getLevel() == ShedLevel::None);
+
+      // The smoothed load needs a few blocks to cross the threshold
+      int blocks = 0;
+      while (governor.getLevel() == ShedLevel::None && blocks < 100)
+        governor.update(0.95, 1000 + blocks++, true);
+      expect(governor.getLevel() == ShedLevel::SkipMeters);
+      expectGreaterOrEqual(blocks, OverloadGovernor::kBlocksToEscalate);
+
+      // Each further step waits for the previous one to take effect
+      for (int i = 0; i < OverloadGovernor::kBlocksToEscalate - 1; ++i)
+        governor.update(0.95, 2000 + i, true);
+      expect(governor.getLevel() == ShedLevel::SkipMeters);
+      for (int i = 0; i < 100; ++i) governor.update(0.95, 3000 + i, true);
+      expect(governor.getLevel() == ShedLevel::DropNormalPriority);
+
+      auto actions = governor.getActionsSince(0);
+      expectEquals(actions.size(), 4);
+      expect(actions[0].from == ShedLevel::None);
+      expect(actions[0].to == ShedLevel::SkipMeters);
+      expectEquals(actions[0].master_pos, (int64_t)(1000 + blocks - 1));
+      expect(actions[3].to == ShedLevel::DropNormalPriority);
+      expectEquals(governor.getActionsSince(2).size(), 2);
+    }
+
+    beginTest("An Overrun Sheds At Once And Recovery Is Slow");
+    {
+      OverloadGovernor governor;
+      governor.update(1.4, 0, true);
+      expect(governor.getLevel() == ShedLevel::SkipMeters);
+
+      for (int i = 0; i < OverloadGovernor::kBlocksToRecover - 1; ++i)
+        governor.update(0.1, i, true);
+      expect(governor.getLevel() == ShedLevel::SkipMeters);
+      governor.update(0.1, 0, true);
+      expect(governor.getLevel() == ShedLevel::None);
+      expectEquals(governor.getNumActions(), (int64_t)2);
+    }
+
+    beginTest("Never Sheds Where Output Must Not Depend On Timing");
+    {
+      OverloadGovernor governor;
+      governor.update(2.0, 0, true);
+      expect(governor.getLevel() == ShedLevel::SkipMeters);
+      expect(governor.update(2.0, 512, false) == ShedLevel::None);
+      expect(governor.update(2.0, 1024, false) == ShedLevel::None);
+
+      auto actions = governor.getActionsSince(0);
+      expectEquals(actions.size(), 2);
+      expect(actions[1].to == ShedLevel::None);
+      expect(OverloadGovernor::describe(actions[1]).contains("restoring"));
+    }
+
+    beginTest("Dropped Clips Fade Out By Priority");
+    {
+      const int block = 2 * ClipNode::kShedFadeSamples;
+      ClipNode low("Low", 44100.0), essential("Essential", 44100.0);
+      low.setPriority(NodePriority::Low);
+      essential.setPriority(NodePriority::Essential);
+      recordConstant(low, 4 * block);
+      recordConstant(essential, 4 * block);
+
+      ProcessContext context;
+      context.num_samples = block;
+      context.is_playing = true;
+
+      auto output = render(low, context);
+      expectEquals(output.front(), 0.5f);
+      expectEquals(output.back(), 0.5f);
+
+      context.shed_level = ShedLevel::SkipSilenced;
+      expectEquals(render(low, context).back(), 0.5f);
+
+      // Low priority goes first, with a short fade rather than a click
+      context.shed_level = ShedLevel::DropLowPriority;
+      output = render(low, context);
+      expectGreaterThan(output.front(), 0.49f);
+      expectLessThan(output[ClipNode::kShedFadeSamples / 2], 0.3f);
+      expectEquals(output[ClipNode::kShedFadeSamples], 0.0f);
+      expectEquals(render(low, context).front(), 0.0f);
+
+      context.shed_level = ShedLevel::DropNormalPriority;
+      expectEquals(render(essential, context).back(), 0.5f);
+
+      // Restored with a fade in
+      context.shed_level = ShedLevel::None;
+      output = render(low, context);
+      expectLessThan(output.front(), 0.01f);
+      expectEquals(output.back(), 0.5f);
+    }
+  }
+
+ private:
+  static void recordConstant(ClipNode &node, int num_samples) {
+    std::vector<float> input((size_t)num_samples, 0.5f);
+    float *const inputs[] = {input.data()};
+    ProcessContext context;
+    context.num_samples = num_samples;
+    context.is_recording = true;
+    node.startRecording();
+    node.process(inputs, nullptr, 1, 0, context);
+    node.stopRecording();
+  }
+
+  static std::vector<float> render(ClipNode &node,
+                                   const ProcessContext &context) {
+    std::vector<float> output((size_t)context.num_samples, 0.0f);
+    float *const outputs[] = {output.data()};
+    node.process(nullptr, outputs, 0, 1, context);
+    return output;
+  }
+};
+
+static OverloadGovernorTests overloadGovernorTests;
+
+}  // namespace celestrian
@@ -0,0 +1,95 @@
+#include <juce_core/juce_core.h>
+
+#include <mutex>
+#include <vector>
+
+#include "../src/audio_engine.h"
+#include "../src/realtime_checks.h"
+
+namespace celestrian {
+
+/**
+ * Realtime-safety regression tests. Only meaningful in builds configured
+ * with -DCELESTRIAN_REALTIME_CHECKS=ON; otherwise they just report skipping.
+ */
+class RealtimeChecksTests : public juce::UnitTest {
+ public:
+  RealtimeChecksTests() : juce::UnitTest("RealtimeChecks", "Realtime") {}
+
+  void runTest() override {
+    if (!realtime::kChecksEnabled) {
+      beginTest("Skipped (CELESTRIAN_REALTIME_CHECKS is OFF)");
+      expect(realtime::getViolationCounts().total() == 0);
+      return;
+    }
+
+    beginTest("Detector Catches Violations Only On Realtime Threads");
+    {
+      std::mutex mutex;
+      realtime::resetViolationCounts();
+
+      // Not realtime: nothing counted
+      {
+        std::vector<int> allowed(16);
+        std::lock_guard<std::mutex> lock(mutex);
+      }
+      expectEquals(realtime::getViolationCounts().total(), (int64_t)0);
+
+      {
+        realtime::ScopedRealtimeThread realtime_thread;
+        std::vector<int> allocates(16);
+        std::lock_guard<std::mutex> lock(mutex);
+        juce::Thread::sleep(1);
+      }
+      auto counts = realtime::getViolationCounts();
+      expect(counts.allocations >= 1, "Allocation not detected");
+      expect(counts.locks >= 1, "Lock not detected");
+      expect(counts.blocking_calls >= 1, "Sleep not detected");
+
+      realtime::resetViolationCounts();
+      {
+        realtime::ScopedRealtimeThread realtime_thread;
+        realtime::ScopedAllowViolations allow;
+        std::vector<int> excused(16);
+      }
+      expectEquals(realtime::getViolationCounts().total(), (int64_t)0);
+    }
+
+    beginTest("Steady-State Playback Neither Allocates Nor Blocks");
+    {
+      AudioEngine engine;
+      engine.createNode("clip");
+      auto uuid = engine.getGraphState()["nodes"][0]["id"].toString();
+
+      const int block_size = 512;
+      std::vector<float> input(block_size, 0.25f);
+      std::vector<float> left(block_size), right(block_size);
+      const float* inputs[] = {input.data()};
+      float* outputs[] = {left.data(), right.data()};
+      auto runBlocks = [&](int count) {
+        for (int i = 0; i < count; ++i)
+          engine.audioDeviceIOCallbackWithContext(
+              inputs, 1, outputs, 2, block_size,
+              juce::AudioIODeviceCallbackContext{});
+      };
+
+      // Record and commit a first clip; counting starts with the first
+      // block that plays it
+      engine.startRecordingInNode(uuid);
+      runBlocks(40);
+      engine.stopRecordingInNode(uuid);
+
+      realtime::resetViolationCounts();
+      runBlocks(200);
+      auto counts = realtime::getViolationCounts();
+
+      expectEquals(counts.allocations, (int64_t)0);
+      expectEquals(counts.locks, (int64_t)0);
+      expectEquals(counts.blocking_calls, (int64_t)0);
+    }
+  }
+};
+
+static RealtimeChecksTests realtimeChecksTests;
+
+}  // namespace celestrian
@@ -0,0 +1,67 @@
+#include <juce_core/juce_core.h>
+
+#include <vector>
+
+#include "../src/clip_node.h"
+#include "../src/recording_log.h"
+
+namespace celestrian {
+
+class RecordingLogTests : public juce::UnitTest {
+ public:
+  RecordingLogTests() : juce::UnitTest("RecordingLog", "Audio Engine") {}
+
+  void runTest() override {
+    beginTest("A Boundary Commit Is Logged From The Block");
+    {
+      RecordingLog log;
+      ClipNode clip("Clip", 1000.0);
+      std::vector<float> input(100, 0.5f);
+      const float *inputs[] = {input.data()};
+
+      ProcessContext context;
+      context.num_samples = 100;
+      context.is_recording = true;
+      context.recording_log = &log;
+      auto runBlock = [&] {
+        clip.process(inputs, nullptr, 1, 0, context);
+        context.master_pos += context.num_samples;
+      };
+
+      clip.startRecording();
+      for (int i = 0; i < 3; ++i) runBlock();
+      expect(!clip.stopRecording(1000), "Waits for the boundary");
+      while (clip.isRecording() && context.master_pos < 2000) runBlock();
+      expect(!clip.isRecording());
+
+      auto entries = log.getEntriesSince(0);
+      expectEquals(entries.size(), 2);
+      expect(entries[0].type == RecordingLog::EntryType::Started);
+      expect(entries[1].type == RecordingLog::EntryType::Committed);
+      // Under half the quantum: the stop waited for Q / 2
+      expect(entries[1].snap == RecordingLog::Snap::Anticipatory);
+      expectEquals(entries[1].duration, (int64_t)500);
+      expectEquals(clip.getDurationSamples(), (int64_t)500);
+      expect(RecordingLog::describe(entries[1]).contains("B=500"));
+      expectEquals(log.getEntriesSince(2).size(), 0);
+    }
+
+    beginTest("Keeps The Latest Entries");
+    {
+      RecordingLog log;
+      RecordingLog::Entry entry;
+      for (int i = 0; i < RecordingLog::kHistorySize + 4; ++i) {
+        entry.master_pos = i;
+        log.add(entry);
+      }
+      auto entries = log.getEntriesSince(0);
+      expectEquals(entries.size(), RecordingLog::kHistorySize);
+      expectEquals(entries[0].index, (int64_t)4);
+      expectEquals(entries[0].master_pos, (int64_t)4);
+    }
+  }
+};
+
+static RecordingLogTests recordingLogTests;
+
+}  // namespace celestrian
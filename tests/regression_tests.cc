@@ -98,8 +98,8 @@ class AudioEngineWorkflowTests : public juce::UnitTest {
 
       // Debug output
       int64_t anchor = clip2Ptr->anchor_phase_samples.load();
-      int64_t launch = clip2Ptr->launch_point_samples.load();
-      int64_t duration = clip2Ptr->duration_samples.load();
+      int64_t launch = clip2Ptr->getLaunchPoint();
+      int64_t duration = clip2Ptr->getDurationSamples();
 
       juce::Logger::writeToLog(
           "TEST DEBUG: Clip2 anchor=" + juce::String(anchor) + ", launch=" +
@@ -127,7 +127,7 @@ class AudioEngineWorkflowTests : public juce::UnitTest {
 
       clip2Ptr->process(nullptr, outputs, 0, 2, ctx);
 
-      double playhead = clip2Ptr->playhead_pos.load();
+      double playhead = clip2Ptr->getPlayheadPosition();
       juce::Logger::writeToLog(
           "TEST PLAYBACK: At commit_pos=" + juce::String(commit_pos) +
           ", playhead=" + juce::String(playhead));
@@ -0,0 +1,174 @@
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../src/box_node.h"
+#include "../src/clip_node.h"
+#include "../src/render_ahead.h"
+
+namespace celestrian {
+
+class RenderAheadTests : public juce::UnitTest {
+ public:
+  RenderAheadTests() : juce::UnitTest("RenderAhead", "Audio Engine") {}
+
+  void runTest() override {
+    // Declared first: it must outlive the boxes it renders
+    RenderAheadPool pool(false);
+
+    const int block = 64;
+    const int64_t timeline = 900;  // LCM of the two loop lengths
+    BoxNode ahead("Ahead"), live("Live");
+    for (auto *box : {&ahead, &live}) {
+      box->addChild(makeClip("Short", 300));
+      box->addChild(makeClip("Long", 450));
+      box->prepare(44100.0, block, 1);
+    }
+    ahead.enableRenderAhead(pool);
+
+    ProcessContext context;
+    context.num_samples = block;
+    context.is_playing = true;
+    context.timeline_length = timeline;
+
+    beginTest("Pre-Rendered Blocks Match The Live Graph Exactly");
+    {
+      bool matches = true;
+      for (int i = 0; i < 40; ++i) {
+        pool.renderRound();
+        matches = matches && render(ahead, context) == render(live, context);
+        advance(context);
+      }
+      expect(matches);
+
+      const auto *state = ahead.getRenderAhead();
+      expect(state != nullptr);
+      // Only the first block anchors; every later one was rendered ahead
+      expectEquals(state->getNumMisses(), (int64_t)1);
+      expectEquals(state->getNumHits(), (int64_t)39);
+      auto metadata = ahead.getMetadata(MetadataQuery{});
+      expect(metadata.getProperty("renderAhead", {}).isObject());
+    }
+
+    beginTest("A Graph Change Falls Back To Live Rendering");
+    {
+      const auto *state = ahead.getRenderAhead();
+      const auto hits = state->getNumHits();
+      const auto misses = state->getNumMisses();
+
+      // What was rendered ahead assumed the old graph
+      ++context.graph_generation;
+      pool.renderRound();
+      expect(render(ahead, context) == render(live, context));
+      expectEquals(state->getNumHits(), hits);
+      expectEquals(state->getNumMisses(), misses + 1);
+      advance(context);
+
+      // Back on track from the next block
+      for (int i = 0; i < 4; ++i) {
+        pool.renderRound();
+        expect(render(ahead, context) == render(live, context));
+        advance(context);
+      }
+      expectEquals(state->getNumHits(), hits + 4);
+
+      // A jump of the transport is a miss too
+      context.master_pos = (context.master_pos + 7) % timeline;
+      pool.renderRound();
+      expect(render(ahead, context) == render(live, context));
+      expectEquals(state->getNumMisses(), misses + 2);
+    }
+
+    beginTest("A Recording Child Is Never Rendered Ahead");
+    {
+      BoxNode box("Recording");
+      auto clip = std::make_unique<ClipNode>("Take", 44100.0);
+      auto *take = clip.get();
+      box.addChild(std::move(clip));
+      box.prepare(44100.0, block, 1);
+      take->startRecording();
+
+      std::vector<float> output((size_t)block, 0.0f);
+      float *const outputs[] = {output.data()};
+      RenderScratch scratch;
+      scratch.prepare(block, 1);
+      expect(!box.renderAhead(outputs, 1, context, scratch));
+    }
+
+    beginTest("The Worker Never Waits For A Box's Lock");
+    {
+      std::vector<float> output((size_t)block, 0.0f);
+      float *const outputs[] = {output.data()};
+      RenderScratch scratch;
+      scratch.prepare(block, 1);
+      expect(live.renderAhead(outputs, 1, context, scratch));
+
+      // Another thread holds children_mutex, e.g. a graph query
+      std::atomic<bool> locked{false}, done{false};
+      std::thread holder([&] {
+        live.forEachChild([&](const AudioNode &) {
+          locked.store(true);
+          while (!done.load()) std::this_thread::yield();
+        });
+      });
+      while (!locked.load()) std::this_thread::yield();
+      expect(!live.renderAhead(outputs, 1, context, scratch),
+             "Gives the block up to the live render");
+      done.store(true);
+      holder.join();
+      expect(live.renderAhead(outputs, 1, context, scratch));
+    }
+
+    beginTest("Disabled Boxes Render Live");
+    {
+      ahead.disableRenderAhead();
+      expect(!ahead.isRenderAheadEnabled());
+      const auto hits = ahead.getRenderAhead()->getNumHits();
+      for (int i = 0; i < 4; ++i) {
+        pool.renderRound();
+        expect(render(ahead, context) == render(live, context));
+        advance(context);
+      }
+      expectEquals(ahead.getRenderAhead()->getNumHits(), hits);
+    }
+  }
+
+ private:
+  // A committed clip of `num_samples`, looping a ramp
+  static std::unique_ptr<ClipNode> makeClip(const juce::String &name,
+                                            int num_samples) {
+    auto clip = std::make_unique<ClipNode>(name, 44100.0);
+    std::vector<float> input((size_t)num_samples);
+    for (int i = 0; i < num_samples; ++i)
+      input[(size_t)i] = (float)i / (float)num_samples - 0.5f;
+    const float *const inputs[] = {input.data()};
+    ProcessContext context;
+    context.num_samples = num_samples;
+    context.is_recording = true;
+    clip->startRecording();
+    clip->process(inputs, nullptr, 1, 0, context);
+    clip->stopRecording();
+    return clip;
+  }
+
+  static std::vector<float> render(BoxNode &box,
+                                   const ProcessContext &context) {
+    std::vector<float> output((size_t)context.num_samples, 0.0f);
+    float *const outputs[] = {output.data()};
+    box.process(nullptr, outputs, 0, 1, context);
+    return output;
+  }
+
+  // Moves the transport on a block, the way the engine does
+  static void advance(ProcessContext &context) {
+    context.master_pos =
+        (context.master_pos + context.num_samples) % context.timeline_length;
+    context.sample_time += context.num_samples;
+  }
+};
+
+static RenderAheadTests renderAheadTests;
+
+}  // namespace celestrian
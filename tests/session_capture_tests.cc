@@ -0,0 +1,120 @@
+#include <juce_core/juce_core.h>
+
+#include <cmath>
+
+#include "../src/audio_engine.h"
+#include "../src/offline_device_backend.h"
+#include "../src/session_capture.h"
+#include "../src/session_replay.h"
+
+namespace celestrian {
+
+class SessionCaptureTests : public juce::UnitTest {
+ public:
+  SessionCaptureTests() : juce::UnitTest("SessionCapture", "Audio Engine") {}
+
+  void runTest() override {
+    beginTest("Replays A Live Run Bit For Bit");
+    {
+      juce::TemporaryFile capture_file(".ccap");
+      DeviceConfig config;
+      config.num_inputs = 2;
+      config.input_latency = 64;
+      AudioEngine engine(std::make_unique<OfflineDeviceBackend>(config));
+      auto &backend =
+          static_cast<OfflineDeviceBackend &>(engine.getDeviceBackend());
+      backend.setInputSignal([](int channel, int64_t index) {
+        return 0.25f * (float)std::sin(0.01 * (double)index) +
+               (channel == 1 ? 0.1f : 0.0f);
+      });
+
+      expect(engine.startCapture(capture_file.getFile()));
+      expect(engine.isCapturing());
+
+      auto first = engine.createNode("clip");
+      auto second = engine.createNode("clip", 10.0, 130.0);
+      engine.setNodeInput(second, 1);
+
+      // Uneven blocks, as some devices deliver them
+      engine.startRecordingInNode(first);
+      for (int i = 0; i < 40; ++i) backend.renderBlock(i % 2 ? 512 : 300);
+      engine.stopRecordingInNode(first);
+      backend.renderBlocks(10);
+
+      engine.startRecordingInNode(second);
+      backend.renderBlocks(20);
+      engine.stopRecordingInNode(second);
+      backend.renderBlocks(10);
+      engine.toggleMute(first);
+      backend.renderBlocks(10);
+
+      auto summary = engine.stopCapture();
+      expect(!engine.isCapturing());
+      expectEquals((int)summary["blocks"], 90);
+      expectEquals((int)summary["commands"], 8);
+      expectEquals((int)summary["droppedBlocks"], 0);
+
+      int64_t replayed_samples = 0;
+      ReplayOptions options;
+      options.sink = [&](const float *const *, int, int num_samples) {
+        replayed_samples += num_samples;
+      };
+      auto result = replayCapture(capture_file.getFile(), options);
+      expect(result.complete, result.error);
+      expect(result.isIdentical(), "Replay should match the live output");
+      expectEquals(result.blocks, (int64_t)90);
+      expectEquals(result.commands, (int64_t)8);
+      expectEquals(replayed_samples, backend.getSamplesRendered());
+    }
+
+    beginTest("Needs An Empty Stopped Session");
+    {
+      juce::TemporaryFile capture_file(".ccap");
+      AudioEngine engine;
+      engine.createNode("clip");
+      expect(!engine.startCapture(capture_file.getFile()));
+      expect(engine.stopCapture().isVoid());
+    }
+
+    beginTest("Reports Diverging Output");
+    {
+      juce::TemporaryFile capture_file(".ccap");
+      CaptureHeader header;
+      header.config.block_size = 64;
+      {
+        auto capture = SessionCapture::create(capture_file.getFile(), header);
+        expect(capture != nullptr);
+
+        // A "live" run that output a tone where an empty session is silent
+        juce::AudioBuffer<float> input(1, 64), output(2, 64);
+        input.clear();
+        output.clear();
+        for (int block = 0; block < 4; ++block) {
+          if (block == 2) output.setSample(0, 10, 0.5f);
+          capture->captureBlock(input.getArrayOfReadPointers(), 1,
+                                output.getArrayOfReadPointers(), 2, 64, 0);
+        }
+        capture->finish();
+      }
+
+      auto result = replayCapture(capture_file.getFile());
+      expect(result.complete);
+      expect(!result.isIdentical());
+      expectEquals(result.mismatched_blocks, (int64_t)2);
+      expectEquals(result.first_mismatch_block, (int64_t)2);
+    }
+
+    beginTest("Rejects Other Files");
+    {
+      juce::TemporaryFile not_a_capture(".ccap");
+      not_a_capture.getFile().replaceWithText("hello");
+      auto result = replayCapture(not_a_capture.getFile());
+      expect(!result.complete);
+      expect(result.error.isNotEmpty());
+    }
+  }
+};
+
+static SessionCaptureTests sessionCaptureTests;
+
+}  // namespace celestrian
@@ -0,0 +1,106 @@
+#include <juce_core/juce_core.h>
+
+#include "../src/trace_recorder.h"
+
+namespace celestrian {
+
+class TraceRecorderTests : public juce::UnitTest {
+ public:
+  TraceRecorderTests() : juce::UnitTest("TraceRecorder", "Diagnostics") {}
+
+  void runTest() override {
+    beginTest("Writes Chrome Trace Events From Several Threads");
+    {
+      juce::TemporaryFile temp(".json");
+      auto& recorder = TraceRecorder::getInstance();
+      expect(recorder.start(temp.getFile()));
+      expect(!recorder.start(temp.getFile()), "Only one trace at a time");
+
+      {
+        CELESTRIAN_TRACE_SCOPE("test", "outer");
+        CELESTRIAN_TRACE_SCOPE("test", "inner");
+      }
+
+      juce::WaitableEvent done;
+      juce::Thread::launch([&] {
+        TraceRecorder::nameCurrentThread("Test Worker");
+        { CELESTRIAN_TRACE_SCOPE("test", "worker"); }
+        done.signal();
+      });
+      expect(done.wait(5000));
+
+      expectEquals(recorder.stop(), (int64_t)0, "No events dropped");
+      expect(!TraceRecorder::isEnabled());
+
+      auto parsed = juce::JSON::parse(temp.getFile().loadFileAsString());
+      auto* events = parsed.getArray();
+      expect(events != nullptr, "Trace must be a JSON array");
+
+      int begins = 0, ends = 0;
+      bool saw_worker_name = false;
+      juce::StringArray names;
+      for (const auto& event : *events) {
+        auto phase = event["ph"].toString();
+        if (phase == "B") {
+          ++begins;
+          names.add(event["name"].toString());
+        }
+        if (phase == "E") ++ends;
+        if (phase == "M" && event["args"]["name"] == "Test Worker")
+          saw_worker_name = true;
+      }
+      expectEquals(begins, 3);
+      expectEquals(ends, 3);
+      expect(names.contains("outer") && names.contains("inner") &&
+             names.contains("worker"));
+      expect(saw_worker_name, "Threads are labelled with metadata events");
+    }
+
+    beginTest("Disabled Scopes Record Nothing");
+    {
+      juce::TemporaryFile temp(".json");
+      { CELESTRIAN_TRACE_SCOPE("test", "before start"); }
+
+      auto& recorder = TraceRecorder::getInstance();
+      expect(recorder.start(temp.getFile()));
+      recorder.stop();
+
+      auto parsed = juce::JSON::parse(temp.getFile().loadFileAsString());
+      for (const auto& event : *parsed.getArray())
+        expect(event["ph"].toString() == "M", "Only metadata expected");
+    }
+
+    beginTest("Escapes Names In The JSON");
+    {
+      juce::TemporaryFile temp(".json");
+      const juce::String awkward("a\\b\"c\n");
+      auto& recorder = TraceRecorder::getInstance();
+      expect(recorder.start(temp.getFile()));
+      { CELESTRIAN_TRACE_SCOPE("test", TraceRecorder::intern(awkward)); }
+      recorder.stop();
+
+      auto parsed = juce::JSON::parse(temp.getFile().loadFileAsString());
+      auto* events = parsed.getArray();
+      expect(events != nullptr, "Trace must stay valid JSON");
+
+      int matching = 0;
+      for (const auto& event : *events)
+        if (event["ph"].toString() == "B" &&
+            event["name"].toString() == awkward)
+          ++matching;
+      expectEquals(matching, 1);
+    }
+
+    beginTest("Interned Names Are Stable");
+    {
+      auto* a = TraceRecorder::intern("Guitar");
+      auto* b = TraceRecorder::intern(juce::String("Gui") + "tar");
+      expect(a == b);
+      expectEquals(juce::String(a), juce::String("Guitar"));
+    }
+  }
+};
+
+static TraceRecorderTests traceRecorderTests;
+
+}  // namespace celestrian
@@ -0,0 +1,106 @@
+#include <juce_core/juce_core.h>
+
+#include <vector>
+
+#include "../src/audio_engine.h"
+#include "../src/box_node.h"
+#include "../src/clip_node.h"
+#include "../src/offline_device_backend.h"
+#include "../src/transport_scheduler.h"
+
+namespace celestrian {
+
+class TransportSchedulerTests : public juce::UnitTest {
+ public:
+  TransportSchedulerTests()
+      : juce::UnitTest("TransportScheduler", "Audio Engine") {}
+
+  void runTest() override {
+    beginTest("Dispatches In Time Order");
+    {
+      TransportScheduler scheduler;
+      expectEquals(scheduler.getNextEventTime(), TransportScheduler::kNoEvent);
+
+      scheduler.schedule(makeEvent(300, 1));
+      scheduler.schedule(makeEvent(100, 2));
+      scheduler.schedule(makeEvent(300, 3));  // Same time: after the first
+      scheduler.schedule(makeEvent(200, 4));
+      expectEquals(scheduler.getNumPending(), 4);
+      expectEquals(scheduler.getNextEventTime(), (int64_t)100);
+
+      std::vector<int64_t> order;
+      auto record = [&](const TransportEvent &event) {
+        order.push_back(event.value);
+      };
+      scheduler.dispatchDue(99, record);
+      expect(order.empty(), "Nothing is due before its time");
+      scheduler.dispatchDue(300, record);
+      expect(order == std::vector<int64_t>({2, 4, 1, 3}));
+      expectEquals(scheduler.getNumPending(), 0);
+    }
+
+    beginTest("Refuses Events When Full");
+    {
+      TransportScheduler scheduler;
+      for (int i = 0; i < TransportScheduler::kCapacity; ++i)
+        expect(scheduler.schedule(makeEvent(i, i)));
+      expect(!scheduler.schedule(makeEvent(0, 0)));
+      scheduler.clear();
+      expectEquals(scheduler.getNumPending(), 0);
+    }
+
+    beginTest("Recording Starts And Stops On The Exact Boundary");
+    {
+      // Device blocks of 512 samples and a 1000-sample quantum: boundaries
+      // fall mid-block
+      AudioEngine engine(std::make_unique<OfflineDeviceBackend>());
+      auto &backend =
+          static_cast<OfflineDeviceBackend &>(engine.getDeviceBackend());
+      // Each input sample is its own index, so a buffer shows where it began
+      backend.setInputSignal(
+          [](int, int64_t index) { return (float)index; });
+
+      auto root = std::make_unique<BoxNode>("Root");
+      auto *first = new ClipNode("First");
+      auto *second = new ClipNode("Second");
+      root->addChild(std::unique_ptr<AudioNode>(first));
+      root->addChild(std::unique_ptr<AudioNode>(second));
+      engine.setRootNode(std::move(root));
+
+      // The first clip sets the quantum: 1000 samples
+      engine.startRecordingInNode(first->getUuid());
+      backend.renderBlock(500);
+      backend.renderBlock(500);
+      engine.stopRecordingInNode(first->getUuid());
+      expectEquals(first->getIntrinsicDuration(), (int64_t)1000);
+      backend.renderBlock(300);
+
+      // 300 samples into the quantum: the next boundary is 700 away
+      engine.startRecordingInNode(second->getUuid());
+      backend.renderBlocks(4);
+      expect(second->isRecording());
+      expectEquals(second->getAudioBuffer().getSample(0, 0), 2000.0f);
+
+      // Stops on the next boundary after 1348 samples: 2000
+      engine.stopRecordingInNode(second->getUuid());
+      backend.renderBlocks(3);
+      expect(!second->isRecording());
+      expectEquals(second->getIntrinsicDuration(), (int64_t)2000);
+      expectEquals(second->getAudioBuffer().getSample(0, 1999), 3999.0f);
+      expectEquals(second->getCommitMasterPos() % 1000, (int64_t)0);
+      expectEquals((int)engine.getTransportClock()["scheduledEvents"], 0);
+    }
+  }
+
+ private:
+  static TransportEvent makeEvent(int64_t time, int64_t value) {
+    TransportEvent event;
+    event.time = time;
+    event.value = value;
+    return event;
+  }
+};
+
+static TransportSchedulerTests transportSchedulerTests;
+
+}  // namespace celestrian
@@ -0,0 +1,112 @@
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_core/juce_core.h>
+
+#include <iostream>
+
+#include "../../src/session_capture.h"
+#include "../../src/session_replay.h"
+
+namespace {
+// Replayed commands log exactly as they did live; that's noise here.
+class SilentLogger : public juce::Logger {
+  void logMessage(const juce::String &) override {}
+};
+
+void printUsage() {
+  std::cout
+      << "Usage: CelestrianReplay <capture.ccap> [options]\n"
+         "  --wav <file>          Write the replayed output as 32-bit WAV\n"
+         "  --repeat <n>          Replay n times and report each run's speed\n"
+         "                        (a deterministic profiling workload)\n"
+         "  --stop-on-mismatch    Stop at the first block that differs\n";
+}
+}  // namespace
+
+/**
+ * Replays a capture offline and checks it against the live run. Exit code
+ * 1 if the replay isn't bit-identical.
+ */
+int main(int argc, char *argv[]) {
+  juce::ArgumentList args(argc, argv);
+  if (args.containsOption("--help|-h") || args.size() == 0 ||
+      args[0].isOption()) {
+    printUsage();
+    return args.containsOption("--help|-h") ? 0 : 1;
+  }
+
+  auto capture_file = args[0].resolveAsFile();
+  auto wav_path = args.getValueForOption("--wav");
+  auto repeat = args.getValueForOption("--repeat");
+  const int num_runs = repeat.isNotEmpty() ? std::max(1, repeat.getIntValue())
+                                           : 1;
+
+  celestrian::CaptureReader reader(capture_file);
+  if (!reader.isValid()) {
+    std::cout << "Not a capture file: " << capture_file.getFullPathName()
+              << std::endl;
+    return 1;
+  }
+  const auto config = reader.getHeader().config;
+  std::cout << "Capture: " << config.sample_rate << " Hz, "
+            << config.block_size << "-sample blocks, " << config.num_inputs
+            << " in / " << config.num_outputs << " out" << std::endl;
+
+  SilentLogger silent_logger;
+  juce::Logger::setCurrentLogger(&silent_logger);
+
+  bool identical = true;
+  for (int run = 0; run < num_runs; ++run) {
+    celestrian::ReplayOptions options;
+    options.stop_on_mismatch = args.containsOption("--stop-on-mismatch");
+
+    // Only the first run writes audio; the rest only time the engine
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    if (run == 0 && wav_path.isNotEmpty()) {
+      auto wav_file =
+          juce::File::getCurrentWorkingDirectory().getChildFile(wav_path);
+      wav_file.deleteFile();
+      auto stream = wav_file.createOutputStream();
+      juce::WavAudioFormat wav;
+      if (stream != nullptr)
+        writer.reset(wav.createWriterFor(
+            stream.get(), config.sample_rate,
+            (unsigned int)std::max(1, config.num_outputs), 32, {}, 0));
+      if (writer == nullptr) {
+        std::cout << "Cannot write " << wav_file.getFullPathName()
+                  << std::endl;
+        return 1;
+      }
+      stream.release();  // Owned by the writer
+      options.sink = [&writer](const float *const *channels, int num_channels,
+                               int num_samples) {
+        writer->writeFromFloatArrays(channels, num_channels, num_samples);
+      };
+    }
+
+    auto result = celestrian::replayCapture(capture_file, options);
+    writer.reset();
+
+    if (result.error.isNotEmpty()) std::cout << result.error << std::endl;
+    std::cout << "Run " << run + 1 << ": " << result.blocks << " blocks, "
+              << result.commands << " commands, "
+              << juce::String((double)result.samples / result.sample_rate, 1)
+              << " s of audio in " << juce::String(result.render_ms, 1)
+              << " ms (" << juce::String(result.getRealtimeFactor(), 1)
+              << "x realtime)" << std::endl;
+
+    if (result.dropped_blocks > 0)
+      std::cout << "  The live run dropped " << result.dropped_blocks
+                << " blocks" << std::endl;
+    if (result.mismatched_blocks > 0)
+      std::cout << "  " << result.mismatched_blocks
+                << " blocks differ from the live run, the first at block "
+                << result.first_mismatch_block << std::endl;
+    identical &= result.isIdentical();
+  }
+
+  juce::Logger::setCurrentLogger(nullptr);
+  std::cout << (identical ? "Output is bit-identical to the live run"
+                          : "Output DIFFERS from the live run")
+            << std::endl;
+  return identical ? 0 : 1;
+}
@@ -0,0 +1,444 @@
+#include <juce_core/juce_core.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+#include "../../src/audio_engine.h"
+#include "../../src/offline_device_backend.h"
+#include "synthetic_session.h"
+
+/**
+ * CelestrianSoak: drives a large synthetic session through the engine for a
+ * long time while simulated UI traffic polls and mutates it, and reports
+ * callback deadline misses, memory growth and state latency percentiles.
+ */
+
+namespace {
+
+// Recording start/commit logs from the render loop would drown the periodic
+// report.
+class SilentLogger : public juce::Logger {
+  void logMessage(const juce::String &) override {}
+};
+
+struct SoakOptions {
+  celestrian::soak::SyntheticSessionOptions session;
+  double minutes = 60.0;
+  double report_interval_s = 10.0;
+  bool realtime = true;      // Pace blocks at the device rate
+  int query_threads = 2;     // Simulated bridge jobs (graph state, waveforms)
+  double query_rate = 50.0;  // Per thread, per second (0 = flat out)
+  int armed_clips = 4;       // Full-size clips the UI records into
+  juce::String out;
+};
+
+void printUsage() {
+  std::cout
+      << "Usage: CelestrianSoak [options]\n"
+         "  --clips <n>            Synthetic clips (default 2000)\n"
+         "  --depth <n>            Maximum box nesting (default 8)\n"
+         "  --minutes <n>          Run time (default 60)\n"
+         "  --report <seconds>     Report interval (default 10)\n"
+         "  --fast                 Render flat out instead of in real time\n"
+         "  --query-threads <n>    Simulated bridge job threads (default 2)\n"
+         "  --query-rate <n>       Queries per second per thread (default 50)\n"
+         "  --seed <n>             Session seed (default 1)\n"
+         "  --out <file>           Write the final report as JSON\n";
+}
+
+int64_t getResidentBytes() {
+#if defined(__linux__)
+  long pages = 0, resident = 0;
+  if (auto *statm = std::fopen("/proc/self/statm", "r")) {
+    if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    std::fclose(statm);
+  }
+  return (int64_t)resident * (int64_t)sysconf(_SC_PAGESIZE);
+#elif defined(__APPLE__)
+  mach_task_basic_info info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                (task_info_t)&info, &count) != KERN_SUCCESS)
+    return 0;
+  return (int64_t)info.resident_size;
+#else
+  return 0;
+#endif
+}
+
+double toMegabytes(int64_t bytes) { return (double)bytes / (1024.0 * 1024.0); }
+
+/**
+ * Latency samples per operation, for one report interval and for the run.
+ */
+class LatencyLog {
+ public:
+  struct Percentiles {
+    int count = 0;
+    double p50_ms = 0.0, p90_ms = 0.0, p99_ms = 0.0, max_ms = 0.0;
+  };
+
+  void add(const juce::String &operation, double ms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    interval[operation].push_back(ms);
+  }
+
+  /** Returns the interval's percentiles per operation and starts a new one. */
+  std::map<juce::String, Percentiles> closeInterval() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<juce::String, Percentiles> result;
+    for (auto &[operation, samples] : interval) {
+      result[operation] = summarize(samples);
+      auto &all = totals[operation];
+      all.insert(all.end(), samples.begin(), samples.end());
+      samples.clear();
+    }
+    return result;
+  }
+
+  std::map<juce::String, Percentiles> getTotals() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<juce::String, Percentiles> result;
+    for (auto &[operation, samples] : totals)
+      result[operation] = summarize(samples);
+    return result;
+  }
+
+ private:
+  static Percentiles summarize(std::vector<double> samples) {
+    Percentiles p;
+    p.count = (int)samples.size();
+    if (samples.empty()) return p;
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double q) {
+      return samples[std::min(samples.size() - 1,
+                              (size_t)(q * (double)samples.size()))];
+    };
+    p.p50_ms = at(0.5);
+    p.p90_ms = at(0.9);
+    p.p99_ms = at(0.99);
+    p.max_ms = samples.back();
+    return p;
+  }
+
+  std::mutex mutex;
+  std::map<juce::String, std::vector<double>> interval;
+  std::map<juce::String, std::vector<double>> totals;
+};
+
+double timeMs(const std::function<void()> &operation) {
+  const double start = juce::Time::getMillisecondCounterHiRes();
+  operation();
+  return juce::Time::getMillisecondCounterHiRes() - start;
+}
+
+/**
+ * What the message thread does on user input: mute, solo, and record
+ * takes into armed clips. The offline backend applies commands on the
+ * sender's thread, so these are sent from the render loop between blocks,
+ * never while one is rendering.
+ */
+class Mutations {
+ public:
+  Mutations(AudioEngine &engine, const juce::StringArray &clips,
+            const juce::StringArray &armed, LatencyLog &latencies)
+      : engine(engine),
+        clips(clips),
+        armed(armed),
+        latencies(latencies),
+        random(42) {}
+
+  /** Does at most one thing every 100 ms. */
+  void poll() {
+    const double now = juce::Time::getMillisecondCounterHiRes();
+    if (now < next_ms) return;
+    next_ms = now + 100.0;
+
+    const int choice = random.nextInt(10);
+    if (choice < 5) {
+      const auto &uuid = clips[random.nextInt(clips.size())];
+      latencies.add("toggleMute", timeMs([&] { engine.toggleMute(uuid); }));
+    } else if (choice < 7) {
+      const auto &uuid = clips[random.nextInt(clips.size())];
+      latencies.add("toggleSolo", timeMs([&] { engine.toggleSolo(uuid); }));
+    } else if (recording.isEmpty() && armed.size() > 0) {
+      recording = armed[random.nextInt(armed.size())];
+      recording_since_ms = now;
+      latencies.add("startRecording",
+                    timeMs([&] { engine.startRecordingInNode(recording); }));
+    } else if (recording.isNotEmpty() && now - recording_since_ms > 4000.0) {
+      latencies.add("stopRecording",
+                    timeMs([&] { engine.stopRecordingInNode(recording); }));
+      recording.clear();
+    }
+  }
+
+ private:
+  AudioEngine &engine;
+  const juce::StringArray &clips;
+  const juce::StringArray &armed;
+  LatencyLog &latencies;
+  juce::Random random;
+  juce::String recording;
+  double recording_since_ms = 0.0;
+  double next_ms = 0.0;
+};
+
+/**
+ * Renders the offline backend, optionally paced at the device rate, and
+ * sends the simulated user's mutations between blocks.
+ */
+class AudioThread : public juce::Thread {
+ public:
+  AudioThread(celestrian::OfflineDeviceBackend &backend, Mutations &mutations,
+              bool realtime)
+      : juce::Thread("Soak Audio"),
+        backend(backend),
+        mutations(mutations),
+        realtime(realtime) {}
+
+  void run() override {
+    const auto config = backend.getConfig();
+    const double block_ms = 1000.0 * config.block_size / config.sample_rate;
+    double next_block_ms = juce::Time::getMillisecondCounterHiRes();
+    while (!threadShouldExit()) {
+      backend.renderBlocks(1);
+      mutations.poll();
+      if (!realtime) continue;
+      next_block_ms += block_ms;
+      const double wait_ms =
+          next_block_ms - juce::Time::getMillisecondCounterHiRes();
+      if (wait_ms > 1.0)
+        juce::Thread::sleep((int)wait_ms);
+      else if (wait_ms < -100.0)
+        next_block_ms = juce::Time::getMillisecondCounterHiRes();  // Resync
+    }
+  }
+
+ private:
+  celestrian::OfflineDeviceBackend &backend;
+  Mutations &mutations;
+  const bool realtime;
+};
+
+/** What the bridge's job threads do: poll graph state, fetch waveforms. */
+class QueryThread : public juce::Thread {
+ public:
+  QueryThread(int index, AudioEngine &engine, const juce::StringArray &clips,
+              double rate, LatencyLog &latencies)
+      : juce::Thread("Soak Query " + juce::String(index)),
+        engine(engine),
+        clips(clips),
+        rate(rate),
+        latencies(latencies),
+        random(index + 1) {}
+
+  void run() override {
+    // What app.js asks for every poll
+    celestrian::MetadataQuery query;
+    query.max_depth = 1;
+    while (!threadShouldExit()) {
+      if (random.nextInt(10) < 7) {
+        latencies.add("getGraphState",
+                      timeMs([&] { engine.getGraphState(query); }));
+      } else {
+        const auto &uuid = clips[random.nextInt(clips.size())];
+        latencies.add("getWaveform",
+                      timeMs([&] { engine.getWaveform(uuid, 512); }));
+      }
+      if (rate > 0.0) wait((int)(1000.0 / rate));
+    }
+  }
+
+ private:
+  AudioEngine &engine;
+  const juce::StringArray &clips;
+  const double rate;
+  LatencyLog &latencies;
+  juce::Random random;
+};
+
+juce::var toVar(const std::map<juce::String, LatencyLog::Percentiles> &map) {
+  auto *obj = new juce::DynamicObject();
+  for (const auto &[operation, p] : map) {
+    auto *entry = new juce::DynamicObject();
+    entry->setProperty("count", p.count);
+    entry->setProperty("p50Ms", p.p50_ms);
+    entry->setProperty("p90Ms", p.p90_ms);
+    entry->setProperty("p99Ms", p.p99_ms);
+    entry->setProperty("maxMs", p.max_ms);
+    obj->setProperty(operation, juce::var(entry));
+  }
+  return juce::var(obj);
+}
+
+SoakOptions parseOptions(const juce::ArgumentList &args) {
+  SoakOptions options;
+  auto number = [&](const char *option, double fallback) {
+    auto value = args.getValueForOption(option);
+    return value.isNotEmpty() ? value.getDoubleValue() : fallback;
+  };
+  options.session.num_clips = (int)number("--clips", 2000);
+  options.session.max_depth = (int)number("--depth", 8);
+  options.session.seed = (int64_t)number("--seed", 1);
+  options.minutes = number("--minutes", 60.0);
+  options.report_interval_s = number("--report", 10.0);
+  options.realtime = !args.containsOption("--fast");
+  options.query_threads = (int)number("--query-threads", 2);
+  options.query_rate = number("--query-rate", 50.0);
+  options.out = args.getValueForOption("--out");
+  return options;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  juce::ArgumentList args(argc, argv);
+  if (args.containsOption("--help|-h")) {
+    printUsage();
+    return 0;
+  }
+  const auto options = parseOptions(args);
+
+  SilentLogger silent_logger;
+  juce::Logger::setCurrentLogger(&silent_logger);
+
+  std::cout << "Building " << options.session.num_clips << " clips, depth "
+            << options.session.max_depth << "..." << std::endl;
+  const double build_start_ms = juce::Time::getMillisecondCounterHiRes();
+  auto session = celestrian::soak::buildSyntheticSession(options.session);
+  std::cout << "Built " << session.clip_ids.size() << " clips in "
+            << session.box_ids.size() << " boxes (deepest level "
+            << session.deepest_level << ") in "
+            << juce::String((juce::Time::getMillisecondCounterHiRes() -
+                             build_start_ms) / 1000.0, 1)
+            << " s" << std::endl;
+
+  AudioEngine engine;
+  auto &backend = static_cast<celestrian::OfflineDeviceBackend &>(
+      engine.getDeviceBackend());
+  backend.setInputSignal(celestrian::OfflineDeviceBackend::sine(
+      110.0, 0.3f, backend.getConfig().sample_rate));
+  engine.setRootNode(std::move(session.root));
+
+  // Full-size clips for the simulated user to record into
+  for (int i = 0; i < options.armed_clips; ++i) engine.createNode("clip");
+  juce::StringArray armed;
+  {
+    auto state = engine.getGraphState();
+    auto *nodes = state["nodes"].getArray();
+    for (int i = std::max(0, nodes->size() - options.armed_clips);
+         i < nodes->size(); ++i)
+      armed.add((*nodes)[i]["id"].toString());
+  }
+  engine.togglePlayback();
+
+  const auto start_stats = engine.getCallbackStats();
+  const int64_t start_rss = getResidentBytes();
+  const double start_session_bytes =
+      (double)engine.getMemoryUsage()["totalBytes"];
+  std::cout << "Session memory " << toMegabytes((int64_t)start_session_bytes)
+            << " MB, process RSS " << toMegabytes(start_rss) << " MB"
+            << std::endl;
+
+  LatencyLog latencies;
+  Mutations mutations(engine, session.clip_ids, armed, latencies);
+  AudioThread audio_thread(backend, mutations, options.realtime);
+  juce::OwnedArray<QueryThread> query_threads;
+  for (int i = 0; i < options.query_threads; ++i)
+    query_threads.add(new QueryThread(i, engine, session.clip_ids,
+                                      options.query_rate, latencies));
+
+  audio_thread.startThread(juce::Thread::Priority::highest);
+  for (auto *thread : query_threads) thread->startThread();
+
+  const double run_start_ms = juce::Time::getMillisecondCounterHiRes();
+  const double run_ms = options.minutes * 60000.0;
+  double last_overruns = (double)start_stats["overruns"];
+  double last_near_misses = (double)start_stats["nearMisses"];
+  int64_t peak_rss = start_rss;
+
+  while (juce::Time::getMillisecondCounterHiRes() - run_start_ms < run_ms) {
+    juce::Thread::sleep((int)(options.report_interval_s * 1000.0));
+
+    auto stats = engine.getCallbackStats();
+    const int64_t rss = getResidentBytes();
+    peak_rss = std::max(peak_rss, rss);
+    auto interval = latencies.closeInterval();
+
+    juce::String line;
+    line << "[" << juce::String((juce::Time::getMillisecondCounterHiRes() -
+                                 run_start_ms) / 60000.0, 1)
+         << " min] blocks " << (int64_t)(double)stats["blocks"]
+         << ", overruns +"
+         << (int64_t)((double)stats["overruns"] - last_overruns)
+         << ", near misses +"
+         << (int64_t)((double)stats["nearMisses"] - last_near_misses)
+         << ", max load " << juce::String((double)stats["maxLoad"] * 100.0, 0)
+         << "%, RSS " << juce::String(toMegabytes(rss), 0) << " MB ("
+         << (rss >= start_rss ? "+" : "")
+         << juce::String(toMegabytes(rss - start_rss), 1) << ")";
+    for (const auto &[operation, p] : interval)
+      line << "\n    " << operation << ": p50 " << juce::String(p.p50_ms, 2)
+           << " ms, p99 " << juce::String(p.p99_ms, 2) << " ms, max "
+           << juce::String(p.max_ms, 2) << " ms (" << p.count << ")";
+    std::cout << line << std::endl;
+
+    last_overruns = (double)stats["overruns"];
+    last_near_misses = (double)stats["nearMisses"];
+  }
+
+  for (auto *thread : query_threads) thread->signalThreadShouldExit();
+  audio_thread.signalThreadShouldExit();
+  for (auto *thread : query_threads) thread->stopThread(5000);
+  audio_thread.stopThread(5000);
+  latencies.closeInterval();
+
+  auto stats = engine.getCallbackStats();
+  const int64_t end_rss = getResidentBytes();
+  const double end_session_bytes =
+      (double)engine.getMemoryUsage()["totalBytes"];
+
+  auto *report = new juce::DynamicObject();
+  report->setProperty("clips", session.clip_ids.size());
+  report->setProperty("boxes", session.box_ids.size());
+  report->setProperty("deepestLevel", session.deepest_level);
+  report->setProperty("minutes", options.minutes);
+  report->setProperty("realtime", options.realtime);
+  report->setProperty("callbacks", stats);
+  report->setProperty("startRssBytes", (double)start_rss);
+  report->setProperty("endRssBytes", (double)end_rss);
+  report->setProperty("peakRssBytes", (double)peak_rss);
+  report->setProperty("startSessionBytes", start_session_bytes);
+  report->setProperty("endSessionBytes", end_session_bytes);
+  report->setProperty("latencies", toVar(latencies.getTotals()));
+  juce::var report_var(report);
+
+  std::cout << "\nDone: " << (int64_t)(double)stats["blocks"] << " blocks, "
+            << (int64_t)(double)stats["overruns"] << " overruns, "
+            << (int64_t)(double)stats["nearMisses"] << " near misses; RSS "
+            << juce::String(toMegabytes(start_rss), 0) << " -> "
+            << juce::String(toMegabytes(end_rss), 0) << " MB (peak "
+            << juce::String(toMegabytes(peak_rss), 0) << ")" << std::endl;
+
+  juce::Logger::setCurrentLogger(nullptr);
+
+  if (options.out.isNotEmpty()) {
+    auto file =
+        juce::File::getCurrentWorkingDirectory().getChildFile(options.out);
+    file.replaceWithText(juce::JSON::toString(report_var));
+    std::cout << "Report written to " << file.getFullPathName() << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include "synthetic_session.h"
+
+#include <cmath>
+#include <vector>
+
+#include "../../src/clip_node.h"
+
+namespace celestrian::soak {
+
+namespace {
+constexpr int kRecordBlockSize = 512;
+
+int64_t pickDuration(juce::Random &random, int64_t quantum) {
+  // Mostly whole quanta; one clip in ten is a subdivision
+  if (random.nextInt(10) == 0)
+    return random.nextBool() ? quantum / 2 : quantum / 4;
+  return quantum * (1 + random.nextInt(8));
+}
+
+/**
+ * Records `duration` samples of generated audio into a parentless clip,
+ * which commits immediately on stop (no quantum yet).
+ */
+std::unique_ptr<ClipNode> makeClip(juce::Random &random, int index,
+                                   int64_t duration) {
+  // ClipNode holds source_sample_rate * 60 samples: size it to the clip
+  auto clip = std::make_unique<ClipNode>(
+      "Synthetic " + juce::String(index),
+      std::ceil((double)duration / 60.0) + 1.0);
+
+  const double partial_1 = 0.002 + 0.05 * random.nextDouble();
+  const double partial_2 = partial_1 * (1.5 + random.nextDouble());
+  const float level = 0.1f + 0.4f * random.nextFloat();
+  const float noise = 0.05f * random.nextFloat();
+
+  std::vector<float> input(kRecordBlockSize);
+  const float *inputs[] = {input.data()};
+  ProcessContext context;
+  context.is_recording = true;
+
+  clip->startRecording();
+  for (int64_t done = 0; done < duration;) {
+    int n = (int)std::min<int64_t>(kRecordBlockSize, duration - done);
+    for (int i = 0; i < n; ++i) {
+      double t = (double)(done + i);
+      input[i] = level * (float)(0.7 * std::sin(partial_1 * t) +
+                                 0.3 * std::sin(partial_2 * t)) +
+                 noise * (random.nextFloat() * 2.0f - 1.0f);
+    }
+    context.num_samples = n;
+    context.master_pos = done;
+    clip->process(inputs, nullptr, 1, 0, context);
+    done += n;
+  }
+  clip->stopRecording();
+  return clip;
+}
+}  // namespace
+
+SyntheticSession buildSyntheticSession(const SyntheticSessionOptions &options) {
+  juce::Random random(options.seed);
+  SyntheticSession session;
+  session.root = std::make_unique<BoxNode>("Synthetic Session");
+
+  struct Slot {
+    BoxNode *box;
+    int depth;
+  };
+  std::vector<Slot> boxes;
+  std::vector<Slot> open_boxes;  // Boxes that may still take sub-boxes
+
+  auto addBox = [&](Slot parent) {
+    auto box = std::make_unique<BoxNode>("Box " +
+                                         juce::String(session.box_ids.size()));
+    box->y_pos = parent.box->getNumChildren() * 120.0;
+    Slot slot{box.get(), parent.depth + 1};
+    session.box_ids.add(box->getUuid());
+    parent.box->addChild(std::move(box));
+    boxes.push_back(slot);
+    if (slot.depth < options.max_depth) open_boxes.push_back(slot);
+    session.deepest_level = std::max(session.deepest_level, slot.depth);
+    return slot;
+  };
+
+  // One chain reaches max_depth; the remaining boxes hang off random boxes
+  Slot root_slot{session.root.get(), 0};
+  open_boxes.push_back(root_slot);
+  Slot chain = root_slot;
+  for (int level = 0; level < options.max_depth; ++level)
+    chain = addBox(chain);
+
+  const int num_boxes =
+      std::max(options.max_depth,
+               options.num_clips / std::max(1, options.clips_per_box));
+  while ((int)boxes.size() < num_boxes)
+    addBox(open_boxes[(size_t)random.nextInt((int)open_boxes.size())]);
+
+  for (int i = 0; i < options.num_clips; ++i) {
+    const auto duration = pickDuration(random, options.quantum);
+    auto clip = makeClip(random, i, duration);
+    session.clip_ids.add(clip->getUuid());
+    session.audio_samples += duration;
+
+    BoxNode *parent =
+        random.nextDouble() < options.root_clip_fraction || boxes.empty()
+            ? session.root.get()
+            : boxes[(size_t)random.nextInt((int)boxes.size())].box;
+    clip->y_pos = parent->getNumChildren() * 120.0;
+    parent->addChild(std::move(clip));
+  }
+
+  return session;
+}
+
+}  // namespace celestrian::soak
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <memory>
+
+#include "../../src/box_node.h"
+
+namespace celestrian::soak {
+
+struct SyntheticSessionOptions {
+  int num_clips = 2000;
+  int max_depth = 8;      // Boxes nested below the root, at most
+  int clips_per_box = 8;  // Average; sets the number of boxes
+  // Base loop length. Clips last 1..8 quanta, a few Q/2 or Q/4, so the LCM
+  // timeline wraps only after 840 quanta.
+  int64_t quantum = 11025;
+  // Share of clips placed directly in the root, where the engine computes
+  // the LCM timeline every block
+  double root_clip_fraction = 0.1;
+  int64_t seed = 1;
+};
+
+struct SyntheticSession {
+  std::unique_ptr<BoxNode> root;
+  juce::StringArray clip_ids;
+  juce::StringArray box_ids;
+  int deepest_level = 0;
+  int64_t audio_samples = 0;  // Total recorded samples across clips
+};
+
+/**
+ * Builds a session of committed clips holding generated audio (a random
+ * mix of sine partials and noise), nested in boxes up to `max_depth`
+ * levels. Each clip's buffer is sized to its duration, so thousands fit in
+ * memory. Deterministic for a given seed.
+ */
+SyntheticSession buildSyntheticSession(const SyntheticSessionOptions &options);
+
+}  // namespace celestrian::soak
@@ -1,7 +1,8 @@
-import { callNative, log } from './bridge.js';
+import { callNative, callNativeBatch, log } from './bridge.js';
 import { drawWaveform } from './canvas_renderer.js';
 import { Viewport } from './viewport.js';
 import { groupNodesByVisualX, calculateButtonPosition } from './stack_logic.js';
+import { TransportClock } from './transport_clock.js';
 
 const nodeLayer = document.getElementById('node-layer');
 const creationUI = document.getElementById('creation-ui');
@@ -9,6 +10,9 @@ const creationMenu = document.getElementById('creation-menu');
 const playBtn = document.getElementById('play-btn');
 
 const livePeaks = new Map();
+const pendingWaveforms = new Map(); // id -> requested peak count
+const VISUAL_OFFSET = 120; // Shift for UI rendering
+const transportClock = new TransportClock();
 let viewport;
 let availableInputs = [];
 // Global API Hooks (Moved to top for reliable early initialization)
@@ -139,24 +143,105 @@ async function fetchInputs() {
     }
 }
 
+// The UI draws the focused box and one level of children; deeper boxes only
+// need their summaries, and off-screen children need nothing at all.
+const GRAPH_QUERY_DEPTH = 1;
+
+function buildGraphQuery() {
+    const query = { depth: GRAPH_QUERY_DEPTH };
+    if (viewport) query.visibleRect = viewport.getVisibleRect(VISUAL_OFFSET);
+    return query;
+}
+
+// One bridge round trip per frame: the graph state plus any waveforms
+// requested by the previous syncUI pass.
+async function pollFrame() {
+    const waveformIds = Array.from(pendingWaveforms.keys());
+    const operations = [{ name: 'getGraphState', args: [buildGraphQuery()] }];
+    waveformIds.forEach(id => {
+        operations.push({ name: 'getWaveform', args: [id, pendingWaveforms.get(id)] });
+    });
+    pendingWaveforms.clear();
+
+    const requestMs = performance.now();
+    const results = await callNativeBatch(operations);
+    if (!results) return null;
+
+    const [state, ...waveforms] = results;
+    waveforms.forEach((peaks, i) => {
+        if (peaks && peaks.length > 0) {
+            livePeaks.set(waveformIds[i], peaks);
+            log(`Fetched ${peaks.length} peaks for ${waveformIds[i]}`);
+        }
+    });
+    if (state) {
+        transportClock.update(state.transport, requestMs, performance.now());
+        syncUI(state);
+    }
+    return state;
+}
+
+// Playheads are extrapolated locally (see animatePlayheads), so the graph only
+// needs fast polling while something is growing: a recording or a waveform
+// fetch still in flight.
+const POLL_INTERVAL_ACTIVE_MS = 50;
+const POLL_INTERVAL_IDLE_MS = 250;
+
+function nextPollInterval(state) {
+    const nodes = (state && state.nodes) || [];
+    const isRecording = nodes.some(n => n.isRecording);
+    return isRecording || pendingWaveforms.size > 0
+        ? POLL_INTERVAL_ACTIVE_MS
+        : POLL_INTERVAL_IDLE_MS;
+}
+
 async function startPolling() {
     console.log("Starting state polling loop...");
+    requestAnimationFrame(animatePlayheads);
     while (true) {
+        let state = null;
         try {
-            const state = await callNative('getGraphState');
-            if (state) syncUI(state);
+            state = await pollFrame();
         } catch (err) {
             console.error("Polling error:", err);
         }
-        await new Promise(r => setTimeout(r, 50));
+        await new Promise(r => setTimeout(r, nextPollInterval(state)));
     }
 }
 
+// Moves every playhead to its interpolated position once per display frame.
+function animatePlayheads(nowMs) {
+    for (const div of nodeLayer.children) {
+        const node = div._latestNode;
+        if (!node) continue;
+        const playhead = div.querySelector('.playhead');
+        if (playhead) playhead.style.left = `${transportClock.clipPhase(node, nowMs) * 100}%`;
+    }
+    nodeLayer.querySelectorAll('.ghost-clip > .playhead').forEach(playhead => {
+        const node = playhead._latestNode;
+        if (node) playhead.style.left = `${transportClock.clipPhase(node, nowMs) * 100}%`;
+    });
+    requestAnimationFrame(animatePlayheads);
+}
+
+// Last memory status reported by the engine, so each change is logged once
+let lastMemoryStatus = 'ok';
+
+function reportMemoryStatus(memory) {
+    if (!memory || memory.status === lastMemoryStatus) return;
+    lastMemoryStatus = memory.status;
+    if (memory.status === 'ok') return;
+    const toMb = bytes => (bytes / (1024 * 1024)).toFixed(0);
+    log(`Session memory ${memory.status === 'overBudget' ? 'over' : 'near'} budget: ` +
+        `${toMb(memory.totalBytes)} / ${toMb(memory.budgetBytes)} MB`);
+}
+
 function syncUI(state) {
     // Playback state
     const isPlaying = state.isPlaying;
     playBtn.classList.toggle('playing', isPlaying);
     playBtn.innerText = isPlaying ? "STOP" : "PLAY";
+    reportMemoryStatus(state.memory);
 
     const nodes = state.nodes || [];
     const newNodeIds = nodes.map(n => n.id);
@@ -177,8 +262,7 @@ function syncUI(state) {
     let maxX = -Infinity;
 
     // UI = Data: C++ sets x_pos based on anchor_phase
-    // JS displays node.x directly with no transformation
-    const VISUAL_OFFSET = 120; // Shift for UI rendering
+    // JS displays node.x directly with no transformation (see VISUAL_OFFSET)
 
     nodes.forEach(node => {
         let div = document.getElementById(node.id);
@@ -260,8 +344,8 @@ function syncUI(state) {
 
         div._latestNode = node; // Store latest state for drag handlers
 
+        // Position is interpolated per frame by animatePlayheads
         const playhead = div.querySelector('.playhead');
-        playhead.style.left = `${node.playhead * 100}%`;
         // Ensure visible by default (ghost logic may hide it later)
         playhead.style.display = node.isPlaying ? 'block' : 'none';
 
@@ -566,7 +650,7 @@ function syncUI(state) {
                 // Ghost Playhead - only show in the ghost aligned with longer loop position
                 const ghostPlayhead = document.createElement('div');
                 ghostPlayhead.className = 'playhead';
-                ghostPlayhead.style.left = `${node.playhead * 100}%`;
+                ghostPlayhead._latestNode = node; // Position set by animatePlayheads
                 ghostPlayhead.style.opacity = '0.4';  // Faded compared to main
 
                 // Determine global playhead position in pixels
@@ -890,25 +974,15 @@ export async function renameNode(id, name) {
     log(`Renamed node to ${name}`);
 }
 
-export async function fetchWaveform(id) {
-    if (window.isFetchingWaveform === id) return;
-    window.isFetchingWaveform = id;
-
-    try {
-        log(`Fetching static waveform for ${id}...`);
-        // Fix Waveform Drift: Request peaks based on actual pixel width to maintain 1:1 resolution
-        // and prevent "stretching" artifacts as the clip grows.
-        const width = parseFloat(div.querySelector('.node-content').style.width) || 200;
-        const peaks = await callNative('getWaveform', id, Math.ceil(width));
-        if (peaks && peaks.length > 0) {
-            livePeaks.set(id, peaks);
-            log(`Fetched ${peaks.length} peaks for ${id}`);
-        }
-    } catch (err) {
-        console.error("Waveform fetch failed:", err);
-    } finally {
-        window.isFetchingWaveform = null;
-    }
+// Queues a static waveform fetch; it rides along with the next poll batch.
+export function fetchWaveform(id) {
+    if (pendingWaveforms.has(id)) return;
+    // Fix Waveform Drift: Request peaks based on actual pixel width to maintain 1:1 resolution
+    // and prevent "stretching" artifacts as the clip grows.
+    const div = document.getElementById(id);
+    const content = div ? div.querySelector('.node-content') : null;
+    const width = (content && parseFloat(content.style.width)) || 200;
+    pendingWaveforms.set(id, Math.ceil(width));
 }
 
 try {
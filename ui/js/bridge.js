@@ -51,6 +51,16 @@ export async function callNative(name, ...args) {
     return null;
 }
 
+/**
+ * Runs several native calls in one bridge round trip.
+ * @param {Array<{name: string, args: Array}>} operations Executed in order.
+ * @returns {Promise<Array|null>} Results in the same order, or null on failure.
+ */
+export async function callNativeBatch(operations) {
+    const results = await callNative('batch', operations);
+    return Array.isArray(results) ? results : null;
+}
+
 export function initBridge(onReady) {
     const b = window.__JUCE__;
     if (b && b.backend && !window.bridgeInited) {
@@ -0,0 +1,91 @@
+import test from 'node:test';
+import assert from 'node:assert/strict';
+import {
+    TransportClock,
+    extrapolatePosition,
+    clipPhaseAt,
+    wrapPosition,
+    MAX_EXTRAPOLATION_MS
+} from '../transport_clock.js';
+
+const SR = 48000;
+
+function makeAnchor(overrides = {}) {
+    return {
+        masterPos: 0,
+        timelineLength: 0,
+        sampleRate: SR,
+        hostTimeNs: 0,
+        anchorTimeNs: 5e9,
+        outputLatency: 0,
+        isPlaying: true,
+        nowNs: 5e9,
+        ...overrides
+    };
+}
+
+test('Transport Clock - Extrapolation', async (t) => {
+    await t.test('should advance by elapsed wall-clock time', () => {
+        const anchor = makeAnchor({ masterPos: 1000 });
+        assert.equal(extrapolatePosition(anchor, 0), 1000);
+        assert.equal(extrapolatePosition(anchor, 500), 1000 + SR / 2);
+    });
+
+    await t.test('should subtract output latency', () => {
+        const anchor = makeAnchor({ masterPos: 10000, outputLatency: 256 });
+        assert.equal(extrapolatePosition(anchor, 0), 10000 - 256);
+    });
+
+    await t.test('should wrap at the timeline length', () => {
+        const anchor = makeAnchor({ masterPos: SR - 100, timelineLength: SR });
+        assert.equal(extrapolatePosition(anchor, 10), (SR - 100 + SR / 100) - SR);
+    });
+
+    await t.test('should hold position when stopped', () => {
+        const anchor = makeAnchor({ masterPos: 777, isPlaying: false, outputLatency: 64 });
+        assert.equal(extrapolatePosition(anchor, 1000), 777);
+    });
+
+    await t.test('should not run away if anchors stop arriving', () => {
+        const anchor = makeAnchor();
+        assert.equal(extrapolatePosition(anchor, 60000),
+            extrapolatePosition(anchor, MAX_EXTRAPOLATION_MS));
+    });
+});
+
+test('Transport Clock - Clip Phase', async (t) => {
+    await t.test('should mirror ClipNode launch point math', () => {
+        // Recorded at 2Q into an 8Q loop: launch = 6Q
+        const Q = 44100;
+        const node = { loopStart: 0, loopEnd: 8 * Q, launchPoint: 6 * Q };
+        assert.equal(clipPhaseAt(node, 2 * Q), 0);
+        assert.equal(clipPhaseAt(node, 0), 0.75);
+    });
+
+    await t.test('should return null for an empty loop', () => {
+        assert.equal(clipPhaseAt({ loopStart: 0, loopEnd: 0 }, 100), null);
+    });
+
+    await t.test('wrapPosition handles negative positions', () => {
+        assert.equal(wrapPosition(-10, 100), 90);
+        assert.equal(wrapPosition(-10, 0), -10);
+    });
+});
+
+test('Transport Clock - Clock Mapping', async (t) => {
+    await t.test('should map native time onto local time via the round trip midpoint', () => {
+        const clock = new TransportClock();
+        // Native clock is 4000ms ahead of the local clock; the anchor block
+        // started 10ms before the native "now" sample.
+        const anchor = makeAnchor({ masterPos: 0, anchorTimeNs: 5.0e9, nowNs: 5.01e9 });
+        clock.update(anchor, 1008, 1012); // midpoint 1010 local == 5010 native
+        assert.equal(Math.round(clock.positionAt(1010)), SR / 100);
+        assert.equal(Math.round(clock.positionAt(1020)), SR / 50);
+    });
+
+    await t.test('should fall back to the polled playhead without an anchor', () => {
+        const clock = new TransportClock();
+        assert.equal(clock.positionAt(0), null);
+        assert.equal(clock.clipPhase({ playhead: 0.3, loopStart: 0, loopEnd: 100 }, 0), 0.3);
+    });
+});
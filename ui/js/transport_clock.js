@@ -0,0 +1,87 @@
+/**
+ * Local playhead extrapolation from the engine's transport anchors.
+ *
+ * The engine publishes, once per audio block, the master position at the
+ * start of the block and when that block started (native clock, ns). Between
+ * polls we advance that anchor by wall-clock time, so playheads move smoothly
+ * at display rate without a bridge call per frame.
+ */
+
+// Never extrapolate further than this past the last anchor: if the audio
+// thread stalls, the playhead should stall too rather than run away.
+export const MAX_EXTRAPOLATION_MS = 1000;
+
+/**
+ * Wraps `pos` into [0, length). Returns `pos` unchanged if length <= 0.
+ */
+export function wrapPosition(pos, length) {
+    if (!(length > 0)) return pos;
+    return ((pos % length) + length) % length;
+}
+
+/**
+ * Returns the audible master position (samples) `elapsedMs` after the anchor.
+ * Output latency is subtracted so the playhead matches what is heard.
+ *
+ * @param {Object} anchor Transport anchor as sent by getTransportClock
+ * @param {number} elapsedMs Time since the anchored block started
+ */
+export function extrapolatePosition(anchor, elapsedMs) {
+    if (!anchor) return 0;
+    if (!anchor.isPlaying) return anchor.masterPos;
+
+    const elapsed = Math.min(Math.max(elapsedMs, 0), MAX_EXTRAPOLATION_MS);
+    const advanced = anchor.masterPos + (elapsed / 1000) * anchor.sampleRate;
+    return wrapPosition(advanced - (anchor.outputLatency || 0), anchor.timelineLength);
+}
+
+/**
+ * Playhead of a clip (0..1) at a given master position, mirroring
+ * ClipNode::process: (master + launchPoint) % (loopEnd - loopStart).
+ * Returns null if the clip has no loop to play.
+ */
+export function clipPhaseAt(node, masterPos) {
+    const dur = (node.loopEnd || 0) - (node.loopStart || 0);
+    if (!(dur > 0)) return null;
+    return wrapPosition(masterPos + (node.launchPoint || 0), dur) / dur;
+}
+
+export class TransportClock {
+    constructor() {
+        this.anchor = null;
+        // Native clock (ms) minus local clock (ms)
+        this.offsetMs = 0;
+    }
+
+    /**
+     * Adopts a new anchor. `requestMs`/`responseMs` bracket the bridge call
+     * (local clock) so the native clock can be mapped onto ours; the
+     * midpoint of the round trip is taken as the moment `nowNs` was sampled.
+     */
+    update(anchor, requestMs, responseMs) {
+        if (!anchor || !(anchor.sampleRate > 0)) return;
+        this.anchor = anchor;
+        this.offsetMs = anchor.nowNs / 1e6 - (requestMs + responseMs) / 2;
+    }
+
+    /**
+     * Audible master position at local time `nowMs`, or null before the
+     * first anchor arrives.
+     */
+    positionAt(nowMs) {
+        if (!this.anchor) return null;
+        const elapsedMs = nowMs + this.offsetMs - this.anchor.anchorTimeNs / 1e6;
+        return extrapolatePosition(this.anchor, elapsedMs);
+    }
+
+    /**
+     * Interpolated playhead (0..1) for a clip at local time `nowMs`. Falls back
+     * to the last polled `node.playhead` until an anchor is available.
+     */
+    clipPhase(node, nowMs) {
+        const pos = this.positionAt(nowMs);
+        if (pos === null) return node.playhead || 0;
+        const phase = clipPhaseAt(node, pos);
+        return phase === null ? node.playhead || 0 : phase;
+    }
+}
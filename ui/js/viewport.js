@@ -52,6 +52,22 @@ export class Viewport {
         this.updateTransform();
     }
 
+    /**
+     * Returns the visible area in node-layer coordinates, padded by `margin`
+     * (a fraction of the screen) on every side so nodes load before they
+     * scroll into view.
+     */
+    getVisibleRect(offsetX = 0, margin = 0.5) {
+        const w = this.container.clientWidth / this.scale;
+        const h = this.container.clientHeight / this.scale;
+        return {
+            x: -this.posX / this.scale - offsetX - w * margin,
+            y: -this.posY / this.scale - h * margin,
+            w: w * (1 + 2 * margin),
+            h: h * (1 + 2 * margin)
+        };
+    }
+
     reset() {
         this.posX = 0;
         this.posY = 0;